@@ -14,9 +14,11 @@ DataLogThread::~DataLogThread() {
 }
 
 void DataLogThread::ReadMain() {
-  for (auto record : m_reader) {
+  // build the index in the same pass, so export can split the log into chunks
+  // without another scan
+  m_reader.BuildIndex([&](const wpi::log::DataLogRecord& record) {
     if (!m_active) {
-      break;
+      return false;
     }
     ++m_numRecords;
     if (record.IsStart()) {
@@ -26,8 +28,8 @@ void DataLogThread::ReadMain() {
         if (m_entries.find(data.entry) != m_entries.end()) {
           fmt::print("...DUPLICATE entry ID, overriding\n");
         }
-        m_entries[data.entry] = data;
-        m_entryNames.emplace(data.name, data);
+        m_entries[data.entry] = EntryData{data};
+        m_entryNames.emplace(data.name, EntryData{data});
         sigEntryAdded(data);
       } else {
         fmt::print("Start(INVALID)\n");
@@ -65,7 +67,8 @@ void DataLogThread::ReadMain() {
     } else if (record.IsControl()) {
       fmt::print("Unrecognized control record\n");
     }
-  }
+    return true;
+  });
 
   sigDone();
   m_done = true;
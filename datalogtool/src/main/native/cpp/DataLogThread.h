@@ -17,6 +17,22 @@
 #include <wpi/Signal.h>
 #include <wpi/mutex.h>
 
+// Owned copy of wpi::log::StartRecordData, as records within compressed
+// blocks are only valid during iteration.
+struct EntryData {
+  EntryData() = default;
+  explicit EntryData(const wpi::log::StartRecordData& data)
+      : entry{data.entry},
+        name{data.name},
+        type{data.type},
+        metadata{data.metadata} {}
+
+  int entry = 0;
+  std::string name;
+  std::string type;
+  std::string metadata;
+};
+
 class DataLogThread {
  public:
   explicit DataLogThread(wpi::log::DataLogReader reader)
@@ -33,7 +49,7 @@ class DataLogThread {
     return m_entryNames.size();
   }
 
-  // Passes wpi::log::StartRecordData to func
+  // Passes EntryData to func
   template <typename T>
   void ForEachEntryName(T&& func) {
     std::scoped_lock lock{m_mutex};
@@ -42,7 +58,7 @@ class DataLogThread {
     }
   }
 
-  wpi::log::StartRecordData GetEntry(std::string_view name) const {
+  EntryData GetEntry(std::string_view name) const {
     std::scoped_lock lock{m_mutex};
     auto it = m_entryNames.find(name);
     if (it == m_entryNames.end()) {
@@ -65,7 +81,7 @@ class DataLogThread {
   std::atomic_bool m_active{true};
   std::atomic_bool m_done{false};
   std::atomic<unsigned int> m_numRecords{0};
-  std::map<std::string, wpi::log::StartRecordData, std::less<>> m_entryNames;
-  wpi::DenseMap<int, wpi::log::StartRecordData> m_entries;
+  std::map<std::string, EntryData, std::less<>> m_entryNames;
+  wpi::DenseMap<int, EntryData> m_entries;
   std::thread m_thread;
 };
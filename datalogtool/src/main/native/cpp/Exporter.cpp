@@ -4,14 +4,18 @@
 
 #include "Exporter.h"
 
+#include <algorithm>
 #include <atomic>
 #include <ctime>
+#include <deque>
 #include <future>
 #include <map>
 #include <memory>
+#include <queue>
 #include <set>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <vector>
 
 #include <fmt/chrono.h>
@@ -33,6 +37,7 @@
 
 #include "App.h"
 #include "DataLogThread.h"
+#include "ParquetWriter.h"
 
 namespace {
 struct InputFile {
@@ -179,14 +184,14 @@ InputFile::~InputFile() {
 
 static std::unique_ptr<InputFile> LoadDataLog(std::string_view filename) {
   std::error_code ec;
-  auto buf = wpi::MemoryBuffer::GetFile(filename, ec);
+  // map rather than read so large logs don't need to fit in memory
+  wpi::log::DataLogReader reader{filename, ec};
   std::string fn{filename};
   if (ec) {
     return std::make_unique<InputFile>(
         fn, fmt::format("Could not open file: {}", ec.message()));
   }
 
-  wpi::log::DataLogReader reader{std::move(buf)};
   if (!reader.IsValid()) {
     return std::make_unique<InputFile>(fn, "Not a valid datalog file");
   }
@@ -528,6 +533,156 @@ static void ValueToCsv(wpi::raw_ostream& os, const Entry& entry,
   fmt::print(os, "<invalid>");
 }
 
+template <typename F>
+static void PrintCsvRow(wpi::raw_ostream& os, const Entry& entry, int style,
+                        int64_t timestamp, F&& printValue) {
+  if (style == 0) {
+    fmt::print(os, "{},\"", timestamp / 1000000.0);
+    PrintEscapedCsvString(os, entry.name);
+    os << '"' << ',';
+    printValue();
+    os << '\n';
+  } else if (style == 1 && entry.column != -1) {
+    fmt::print(os, "{},", timestamp / 1000000.0);
+    for (int i = 0; i < entry.column; ++i) {
+      os << ',';
+    }
+    printValue();
+    os << '\n';
+  }
+}
+
+// packed records contain multiple timestamped values; adds each one
+template <typename F>
+static bool PackedToCsv(wpi::raw_ostream& os, const Entry& entry,
+                        const wpi::log::DataLogRecord& record, F&& addValue) {
+  if (entry.type == "packed:double") {
+    std::vector<wpi::log::TimestampedValue<double>> val;
+    if (record.GetPackedDoubles(&val)) {
+      for (auto&& v : val) {
+        addValue(v.timestamp, [&] { fmt::print(os, "{}", v.value); });
+      }
+      return true;
+    }
+  } else if (entry.type == "packed:int64") {
+    std::vector<wpi::log::TimestampedValue<int64_t>> val;
+    if (record.GetPackedIntegers(&val)) {
+      for (auto&& v : val) {
+        addValue(v.timestamp, [&] { fmt::print(os, "{}", v.value); });
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+// amount of log data formatted by each export task
+static constexpr size_t kExportChunkSize = 4 * 1024 * 1024;
+
+// formatted values of a single entry within a chunk, in log order
+struct CsvColumn {
+  explicit CsvColumn(Entry* entry) : entry{entry} {}
+
+  Entry* entry;
+  std::vector<int64_t> timestamps;
+  std::vector<size_t> ends;  // end of each value within values
+  wpi::SmallVector<char, 0> values;
+};
+
+// decodes records in [begin, end) into per-entry columns; safe to call
+// concurrently for different ranges, as gEntries is not modified during export
+static std::vector<CsvColumn> DecodeCsvRange(
+    const wpi::log::DataLogReader& reader, wpi::log::DataLogIterator begin,
+    wpi::log::DataLogIterator end, int style) {
+  std::vector<CsvColumn> columns;
+  wpi::DenseMap<Entry*, size_t> columnNums;
+  wpi::DenseMap<int, Entry*> nameMap;
+  auto handleControl = [&](const wpi::log::DataLogRecord& record) {
+    if (record.IsStart()) {
+      wpi::log::StartRecordData data;
+      if (record.GetStartData(&data)) {
+        auto it = gEntries.find(data.name);
+        if (it != gEntries.end() && it->second->selected) {
+          nameMap[data.entry] = it->second.get();
+        }
+      }
+    } else if (record.IsFinish()) {
+      int entry;
+      if (record.GetFinishEntry(&entry)) {
+        nameMap.erase(entry);
+      }
+    }
+  };
+
+  // establish the entries active at the start of the range
+  for (auto&& record : reader.GetControlRecords(begin)) {
+    handleControl(record);
+  }
+
+  for (; begin != end; ++begin) {
+    auto& record = *begin;
+    if (record.IsControl()) {
+      handleControl(record);
+      continue;
+    }
+    auto entryIt = nameMap.find(record.GetEntry());
+    if (entryIt == nameMap.end()) {
+      continue;
+    }
+    Entry* entry = entryIt->second;
+    if (style == 1 && entry->column == -1) {
+      continue;
+    }
+
+    auto [columnIt, isNew] = columnNums.try_emplace(entry, columns.size());
+    if (isNew) {
+      columns.emplace_back(entry);
+    }
+    CsvColumn& column = columns[columnIt->second];
+    wpi::raw_svector_ostream os{column.values};
+    auto addValue = [&](int64_t timestamp, auto&& printValue) {
+      printValue();
+      column.timestamps.push_back(timestamp);
+      column.ends.push_back(column.values.size());
+    };
+
+    if (PackedToCsv(os, *entry, record, addValue)) {
+      continue;
+    }
+    addValue(record.GetTimestamp(), [&] { ValueToCsv(os, *entry, record); });
+  }
+  return columns;
+}
+
+// merges the columns of a chunk by timestamp, writing a row for each value;
+// the values of each column stay in log order
+static void WriteCsvColumns(wpi::raw_ostream& os,
+                            const std::vector<CsvColumn>& columns, int style) {
+  // next value of each column, earliest timestamp first
+  using Head = std::pair<int64_t, size_t>;
+  std::priority_queue<Head, std::vector<Head>, std::greater<>> heads;
+  std::vector<size_t> next(columns.size(), 0);
+  for (size_t i = 0; i < columns.size(); ++i) {
+    if (!columns[i].timestamps.empty()) {
+      heads.emplace(columns[i].timestamps.front(), i);
+    }
+  }
+  while (!heads.empty()) {
+    auto [timestamp, i] = heads.top();
+    heads.pop();
+    auto& column = columns[i];
+    size_t n = next[i]++;
+    size_t start = n == 0 ? 0 : column.ends[n - 1];
+    PrintCsvRow(os, *column.entry, style, timestamp, [&] {
+      os << std::string_view{column.values.data() + start,
+                             column.ends[n] - start};
+    });
+    if (next[i] < column.timestamps.size()) {
+      heads.emplace(column.timestamps[next[i]], i);
+    }
+  }
+}
+
 static void ExportCsvFile(InputFile& f, wpi::raw_ostream& os, int style) {
   // header
   if (style == 0) {
@@ -550,13 +705,140 @@ static void ExportCsvFile(InputFile& f, wpi::raw_ostream& os, int style) {
     os << '\n';
   }
 
+  // split the log into chunks and decode them into per-entry columns in
+  // parallel; the columns of each chunk are merged into rows as chunks
+  // complete, in order, with a bounded number in flight to limit memory use
+  const auto& reader = f.datalog->GetReader();
+  auto chunks = reader.Split(kExportChunkSize);
+  size_t maxPending = 2 * (std::max)(1u, std::thread::hardware_concurrency());
+  std::deque<std::future<std::vector<CsvColumn>>> pending;
+  size_t next = 0;
+  while (next < chunks.size() || !pending.empty()) {
+    while (next < chunks.size() && pending.size() < maxPending) {
+      auto begin = chunks[next];
+      auto end = (next + 1) < chunks.size() ? chunks[next + 1] : reader.end();
+      ++next;
+      pending.emplace_back(
+          std::async(std::launch::async, [&reader, begin, end, style] {
+            return DecodeCsvRange(reader, begin, end, style);
+          }));
+    }
+    WriteCsvColumns(os, pending.front().get(), style);
+    pending.pop_front();
+  }
+}
+
+// returns column index, or -1 if the type is not supported
+static int AddParquetColumn(ParquetWriter& writer, const Entry& entry) {
+  std::string_view type = entry.type;
+  bool list = wpi::ends_with(type, "[]");
+  if (list) {
+    type.remove_suffix(2);
+  }
+  if (type == "boolean") {
+    return writer.AddColumn(entry.name, ParquetWriter::Type::kBoolean, list);
+  } else if (type == "int64" || type == "packed:int64") {
+    return writer.AddColumn(entry.name, ParquetWriter::Type::kInt64, list);
+  } else if (type == "float") {
+    return writer.AddColumn(entry.name, ParquetWriter::Type::kFloat, list);
+  } else if (type == "double" || type == "packed:double") {
+    return writer.AddColumn(entry.name, ParquetWriter::Type::kDouble, list);
+  } else if (type == "string" || (type == "json" && !list)) {
+    return writer.AddColumn(entry.name, ParquetWriter::Type::kString, list);
+  }
+  return -1;
+}
+
+static void ValueToParquet(ParquetWriter& writer, const Entry& entry,
+                           const wpi::log::DataLogRecord& record) {
+  int64_t timestamp = record.GetTimestamp();
+  int column = entry.column;
+  if (entry.type == "double") {
+    double val;
+    if (record.GetDouble(&val)) {
+      writer.AppendDouble(timestamp, column, val);
+    }
+  } else if (entry.type == "int64") {
+    int64_t val;
+    if (record.GetInteger(&val)) {
+      writer.AppendInteger(timestamp, column, val);
+    }
+  } else if (entry.type == "string" || entry.type == "json") {
+    std::string_view val;
+    if (record.GetString(&val)) {
+      writer.AppendString(timestamp, column, val);
+    }
+  } else if (entry.type == "boolean") {
+    bool val;
+    if (record.GetBoolean(&val)) {
+      writer.AppendBoolean(timestamp, column, val);
+    }
+  } else if (entry.type == "float") {
+    float val;
+    if (record.GetFloat(&val)) {
+      writer.AppendFloat(timestamp, column, val);
+    }
+  } else if (entry.type == "boolean[]") {
+    std::vector<int> val;
+    if (record.GetBooleanArray(&val)) {
+      writer.AppendBooleanArray(timestamp, column, val);
+    }
+  } else if (entry.type == "double[]") {
+    std::vector<double> val;
+    if (record.GetDoubleArray(&val)) {
+      writer.AppendDoubleArray(timestamp, column, val);
+    }
+  } else if (entry.type == "float[]") {
+    std::vector<float> val;
+    if (record.GetFloatArray(&val)) {
+      writer.AppendFloatArray(timestamp, column, val);
+    }
+  } else if (entry.type == "int64[]") {
+    std::vector<int64_t> val;
+    if (record.GetIntegerArray(&val)) {
+      writer.AppendIntegerArray(timestamp, column, val);
+    }
+  } else if (entry.type == "string[]") {
+    std::vector<std::string_view> val;
+    if (record.GetStringArray(&val)) {
+      writer.AppendStringArray(timestamp, column, val);
+    }
+  } else if (entry.type == "packed:double") {
+    std::vector<wpi::log::TimestampedValue<double>> val;
+    if (record.GetPackedDoubles(&val)) {
+      for (auto&& v : val) {
+        writer.AppendDouble(v.timestamp, column, v.value);
+      }
+    }
+  } else if (entry.type == "packed:int64") {
+    std::vector<wpi::log::TimestampedValue<int64_t>> val;
+    if (record.GetPackedIntegers(&val)) {
+      for (auto&& v : val) {
+        writer.AppendInteger(v.timestamp, column, v.value);
+      }
+    }
+  }
+}
+
+// one row per value, with a timestamp column and one column per entry
+static void ExportParquetFile(InputFile& f, wpi::raw_ostream& os) {
+  ParquetWriter writer{os};
+  for (auto&& entry : gEntries) {
+    if (entry.second->selected &&
+        entry.second->inputFiles.find(&f) != entry.second->inputFiles.end()) {
+      entry.second->column = AddParquetColumn(writer, *entry.second);
+    } else {
+      entry.second->column = -1;
+    }
+  }
+
   wpi::DenseMap<int, Entry*> nameMap;
   for (auto&& record : f.datalog->GetReader()) {
     if (record.IsStart()) {
       wpi::log::StartRecordData data;
       if (record.GetStartData(&data)) {
         auto it = gEntries.find(data.name);
-        if (it != gEntries.end() && it->second->selected) {
+        if (it != gEntries.end() && it->second->column != -1) {
           nameMap[data.entry] = it->second.get();
         }
       }
@@ -567,37 +849,25 @@ static void ExportCsvFile(InputFile& f, wpi::raw_ostream& os, int style) {
       }
     } else if (!record.IsControl()) {
       auto entryIt = nameMap.find(record.GetEntry());
-      if (entryIt == nameMap.end()) {
-        continue;
-      }
-      Entry* entry = entryIt->second;
-
-      if (style == 0) {
-        fmt::print(os, "{},\"", record.GetTimestamp() / 1000000.0);
-        PrintEscapedCsvString(os, entry->name);
-        os << '"' << ',';
-        ValueToCsv(os, *entry, record);
-        os << '\n';
-      } else if (style == 1 && entry->column != -1) {
-        fmt::print(os, "{},", record.GetTimestamp() / 1000000.0);
-        for (int i = 0; i < entry->column; ++i) {
-          os << ',';
-        }
-        ValueToCsv(os, *entry, record);
-        os << '\n';
+      if (entryIt != nameMap.end()) {
+        ValueToParquet(writer, *entryIt->second, record);
       }
     }
   }
+  writer.Finish();
 }
 
-static void ExportCsv(std::string_view outputFolder, int style) {
+template <typename F>
+static void ExportFiles(std::string_view outputFolder,
+                        std::string_view extension, fs::OpenFlags flags,
+                        F&& exportFile) {
   fs::path outPath{outputFolder};
   for (auto&& f : gInputFiles) {
     if (f.second->datalog) {
       std::error_code ec;
       auto of = fs::OpenFileForWrite(
-          outPath / fs::path{f.first}.replace_extension("csv"), ec,
-          fs::CD_CreateNew, fs::OF_Text);
+          outPath / fs::path{f.first}.replace_extension(extension), ec,
+          fs::CD_CreateNew, flags);
       if (ec) {
         std::scoped_lock lock{gExportMutex};
         gExportErrors.emplace_back(
@@ -605,13 +875,24 @@ static void ExportCsv(std::string_view outputFolder, int style) {
         ++gExportCount;
         continue;
       }
-      wpi::raw_fd_ostream os{fs::FileToFd(of, ec, fs::OF_Text), true};
-      ExportCsvFile(*f.second, os, style);
+      wpi::raw_fd_ostream os{fs::FileToFd(of, ec, flags), true};
+      exportFile(*f.second, os);
     }
     ++gExportCount;
   }
 }
 
+static void ExportCsv(std::string_view outputFolder, int style) {
+  ExportFiles(outputFolder, "csv", fs::OF_Text,
+              [&](InputFile& f, wpi::raw_ostream& os) {
+                ExportCsvFile(f, os, style);
+              });
+}
+
+static void ExportParquet(std::string_view outputFolder) {
+  ExportFiles(outputFolder, "parquet", fs::OF_None, ExportParquetFile);
+}
+
 void DisplayOutput(glass::Storage& storage) {
   static std::string& outputFolder = storage.GetString("outputFolder");
   static std::unique_ptr<pfd::select_folder> outputFolderSelector;
@@ -632,13 +913,21 @@ void DisplayOutput(glass::Storage& storage) {
                  sizeof(options) / sizeof(const char*));
 
     static std::future<void> exporter;
-    if (!gInputFiles.empty() && !outputFolder.empty() &&
-        ImGui::Button("Export CSV") &&
-        (gExportCount == 0 ||
-         gExportCount == static_cast<int>(gInputFiles.size()))) {
-      gExportCount = 0;
-      gExportErrors.clear();
-      exporter = std::async(std::launch::async, ExportCsv, outputFolder, style);
+    if (!gInputFiles.empty() && !outputFolder.empty()) {
+      bool idle = gExportCount == 0 ||
+                  gExportCount == static_cast<int>(gInputFiles.size());
+      if (ImGui::Button("Export CSV") && idle) {
+        gExportCount = 0;
+        gExportErrors.clear();
+        exporter =
+            std::async(std::launch::async, ExportCsv, outputFolder, style);
+      }
+      ImGui::SameLine();
+      if (ImGui::Button("Export Parquet") && idle) {
+        gExportCount = 0;
+        gExportErrors.clear();
+        exporter = std::async(std::launch::async, ExportParquet, outputFolder);
+      }
     }
     if (exporter.valid()) {
       ImGui::SameLine();
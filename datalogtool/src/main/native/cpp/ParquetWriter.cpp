@@ -0,0 +1,597 @@
+// Copyright (c) FIRST and other WPILib contributors.
+// Open Source Software; you can modify and/or share it under the terms of
+// the WPILib BSD license file in the root directory of this project.
+
+#include "ParquetWriter.h"
+
+#include <algorithm>
+
+#include <wpi/Endian.h>
+#include <wpi/MathExtras.h>
+#include <wpi/raw_ostream.h>
+
+// See https://github.com/apache/parquet-format for the file format.  Only the
+// subset needed here is implemented: PLAIN and RLE_DICTIONARY value
+// encodings, RLE/bit-packed hybrid levels, v1 data pages, and no compression.
+
+namespace {
+
+// parquet.thrift enumerations
+enum PhysicalType {
+  kBooleanType = 0,
+  kInt64Type = 2,
+  kFloatType = 4,
+  kDoubleType = 5,
+  kByteArrayType = 6
+};
+enum Repetition { kRequired = 0, kOptional = 1, kRepeated = 2 };
+enum ConvertedType { kConvertedUtf8 = 0, kConvertedList = 3 };
+enum Encoding { kPlain = 0, kRle = 3, kRleDictionary = 8 };
+enum PageType { kDataPage = 0, kDictionaryPage = 2 };
+
+void WriteVarint(std::vector<uint8_t>* out, uint64_t val) {
+  while (val >= 0x80) {
+    out->push_back((val & 0x7f) | 0x80);
+    val >>= 7;
+  }
+  out->push_back(val);
+}
+
+void WriteLE32(std::vector<uint8_t>* out, uint32_t val) {
+  uint8_t buf[4];
+  wpi::support::endian::write32le(buf, val);
+  out->insert(out->end(), buf, buf + 4);
+}
+
+void WriteLE64(std::vector<uint8_t>* out, uint64_t val) {
+  uint8_t buf[8];
+  wpi::support::endian::write64le(buf, val);
+  out->insert(out->end(), buf, buf + 8);
+}
+
+void WriteByteArray(std::vector<uint8_t>* out, std::string_view str) {
+  WriteLE32(out, str.size());
+  out->insert(out->end(), str.begin(), str.end());
+}
+
+// number of bits needed to represent values in [0, maxValue]
+unsigned int BitWidth(uint32_t maxValue) {
+  return maxValue == 0 ? 0 : 32 - wpi::countLeadingZeros(maxValue);
+}
+
+// Encodes (value, count) runs using the RLE/bit-packed hybrid encoding.
+// Long runs are RLE encoded; everything else is bit-packed in groups of 8.
+void EncodeHybrid(const std::vector<std::pair<uint32_t, uint32_t>>& runs,
+                  unsigned int bitWidth, std::vector<uint8_t>* out) {
+  std::vector<uint32_t> literals;
+  auto flushLiterals = [&] {
+    // only the final group may be padded
+    while ((literals.size() % 8) != 0) {
+      literals.push_back(0);
+    }
+    for (size_t start = 0; start < literals.size(); start += 504) {
+      size_t count = (std::min)(literals.size() - start, size_t{504});
+      WriteVarint(out, ((count / 8) << 1) | 1);
+      size_t oldSize = out->size();
+      out->resize(oldSize + count * bitWidth / 8);
+      uint8_t* data = &(*out)[oldSize];
+      for (size_t i = 0; i < count; ++i) {
+        uint32_t val = literals[start + i];
+        for (unsigned int b = 0; b < bitWidth; ++b) {
+          if ((val >> b) & 1) {
+            size_t bit = i * bitWidth + b;
+            data[bit / 8] |= 1 << (bit % 8);
+          }
+        }
+      }
+    }
+    literals.clear();
+  };
+
+  for (auto [value, count] : runs) {
+    if (count < 8) {
+      literals.insert(literals.end(), count, value);
+      continue;
+    }
+    // complete any partial literal group with this run
+    while ((literals.size() % 8) != 0 && count > 0) {
+      literals.push_back(value);
+      --count;
+    }
+    flushLiterals();
+    if (count > 0) {
+      WriteVarint(out, count << 1);
+      for (unsigned int i = 0; i < bitWidth; i += 8) {
+        out->push_back((value >> i) & 0xff);
+      }
+    }
+  }
+  flushLiterals();
+}
+
+// Writer for the Thrift compact protocol, as used by Parquet metadata.
+class ThriftWriter {
+ public:
+  enum FieldType : uint8_t {
+    kI32 = 5,
+    kI64 = 6,
+    kBinary = 8,
+    kList = 9,
+    kStruct = 12
+  };
+
+  explicit ThriftWriter(std::vector<uint8_t>* out) : m_out{out} {
+    m_lastId.push_back(0);
+  }
+
+  void I32(int16_t id, int32_t val) {
+    Field(id, kI32);
+    WriteVarint(m_out, ZigZag(val));
+  }
+
+  void I64(int16_t id, int64_t val) {
+    Field(id, kI64);
+    WriteVarint(m_out, ZigZag(val));
+  }
+
+  void Binary(int16_t id, std::string_view val) {
+    Field(id, kBinary);
+    ElementBinary(val);
+  }
+
+  void StructBegin(int16_t id) {
+    Field(id, kStruct);
+    m_lastId.push_back(0);
+  }
+
+  void ListBegin(int16_t id, FieldType elemType, uint32_t size) {
+    Field(id, kList);
+    if (size < 15) {
+      m_out->push_back((size << 4) | elemType);
+    } else {
+      m_out->push_back(0xf0 | elemType);
+      WriteVarint(m_out, size);
+    }
+  }
+
+  void ElementStructBegin() { m_lastId.push_back(0); }
+
+  void ElementI32(int32_t val) { WriteVarint(m_out, ZigZag(val)); }
+
+  void ElementBinary(std::string_view val) {
+    WriteVarint(m_out, val.size());
+    m_out->insert(m_out->end(), val.begin(), val.end());
+  }
+
+  void StructEnd() {
+    m_out->push_back(0);
+    m_lastId.pop_back();
+  }
+
+ private:
+  static uint64_t ZigZag(int64_t val) {
+    return (static_cast<uint64_t>(val) << 1) ^ static_cast<uint64_t>(val >> 63);
+  }
+
+  void Field(int16_t id, FieldType type) {
+    int delta = id - m_lastId.back();
+    if (delta > 0 && delta <= 15) {
+      m_out->push_back((delta << 4) | type);
+    } else {
+      m_out->push_back(type);
+      WriteVarint(m_out, ZigZag(id));
+    }
+    m_lastId.back() = id;
+  }
+
+  std::vector<uint8_t>* m_out;
+  std::vector<int16_t> m_lastId;
+};
+
+PhysicalType GetPhysicalType(ParquetWriter::Type type) {
+  switch (type) {
+    case ParquetWriter::Type::kBoolean:
+      return kBooleanType;
+    case ParquetWriter::Type::kInt64:
+      return kInt64Type;
+    case ParquetWriter::Type::kFloat:
+      return kFloatType;
+    case ParquetWriter::Type::kDouble:
+      return kDoubleType;
+    default:
+      return kByteArrayType;
+  }
+}
+
+}  // namespace
+
+void ParquetWriter::Levels::Add(uint32_t level, uint32_t count) {
+  if (count == 0) {
+    return;
+  }
+  if (!m_runs.empty() && m_runs.back().first == level) {
+    m_runs.back().second += count;
+  } else {
+    m_runs.emplace_back(level, count);
+  }
+  m_count += count;
+}
+
+ParquetWriter::ParquetWriter(wpi::raw_ostream& os, size_t rowGroupSize,
+                             size_t pageSize)
+    : m_os{os}, m_rowGroupSize{rowGroupSize}, m_pageSize{pageSize} {
+  auto& ts = m_columns.emplace_back();
+  ts.name = "timestamp";
+  ts.type = Type::kInt64;
+  ts.list = false;
+  ts.required = true;
+
+  static const uint8_t magic[] = {'P', 'A', 'R', '1'};
+  Write(magic);
+}
+
+int ParquetWriter::AddColumn(std::string_view name, Type type, bool list) {
+  auto& col = m_columns.emplace_back();
+  col.name = name;
+  col.type = type;
+  col.list = list;
+  return m_columns.size() - 1;
+}
+
+ParquetWriter::Column& ParquetWriter::StartValue(int64_t timestamp,
+                                                 int column, size_t count) {
+  if (m_rows >= m_rowGroupSize) {
+    FlushRowGroup();
+  }
+  auto& ts = m_columns[0];
+  if (GetPageSize(ts) >= m_pageSize) {
+    FlushPage(ts);
+  }
+  WriteLE64(&ts.values, timestamp);
+
+  // pages end at row boundaries, so check before adding this row
+  auto& col = m_columns[column];
+  if (GetPageSize(col) >= m_pageSize) {
+    FlushPage(col);
+  }
+  // fill in nulls for any rows since the last value
+  col.defLevels.Add(0, m_rows - col.rows);
+  if (col.list) {
+    col.repLevels.Add(0, m_rows - col.rows);
+  }
+  if (!col.list) {
+    col.defLevels.Add(1, 1);
+  } else if (count == 0) {
+    // empty list
+    col.defLevels.Add(1, 1);
+    col.repLevels.Add(0, 1);
+  } else {
+    col.defLevels.Add(2, count);
+    col.repLevels.Add(0, 1);
+    col.repLevels.Add(1, count - 1);
+  }
+  ++m_rows;
+  ++m_totalRows;
+  col.rows = m_rows;
+  return col;
+}
+
+void ParquetWriter::AddElement(Column& col, bool value) {
+  if ((col.numBools % 8) == 0) {
+    col.values.push_back(0);
+  }
+  if (value) {
+    col.values.back() |= 1 << (col.numBools % 8);
+  }
+  ++col.numBools;
+}
+
+void ParquetWriter::AddElement(Column& col, int64_t value) {
+  WriteLE64(&col.values, value);
+}
+
+void ParquetWriter::AddElement(Column& col, float value) {
+  WriteLE32(&col.values, wpi::FloatToBits(value));
+}
+
+void ParquetWriter::AddElement(Column& col, double value) {
+  WriteLE64(&col.values, wpi::DoubleToBits(value));
+}
+
+void ParquetWriter::AddElement(Column& col, std::string_view value) {
+  auto [it, isNew] = col.dict.try_emplace(value, col.dict.size());
+  if (isNew) {
+    WriteByteArray(&col.dictValues, value);
+  }
+  col.indices.push_back(it->second);
+}
+
+void ParquetWriter::AppendBoolean(int64_t timestamp, int column, bool value) {
+  AddElement(StartValue(timestamp, column, 1), value);
+}
+
+void ParquetWriter::AppendInteger(int64_t timestamp, int column,
+                                  int64_t value) {
+  AddElement(StartValue(timestamp, column, 1), value);
+}
+
+void ParquetWriter::AppendFloat(int64_t timestamp, int column, float value) {
+  AddElement(StartValue(timestamp, column, 1), value);
+}
+
+void ParquetWriter::AppendDouble(int64_t timestamp, int column, double value) {
+  AddElement(StartValue(timestamp, column, 1), value);
+}
+
+void ParquetWriter::AppendString(int64_t timestamp, int column,
+                                 std::string_view value) {
+  AddElement(StartValue(timestamp, column, 1), value);
+}
+
+template <typename T>
+void ParquetWriter::AppendArray(int64_t timestamp, int column,
+                                wpi::span<const T> arr) {
+  auto& col = StartValue(timestamp, column, arr.size());
+  for (auto&& v : arr) {
+    AddElement(col, v);
+  }
+}
+
+void ParquetWriter::AppendBooleanArray(int64_t timestamp, int column,
+                                       wpi::span<const int> arr) {
+  auto& col = StartValue(timestamp, column, arr.size());
+  for (int v : arr) {
+    AddElement(col, v != 0);
+  }
+}
+
+void ParquetWriter::AppendIntegerArray(int64_t timestamp, int column,
+                                       wpi::span<const int64_t> arr) {
+  AppendArray(timestamp, column, arr);
+}
+
+void ParquetWriter::AppendFloatArray(int64_t timestamp, int column,
+                                     wpi::span<const float> arr) {
+  AppendArray(timestamp, column, arr);
+}
+
+void ParquetWriter::AppendDoubleArray(int64_t timestamp, int column,
+                                      wpi::span<const double> arr) {
+  AppendArray(timestamp, column, arr);
+}
+
+void ParquetWriter::AppendStringArray(int64_t timestamp, int column,
+                                      wpi::span<const std::string_view> arr) {
+  AppendArray(timestamp, column, arr);
+}
+
+void ParquetWriter::Finish() {
+  if (m_rows > 0) {
+    FlushRowGroup();
+  }
+  WriteFooter();
+}
+
+void ParquetWriter::FlushRowGroup() {
+  int64_t start = m_pos;
+  for (auto&& col : m_columns) {
+    if (!col.required) {
+      col.defLevels.Add(0, m_rows - col.rows);
+      if (col.list) {
+        col.repLevels.Add(0, m_rows - col.rows);
+      }
+    }
+    WriteColumnChunk(col);
+    col.rows = 0;
+    col.dict.clear();
+    col.dictValues.clear();
+  }
+  m_rowGroups.push_back({m_pos - start, static_cast<int64_t>(m_rows)});
+  m_rows = 0;
+}
+
+// estimated encoded size of the current page's levels and values
+size_t ParquetWriter::GetPageSize(const Column& col) const {
+  return (col.repLevels.GetRuns().size() + col.defLevels.GetRuns().size()) *
+             4 +
+         col.values.size() + col.indices.size() * 4;
+}
+
+void ParquetWriter::FlushPage(Column& col) {
+  std::vector<uint8_t> body;
+  auto writeLevels = [&](const Levels& levels, unsigned int bitWidth) {
+    // v1 data pages prefix each level block with its length
+    size_t lenPos = body.size();
+    body.resize(lenPos + 4);
+    EncodeHybrid(levels.GetRuns(), bitWidth, &body);
+    wpi::support::endian::write32le(&body[lenPos], body.size() - lenPos - 4);
+  };
+  if (col.list) {
+    writeLevels(col.repLevels, 1);
+  }
+  if (!col.required) {
+    writeLevels(col.defLevels, BitWidth(col.list ? 2 : 1));
+  }
+
+  // strings are always dictionary encoded (unless there are no values yet);
+  // each page encodes indices with the bit width of the dictionary so far
+  bool useDict = !col.dict.empty();
+  if (useDict) {
+    unsigned int bitWidth = (std::max)(BitWidth(col.dict.size() - 1), 1u);
+    body.push_back(bitWidth);
+    std::vector<std::pair<uint32_t, uint32_t>> runs;
+    for (uint32_t index : col.indices) {
+      if (!runs.empty() && runs.back().first == index) {
+        ++runs.back().second;
+      } else {
+        runs.emplace_back(index, 1);
+      }
+    }
+    EncodeHybrid(runs, bitWidth, &body);
+  } else {
+    body.insert(body.end(), col.values.begin(), col.values.end());
+  }
+
+  // the only required column is the INT64 timestamp column
+  int64_t numValues =
+      col.required ? col.values.size() / 8 : col.defLevels.GetCount();
+
+  ThriftWriter w{&col.pages};
+  w.I32(1, kDataPage);
+  w.I32(2, body.size());
+  w.I32(3, body.size());
+  w.StructBegin(5);  // data_page_header
+  w.I32(1, numValues);
+  w.I32(2, useDict ? kRleDictionary : kPlain);
+  w.I32(3, kRle);
+  w.I32(4, kRle);
+  w.StructEnd();
+  col.pages.push_back(0);  // end of PageHeader
+  col.pages.insert(col.pages.end(), body.begin(), body.end());
+  col.pageValues += numValues;
+
+  col.repLevels.Clear();
+  col.defLevels.Clear();
+  col.values.clear();
+  col.numBools = 0;
+  col.indices.clear();
+}
+
+void ParquetWriter::WriteColumnChunk(Column& col) {
+  bool pending =
+      col.required ? !col.values.empty() : col.defLevels.GetCount() > 0;
+  if (pending || col.pages.empty()) {
+    FlushPage(col);
+  }
+
+  ChunkInfo info;
+  info.offset = m_pos;
+  info.dictOffset = -1;
+  info.numValues = col.pageValues;
+
+  // the dictionary page must precede the data pages
+  if (!col.dict.empty()) {
+    info.dictOffset = m_pos;
+    std::vector<uint8_t> header;
+    ThriftWriter w{&header};
+    w.I32(1, kDictionaryPage);
+    w.I32(2, col.dictValues.size());
+    w.I32(3, col.dictValues.size());
+    w.StructBegin(7);  // dictionary_page_header
+    w.I32(1, col.dict.size());
+    w.I32(2, kPlain);
+    w.StructEnd();
+    header.push_back(0);  // end of PageHeader
+    Write(header);
+    Write(col.dictValues);
+  }
+
+  info.dataOffset = m_pos;
+  Write(col.pages);
+  col.pages.clear();
+  col.pageValues = 0;
+
+  info.size = m_pos - info.offset;
+  col.chunks.push_back(info);
+}
+
+void ParquetWriter::WriteFooter() {
+  std::vector<uint8_t> out;
+  ThriftWriter w{&out};
+  w.I32(1, 1);  // version
+
+  // schema: a root element followed by the columns in depth-first order
+  size_t numElements = 1;
+  for (auto&& col : m_columns) {
+    numElements += col.list ? 3 : 1;
+  }
+  w.ListBegin(2, ThriftWriter::kStruct, numElements);
+  w.ElementStructBegin();
+  w.Binary(4, "schema");
+  w.I32(5, m_columns.size());
+  w.StructEnd();
+  for (auto&& col : m_columns) {
+    auto type = GetPhysicalType(col.type);
+    if (col.list) {
+      // 3-level list structure
+      w.ElementStructBegin();
+      w.I32(3, kOptional);
+      w.Binary(4, col.name);
+      w.I32(5, 1);
+      w.I32(6, kConvertedList);
+      w.StructEnd();
+      w.ElementStructBegin();
+      w.I32(3, kRepeated);
+      w.Binary(4, "list");
+      w.I32(5, 1);
+      w.StructEnd();
+    }
+    w.ElementStructBegin();
+    w.I32(1, type);
+    w.I32(3, col.required || col.list ? kRequired : kOptional);
+    w.Binary(4, col.list ? "element" : col.name);
+    if (col.type == Type::kString) {
+      w.I32(6, kConvertedUtf8);
+    }
+    w.StructEnd();
+  }
+
+  w.I64(3, m_totalRows);
+
+  w.ListBegin(4, ThriftWriter::kStruct, m_rowGroups.size());
+  for (size_t i = 0; i < m_rowGroups.size(); ++i) {
+    w.ElementStructBegin();
+    w.ListBegin(1, ThriftWriter::kStruct, m_columns.size());
+    for (auto&& col : m_columns) {
+      auto& chunk = col.chunks[i];
+      w.ElementStructBegin();
+      w.I64(2, chunk.offset);
+      w.StructBegin(3);  // meta_data
+      w.I32(1, GetPhysicalType(col.type));
+      if (chunk.dictOffset >= 0) {
+        w.ListBegin(2, ThriftWriter::kI32, 3);
+        w.ElementI32(kPlain);
+        w.ElementI32(kRle);
+        w.ElementI32(kRleDictionary);
+      } else {
+        w.ListBegin(2, ThriftWriter::kI32, 2);
+        w.ElementI32(kPlain);
+        w.ElementI32(kRle);
+      }
+      if (col.list) {
+        w.ListBegin(3, ThriftWriter::kBinary, 3);
+        w.ElementBinary(col.name);
+        w.ElementBinary("list");
+        w.ElementBinary("element");
+      } else {
+        w.ListBegin(3, ThriftWriter::kBinary, 1);
+        w.ElementBinary(col.name);
+      }
+      w.I32(4, 0);  // uncompressed
+      w.I64(5, chunk.numValues);
+      w.I64(6, chunk.size);
+      w.I64(7, chunk.size);
+      w.I64(9, chunk.dataOffset);
+      if (chunk.dictOffset >= 0) {
+        w.I64(11, chunk.dictOffset);
+      }
+      w.StructEnd();  // meta_data
+      w.StructEnd();  // ColumnChunk
+    }
+    w.I64(2, m_rowGroups[i].size);
+    w.I64(3, m_rowGroups[i].numRows);
+    w.StructEnd();  // RowGroup
+  }
+
+  w.Binary(6, "datalogtool");
+  out.push_back(0);  // end of FileMetaData
+
+  WriteLE32(&out, out.size());
+  out.insert(out.end(), {'P', 'A', 'R', '1'});
+  Write(out);
+}
+
+void ParquetWriter::Write(wpi::span<const uint8_t> data) {
+  m_os << data;
+  m_pos += data.size();
+}
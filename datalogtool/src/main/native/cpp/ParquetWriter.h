@@ -0,0 +1,152 @@
+// Copyright (c) FIRST and other WPILib contributors.
+// Open Source Software; you can modify and/or share it under the terms of
+// the WPILib BSD license file in the root directory of this project.
+
+#pragma once
+
+#include <stdint.h>
+
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <wpi/StringMap.h>
+#include <wpi/span.h>
+
+namespace wpi {
+class raw_ostream;
+}  // namespace wpi
+
+/**
+ * Writes a Parquet file containing a table with an INT64 "timestamp" column
+ * followed by one nullable column per log entry.  Each Append call adds one
+ * row, with every column other than the appended one set to null.  Strings
+ * are dictionary encoded, arrays are stored as Parquet LISTs, and rows are
+ * grouped into row groups of a fixed number of rows.  Within each row group,
+ * a column's data is split into pages of approximately a fixed size.  Data is
+ * uncompressed.
+ */
+class ParquetWriter {
+ public:
+  enum class Type { kBoolean, kInt64, kFloat, kDouble, kString };
+
+  explicit ParquetWriter(wpi::raw_ostream& os, size_t rowGroupSize = 65536,
+                         size_t pageSize = 1024 * 1024);
+
+  ParquetWriter(const ParquetWriter&) = delete;
+  ParquetWriter& operator=(const ParquetWriter&) = delete;
+
+  /**
+   * Adds a column.  All columns must be added before the first row.
+   *
+   * @param name column name
+   * @param type element type
+   * @param list true if each value is an array of elements
+   * @return column index
+   */
+  int AddColumn(std::string_view name, Type type, bool list);
+
+  void AppendBoolean(int64_t timestamp, int column, bool value);
+  void AppendInteger(int64_t timestamp, int column, int64_t value);
+  void AppendFloat(int64_t timestamp, int column, float value);
+  void AppendDouble(int64_t timestamp, int column, double value);
+  void AppendString(int64_t timestamp, int column, std::string_view value);
+  void AppendBooleanArray(int64_t timestamp, int column,
+                          wpi::span<const int> arr);
+  void AppendIntegerArray(int64_t timestamp, int column,
+                          wpi::span<const int64_t> arr);
+  void AppendFloatArray(int64_t timestamp, int column,
+                        wpi::span<const float> arr);
+  void AppendDoubleArray(int64_t timestamp, int column,
+                         wpi::span<const double> arr);
+  void AppendStringArray(int64_t timestamp, int column,
+                         wpi::span<const std::string_view> arr);
+
+  /**
+   * Writes any buffered rows and the file footer.  Must be called exactly
+   * once, after all rows have been appended.
+   */
+  void Finish();
+
+ private:
+  // run-length list of repetition or definition levels
+  class Levels {
+   public:
+    void Add(uint32_t level, uint32_t count);
+    const std::vector<std::pair<uint32_t, uint32_t>>& GetRuns() const {
+      return m_runs;
+    }
+    uint32_t GetCount() const { return m_count; }
+    void Clear() {
+      m_runs.clear();
+      m_count = 0;
+    }
+
+   private:
+    std::vector<std::pair<uint32_t, uint32_t>> m_runs;  // (level, count)
+    uint32_t m_count = 0;
+  };
+
+  struct ChunkInfo {
+    int64_t offset;
+    int64_t dictOffset;  // -1 if no dictionary page
+    int64_t dataOffset;
+    int64_t size;
+    int64_t numValues;
+  };
+
+  struct Column {
+    std::string name;
+    Type type;
+    bool list;
+    bool required = false;  // only the timestamp column
+
+    // rows in the current row group with a value or null
+    size_t rows = 0;
+    // levels and values of the current page
+    Levels repLevels;
+    Levels defLevels;
+    // PLAIN-encoded values; for strings, dictionary indices are used instead
+    std::vector<uint8_t> values;
+    size_t numBools = 0;
+    wpi::StringMap<uint32_t> dict;
+    std::vector<uint8_t> dictValues;  // PLAIN-encoded dictionary
+    std::vector<uint32_t> indices;
+
+    // completed data pages (headers and bodies) of the current row group
+    std::vector<uint8_t> pages;
+    int64_t pageValues = 0;  // values in completed pages
+
+    std::vector<ChunkInfo> chunks;
+  };
+
+  struct RowGroupInfo {
+    int64_t size;
+    int64_t numRows;
+  };
+
+  Column& StartValue(int64_t timestamp, int column, size_t count);
+  void AddElement(Column& col, bool value);
+  void AddElement(Column& col, int64_t value);
+  void AddElement(Column& col, float value);
+  void AddElement(Column& col, double value);
+  void AddElement(Column& col, std::string_view value);
+  template <typename T>
+  void AppendArray(int64_t timestamp, int column, wpi::span<const T> arr);
+  void FlushRowGroup();
+  size_t GetPageSize(const Column& col) const;
+  void FlushPage(Column& col);
+  void WriteColumnChunk(Column& col);
+  void WriteFooter();
+  void Write(wpi::span<const uint8_t> data);
+
+  wpi::raw_ostream& m_os;
+  size_t m_rowGroupSize;
+  size_t m_pageSize;
+  int64_t m_pos = 0;
+  size_t m_rows = 0;  // rows in current row group
+  int64_t m_totalRows = 0;
+  std::vector<Column> m_columns;
+  std::vector<RowGroupInfo> m_rowGroups;
+};
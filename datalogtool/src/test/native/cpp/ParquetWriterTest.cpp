@@ -0,0 +1,88 @@
+// Copyright (c) FIRST and other WPILib contributors.
+// Open Source Software; you can modify and/or share it under the terms of
+// the WPILib BSD license file in the root directory of this project.
+
+#include "ParquetWriter.h"  // NOLINT(build/include_order)
+
+#include <stdint.h>
+
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include <wpi/raw_ostream.h>
+
+#include "gtest/gtest.h"
+
+// Expected output was verified to read back as
+// [{timestamp: 1, i: 5, s: null}, {timestamp: 2, i: null, s: "x"},
+//  {timestamp: 3, i: 6, s: null}] with Apache Arrow.  The small page size
+// splits the timestamp column into two data pages, and the string column is
+// written as a dictionary page followed by a dictionary-encoded data page.
+static const uint8_t kExpected[] = {
+      0x50, 0x41, 0x52, 0x31, 0x15, 0x00, 0x15, 0x20, 0x15, 0x20, 0x2c, 0x15,
+      0x04, 0x15, 0x00, 0x15, 0x06, 0x15, 0x06, 0x00, 0x00, 0x01, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x15, 0x00, 0x15, 0x10, 0x15, 0x10, 0x2c, 0x15, 0x02, 0x15, 0x00,
+      0x15, 0x06, 0x15, 0x06, 0x00, 0x00, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x15, 0x00, 0x15, 0x2c, 0x15, 0x2c, 0x2c, 0x15, 0x06, 0x15,
+      0x00, 0x15, 0x06, 0x15, 0x06, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x03,
+      0x05, 0x05, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x06, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0x00, 0x15, 0x04, 0x15, 0x0a, 0x15, 0x0a, 0x4c,
+      0x15, 0x02, 0x15, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x78, 0x15,
+      0x00, 0x15, 0x12, 0x15, 0x12, 0x2c, 0x15, 0x06, 0x15, 0x10, 0x15, 0x06,
+      0x15, 0x06, 0x00, 0x00, 0x02, 0x00, 0x00, 0x00, 0x03, 0x02, 0x01, 0x03,
+      0x00, 0x15, 0x02, 0x19, 0x4c, 0x48, 0x06, 0x73, 0x63, 0x68, 0x65, 0x6d,
+      0x61, 0x15, 0x06, 0x00, 0x15, 0x04, 0x25, 0x00, 0x18, 0x09, 0x74, 0x69,
+      0x6d, 0x65, 0x73, 0x74, 0x61, 0x6d, 0x70, 0x00, 0x15, 0x04, 0x25, 0x02,
+      0x18, 0x01, 0x69, 0x00, 0x15, 0x0c, 0x25, 0x02, 0x18, 0x01, 0x73, 0x25,
+      0x00, 0x00, 0x16, 0x06, 0x19, 0x1c, 0x19, 0x3c, 0x26, 0x08, 0x1c, 0x15,
+      0x04, 0x19, 0x25, 0x00, 0x06, 0x19, 0x18, 0x09, 0x74, 0x69, 0x6d, 0x65,
+      0x73, 0x74, 0x61, 0x6d, 0x70, 0x15, 0x00, 0x16, 0x06, 0x16, 0x74, 0x16,
+      0x74, 0x26, 0x08, 0x00, 0x00, 0x26, 0x7c, 0x1c, 0x15, 0x04, 0x19, 0x25,
+      0x00, 0x06, 0x19, 0x18, 0x01, 0x69, 0x15, 0x00, 0x16, 0x06, 0x16, 0x4e,
+      0x16, 0x4e, 0x26, 0x7c, 0x00, 0x00, 0x26, 0xca, 0x01, 0x1c, 0x15, 0x0c,
+      0x19, 0x35, 0x00, 0x06, 0x10, 0x19, 0x18, 0x01, 0x73, 0x15, 0x00, 0x16,
+      0x06, 0x16, 0x58, 0x16, 0x58, 0x26, 0xee, 0x01, 0x26, 0xca, 0x01, 0x00,
+      0x00, 0x16, 0x9a, 0x02, 0x16, 0x06, 0x00, 0x28, 0x0b, 0x64, 0x61, 0x74,
+      0x61, 0x6c, 0x6f, 0x67, 0x74, 0x6f, 0x6f, 0x6c, 0x00, 0xa4, 0x00, 0x00,
+      0x00, 0x50, 0x41, 0x52, 0x31
+};
+
+TEST(ParquetWriterTest, KnownBytes) {
+  std::vector<uint8_t> out;
+  wpi::raw_uvector_ostream os{out};
+  ParquetWriter writer{os, 65536, 16};
+  int i = writer.AddColumn("i", ParquetWriter::Type::kInt64, false);
+  int s = writer.AddColumn("s", ParquetWriter::Type::kString, false);
+  writer.AppendInteger(1, i, 5);
+  writer.AppendString(2, s, "x");
+  writer.AppendInteger(3, i, 6);
+  writer.Finish();
+
+  ASSERT_EQ(out.size(), sizeof(kExpected));
+  for (size_t j = 0; j < out.size(); ++j) {
+    EXPECT_EQ(out[j], kExpected[j]) << "at offset " << j;
+  }
+}
+
+TEST(ParquetWriterTest, PageSplit) {
+  std::vector<uint8_t> single;
+  std::vector<uint8_t> split;
+  for (auto [out, pageSize] : {std::pair{&single, 1024 * 1024},
+                               std::pair{&split, 64}}) {
+    wpi::raw_uvector_ostream os{*out};
+    ParquetWriter writer{os, 65536, static_cast<size_t>(pageSize)};
+    int i = writer.AddColumn("i", ParquetWriter::Type::kInt64, false);
+    for (int64_t t = 0; t < 100; ++t) {
+      writer.AppendInteger(t, i, t * 3);
+    }
+    writer.Finish();
+  }
+
+  // identical values, so only the extra page headers differ
+  EXPECT_GT(split.size(), single.size());
+  ASSERT_GE(split.size(), 8u);
+  EXPECT_EQ(std::memcmp(split.data(), "PAR1", 4), 0);
+  EXPECT_EQ(std::memcmp(split.data() + split.size() - 4, "PAR1", 4), 0);
+}
@@ -0,0 +1,115 @@
+// Copyright (c) FIRST and other WPILib contributors.
+// Open Source Software; you can modify and/or share it under the terms of
+// the WPILib BSD license file in the root directory of this project.
+
+package edu.wpi.first.networktables;
+
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+
+/**
+ * A fixed group of entries whose values are read or written together. Each bulk operation makes a
+ * single native call for the whole group and creates no objects, unlike the per-entry getters and
+ * setters of {@link NetworkTableEntry}.
+ *
+ * <p>Double arrays are transferred through a direct byte buffer in native byte order (see {@link
+ * #allocateArrayBuffer(int)}) holding the arrays one after another, with a separate array of
+ * lengths.
+ */
+public final class NetworkTableEntryGroup {
+  /**
+   * Constructs a group.
+   *
+   * @param entries Entries; all must belong to the same instance
+   * @throws IllegalArgumentException if the entries belong to different instances
+   */
+  public NetworkTableEntryGroup(NetworkTableEntry... entries) {
+    m_entries = entries.clone();
+    m_handles = new int[entries.length];
+    for (int i = 0; i < entries.length; i++) {
+      if (!entries[0].getInstance().equals(entries[i].getInstance())) {
+        throw new IllegalArgumentException("entries must belong to the same instance");
+      }
+      m_handles[i] = entries[i].getHandle();
+    }
+  }
+
+  /**
+   * Allocates a buffer suitable for transferring double arrays.
+   *
+   * @param capacity Capacity in doubles
+   * @return Direct buffer in native byte order
+   */
+  public static ByteBuffer allocateArrayBuffer(int capacity) {
+    return ByteBuffer.allocateDirect(capacity * Double.BYTES).order(ByteOrder.nativeOrder());
+  }
+
+  /**
+   * Gets the number of entries in the group.
+   *
+   * @return Number of entries
+   */
+  public int size() {
+    return m_handles.length;
+  }
+
+  /**
+   * Gets an entry of the group.
+   *
+   * @param index Index of the entry
+   * @return Entry
+   */
+  public NetworkTableEntry getEntry(int index) {
+    return m_entries[index];
+  }
+
+  /**
+   * Gets the values of the entries as doubles.
+   *
+   * @param defaultValue Value to use for entries that don't hold a double
+   * @param values Receives the value of each entry; only entries with an index less than its length
+   *     are read
+   */
+  public void getDoubles(double defaultValue, double[] values) {
+    NetworkTablesJNI.getDoubles(m_handles, defaultValue, values);
+  }
+
+  /**
+   * Sets the values of the entries as doubles. Entries of another type are left unchanged.
+   *
+   * @param values New value of each entry; only entries with an index less than its length are set
+   * @return Number of entries set
+   */
+  public int setDoubles(double[] values) {
+    return NetworkTablesJNI.setDoubles(m_handles, 0, values);
+  }
+
+  /**
+   * Gets the values of the entries as double arrays. The arrays are copied into the buffer one
+   * after another, starting at its beginning; an array that doesn't fit in the remaining space is
+   * not copied. The buffer's position and limit are not changed.
+   *
+   * @param values Direct buffer that receives the arrays
+   * @param lengths Receives the length of each array, or -1 if the entry doesn't hold a double
+   *     array
+   * @return Total length of the arrays in doubles; if greater than the buffer capacity, not every
+   *     array was copied
+   */
+  public int getDoubleArrays(ByteBuffer values, int[] lengths) {
+    return NetworkTablesJNI.getDoubleArrays(m_handles, values, lengths);
+  }
+
+  /**
+   * Sets the values of the entries as double arrays. Entries of another type are left unchanged.
+   *
+   * @param values Direct buffer holding the arrays one after another, starting at its beginning
+   * @param lengths Length of each array; entries with a negative length are skipped
+   * @return Number of entries set
+   */
+  public int setDoubleArrays(ByteBuffer values, int[] lengths) {
+    return NetworkTablesJNI.setDoubleArrays(m_handles, 0, values, lengths);
+  }
+
+  private final NetworkTableEntry[] m_entries;
+  private final int[] m_handles;
+}
@@ -109,6 +109,15 @@ public final class NetworkTablesJNI {
 
   public static native String[] getStringArray(int entry, String[] defaultValue);
 
+  public static native void getDoubles(int[] entries, double defaultValue, double[] values);
+
+  public static native int setDoubles(int[] entries, long time, double[] values);
+
+  public static native int getDoubleArrays(int[] entries, ByteBuffer values, int[] lengths);
+
+  public static native int setDoubleArrays(
+      int[] entries, long time, ByteBuffer values, int[] lengths);
+
   public static native boolean setDefaultBoolean(int entry, long time, boolean defaultValue);
 
   public static native boolean setDefaultDouble(int entry, long time, double defaultValue);
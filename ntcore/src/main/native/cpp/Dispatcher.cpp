@@ -12,16 +12,34 @@
 #include <wpi/json_serializer.h>
 #include <wpi/raw_ostream.h>
 #include <wpi/timestamp.h>
+#include <wpinet/EventLoopRunner.h>
 #include <wpinet/TCPAcceptor.h>
 #include <wpinet/TCPConnector.h>
+#include <wpinet/uv/Async.h>
+#include <wpinet/uv/Tcp.h>
+#include <wpinet/uv/Timer.h>
 
 #include "IConnectionNotifier.h"
 #include "IStorage.h"
 #include "Log.h"
 #include "NetworkConnection.h"
+#include "UvNetworkConnection.h"
 
 using namespace nt;
 
+static constexpr auto kSaveDeltaTime = std::chrono::seconds(1);
+
+// Messages a client may send before CLIENT_HELLO_DONE.  In protocol 3.1, a
+// resuming client also sends its changes since the last sync.
+static bool IsHandshakeMessage(const Message& msg, unsigned int proto_rev) {
+  if (msg.Is(Message::kEntryAssign)) {
+    return true;
+  }
+  return proto_rev >= 0x0301 &&
+         (msg.Is(Message::kEntryUpdate) || msg.Is(Message::kFlagsUpdate) ||
+          msg.Is(Message::kEntryDelete));
+}
+
 static std::string ConnInfoToJson(bool connected, const ConnectionInfo& info) {
   std::string str;
   wpi::raw_string_ostream os{str};
@@ -43,10 +61,16 @@ static std::string ConnInfoToJson(bool connected, const ConnectionInfo& info) {
 void Dispatcher::StartServer(std::string_view persist_filename,
                              const char* listen_address, unsigned int port) {
   std::string listen_address_copy(wpi::trim(listen_address));
+  if (m_server_event_loop) {
+    DispatcherBase::StartServerEventLoop(persist_filename, listen_address_copy,
+                                         port);
+    return;
+  }
   DispatcherBase::StartServer(
       persist_filename,
       std::unique_ptr<wpi::NetworkAcceptor>(new wpi::TCPAcceptor(
-          static_cast<int>(port), listen_address_copy.c_str(), m_logger)));
+          static_cast<int>(port), listen_address_copy.c_str(), m_logger)),
+      port);
 }
 
 void Dispatcher::SetServer(const char* server_name, unsigned int port) {
@@ -146,19 +170,17 @@ void DispatcherBase::StartLocal() {
   m_storage.SetDispatcher(this, false);
 }
 
-void DispatcherBase::StartServer(
-    std::string_view persist_filename,
-    std::unique_ptr<wpi::NetworkAcceptor> acceptor) {
+bool DispatcherBase::InitServer(std::string_view persist_filename,
+                                unsigned int port) {
   {
     std::scoped_lock lock(m_user_mutex);
     if (m_active) {
-      return;
+      return false;
     }
     m_active = true;
   }
   m_networkMode = NT_NET_MODE_SERVER | NT_NET_MODE_STARTING;
   m_persist_filename = persist_filename;
-  m_server_acceptor = std::move(acceptor);
 
   // Load persistent file.  Ignore errors, but pass along warnings.
   if (!persist_filename.empty()) {
@@ -175,11 +197,110 @@ void DispatcherBase::StartServer(
   }
 
   m_storage.SetDispatcher(this, true);
+  if (size_t size = m_server_shared_memory; size != 0 && port != 0) {
+    m_storage.StartSharedTable(port, size);
+  }
+  return true;
+}
+
+void DispatcherBase::StartServer(
+    std::string_view persist_filename,
+    std::unique_ptr<wpi::NetworkAcceptor> acceptor, unsigned int port) {
+  if (!InitServer(persist_filename, port)) {
+    return;
+  }
+  m_server_acceptor = std::move(acceptor);
 
   m_dispatch_thread = std::thread(&Dispatcher::DispatchThreadMain, this);
   m_clientserver_thread = std::thread(&Dispatcher::ServerThreadMain, this);
 }
 
+void DispatcherBase::StartServerEventLoop(std::string_view persist_filename,
+                                          std::string_view listen_address,
+                                          unsigned int port) {
+  if (!InitServer(persist_filename, port)) {
+    return;
+  }
+
+  // Accept and service all connections on a single loop thread.
+  m_server_loop = std::make_unique<wpi::EventLoopRunner>();
+  bool ok = true;
+  m_server_loop->ExecSync([&](wpi::uv::Loop& loop) {
+    auto server = wpi::uv::Tcp::Create(loop);
+    if (!server) {
+      ok = false;
+      return;
+    }
+    {
+      auto failed = server->error.connect_scoped([&](wpi::uv::Error err) {
+        ERROR("could not listen on {} port {}: {}", listen_address, port,
+              err.str());
+        ok = false;
+      });
+      server->Bind(listen_address, port);
+      server->Listen();
+    }
+    if (!ok) {
+      server->Close();
+      return;
+    }
+    server->error.connect(
+        [this](wpi::uv::Error err) { ERROR("accept: {}", err.str()); });
+
+    // The loop also takes the place of the dispatch thread, so connections
+    // are only ever written from the loop.
+    m_next_save_time = std::chrono::steady_clock::now() + kSaveDeltaTime;
+    auto timer = wpi::uv::Timer::Create(loop);
+    timer->timeout.connect([this, timer = timer.get()] {
+      // pick up update rate changes
+      wpi::uv::Timer::Time rate{m_update_rate};
+      if (timer->GetRepeat() != rate) {
+        timer->SetRepeat(rate);
+      }
+      Dispatch(std::chrono::steady_clock::now());
+    });
+    timer->Start(wpi::uv::Timer::Time{m_update_rate},
+                 wpi::uv::Timer::Time{m_update_rate});
+    auto flush = wpi::uv::Async<>::Create(loop);
+    flush->wakeup.connect(
+        [this] { Dispatch(std::chrono::steady_clock::now()); });
+    {
+      std::scoped_lock lock(m_flush_mutex);
+      m_server_flush = flush;
+    }
+
+    server->connection.connect([this, srv = server.get()] {
+      auto stream = srv->Accept();
+      if (!stream || !m_active) {
+        return;
+      }
+      using namespace std::placeholders;
+      auto conn = std::make_shared<UvNetworkConnection>(
+          ++m_connections_uid, std::move(stream), m_notifier, m_logger,
+          std::bind(&Dispatcher::ServerHandshakeStep, this, _1, _2,  // NOLINT
+                    _3),
+          std::bind(&IStorage::GetMessageEntryType, &m_storage,  // NOLINT
+                    _1));
+      conn->set_process_incoming(
+          std::bind(&IStorage::ProcessIncoming, &m_storage, _1, _2,  // NOLINT
+                    std::weak_ptr<UvNetworkConnection>(conn)));
+      auto info = conn->info();
+      DEBUG0("server: client connection from {} port {}", info.remote_ip,
+             info.remote_port);
+      AddServerConnection(conn);
+      conn->Start();
+    });
+  });
+
+  if (!ok) {
+    m_server_loop.reset();
+    m_active = false;
+    m_networkMode = NT_NET_MODE_SERVER | NT_NET_MODE_FAILURE;
+    return;
+  }
+  m_networkMode = NT_NET_MODE_SERVER;
+}
+
 void DispatcherBase::StartClient() {
   {
     std::scoped_lock lock(m_user_mutex);
@@ -187,6 +308,8 @@ void DispatcherBase::StartClient() {
       return;
     }
     m_active = true;
+    m_client_proto_rev = 0x0301;
+    m_reconnect_proto_rev = 0x0301;
   }
   m_networkMode = NT_NET_MODE_CLIENT | NT_NET_MODE_STARTING;
   m_storage.SetDispatcher(this, false);
@@ -221,6 +344,16 @@ void DispatcherBase::Stop() {
     m_clientserver_thread.join();
   }
 
+  // stop the server loop; this closes all of its connections' sockets
+  if (m_server_loop) {
+    m_server_loop.reset();
+    {
+      std::scoped_lock lock(m_flush_mutex);
+      m_server_flush.reset();
+    }
+    m_networkMode = NT_NET_MODE_NONE;
+  }
+
   std::vector<std::shared_ptr<INetworkConnection>> conns;
   {
     std::scoped_lock lock(m_user_mutex);
@@ -229,6 +362,8 @@ void DispatcherBase::Stop() {
 
   // close all connections
   conns.resize(0);
+
+  m_storage.StopSharedTable();
 }
 
 void DispatcherBase::SetUpdateRate(double interval) {
@@ -246,8 +381,21 @@ void DispatcherBase::SetIdentity(std::string_view name) {
   m_identity = name;
 }
 
+void DispatcherBase::SetSubscriptions(
+    wpi::span<const std::string_view> prefixes) {
+  std::scoped_lock lock(m_user_mutex);
+  m_subscriptions.assign(prefixes.begin(), prefixes.end());
+  // otherwise sent during the client handshake
+  if (m_server_subscribe) {
+    for (auto& conn : m_connections) {
+      conn->QueueOutgoing(Message::Subscribe(m_subscriptions));
+    }
+  }
+}
+
 void DispatcherBase::Flush() {
   auto now = wpi::Now();
+  std::shared_ptr<wpi::uv::Async<>> server_flush;
   {
     std::scoped_lock lock(m_flush_mutex);
     // don't allow flushes more often than every 5 ms
@@ -256,8 +404,13 @@ void DispatcherBase::Flush() {
     }
     m_last_flush = now;
     m_do_flush = true;
+    server_flush = m_server_flush;
+  }
+  if (server_flush) {
+    server_flush->Send();
+  } else {
+    m_flush_cv.notify_one();
   }
-  m_flush_cv.notify_one();
 }
 
 std::vector<ConnectionInfo> DispatcherBase::GetConnections() const {
@@ -373,11 +526,7 @@ void DispatcherBase::ClearConnectorOverride() {
 
 void DispatcherBase::DispatchThreadMain() {
   auto timeout_time = std::chrono::steady_clock::now();
-
-  static const auto save_delta_time = std::chrono::seconds(1);
-  auto next_save_time = timeout_time + save_delta_time;
-
-  int count = 0;
+  m_next_save_time = timeout_time + kSaveDeltaTime;
 
   while (m_active) {
     // handle loop taking too long
@@ -397,49 +546,54 @@ void DispatcherBase::DispatchThreadMain() {
       break;  // in case we were woken up to terminate
     }
 
-    // perform periodic persistent save
-    if ((m_networkMode & NT_NET_MODE_SERVER) != 0 &&
-        !m_persist_filename.empty() && start > next_save_time) {
-      next_save_time += save_delta_time;
-      // handle loop taking too long
-      if (start > next_save_time) {
-        next_save_time = start + save_delta_time;
-      }
-      const char* err = m_storage.SavePersistent(m_persist_filename, true);
-      if (err) {
-        WARNING("periodic persistent save: {}", err);
-      }
+    Dispatch(start);
+  }
+}
+
+void DispatcherBase::Dispatch(std::chrono::steady_clock::time_point start) {
+  // perform periodic persistent save
+  if ((m_networkMode & NT_NET_MODE_SERVER) != 0 &&
+      !m_persist_filename.empty() && start > m_next_save_time) {
+    m_next_save_time += kSaveDeltaTime;
+    // handle loop taking too long
+    if (start > m_next_save_time) {
+      m_next_save_time = start + kSaveDeltaTime;
     }
+    const char* err = m_storage.SavePersistent(m_persist_filename, true);
+    if (err) {
+      WARNING("periodic persistent save: {}", err);
+    }
+  }
 
-    {
-      std::scoped_lock user_lock(m_user_mutex);
-      bool reconnect = false;
+  // must be done before taking the user lock, as it queues messages
+  m_storage.FlushPendingUpdates();
 
-      if (++count > 10) {
-        DEBUG0("dispatch running {} connections", m_connections.size());
-        count = 0;
-      }
+  std::scoped_lock user_lock(m_user_mutex);
+  bool reconnect = false;
 
-      for (auto& conn : m_connections) {
-        // post outgoing messages if connection is active
-        // only send keep-alives on client
-        if (conn->state() == NetworkConnection::kActive) {
-          conn->PostOutgoing((m_networkMode & NT_NET_MODE_CLIENT) != 0);
-        }
+  if (++m_dispatch_count > 10) {
+    DEBUG0("dispatch running {} connections", m_connections.size());
+    m_dispatch_count = 0;
+  }
 
-        // if client, reconnect if connection died
-        if ((m_networkMode & NT_NET_MODE_CLIENT) != 0 &&
-            conn->state() == NetworkConnection::kDead) {
-          reconnect = true;
-        }
-      }
-      // reconnect if we disconnected (and a reconnect is not in progress)
-      if (reconnect && !m_do_reconnect) {
-        m_do_reconnect = true;
-        m_reconnect_cv.notify_one();
-      }
+  for (auto& conn : m_connections) {
+    // post outgoing messages if connection is active
+    // only send keep-alives on client
+    if (conn->state() == NetworkConnection::kActive) {
+      conn->PostOutgoing((m_networkMode & NT_NET_MODE_CLIENT) != 0);
+    }
+
+    // if client, reconnect if connection died
+    if ((m_networkMode & NT_NET_MODE_CLIENT) != 0 &&
+        conn->state() == NetworkConnection::kDead) {
+      reconnect = true;
     }
   }
+  // reconnect if we disconnected (and a reconnect is not in progress)
+  if (reconnect && !m_do_reconnect) {
+    m_do_reconnect = true;
+    m_reconnect_cv.notify_one();
+  }
 }
 
 void DispatcherBase::QueueOutgoing(std::shared_ptr<Message> msg,
@@ -491,26 +645,25 @@ void DispatcherBase::ServerThreadMain() {
     conn->set_process_incoming(
         std::bind(&IStorage::ProcessIncoming, &m_storage, _1, _2,  // NOLINT
                   std::weak_ptr<NetworkConnection>(conn)));
-    {
-      std::scoped_lock lock(m_user_mutex);
-      // reuse dead connection slots
-      bool placed = false;
-      for (auto& c : m_connections) {
-        if (c->state() == NetworkConnection::kDead) {
-          c = conn;
-          placed = true;
-          break;
-        }
-      }
-      if (!placed) {
-        m_connections.emplace_back(conn);
-      }
-      conn->Start();
-    }
+    AddServerConnection(conn);
+    conn->Start();
   }
   m_networkMode = NT_NET_MODE_NONE;
 }
 
+void DispatcherBase::AddServerConnection(
+    std::shared_ptr<INetworkConnection> conn) {
+  std::scoped_lock lock(m_user_mutex);
+  // reuse dead connection slots
+  for (auto& c : m_connections) {
+    if (c->state() == INetworkConnection::kDead) {
+      c = std::move(conn);
+      return;
+    }
+  }
+  m_connections.emplace_back(std::move(conn));
+}
+
 void DispatcherBase::ClientThreadMain() {
   while (m_active) {
     // sleep between retries
@@ -552,11 +705,13 @@ void DispatcherBase::ClientThreadMain() {
                   std::weak_ptr<NetworkConnection>(conn)));
     m_connections.resize(0);  // disconnect any current
     m_connections.emplace_back(conn);
+    m_server_subscribe = false;
     conn->set_proto_rev(m_reconnect_proto_rev);
     conn->Start();
 
-    // reconnect the next time starting with latest protocol revision
-    m_reconnect_proto_rev = 0x0300;
+    // reconnect the next time starting with latest protocol revision the
+    // server may support
+    m_reconnect_proto_rev = m_client_proto_rev;
 
     // block until told to reconnect
     m_do_reconnect = false;
@@ -575,9 +730,13 @@ bool DispatcherBase::ClientHandshake(
     self_id = m_identity;
   }
 
-  // send client hello
+  // send client hello, with where to resume from
+  SyncPoint resume;
+  if (conn.proto_rev() >= 0x0301) {
+    resume = m_storage.GetSyncPoint();
+  }
   DEBUG0("{}", "client: sending hello");
-  auto msg = Message::ClientHello(self_id);
+  auto msg = Message::ClientHello(conn.proto_rev(), self_id, resume);
   send_msgs(wpi::span(&msg, 1));
 
   // wait for response
@@ -591,20 +750,34 @@ bool DispatcherBase::ClientHandshake(
   if (msg->Is(Message::kProtoUnsup)) {
     if (msg->id() == 0x0200) {
       ClientReconnect(0x0200);
+    } else if (msg->id() == 0x0300 && conn.proto_rev() > 0x0300) {
+      // a 3.0 server without the ntcore extensions; stay on 3.0 with it
+      {
+        std::scoped_lock lock(m_user_mutex);
+        m_client_proto_rev = 0x0300;
+      }
+      ClientReconnect(0x0300);
     }
     return false;
   }
 
   bool new_server = true;
+  bool server_subscribe = false;
+  bool resumed = false;
+  SyncPoint sync;
   if (conn.proto_rev() >= 0x0300) {
     // should be server hello; if not, disconnect.
     if (!msg->Is(Message::kServerHello)) {
       return false;
     }
     conn.set_remote_id(msg->str());
-    if ((msg->flags() & 1) != 0) {
+    if ((msg->flags() & Message::kServerReconnect) != 0) {
       new_server = false;
     }
+    server_subscribe = (msg->flags() & Message::kServerSubscribe) != 0;
+    resumed = (msg->flags() & Message::kServerResumed) != 0 &&
+              conn.proto_rev() >= 0x0301;
+    sync = msg->sync_point();
     // get the next message
     msg = get_msg();
   }
@@ -627,7 +800,8 @@ bool DispatcherBase::ClientHandshake(
       msg = get_msg();
       continue;
     }
-    if (!msg->Is(Message::kEntryAssign)) {
+    if (!msg->Is(Message::kEntryAssign) &&
+        !(resumed && msg->Is(Message::kEntryDelete))) {
       // unexpected message
       DEBUG0(
           "client: received message ({}) other than entry assignment during "
@@ -643,12 +817,27 @@ bool DispatcherBase::ClientHandshake(
   // generate outgoing assignments
   NetworkConnection::Outgoing outgoing;
 
-  m_storage.ApplyInitialAssignments(conn, incoming, new_server, &outgoing);
+  if (resumed) {
+    DEBUG0("client: resumed with {} changes", incoming.size());
+    m_storage.ApplyResumeAssignments(conn, incoming, sync, &outgoing);
+  } else {
+    m_storage.ApplyInitialAssignments(conn, incoming, new_server, sync,
+                                      &outgoing);
+  }
 
   if (conn.proto_rev() >= 0x0300) {
     outgoing.emplace_back(Message::ClientHelloDone());
   }
 
+  // the server sent all entries above; narrow that down from here on
+  if (server_subscribe) {
+    std::scoped_lock lock(m_user_mutex);
+    m_server_subscribe = true;
+    if (!m_subscriptions.empty()) {
+      outgoing.emplace_back(Message::Subscribe(m_subscriptions));
+    }
+  }
+
   if (!outgoing.empty()) {
     send_msgs(outgoing);
   }
@@ -672,42 +861,14 @@ bool DispatcherBase::ServerHandshake(
     return false;
   }
 
-  // Check that the client requested version is not too high.
-  unsigned int proto_rev = msg->id();
-  if (proto_rev > 0x0300) {
-    DEBUG0("{}", "server: client requested proto > 0x0300");
-    auto toSend = Message::ProtoUnsup();
-    send_msgs(wpi::span(&toSend, 1));
+  if (!ServerHello(conn, *msg, send_msgs)) {
     return false;
   }
-
+  unsigned int proto_rev = msg->id();
   if (proto_rev >= 0x0300) {
     conn.set_remote_id(msg->str());
   }
 
-  // Set the proto version to the client requested version
-  DEBUG0("server: client protocol {}", proto_rev);
-  conn.set_proto_rev(proto_rev);
-
-  // Send initial set of assignments
-  NetworkConnection::Outgoing outgoing;
-
-  // Start with server hello.  TODO: initial connection flag
-  if (proto_rev >= 0x0300) {
-    std::scoped_lock lock(m_user_mutex);
-    outgoing.emplace_back(Message::ServerHello(0u, m_identity));
-  }
-
-  // Get snapshot of initial assignments
-  m_storage.GetInitialAssignments(conn, &outgoing);
-
-  // Finish with server hello done
-  outgoing.emplace_back(Message::ServerHelloDone());
-
-  // Batch transmit
-  DEBUG0("{}", "server: sending initial assignments");
-  send_msgs(outgoing);
-
   // In proto rev 3.0 and later, the handshake concludes with a client hello
   // done message, so we can batch the assigns before marking the connection
   // active.  In pre-3.0, we need to just immediately mark it active and hand
@@ -730,7 +891,7 @@ bool DispatcherBase::ServerHandshake(
         msg = get_msg();
         continue;
       }
-      if (!msg->Is(Message::kEntryAssign)) {
+      if (!IsHandshakeMessage(*msg, proto_rev)) {
         // unexpected message
         DEBUG0(
             "server: received message ({}) other than entry assignment during "
@@ -752,6 +913,109 @@ bool DispatcherBase::ServerHandshake(
   return true;
 }
 
+bool DispatcherBase::ServerHello(
+    INetworkConnection& conn, const Message& hello,
+    std::function<void(wpi::span<std::shared_ptr<Message>>)> send_msgs) {
+  // Check that the client requested version is not too high.
+  unsigned int proto_rev = hello.id();
+  if (proto_rev > 0x0301) {
+    DEBUG0("{}", "server: client requested proto > 0x0301");
+    auto toSend = Message::ProtoUnsup(0x0301);
+    send_msgs(wpi::span(&toSend, 1));
+    return false;
+  }
+
+  // Set the proto version to the client requested version
+  DEBUG0("server: client protocol {}", proto_rev);
+  conn.set_proto_rev(proto_rev);
+
+  // Send initial set of assignments
+  NetworkConnection::Outgoing outgoing;
+
+  // Start with server hello, which is filled in below.  TODO: initial
+  // connection flag
+  if (proto_rev >= 0x0300) {
+    outgoing.emplace_back();
+  }
+
+  // Get snapshot of the changes since the client's sync point, or of all
+  // assignments
+  SyncPoint sync;
+  bool resumed = proto_rev >= 0x0301 &&
+                 m_storage.GetResumeAssignments(conn, hello.sync_point(),
+                                                &outgoing, &sync);
+  if (!resumed) {
+    m_storage.GetInitialAssignments(conn, &outgoing, &sync);
+  }
+  if (proto_rev >= 0x0300) {
+    unsigned int flags = Message::kServerSubscribe;
+    if (resumed) {
+      DEBUG0("server: resuming client with {} changes", outgoing.size() - 1);
+      flags |= Message::kServerResumed;
+    }
+    std::scoped_lock lock(m_user_mutex);
+    outgoing[0] = Message::ServerHello(proto_rev, flags, m_identity, sync);
+  }
+
+  // Finish with server hello done
+  outgoing.emplace_back(Message::ServerHelloDone());
+
+  // Batch transmit
+  DEBUG0("{}", "server: sending initial assignments");
+  send_msgs(outgoing);
+  return true;
+}
+
+// Non-blocking equivalent of ServerHandshake(), called for each message
+// received by an event loop connection until it becomes active.
+bool DispatcherBase::ServerHandshakeStep(
+    UvNetworkConnection& conn, std::shared_ptr<Message> msg,
+    std::function<void(wpi::span<std::shared_ptr<Message>>)> send_msgs) {
+  if (conn.state() == NetworkConnection::kHandshake) {
+    // Wait for the client to send us a hello.
+    if (!msg->Is(Message::kClientHello)) {
+      DEBUG0("{}", "server: client initial message was not client hello");
+      return false;
+    }
+    if (!ServerHello(conn, *msg, send_msgs)) {
+      return false;
+    }
+    if (msg->id() < 0x0300) {
+      // pre-3.0 clients are active immediately
+      conn.set_state(NetworkConnection::kActive);
+    } else {
+      conn.set_remote_id(msg->str());
+      return true;
+    }
+  } else if (msg->Is(Message::kClientHelloDone)) {
+    for (auto& msg : conn.handshake_incoming()) {
+      m_storage.ProcessIncoming(msg, &conn,
+                                std::weak_ptr<NetworkConnection>());
+    }
+    conn.handshake_incoming().clear();
+    conn.set_state(NetworkConnection::kActive);
+  } else if (msg->Is(Message::kKeepAlive)) {
+    // shouldn't receive a keep alive, but handle gracefully
+    return true;
+  } else if (IsHandshakeMessage(*msg, conn.proto_rev())) {
+    // batch the client initial assignments until client hello done
+    conn.handshake_incoming().emplace_back(std::move(msg));
+    return true;
+  } else {
+    // unexpected message
+    DEBUG0(
+        "server: received message ({}) other than entry assignment during "
+        "initial handshake",
+        msg->type());
+    return false;
+  }
+
+  auto info = conn.info();
+  INFO("server: client CONNECTED: {} port {}", info.remote_ip,
+       info.remote_port);
+  return true;
+}
+
 void DispatcherBase::ClientReconnect(unsigned int proto_rev) {
   if ((m_networkMode & NT_NET_MODE_SERVER) != 0) {
     return;
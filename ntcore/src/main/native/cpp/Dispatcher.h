@@ -6,6 +6,7 @@
 #define NTCORE_DISPATCHER_H_
 
 #include <atomic>
+#include <chrono>
 #include <functional>
 #include <memory>
 #include <string>
@@ -24,9 +25,14 @@
 #include "INetworkConnection.h"
 
 namespace wpi {
+class EventLoopRunner;
 class Logger;
 class NetworkAcceptor;
 class NetworkStream;
+namespace uv {
+template <typename... T>
+class Async;
+}  // namespace uv
 }  // namespace wpi
 
 namespace nt {
@@ -34,6 +40,7 @@ namespace nt {
 class IConnectionNotifier;
 class IStorage;
 class NetworkConnection;
+class UvNetworkConnection;
 
 class DispatcherBase : public IDispatcher {
   friend class DispatcherTest;
@@ -48,11 +55,22 @@ class DispatcherBase : public IDispatcher {
   unsigned int GetNetworkMode() const;
   void StartLocal();
   void StartServer(std::string_view persist_filename,
-                   std::unique_ptr<wpi::NetworkAcceptor> acceptor);
+                   std::unique_ptr<wpi::NetworkAcceptor> acceptor,
+                   unsigned int port = 0);
+  void StartServerEventLoop(std::string_view persist_filename,
+                            std::string_view listen_address,
+                            unsigned int port);
   void StartClient();
   void Stop();
+
+  // Sets the size of the shared memory segment subsequent StartServer calls
+  // mirror entry values to; 0 disables it.  The segment is named after the
+  // port, so servers started without one don't get a segment.
+  void SetServerSharedMemory(size_t size) { m_server_shared_memory = size; }
+
   void SetUpdateRate(double interval);
   void SetIdentity(std::string_view name);
+  void SetSubscriptions(wpi::span<const std::string_view> prefixes);
   void Flush();
   std::vector<ConnectionInfo> GetConnections() const;
   bool IsConnected() const;
@@ -76,7 +94,11 @@ class DispatcherBase : public IDispatcher {
   DispatcherBase& operator=(const DispatcherBase&) = delete;
 
  private:
+  bool InitServer(std::string_view persist_filename, unsigned int port);
+  void AddServerConnection(std::shared_ptr<INetworkConnection> conn);
+
   void DispatchThreadMain();
+  void Dispatch(std::chrono::steady_clock::time_point start);
   void ServerThreadMain();
   void ClientThreadMain();
 
@@ -88,8 +110,14 @@ class DispatcherBase : public IDispatcher {
       NetworkConnection& conn,
       std::function<std::shared_ptr<Message>()> get_msg,
       std::function<void(wpi::span<std::shared_ptr<Message>>)> send_msgs);
+  bool ServerHello(
+      INetworkConnection& conn, const Message& hello,
+      std::function<void(wpi::span<std::shared_ptr<Message>>)> send_msgs);
+  bool ServerHandshakeStep(
+      UvNetworkConnection& conn, std::shared_ptr<Message> msg,
+      std::function<void(wpi::span<std::shared_ptr<Message>>)> send_msgs);
 
-  void ClientReconnect(unsigned int proto_rev = 0x0300);
+  void ClientReconnect(unsigned int proto_rev = 0x0301);
 
   void QueueOutgoing(std::shared_ptr<Message> msg, INetworkConnection* only,
                      INetworkConnection* except) override;
@@ -102,6 +130,9 @@ class DispatcherBase : public IDispatcher {
   std::thread m_clientserver_thread;
 
   std::unique_ptr<wpi::NetworkAcceptor> m_server_acceptor;
+  // all server connections are serviced by this loop if it is running;
+  // it also does the work of the dispatch thread
+  std::unique_ptr<wpi::EventLoopRunner> m_server_loop;
   Connector m_client_connector_override;
   Connector m_client_connector;
   uint8_t m_connections_uid = 0;
@@ -110,19 +141,30 @@ class DispatcherBase : public IDispatcher {
   mutable wpi::mutex m_user_mutex;
   std::vector<std::shared_ptr<INetworkConnection>> m_connections;
   std::string m_identity;
+  std::vector<std::string> m_subscriptions;
+  // client connected to a server that accepts subscriptions
+  bool m_server_subscribe = false;
 
   std::atomic_bool m_active;       // set to false to terminate threads
   std::atomic_uint m_update_rate;  // periodic dispatch update rate, in ms
+  std::atomic<size_t> m_server_shared_memory{0};
+
+  // Dispatch state (dispatch thread or server loop only)
+  std::chrono::steady_clock::time_point m_next_save_time;
+  int m_dispatch_count = 0;
 
   // Condition variable for forced dispatch wakeup (flush)
   wpi::mutex m_flush_mutex;
   wpi::condition_variable m_flush_cv;
   uint64_t m_last_flush = 0;
   bool m_do_flush = false;
+  std::shared_ptr<wpi::uv::Async<>> m_server_flush;
 
   // Condition variable for client reconnect (uses user mutex)
   wpi::condition_variable m_reconnect_cv;
-  unsigned int m_reconnect_proto_rev = 0x0300;
+  unsigned int m_reconnect_proto_rev = 0x0301;
+  // latest protocol revision the server may support
+  unsigned int m_client_proto_rev = 0x0301;
   bool m_do_reconnect = true;
 
   struct DataLogger {
@@ -154,6 +196,10 @@ class Dispatcher : public DispatcherBase {
   void StartServer(std::string_view persist_filename,
                    const char* listen_address, unsigned int port);
 
+  // Selects the event loop connection engine for subsequent StartServer
+  // calls.
+  void SetServerEventLoop(bool enable) { m_server_event_loop = enable; }
+
   void SetServer(const char* server_name, unsigned int port);
   void SetServer(
       wpi::span<const std::pair<std::string_view, unsigned int>> servers);
@@ -161,6 +207,9 @@ class Dispatcher : public DispatcherBase {
 
   void SetServerOverride(const char* server_name, unsigned int port);
   void ClearServerOverride();
+
+ private:
+  std::atomic_bool m_server_event_loop{false};
 };
 
 }  // namespace nt
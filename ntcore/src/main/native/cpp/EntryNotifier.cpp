@@ -4,6 +4,8 @@
 
 #include "EntryNotifier.h"
 
+#include <tuple>
+
 #include <wpi/StringExtras.h>
 
 #include "Log.h"
@@ -23,8 +25,35 @@ bool EntryNotifier::local_notifiers() const {
   return m_local_notifiers;
 }
 
+void impl::EntryBatch::Append(const EntryNotifierData& data) {
+  if (size == events.size()) {
+    events.emplace_back(data);
+  } else {
+    // reuse the name's storage
+    auto& event = events[size];
+    event.listener = data.listener;
+    event.entry = data.entry;
+    event.name.assign(*data.name);
+    event.value = data.value;
+    event.flags = data.flags;
+  }
+  ++size;
+}
+
+void impl::EntryBatch::Flush() {
+  if (size == 0) {
+    return;
+  }
+  callback(wpi::span{events.data(), size});
+  // don't hold on to the values
+  for (size_t i = 0; i < size; ++i) {
+    events[i].value.reset();
+  }
+  size = 0;
+}
+
 bool impl::EntryNotifierThread::Matches(const EntryListenerData& listener,
-                                        const EntryNotification& data) {
+                                        const EntryNotifierData& data) {
   if (!data.value) {
     return false;
   }
@@ -51,20 +80,62 @@ bool impl::EntryNotifierThread::Matches(const EntryListenerData& listener,
   if (listener.entry != 0 && data.entry != listener.entry) {
     return false;
   }
-  if (listener.entry == 0 && !wpi::starts_with(data.name, listener.prefix)) {
+  if (listener.entry == 0 && !wpi::starts_with(*data.name, listener.prefix)) {
     return false;
   }
 
   return true;
 }
 
+void impl::EntryNotifierThread::DoCallback(EntryCallback callback,
+                                           const EntryNotifierData& data) {
+  if (!callback.batch) {
+    callback.func(data);
+    return;
+  }
+  auto& batch = *callback.batch;
+  if (batch.size == 0) {
+    m_batches.emplace_back(std::move(callback.batch));
+  }
+  batch.Append(data);
+  if (batch.size >= kMaxBatch) {
+    batch.Flush();
+  }
+}
+
+void impl::EntryNotifierThread::FlushCallbacks(
+    std::unique_lock<wpi::mutex>& lock) {
+  if (m_batches.empty()) {
+    return;
+  }
+  // m_batches is only used by this thread, so it's safe to use unlocked
+  lock.unlock();
+  for (auto&& batch : m_batches) {
+    batch->Flush();
+  }
+  m_batches.clear();
+  lock.lock();
+}
+
+std::shared_ptr<const std::string> impl::EntryNotifierThread::InternName(
+    unsigned int local_id, std::string_view name) {
+  if (local_id >= m_names.size()) {
+    m_names.resize(local_id + 1);
+  }
+  auto& interned = m_names[local_id];
+  if (!interned || *interned != name) {
+    interned = std::make_shared<const std::string>(name);
+  }
+  return interned;
+}
+
 unsigned int EntryNotifier::Add(
     std::function<void(const EntryNotification& event)> callback,
     std::string_view prefix, unsigned int flags) {
   if ((flags & NT_NOTIFY_LOCAL) != 0) {
     m_local_notifiers = true;
   }
-  return DoAdd(callback, prefix, flags);
+  return DoAdd(impl::EntryCallback{std::move(callback)}, prefix, flags);
 }
 
 unsigned int EntryNotifier::Add(
@@ -73,7 +144,8 @@ unsigned int EntryNotifier::Add(
   if ((flags & NT_NOTIFY_LOCAL) != 0) {
     m_local_notifiers = true;
   }
-  return DoAdd(callback, Handle(m_inst, local_id, Handle::kEntry), flags);
+  return DoAdd(impl::EntryCallback{std::move(callback)},
+               Handle(m_inst, local_id, Handle::kEntry), flags);
 }
 
 unsigned int EntryNotifier::AddPolled(unsigned int poller_uid,
@@ -94,6 +166,17 @@ unsigned int EntryNotifier::AddPolled(unsigned int poller_uid,
   return DoAdd(poller_uid, Handle(m_inst, local_id, Handle::kEntry), flags);
 }
 
+unsigned int EntryNotifier::AddBatch(
+    std::function<void(wpi::span<const EntryNotification> events)> callback,
+    std::string_view prefix, unsigned int flags) {
+  if ((flags & NT_NOTIFY_LOCAL) != 0) {
+    m_local_notifiers = true;
+  }
+  return DoAdd(impl::EntryCallback{std::make_shared<impl::EntryBatch>(
+                   std::move(callback))},
+               prefix, flags);
+}
+
 void EntryNotifier::NotifyEntry(unsigned int local_id, std::string_view name,
                                 std::shared_ptr<Value> value,
                                 unsigned int flags,
@@ -104,6 +187,14 @@ void EntryNotifier::NotifyEntry(unsigned int local_id, std::string_view name,
     return;
   }
   DEBUG0("notifying '{}' (local={}), flags={}", name, local_id, flags);
-  Send(only_listener, 0, Handle(m_inst, local_id, Handle::kEntry).handle(),
-       name, value, flags);
+  auto thr = GetThread();
+  if (!thr || thr->m_listeners.empty()) {
+    return;
+  }
+  thr->m_queue.emplace(
+      std::piecewise_construct, std::make_tuple(only_listener),
+      std::forward_as_tuple(
+          0, Handle(m_inst, local_id, Handle::kEntry).handle(),
+          thr->InternName(local_id, name), std::move(value), flags));
+  thr->m_cond.notify_one();
 }
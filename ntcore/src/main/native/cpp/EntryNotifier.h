@@ -6,12 +6,15 @@
 #define NTCORE_ENTRYNOTIFIER_H_
 
 #include <atomic>
+#include <functional>
 #include <memory>
 #include <string>
 #include <string_view>
 #include <utility>
+#include <vector>
 
 #include <wpi/CallbackManager.h>
+#include <wpi/span.h>
 
 #include "Handle.h"
 #include "IEntryNotifier.h"
@@ -25,18 +28,71 @@ namespace nt {
 
 namespace impl {
 
-struct EntryListenerData
-    : public wpi::CallbackListenerData<
-          std::function<void(const EntryNotification& event)>> {
+// A notification as queued.  The name is interned per entry, so queueing a
+// notification doesn't copy it.
+struct EntryNotifierData {
+  EntryNotifierData(NT_EntryListener listener_, NT_Entry entry_,
+                    std::shared_ptr<const std::string> name_,
+                    std::shared_ptr<Value> value_, unsigned int flags_)
+      : listener(listener_),
+        entry(entry_),
+        name(std::move(name_)),
+        value(std::move(value_)),
+        flags(flags_) {}
+
+  operator EntryNotification() const {  // NOLINT
+    return {listener, entry, *name, value, flags};
+  }
+
+  NT_EntryListener listener;
+  NT_Entry entry;
+  std::shared_ptr<const std::string> name;
+  std::shared_ptr<Value> value;
+  unsigned int flags;
+};
+
+// Notifications for a batch listener.  Only used by the notifier thread.
+struct EntryBatch {
+  explicit EntryBatch(
+      std::function<void(wpi::span<const EntryNotification> events)> callback_)
+      : callback(std::move(callback_)) {}
+
+  void Append(const EntryNotifierData& data);
+  void Flush();
+
+  std::function<void(wpi::span<const EntryNotification> events)> callback;
+  // events past size are kept so their name strings can be reused
+  std::vector<EntryNotification> events;
+  size_t size = 0;
+};
+
+// Listener callback; either called per notification or batched.
+struct EntryCallback {
+  EntryCallback() = default;
+  explicit EntryCallback(
+      std::function<void(const EntryNotification& event)> func_)
+      : func(std::move(func_)) {}
+  explicit EntryCallback(std::shared_ptr<EntryBatch> batch_)
+      : batch(std::move(batch_)) {}
+
+  explicit operator bool() const { return func || batch; }
+
+  std::function<void(const EntryNotification& event)> func;
+  std::shared_ptr<EntryBatch> batch;
+};
+
+struct EntryListenerData : public wpi::CallbackListenerData<EntryCallback> {
   EntryListenerData() = default;
-  EntryListenerData(
-      std::function<void(const EntryNotification& event)> callback_,
-      std::string_view prefix_, unsigned int flags_)
-      : CallbackListenerData(callback_), prefix(prefix_), flags(flags_) {}
-  EntryListenerData(
-      std::function<void(const EntryNotification& event)> callback_,
-      NT_Entry entry_, unsigned int flags_)
-      : CallbackListenerData(callback_), entry(entry_), flags(flags_) {}
+  EntryListenerData(EntryCallback callback_, std::string_view prefix_,
+                    unsigned int flags_)
+      : CallbackListenerData(std::move(callback_)),
+        prefix(prefix_),
+        flags(flags_) {}
+  EntryListenerData(EntryCallback callback_, NT_Entry entry_,
+                    unsigned int flags_)
+      : CallbackListenerData(std::move(callback_)),
+        entry(entry_),
+        flags(flags_) {}
   EntryListenerData(unsigned int poller_uid_, std::string_view prefix_,
                     unsigned int flags_)
       : CallbackListenerData(poller_uid_), prefix(prefix_), flags(flags_) {}
@@ -51,26 +107,37 @@ struct EntryListenerData
 
 class EntryNotifierThread
     : public wpi::CallbackThread<EntryNotifierThread, EntryNotification,
-                                 EntryListenerData> {
+                                 EntryListenerData, EntryNotifierData> {
  public:
+  // Batches are delivered early once they reach this many notifications.
+  static constexpr size_t kMaxBatch = 1024;
+
   EntryNotifierThread(std::function<void()> on_start,
                       std::function<void()> on_exit, int inst)
       : CallbackThread(std::move(on_start), std::move(on_exit)), m_inst(inst) {}
 
   bool Matches(const EntryListenerData& listener,
-               const EntryNotification& data);
+               const EntryNotifierData& data);
 
-  void SetListener(EntryNotification* data, unsigned int listener_uid) {
+  void SetListener(EntryNotifierData* data, unsigned int listener_uid) {
     data->listener =
         Handle(m_inst, listener_uid, Handle::kEntryListener).handle();
   }
 
-  void DoCallback(std::function<void(const EntryNotification& event)> callback,
-                  const EntryNotification& data) {
-    callback(data);
-  }
+  void DoCallback(EntryCallback callback, const EntryNotifierData& data);
+  void FlushCallbacks(std::unique_lock<wpi::mutex>& lock);
+
+  // Must be called with m_mutex held
+  std::shared_ptr<const std::string> InternName(unsigned int local_id,
+                                                std::string_view name);
 
   int m_inst;
+
+  // Interned names, indexed by local id
+  std::vector<std::shared_ptr<const std::string>> m_names;
+
+  // Batches with notifications waiting for the queue to drain
+  std::vector<std::shared_ptr<EntryBatch>> m_batches;
 };
 
 }  // namespace impl
@@ -96,6 +163,9 @@ class EntryNotifier
                          unsigned int flags) override;
   unsigned int AddPolled(unsigned int poller_uid, unsigned int local_id,
                          unsigned int flags) override;
+  unsigned int AddBatch(
+      std::function<void(wpi::span<const EntryNotification> events)> callback,
+      std::string_view prefix, unsigned int flags) override;
 
   void NotifyEntry(unsigned int local_id, std::string_view name,
                    std::shared_ptr<Value> value, unsigned int flags,
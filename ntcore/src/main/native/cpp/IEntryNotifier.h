@@ -9,6 +9,8 @@
 #include <memory>
 #include <string_view>
 
+#include <wpi/span.h>
+
 #include "ntcore_cpp.h"
 
 namespace nt {
@@ -32,6 +34,9 @@ class IEntryNotifier {
                                  unsigned int flags) = 0;
   virtual unsigned int AddPolled(unsigned int poller_uid, unsigned int local_id,
                                  unsigned int flags) = 0;
+  virtual unsigned int AddBatch(
+      std::function<void(wpi::span<const EntryNotification> events)> callback,
+      std::string_view prefix, unsigned int flags) = 0;
 
   virtual void NotifyEntry(unsigned int local_id, std::string_view name,
                            std::shared_ptr<Value> value, unsigned int flags,
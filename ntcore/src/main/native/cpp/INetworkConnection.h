@@ -6,6 +6,9 @@
 #define NTCORE_INETWORKCONNECTION_H_
 
 #include <memory>
+#include <string>
+
+#include <wpi/span.h>
 
 #include "Message.h"
 #include "ntcore_cpp.h"
@@ -26,6 +29,12 @@ class INetworkConnection {
   virtual void QueueOutgoing(std::shared_ptr<Message> msg) = 0;
   virtual void PostOutgoing(bool keep_alive) = 0;
 
+  // Applies a subscription received from the remote; see
+  // PendingOutgoing::SetSubscriptions().
+  virtual void SetSubscriptions(
+      wpi::span<const std::string> prefixes,
+      wpi::span<const std::shared_ptr<Message>> assigns) = 0;
+
   virtual unsigned int proto_rev() const = 0;
   virtual void set_proto_rev(unsigned int proto_rev) = 0;
 
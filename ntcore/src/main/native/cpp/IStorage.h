@@ -42,11 +42,36 @@ class IStorage {
                                INetworkConnection* conn,
                                std::weak_ptr<INetworkConnection> conn_weak) = 0;
   virtual void GetInitialAssignments(
-      INetworkConnection& conn,
-      std::vector<std::shared_ptr<Message>>* msgs) = 0;
+      INetworkConnection& conn, std::vector<std::shared_ptr<Message>>* msgs,
+      SyncPoint* sync) = 0;
   virtual void ApplyInitialAssignments(
       INetworkConnection& conn, wpi::span<std::shared_ptr<Message>> msgs,
-      bool new_server, std::vector<std::shared_ptr<Message>>* out_msgs) = 0;
+      bool new_server, const SyncPoint& sync,
+      std::vector<std::shared_ptr<Message>>* out_msgs) = 0;
+
+  // Resumed synchronization (protocol 3.1).  On the server, gets the
+  // deletes and assignments since a client's sync point; returns false if
+  // the server can't resume from it.  On the client, applies them and
+  // generates the messages for local changes since the last sync.
+  virtual bool GetResumeAssignments(
+      INetworkConnection& conn, const SyncPoint& since,
+      std::vector<std::shared_ptr<Message>>* msgs, SyncPoint* sync) = 0;
+  virtual void ApplyResumeAssignments(
+      INetworkConnection& conn, wpi::span<std::shared_ptr<Message>> msgs,
+      const SyncPoint& sync,
+      std::vector<std::shared_ptr<Message>>* out_msgs) = 0;
+  // The sync point of the client's last synchronization, or an empty one if
+  // it can't resume from it.
+  virtual SyncPoint GetSyncPoint() const = 0;
+
+  // Mirrors entry values to the shared memory segment of a server port, for
+  // readers on the same host, until stopped.
+  virtual void StartSharedTable(unsigned int port, size_t size) = 0;
+  virtual void StopSharedTable() = 0;
+
+  // Queues entry updates deferred by the typed setters.  Called by the
+  // dispatcher before posting outgoing messages.
+  virtual void FlushPendingUpdates() = 0;
 
   // Filename-based save/load functions.  Used both by periodic saves and
   // accessible directly via the user API.
@@ -38,6 +38,12 @@ std::shared_ptr<Message> Message::Read(WireDecoder& decoder,
           return nullptr;
         }
       }
+      if (proto_rev >= 0x0301u) {
+        if (!decoder.ReadUleb128(&msg->m_sync_point.epoch) ||
+            !decoder.ReadUleb128(&msg->m_sync_point.revision)) {
+          return nullptr;
+        }
+      }
       break;
     }
     case kProtoUnsup: {
@@ -53,12 +59,19 @@ std::shared_ptr<Message> Message::Read(WireDecoder& decoder,
         decoder.set_error("received SERVER_HELLO in protocol < 3.0");
         return nullptr;
       }
+      msg->m_id = decoder.proto_rev();
       if (!decoder.Read8(&msg->m_flags)) {
         return nullptr;
       }
       if (!decoder.ReadString(&msg->m_str)) {
         return nullptr;
       }
+      if (decoder.proto_rev() >= 0x0301u) {
+        if (!decoder.ReadUleb128(&msg->m_sync_point.epoch) ||
+            !decoder.ReadUleb128(&msg->m_sync_point.revision)) {
+          return nullptr;
+        }
+      }
       break;
     case kClientHelloDone:
       if (decoder.proto_rev() < 0x0300u) {
@@ -196,6 +209,17 @@ std::shared_ptr<Message> Message::Read(WireDecoder& decoder,
       msg->m_str.assign(results, size);
       break;
     }
+    case kSubscribe: {
+      if (decoder.proto_rev() < 0x0300u) {
+        decoder.set_error("received SUBSCRIBE in protocol < 3.0");
+        return nullptr;
+      }
+      msg->m_value = decoder.ReadValue(NT_STRING_ARRAY);
+      if (!msg->m_value) {
+        return nullptr;
+      }
+      break;
+    }
     default:
       decoder.set_error("unrecognized message type");
       WPI_INFO(decoder.logger(), "unrecognized message type: {}", msg_type);
@@ -204,17 +228,31 @@ std::shared_ptr<Message> Message::Read(WireDecoder& decoder,
   return msg;
 }
 
-std::shared_ptr<Message> Message::ClientHello(std::string_view self_id) {
+std::shared_ptr<Message> Message::ClientHello(unsigned int proto_rev,
+                                              std::string_view self_id,
+                                              const SyncPoint& sync) {
   auto msg = std::make_shared<Message>(kClientHello, private_init());
   msg->m_str = self_id;
+  msg->m_id = proto_rev;
+  msg->m_sync_point = sync;
+  return msg;
+}
+
+std::shared_ptr<Message> Message::ProtoUnsup(unsigned int proto_rev) {
+  auto msg = std::make_shared<Message>(kProtoUnsup, private_init());
+  msg->m_id = proto_rev;
   return msg;
 }
 
-std::shared_ptr<Message> Message::ServerHello(unsigned int flags,
-                                              std::string_view self_id) {
+std::shared_ptr<Message> Message::ServerHello(unsigned int proto_rev,
+                                              unsigned int flags,
+                                              std::string_view self_id,
+                                              const SyncPoint& sync) {
   auto msg = std::make_shared<Message>(kServerHello, private_init());
   msg->m_str = self_id;
+  msg->m_id = proto_rev;
   msg->m_flags = flags;
+  msg->m_sync_point = sync;
   return msg;
 }
 
@@ -274,6 +312,62 @@ std::shared_ptr<Message> Message::RpcResponse(unsigned int id, unsigned int uid,
   return msg;
 }
 
+std::shared_ptr<Message> Message::Subscribe(
+    wpi::span<const std::string> prefixes) {
+  auto msg = std::make_shared<Message>(kSubscribe, private_init());
+  msg->m_value = Value::MakeStringArray(prefixes);
+  return msg;
+}
+
+std::string_view Message::GetEncoded() const {
+  std::call_once(m_encoded_flag, [this] {
+    WireEncoder encoder(0x0300);
+    Write(encoder);
+    m_encoded = encoder.ToStringView();
+  });
+  return m_encoded;
+}
+
+size_t Message::GatherEncoded(wpi::span<const std::shared_ptr<Message>> msgs,
+                              std::string* buf,
+                              std::vector<std::string_view>* bufs) {
+  // encodings at least this long are referenced rather than copied
+  constexpr size_t kMinReference = 256;
+
+  // reserve up front so views into buf stay valid
+  size_t copied = 0;
+  for (auto& msg : msgs) {
+    if (msg && msg->GetEncoded().size() < kMinReference) {
+      copied += msg->GetEncoded().size();
+    }
+  }
+  buf->clear();
+  buf->reserve(copied);
+
+  size_t total = 0;
+  size_t run = 0;  // start of the current run of copies in buf
+  for (auto& msg : msgs) {
+    if (!msg) {
+      continue;
+    }
+    auto encoded = msg->GetEncoded();
+    total += encoded.size();
+    if (encoded.size() < kMinReference) {
+      buf->append(encoded);
+      continue;
+    }
+    if (buf->size() > run) {
+      bufs->emplace_back(buf->data() + run, buf->size() - run);
+      run = buf->size();
+    }
+    bufs->emplace_back(encoded);
+  }
+  if (buf->size() > run) {
+    bufs->emplace_back(buf->data() + run, buf->size() - run);
+  }
+  return total;
+}
+
 void Message::Write(WireEncoder& encoder) const {
   switch (m_type) {
     case kKeepAlive:
@@ -281,26 +375,34 @@ void Message::Write(WireEncoder& encoder) const {
       break;
     case kClientHello:
       encoder.Write8(kClientHello);
-      encoder.Write16(encoder.proto_rev());
-      if (encoder.proto_rev() < 0x0300u) {
+      encoder.Write16(m_id);
+      if (m_id < 0x0300u) {
         return;
       }
       encoder.WriteString(m_str);
+      if (m_id >= 0x0301u) {
+        encoder.WriteUleb128(m_sync_point.epoch);
+        encoder.WriteUleb128(m_sync_point.revision);
+      }
       break;
     case kProtoUnsup:
       encoder.Write8(kProtoUnsup);
-      encoder.Write16(encoder.proto_rev());
+      encoder.Write16(m_id);
       break;
     case kServerHelloDone:
       encoder.Write8(kServerHelloDone);
       break;
     case kServerHello:
-      if (encoder.proto_rev() < 0x0300u) {
+      if (m_id < 0x0300u) {
         return;  // new message in version 3.0
       }
       encoder.Write8(kServerHello);
       encoder.Write8(m_flags);
       encoder.WriteString(m_str);
+      if (m_id >= 0x0301u) {
+        encoder.WriteUleb128(m_sync_point.epoch);
+        encoder.WriteUleb128(m_sync_point.revision);
+      }
       break;
     case kClientHelloDone:
       if (encoder.proto_rev() < 0x0300u) {
@@ -368,6 +470,13 @@ void Message::Write(WireEncoder& encoder) const {
       encoder.Write16(m_seq_num_uid);
       encoder.WriteString(m_str);
       break;
+    case kSubscribe:
+      if (encoder.proto_rev() < 0x0300u) {
+        return;  // extension to version 3.0
+      }
+      encoder.Write8(kSubscribe);
+      encoder.WriteValue(*m_value);
+      break;
     default:
       break;
   }
@@ -5,10 +5,16 @@
 #ifndef NTCORE_MESSAGE_H_
 #define NTCORE_MESSAGE_H_
 
+#include <stdint.h>
+
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <string_view>
+#include <vector>
+
+#include <wpi/span.h>
 
 #include "networktables/NetworkTableValue.h"
 
@@ -17,6 +23,14 @@ namespace nt {
 class WireDecoder;
 class WireEncoder;
 
+// A state of a server's entries: the server run and a count of its changes.
+// A client presenting the sync point it last synchronized to is only sent
+// the changes since (protocol 3.1, an ntcore extension to 3.0).
+struct SyncPoint {
+  uint64_t epoch = 0;  // random per server start; 0 if none
+  uint64_t revision = 0;
+};
+
 class Message {
   struct private_init {};
 
@@ -35,8 +49,15 @@ class Message {
     kEntryDelete = 0x13,
     kClearEntries = 0x14,
     kExecuteRpc = 0x20,
-    kRpcResponse = 0x21
+    kRpcResponse = 0x21,
+    // ntcore extension; only sent to servers advertising kServerSubscribe
+    kSubscribe = 0x30
   };
+  // SERVER_HELLO flags
+  static constexpr unsigned int kServerReconnect = 0x01;
+  static constexpr unsigned int kServerSubscribe = 0x02;
+  // the handshake only carries the changes since the client's sync point
+  static constexpr unsigned int kServerResumed = 0x04;
   using GetEntryTypeFunc = std::function<NT_Type(unsigned int id)>;
 
   Message() = default;
@@ -52,9 +73,23 @@ class Message {
   unsigned int id() const { return m_id; }
   unsigned int flags() const { return m_flags; }
   unsigned int seq_num_uid() const { return m_seq_num_uid; }
+  const SyncPoint& sync_point() const { return m_sync_point; }
 
   // Read and write from wire representation
   void Write(WireEncoder& encoder) const;
+
+  // Wire representation for protocol 3.0 and 3.1, which only differ in the
+  // hello messages.  This is encoded on first use and kept, so a message
+  // queued to many connections is only encoded once.
+  std::string_view GetEncoded() const;
+
+  // Gathers the protocol 3.0 encodings of msgs for a scatter-gather write.
+  // Short encodings are copied together into buf, as separate small writes
+  // cost more than the copy; longer ones are referenced in place and stay
+  // valid while the messages are alive.  Returns the total size.
+  static size_t GatherEncoded(wpi::span<const std::shared_ptr<Message>> msgs,
+                              std::string* buf,
+                              std::vector<std::string_view>* bufs);
   static std::shared_ptr<Message> Read(WireDecoder& decoder,
                                        GetEntryTypeFunc get_entry_type);
 
@@ -62,9 +97,6 @@ class Message {
   static std::shared_ptr<Message> KeepAlive() {
     return std::make_shared<Message>(kKeepAlive, private_init());
   }
-  static std::shared_ptr<Message> ProtoUnsup() {
-    return std::make_shared<Message>(kProtoUnsup, private_init());
-  }
   static std::shared_ptr<Message> ServerHelloDone() {
     return std::make_shared<Message>(kServerHelloDone, private_init());
   }
@@ -75,10 +107,16 @@ class Message {
     return std::make_shared<Message>(kClearEntries, private_init());
   }
 
-  // Create messages with data
-  static std::shared_ptr<Message> ClientHello(std::string_view self_id);
-  static std::shared_ptr<Message> ServerHello(unsigned int flags,
-                                              std::string_view self_id);
+  // Create messages with data.  The hello messages are encoded for the
+  // protocol revision they carry rather than that of the encoder.
+  static std::shared_ptr<Message> ClientHello(unsigned int proto_rev,
+                                              std::string_view self_id,
+                                              const SyncPoint& sync = {});
+  static std::shared_ptr<Message> ProtoUnsup(unsigned int proto_rev);
+  static std::shared_ptr<Message> ServerHello(unsigned int proto_rev,
+                                              unsigned int flags,
+                                              std::string_view self_id,
+                                              const SyncPoint& sync = {});
   static std::shared_ptr<Message> EntryAssign(std::string_view name,
                                               unsigned int id,
                                               unsigned int seq_num,
@@ -94,6 +132,11 @@ class Message {
                                              std::string_view params);
   static std::shared_ptr<Message> RpcResponse(unsigned int id, unsigned int uid,
                                               std::string_view result);
+  // Replaces the set of entry name prefixes the server sends updates for;
+  // an empty set subscribes to everything.  The prefixes are carried as a
+  // string array value.
+  static std::shared_ptr<Message> Subscribe(
+      wpi::span<const std::string> prefixes);
 
   Message(const Message&) = delete;
   Message& operator=(const Message&) = delete;
@@ -107,6 +150,11 @@ class Message {
   unsigned int m_id{0};  // also used for proto_rev
   unsigned int m_flags{0};
   unsigned int m_seq_num_uid{0};
+  SyncPoint m_sync_point;  // hellos in protocol 3.1
+
+  // Cached encoding; see GetEncoded()
+  mutable std::once_flag m_encoded_flag;
+  mutable std::string m_encoded;
 };
 
 }  // namespace nt
@@ -4,7 +4,10 @@
 
 #include "NetworkConnection.h"
 
+#include <string>
+#include <string_view>
 #include <utility>
+#include <vector>
 
 #include <wpi/timestamp.h>
 #include <wpinet/NetworkStream.h>
@@ -192,6 +195,10 @@ void NetworkConnection::ReadThreadMain() {
     DEBUG3("received type={} with str={} id={} seq_num={}", msg->type(),
            msg->str(), msg->id(), msg->seq_num_uid());
     m_last_update = Now();
+    if (msg->Is(Message::kEntryAssign) && msg->id() == 0xffff) {
+      std::scoped_lock lock(m_pending_mutex);
+      m_pending.AddRequest(msg->str());
+    }
     m_process_incoming(std::move(msg), this);
   }
   DEBUG2("read thread died ({})", fmt::ptr(this));
@@ -210,6 +217,8 @@ done:
 
 void NetworkConnection::WriteThreadMain() {
   WireEncoder encoder(m_proto_rev);
+  std::string buf;
+  std::vector<std::string_view> bufs;
 
   while (m_active) {
     auto msgs = m_outgoing.pop();
@@ -217,27 +226,41 @@ void NetworkConnection::WriteThreadMain() {
     if (msgs.empty()) {
       continue;
     }
-    encoder.set_proto_rev(m_proto_rev);
-    encoder.Reset();
+    unsigned int proto_rev = m_proto_rev;
+    bufs.clear();
+    size_t size = 0;
     DEBUG3("sending {} messages", msgs.size());
     for (auto& msg : msgs) {
       if (msg) {
         DEBUG3("sending type={} with str={} id={} seq_num={}", msg->type(),
                msg->str(), msg->id(), msg->seq_num_uid());
-        msg->Write(encoder);
       }
     }
+    if (proto_rev >= 0x0300) {
+      // the encodings are shared with other connections sending msgs
+      size = Message::GatherEncoded(msgs, &buf, &bufs);
+    } else {
+      encoder.set_proto_rev(proto_rev);
+      encoder.Reset();
+      for (auto& msg : msgs) {
+        if (msg) {
+          msg->Write(encoder);
+        }
+      }
+      bufs.emplace_back(encoder.ToStringView());
+      size = encoder.size();
+    }
     wpi::NetworkStream::Error err;
     if (!m_stream) {
       break;
     }
-    if (encoder.size() == 0) {
+    if (size == 0) {
       continue;
     }
-    if (m_stream->send(encoder.data(), encoder.size(), &err) == 0) {
+    if (m_stream->sendv(bufs, &err) != size) {
       break;
     }
-    DEBUG4("sent {} bytes", encoder.size());
+    DEBUG4("sent {} bytes", size);
   }
   DEBUG2("write thread died ({})", fmt::ptr(this));
   set_state(kDead);
@@ -256,111 +279,20 @@ void NetworkConnection::WriteThreadMain() {
 
 void NetworkConnection::QueueOutgoing(std::shared_ptr<Message> msg) {
   std::scoped_lock lock(m_pending_mutex);
+  m_pending.Add(std::move(msg));
+}
 
-  // Merge with previous.  One case we don't combine: delete/assign loop.
-  switch (msg->type()) {
-    case Message::kEntryAssign:
-    case Message::kEntryUpdate: {
-      // don't do this for unassigned id's
-      unsigned int id = msg->id();
-      if (id == 0xffff) {
-        m_pending_outgoing.push_back(msg);
-        break;
-      }
-      if (id < m_pending_update.size() && m_pending_update[id].first != 0) {
-        // overwrite the previous one for this id
-        auto& oldmsg = m_pending_outgoing[m_pending_update[id].first - 1];
-        if (oldmsg && oldmsg->Is(Message::kEntryAssign) &&
-            msg->Is(Message::kEntryUpdate)) {
-          // need to update assignment with new seq_num and value
-          oldmsg = Message::EntryAssign(oldmsg->str(), id, msg->seq_num_uid(),
-                                        msg->value(), oldmsg->flags());
-        } else {
-          oldmsg = msg;  // easy update
-        }
-      } else {
-        // new, but remember it
-        size_t pos = m_pending_outgoing.size();
-        m_pending_outgoing.push_back(msg);
-        if (id >= m_pending_update.size()) {
-          m_pending_update.resize(id + 1);
-        }
-        m_pending_update[id].first = pos + 1;
-      }
-      break;
-    }
-    case Message::kEntryDelete: {
-      // don't do this for unassigned id's
-      unsigned int id = msg->id();
-      if (id == 0xffff) {
-        m_pending_outgoing.push_back(msg);
-        break;
-      }
-
-      // clear previous updates
-      if (id < m_pending_update.size()) {
-        if (m_pending_update[id].first != 0) {
-          m_pending_outgoing[m_pending_update[id].first - 1].reset();
-          m_pending_update[id].first = 0;
-        }
-        if (m_pending_update[id].second != 0) {
-          m_pending_outgoing[m_pending_update[id].second - 1].reset();
-          m_pending_update[id].second = 0;
-        }
-      }
-
-      // add deletion
-      m_pending_outgoing.push_back(msg);
-      break;
-    }
-    case Message::kFlagsUpdate: {
-      // don't do this for unassigned id's
-      unsigned int id = msg->id();
-      if (id == 0xffff) {
-        m_pending_outgoing.push_back(msg);
-        break;
-      }
-      if (id < m_pending_update.size() && m_pending_update[id].second != 0) {
-        // overwrite the previous one for this id
-        m_pending_outgoing[m_pending_update[id].second - 1] = msg;
-      } else {
-        // new, but remember it
-        size_t pos = m_pending_outgoing.size();
-        m_pending_outgoing.push_back(msg);
-        if (id >= m_pending_update.size()) {
-          m_pending_update.resize(id + 1);
-        }
-        m_pending_update[id].second = pos + 1;
-      }
-      break;
-    }
-    case Message::kClearEntries: {
-      // knock out all previous assigns/updates!
-      for (auto& i : m_pending_outgoing) {
-        if (!i) {
-          continue;
-        }
-        auto t = i->type();
-        if (t == Message::kEntryAssign || t == Message::kEntryUpdate ||
-            t == Message::kFlagsUpdate || t == Message::kEntryDelete ||
-            t == Message::kClearEntries) {
-          i.reset();
-        }
-      }
-      m_pending_update.resize(0);
-      m_pending_outgoing.push_back(msg);
-      break;
-    }
-    default:
-      m_pending_outgoing.push_back(msg);
-      break;
-  }
+void NetworkConnection::SetSubscriptions(
+    wpi::span<const std::string> prefixes,
+    wpi::span<const std::shared_ptr<Message>> assigns) {
+  std::scoped_lock lock(m_pending_mutex);
+  m_pending.SetSubscriptions(prefixes, assigns);
 }
 
 void NetworkConnection::PostOutgoing(bool keep_alive) {
   std::scoped_lock lock(m_pending_mutex);
   auto now = std::chrono::steady_clock::now();
-  if (m_pending_outgoing.empty()) {
+  if (m_pending.empty()) {
     if (!keep_alive) {
       return;
     }
@@ -370,9 +302,7 @@ void NetworkConnection::PostOutgoing(bool keep_alive) {
     }
     m_outgoing.emplace(Outgoing{Message::KeepAlive()});
   } else {
-    m_outgoing.emplace(std::move(m_pending_outgoing));
-    m_pending_outgoing.resize(0);
-    m_pending_update.resize(0);
+    m_outgoing.emplace(m_pending.Take());
   }
   m_last_post = now;
 }  // NOLINT
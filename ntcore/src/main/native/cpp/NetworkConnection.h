@@ -23,6 +23,7 @@
 
 #include "INetworkConnection.h"
 #include "Message.h"
+#include "PendingOutgoing.h"
 #include "ntcore_cpp.h"
 
 namespace wpi {
@@ -67,6 +68,9 @@ class NetworkConnection : public INetworkConnection {
 
   void QueueOutgoing(std::shared_ptr<Message> msg) final;
   void PostOutgoing(bool keep_alive) override;
+  void SetSubscriptions(
+      wpi::span<const std::string> prefixes,
+      wpi::span<const std::shared_ptr<Message>> assigns) final;
 
   unsigned int uid() const { return m_uid; }
 
@@ -108,8 +112,7 @@ class NetworkConnection : public INetworkConnection {
   std::chrono::steady_clock::time_point m_last_post;
 
   wpi::mutex m_pending_mutex;
-  Outgoing m_pending_outgoing;
-  std::vector<std::pair<size_t, size_t>> m_pending_update;
+  PendingOutgoing m_pending;
 
   // Condition variables for shutdown
   wpi::mutex m_shutdown_mutex;
@@ -0,0 +1,203 @@
+// Copyright (c) FIRST and other WPILib contributors.
+// Open Source Software; you can modify and/or share it under the terms of
+// the WPILib BSD license file in the root directory of this project.
+
+#include "PendingOutgoing.h"
+
+#include <algorithm>
+
+#include <wpi/StringExtras.h>
+
+using namespace nt;
+
+void PendingOutgoing::Add(std::shared_ptr<Message> msg) {
+  if (!m_prefixes.empty() && !Filter(*msg)) {
+    return;
+  }
+  Merge(std::move(msg));
+}
+
+void PendingOutgoing::SetSubscriptions(
+    wpi::span<const std::string> prefixes,
+    wpi::span<const std::shared_ptr<Message>> assigns) {
+  bool was_all = m_prefixes.empty();
+  m_prefixes.assign(prefixes.begin(), prefixes.end());
+  for (auto& msg : assigns) {
+    unsigned int id = msg->id();
+    if (id == 0xffff) {
+      continue;
+    }
+    if (id >= m_remote.size()) {
+      m_remote.resize(id + 1, was_all ? kRemoteKnown : kRemoteNone);
+    }
+    bool had = was_all || m_remote[id] == kRemoteSubscribed;
+    bool has = m_prefixes.empty() || IsSubscribed(msg->str());
+    if (has) {
+      m_remote[id] = kRemoteSubscribed;
+    } else if (m_remote[id] == kRemoteSubscribed) {
+      m_remote[id] = kRemoteKnown;
+    }
+    if (has && !had) {
+      Merge(msg);
+    }
+  }
+  if (m_prefixes.empty()) {
+    m_remote.clear();
+    m_requests.clear();
+  }
+}
+
+void PendingOutgoing::AddRequest(std::string_view name) {
+  if (!m_prefixes.empty() && !IsSubscribed(name)) {
+    m_requests.emplace_back(name);
+  }
+}
+
+bool PendingOutgoing::IsSubscribed(std::string_view name) const {
+  return std::any_of(
+      m_prefixes.begin(), m_prefixes.end(),
+      [&](const auto& prefix) { return wpi::starts_with(name, prefix); });
+}
+
+bool PendingOutgoing::Filter(const Message& msg) {
+  unsigned int id = msg.id();
+  switch (msg.type()) {
+    case Message::kEntryAssign: {
+      bool subscribed = IsSubscribed(msg.str());
+      bool pass = subscribed;
+      if (!subscribed) {
+        auto it = std::find(m_requests.begin(), m_requests.end(), msg.str());
+        if (it != m_requests.end()) {
+          m_requests.erase(it);
+          pass = true;
+        }
+      }
+      if (id != 0xffff && pass) {
+        if (id >= m_remote.size()) {
+          m_remote.resize(id + 1, kRemoteNone);
+        }
+        m_remote[id] = subscribed ? kRemoteSubscribed : kRemoteKnown;
+      }
+      return pass;
+    }
+    case Message::kEntryUpdate:
+    case Message::kFlagsUpdate:
+      return id < m_remote.size() && m_remote[id] == kRemoteSubscribed;
+    case Message::kEntryDelete:
+      if (id >= m_remote.size() || m_remote[id] == kRemoteNone) {
+        return false;
+      }
+      m_remote[id] = kRemoteNone;
+      return true;
+    default:
+      return true;
+  }
+}
+
+void PendingOutgoing::Merge(std::shared_ptr<Message> msg) {
+  // Merge with previous.  One case we don't combine: delete/assign loop.
+  switch (msg->type()) {
+    case Message::kEntryAssign:
+    case Message::kEntryUpdate: {
+      // don't do this for unassigned id's
+      unsigned int id = msg->id();
+      if (id == 0xffff) {
+        m_outgoing.push_back(msg);
+        break;
+      }
+      if (id < m_update.size() && m_update[id].first != 0) {
+        // overwrite the previous one for this id
+        auto& oldmsg = m_outgoing[m_update[id].first - 1];
+        if (oldmsg && oldmsg->Is(Message::kEntryAssign) &&
+            msg->Is(Message::kEntryUpdate)) {
+          // need to update assignment with new seq_num and value
+          oldmsg = Message::EntryAssign(oldmsg->str(), id, msg->seq_num_uid(),
+                                        msg->value(), oldmsg->flags());
+        } else {
+          oldmsg = msg;  // easy update
+        }
+      } else {
+        // new, but remember it
+        size_t pos = m_outgoing.size();
+        m_outgoing.push_back(msg);
+        if (id >= m_update.size()) {
+          m_update.resize(id + 1);
+        }
+        m_update[id].first = pos + 1;
+      }
+      break;
+    }
+    case Message::kEntryDelete: {
+      // don't do this for unassigned id's
+      unsigned int id = msg->id();
+      if (id == 0xffff) {
+        m_outgoing.push_back(msg);
+        break;
+      }
+
+      // clear previous updates
+      if (id < m_update.size()) {
+        if (m_update[id].first != 0) {
+          m_outgoing[m_update[id].first - 1].reset();
+          m_update[id].first = 0;
+        }
+        if (m_update[id].second != 0) {
+          m_outgoing[m_update[id].second - 1].reset();
+          m_update[id].second = 0;
+        }
+      }
+
+      // add deletion
+      m_outgoing.push_back(msg);
+      break;
+    }
+    case Message::kFlagsUpdate: {
+      // don't do this for unassigned id's
+      unsigned int id = msg->id();
+      if (id == 0xffff) {
+        m_outgoing.push_back(msg);
+        break;
+      }
+      if (id < m_update.size() && m_update[id].second != 0) {
+        // overwrite the previous one for this id
+        m_outgoing[m_update[id].second - 1] = msg;
+      } else {
+        // new, but remember it
+        size_t pos = m_outgoing.size();
+        m_outgoing.push_back(msg);
+        if (id >= m_update.size()) {
+          m_update.resize(id + 1);
+        }
+        m_update[id].second = pos + 1;
+      }
+      break;
+    }
+    case Message::kClearEntries: {
+      // knock out all previous assigns/updates!
+      for (auto& i : m_outgoing) {
+        if (!i) {
+          continue;
+        }
+        auto t = i->type();
+        if (t == Message::kEntryAssign || t == Message::kEntryUpdate ||
+            t == Message::kFlagsUpdate || t == Message::kEntryDelete ||
+            t == Message::kClearEntries) {
+          i.reset();
+        }
+      }
+      m_update.resize(0);
+      m_outgoing.push_back(msg);
+      break;
+    }
+    default:
+      m_outgoing.push_back(msg);
+      break;
+  }
+}
+
+PendingOutgoing::Outgoing PendingOutgoing::Take() {
+  Outgoing rv;
+  rv.swap(m_outgoing);
+  m_update.resize(0);
+  return rv;
+}
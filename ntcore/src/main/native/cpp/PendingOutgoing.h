@@ -0,0 +1,78 @@
+// Copyright (c) FIRST and other WPILib contributors.
+// Open Source Software; you can modify and/or share it under the terms of
+// the WPILib BSD license file in the root directory of this project.
+
+#ifndef NTCORE_PENDINGOUTGOING_H_
+#define NTCORE_PENDINGOUTGOING_H_
+
+#include <stdint.h>
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include <wpi/span.h>
+
+#include "Message.h"
+
+namespace nt {
+
+/**
+ * Messages queued for a connection between dispatch periods.  Successive
+ * updates to the same entry are merged so only the latest value is sent.
+ * Entry messages may also be filtered by a subscription from the remote.
+ * Not thread-safe; callers provide their own locking.
+ */
+class PendingOutgoing {
+ public:
+  using Outgoing = std::vector<std::shared_ptr<Message>>;
+
+  void Add(std::shared_ptr<Message> msg);
+
+  /**
+   * Limits subsequently added entry messages to entries whose names start
+   * with one of prefixes; an empty set passes all entries.  assigns are
+   * assignments for all current entries.  Those for entries that become
+   * subscribed are queued, as the remote's values for them may be stale.
+   */
+  void SetSubscriptions(wpi::span<const std::string> prefixes,
+                        wpi::span<const std::shared_ptr<Message>> assigns);
+
+  /**
+   * Notes that the remote requested an id for the named entry.  The
+   * assignment answering it is passed even if the entry is not subscribed.
+   */
+  void AddRequest(std::string_view name);
+
+  bool empty() const { return m_outgoing.empty(); }
+
+  /**
+   * Removes and returns all pending messages.  Messages superseded by a
+   * later delete or clear are returned as nullptr.
+   */
+  Outgoing Take();
+
+ private:
+  // What the remote has of an entry while subscriptions are in effect
+  enum RemoteState : uint8_t { kRemoteNone, kRemoteKnown, kRemoteSubscribed };
+
+  void Merge(std::shared_ptr<Message> msg);
+  bool IsSubscribed(std::string_view name) const;
+  bool Filter(const Message& msg);
+
+  Outgoing m_outgoing;
+  // per entry id, 1-based indices into m_outgoing of the pending
+  // assign/update and flags update
+  std::vector<std::pair<size_t, size_t>> m_update;
+
+  // subscriptions; all entries are passed if m_prefixes is empty
+  std::vector<std::string> m_prefixes;
+  std::vector<RemoteState> m_remote;  // by entry id
+  std::vector<std::string> m_requests;
+};
+
+}  // namespace nt
+
+#endif  // NTCORE_PENDINGOUTGOING_H_
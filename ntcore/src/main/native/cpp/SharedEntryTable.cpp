@@ -0,0 +1,558 @@
+// Copyright (c) FIRST and other WPILib contributors.
+// Open Source Software; you can modify and/or share it under the terms of
+// the WPILib BSD license file in the root directory of this project.
+
+#include "SharedEntryTable.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <climits>
+#include <cstring>
+#include <new>
+#include <thread>
+
+#include <fmt/format.h>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#endif
+
+using namespace nt;
+
+namespace {
+
+constexpr char kMagic[8] = {'N', 'T', 'S', 'H', 'M', '3', '0', '\0'};
+
+// segment bytes per slot; the rest is the data area
+constexpr size_t kBytesPerSlot = 256;
+
+// size of the waiter count segment
+constexpr size_t kWaitersSize = 64;
+
+}  // namespace
+
+struct SharedEntryTable::Header {
+  char magic[8];
+  uint32_t max_slots;
+  uint32_t reserved;
+  uint64_t data_offset;
+  uint64_t data_size;
+  std::atomic<uint32_t> num_slots;
+  std::atomic<uint32_t> changes;  // futex word
+  std::atomic<uint32_t> closed;
+  std::atomic<uint64_t> data_used;  // mirrors the writer's allocator
+};
+
+struct SharedEntryTable::Slot {
+  std::atomic<uint32_t> seq;  // odd while the writer is changing the slot
+  std::atomic<uint32_t> type;
+  std::atomic<uint64_t> name_offset;
+  std::atomic<uint64_t> name_len;  // set once, after the name is written
+  // data_offset and data_capacity mirror the writer's SlotState
+  std::atomic<uint64_t> data_offset;
+  std::atomic<uint64_t> data_capacity;
+  std::atomic<uint64_t> data_len;
+  std::atomic<uint64_t> time;
+};
+
+// the segment is shared between processes, so atomics must not use locks
+static_assert(std::atomic<uint32_t>::is_always_lock_free);
+static_assert(std::atomic<uint64_t>::is_always_lock_free);
+
+static size_t EncodedSize(const Value& value) {
+  switch (value.type()) {
+    case NT_BOOLEAN:
+      return 1;
+    case NT_DOUBLE:
+      return sizeof(double);
+    case NT_STRING:
+      return value.GetString().size();
+    case NT_RAW:
+      return value.GetRaw().size();
+    case NT_RPC:
+      return value.GetRpc().size();
+    case NT_BOOLEAN_ARRAY:
+      return value.GetBooleanArray().size();
+    case NT_DOUBLE_ARRAY:
+      return value.GetDoubleArray().size() * sizeof(double);
+    case NT_STRING_ARRAY: {
+      size_t size = 0;
+      for (auto&& str : value.GetStringArray()) {
+        size += sizeof(uint32_t) + str.size();
+      }
+      return size;
+    }
+    default:
+      return 0;
+  }
+}
+
+static void Encode(const Value& value, char* out) {
+  auto copy = [&](const void* data, size_t len) {
+    if (len != 0) {
+      std::memcpy(out, data, len);
+      out += len;
+    }
+  };
+  switch (value.type()) {
+    case NT_BOOLEAN:
+      *out = value.GetBoolean() ? 1 : 0;
+      break;
+    case NT_DOUBLE: {
+      double v = value.GetDouble();
+      copy(&v, sizeof(v));
+      break;
+    }
+    case NT_STRING:
+    case NT_RAW:
+    case NT_RPC: {
+      // all are stored as strings
+      auto str = value.GetString();
+      copy(str.data(), str.size());
+      break;
+    }
+    case NT_BOOLEAN_ARRAY:
+      for (int v : value.GetBooleanArray()) {
+        *out++ = v ? 1 : 0;
+      }
+      break;
+    case NT_DOUBLE_ARRAY: {
+      auto arr = value.GetDoubleArray();
+      copy(arr.data(), arr.size() * sizeof(double));
+      break;
+    }
+    case NT_STRING_ARRAY:
+      for (auto&& str : value.GetStringArray()) {
+        uint32_t len = str.size();
+        copy(&len, sizeof(len));
+        copy(str.data(), str.size());
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+static std::shared_ptr<Value> Decode(NT_Type type, std::string_view data,
+                                     uint64_t time) {
+  switch (type) {
+    case NT_BOOLEAN:
+      return Value::MakeBoolean(!data.empty() && data[0] != 0, time);
+    case NT_DOUBLE: {
+      double v = 0;
+      std::memcpy(&v, data.data(), (std::min)(data.size(), sizeof(v)));
+      return Value::MakeDouble(v, time);
+    }
+    case NT_STRING:
+      return Value::MakeString(data, time);
+    case NT_RAW:
+      return Value::MakeRaw(data, time);
+    case NT_RPC:
+      return Value::MakeRpc(data, time);
+    case NT_BOOLEAN_ARRAY: {
+      std::vector<int> arr(data.begin(), data.end());
+      return Value::MakeBooleanArray(arr, time);
+    }
+    case NT_DOUBLE_ARRAY: {
+      std::vector<double> arr(data.size() / sizeof(double));
+      std::memcpy(arr.data(), data.data(), arr.size() * sizeof(double));
+      return Value::MakeDoubleArray(arr, time);
+    }
+    case NT_STRING_ARRAY: {
+      std::vector<std::string> arr;
+      while (data.size() >= sizeof(uint32_t)) {
+        uint32_t len;
+        std::memcpy(&len, data.data(), sizeof(len));
+        data.remove_prefix(sizeof(len));
+        len = (std::min<size_t>)(len, data.size());
+        arr.emplace_back(data.substr(0, len));
+        data.remove_prefix(len);
+      }
+      return Value::MakeStringArray(std::move(arr), time);
+    }
+    default:
+      return nullptr;
+  }
+}
+
+#ifdef _WIN32
+
+std::unique_ptr<SharedEntryTable> SharedEntryTable::Create(unsigned int port,
+                                                           size_t size) {
+  return nullptr;
+}
+
+std::unique_ptr<SharedEntryTable> SharedEntryTable::Open(unsigned int port) {
+  return nullptr;
+}
+
+SharedEntryTable::~SharedEntryTable() = default;
+
+#else
+
+static std::string SegmentName(unsigned int port) {
+  return fmt::format("/ntcore-{}", port);
+}
+
+static std::string WaitersName(unsigned int port) {
+  return fmt::format("/ntcore-{}-waiters", port);
+}
+
+// Creates and maps a new segment; returns null on error.
+static void* CreateSegment(const std::string& name, size_t size) {
+  int fd = ::shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+  if (fd < 0) {
+    return nullptr;
+  }
+  if (::ftruncate(fd, size) != 0) {
+    ::close(fd);
+    ::shm_unlink(name.c_str());
+    return nullptr;
+  }
+  void* base =
+      ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  ::close(fd);
+  if (base == MAP_FAILED) {
+    ::shm_unlink(name.c_str());
+    return nullptr;
+  }
+  return base;
+}
+
+// Maps an existing segment; returns null on error.  *size is set to the
+// segment size, which must be at least minSize.
+static void* OpenSegment(const std::string& name, bool writable,
+                         size_t minSize, size_t* size) {
+  int fd = ::shm_open(name.c_str(), writable ? O_RDWR : O_RDONLY, 0);
+  if (fd < 0) {
+    return nullptr;
+  }
+  struct stat st;
+  if (::fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < minSize) {
+    ::close(fd);
+    return nullptr;
+  }
+  *size = st.st_size;
+  void* base = ::mmap(nullptr, *size, PROT_READ | (writable ? PROT_WRITE : 0),
+                      MAP_SHARED, fd, 0);
+  ::close(fd);
+  return base == MAP_FAILED ? nullptr : base;
+}
+
+std::unique_ptr<SharedEntryTable> SharedEntryTable::Create(unsigned int port,
+                                                           size_t size) {
+  size_t max_slots = size / kBytesPerSlot;
+  size_t data_offset = (sizeof(Header) + 63) & ~static_cast<size_t>(63);
+  data_offset += max_slots * sizeof(Slot);
+  if (max_slots == 0 || data_offset >= size) {
+    errno = EINVAL;
+    return nullptr;
+  }
+
+  // segments left by a server that didn't stop cleanly may still be mapped
+  // by readers, so make new ones rather than reusing them
+  auto name = SegmentName(port);
+  auto waitersName = WaitersName(port);
+  ::shm_unlink(name.c_str());
+  ::shm_unlink(waitersName.c_str());
+  void* waiters = CreateSegment(waitersName, kWaitersSize);
+  if (!waiters) {
+    return nullptr;
+  }
+  void* base = CreateSegment(name, size);
+  if (!base) {
+    ::munmap(waiters, kWaitersSize);
+    ::shm_unlink(waitersName.c_str());
+    return nullptr;
+  }
+  new (waiters) std::atomic<uint32_t>{0};
+
+  // the mapping starts zeroed; publish the layout before the magic
+  auto header = new (base) Header;
+  header->max_slots = max_slots;
+  header->data_offset = data_offset;
+  header->data_size = size - data_offset;
+  std::atomic_thread_fence(std::memory_order_release);
+  std::memcpy(header->magic, kMagic, sizeof(kMagic));
+
+  return std::unique_ptr<SharedEntryTable>(
+      new SharedEntryTable(std::move(name), base, size, data_offset,
+                           static_cast<unsigned int>(max_slots), waiters, true));
+}
+
+std::unique_ptr<SharedEntryTable> SharedEntryTable::Open(unsigned int port) {
+  auto name = SegmentName(port);
+  size_t size;
+  void* base = OpenSegment(name, false, sizeof(Header), &size);
+  if (!base) {
+    return nullptr;
+  }
+
+  auto header = static_cast<const Header*>(base);
+  bool valid = std::memcmp(header->magic, kMagic, sizeof(kMagic)) == 0;
+  std::atomic_thread_fence(std::memory_order_acquire);
+  uint64_t data_offset = header->data_offset;
+  uint32_t max_slots = header->max_slots;
+  if (!valid || data_offset > size ||
+      header->data_size != size - data_offset ||
+      sizeof(Header) + max_slots * sizeof(Slot) > data_offset) {
+    ::munmap(base, size);
+    return nullptr;
+  }
+
+  // registering as a waiter needs write access; without it, poll
+  size_t waitersSize;
+  void* waiters =
+      OpenSegment(WaitersName(port), true, kWaitersSize, &waitersSize);
+
+  return std::unique_ptr<SharedEntryTable>(new SharedEntryTable(
+      std::move(name), base, size, data_offset, max_slots, waiters, false));
+}
+
+SharedEntryTable::~SharedEntryTable() {
+  if (m_owner) {
+    m_header->closed.store(1, std::memory_order_release);
+    m_header->changes.fetch_add(1, std::memory_order_release);
+#ifdef __linux__
+    ::syscall(SYS_futex, &m_header->changes, FUTEX_WAKE, INT_MAX, nullptr,
+              nullptr, 0);
+#endif
+    ::shm_unlink(m_name.c_str());
+    ::shm_unlink((m_name + "-waiters").c_str());
+  }
+  if (m_waiters) {
+    ::munmap(m_waiters, kWaitersSize);
+  }
+  ::munmap(m_base, m_size);
+}
+
+#endif  // _WIN32
+
+SharedEntryTable::SharedEntryTable(std::string name, void* base, size_t size,
+                                   uint64_t data_offset,
+                                   unsigned int max_slots, void* waiters,
+                                   bool owner)
+    : m_name{std::move(name)},
+      m_base{base},
+      m_size{size},
+      m_waiters{static_cast<std::atomic<uint32_t>*>(waiters)},
+      m_owner{owner},
+      m_max_slots{max_slots} {
+  auto bytes = static_cast<char*>(base);
+  m_header = static_cast<Header*>(base);
+  m_slots = reinterpret_cast<Slot*>(
+      bytes + ((sizeof(Header) + 63) & ~static_cast<size_t>(63)));
+  m_data = bytes + data_offset;
+  m_data_size = size - data_offset;
+  if (owner) {
+    m_slot_state.resize(max_slots);
+  }
+}
+
+uint64_t SharedEntryTable::Allocate(uint64_t size) {
+  size = (size + 7) & ~static_cast<uint64_t>(7);
+  if (size > m_data_size - m_data_used) {
+    return UINT64_MAX;
+  }
+  uint64_t offset = m_data_used;
+  m_data_used += size;
+  m_header->data_used.store(m_data_used, std::memory_order_relaxed);
+  return offset;
+}
+
+bool SharedEntryTable::Write(unsigned int index, std::string_view name,
+                             const Value* value) {
+  if (index >= m_max_slots) {
+    return false;
+  }
+  Slot& slot = m_slots[index];
+  SlotState& state = m_slot_state[index];
+
+  // names never change, so they are written outside of the sequence lock
+  if (!state.named && !name.empty()) {
+    uint64_t offset = Allocate(name.size());
+    if (offset == UINT64_MAX) {
+      return false;
+    }
+    std::memcpy(m_data + offset, name.data(), name.size());
+    slot.name_offset.store(offset, std::memory_order_relaxed);
+    slot.name_len.store(name.size(), std::memory_order_release);
+    state.named = true;
+  }
+
+  size_t len = value ? EncodedSize(*value) : 0;
+  bool fits = len <= state.data_capacity;
+  if (!fits) {
+    // grow geometrically; the old space is not reused
+    uint64_t capacity = (std::max<uint64_t>)(len, state.data_capacity * 2);
+    uint64_t offset = Allocate(capacity);
+    if (offset == UINT64_MAX) {
+      value = nullptr;
+      len = 0;
+    } else {
+      state.data_offset = offset;
+      state.data_capacity = capacity;
+    }
+  }
+
+  uint32_t seq = state.seq;
+  state.seq += 2;
+  slot.seq.store(seq + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  slot.data_offset.store(state.data_offset, std::memory_order_relaxed);
+  slot.data_capacity.store(state.data_capacity, std::memory_order_relaxed);
+  slot.type.store(value ? value->type() : NT_UNASSIGNED,
+                  std::memory_order_relaxed);
+  slot.data_len.store(len, std::memory_order_relaxed);
+  slot.time.store(value ? value->time() : 0, std::memory_order_relaxed);
+  if (value) {
+    Encode(*value, m_data + state.data_offset);
+  }
+  slot.seq.store(seq + 2, std::memory_order_release);
+
+  if (index >= m_num_slots) {
+    m_num_slots = index + 1;
+    m_header->num_slots.store(m_num_slots, std::memory_order_release);
+  }
+
+  // sequentially consistent, so either the writer sees the waiter or the
+  // waiter sees the change
+  m_header->changes.fetch_add(1);
+#ifdef __linux__
+  if (m_waiters->load() != 0) {
+    ::syscall(SYS_futex, &m_header->changes, FUTEX_WAKE, INT_MAX, nullptr,
+              nullptr, 0);
+  }
+#endif
+  return fits || value;
+}
+
+unsigned int SharedEntryTable::GetNumSlots() const {
+  return (std::min)(m_header->num_slots.load(std::memory_order_acquire),
+                    m_max_slots);
+}
+
+std::string_view SharedEntryTable::GetName(unsigned int index) const {
+  if (index >= GetNumSlots()) {
+    return {};
+  }
+  const Slot& slot = m_slots[index];
+  uint64_t len = slot.name_len.load(std::memory_order_acquire);
+  uint64_t offset = slot.name_offset.load(std::memory_order_relaxed);
+  if (offset > m_data_size || len > m_data_size - offset) {
+    return {};
+  }
+  return {m_data + offset, static_cast<size_t>(len)};
+}
+
+template <typename F>
+bool SharedEntryTable::ReadSlot(unsigned int index, F&& copy) const {
+  if (index >= GetNumSlots()) {
+    return false;
+  }
+  const Slot& slot = m_slots[index];
+  for (;;) {
+    uint32_t seq = slot.seq.load(std::memory_order_acquire);
+    if ((seq & 1) != 0) {
+      std::this_thread::yield();
+      continue;
+    }
+    auto type = static_cast<NT_Type>(slot.type.load(std::memory_order_relaxed));
+    uint64_t offset = slot.data_offset.load(std::memory_order_relaxed);
+    uint64_t len = slot.data_len.load(std::memory_order_relaxed);
+    uint64_t time = slot.time.load(std::memory_order_relaxed);
+    // a torn read may see a bad offset; it is retried below
+    bool ok = type != NT_UNASSIGNED && offset <= m_data_size &&
+              len <= m_data_size - offset &&
+              copy(type, std::string_view{m_data + offset,
+                                          static_cast<size_t>(len)},
+                   time);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.seq.load(std::memory_order_relaxed) == seq) {
+      return ok;
+    }
+  }
+}
+
+std::shared_ptr<Value> SharedEntryTable::Read(unsigned int index) const {
+  NT_Type type = NT_UNASSIGNED;
+  uint64_t time = 0;
+  std::string buf;
+  if (!ReadSlot(index, [&](NT_Type t, std::string_view data, uint64_t tm) {
+        type = t;
+        time = tm;
+        buf.assign(data.data(), data.size());
+        return true;
+      })) {
+    return nullptr;
+  }
+  return Decode(type, buf, time);
+}
+
+bool SharedEntryTable::ReadDouble(unsigned int index, double* value) const {
+  return ReadSlot(index, [&](NT_Type type, std::string_view data, uint64_t) {
+    if (type != NT_DOUBLE || data.size() != sizeof(double)) {
+      return false;
+    }
+    std::memcpy(value, data.data(), sizeof(double));
+    return true;
+  });
+}
+
+bool SharedEntryTable::ReadDoubleArray(unsigned int index,
+                                       std::vector<double>* value) const {
+  return ReadSlot(index, [&](NT_Type type, std::string_view data, uint64_t) {
+    if (type != NT_DOUBLE_ARRAY) {
+      return false;
+    }
+    value->resize(data.size() / sizeof(double));
+    std::memcpy(value->data(), data.data(), value->size() * sizeof(double));
+    return true;
+  });
+}
+
+uint32_t SharedEntryTable::GetChangeCount() const {
+  return m_header->changes.load(std::memory_order_acquire);
+}
+
+bool SharedEntryTable::IsClosed() const {
+  return m_header->closed.load(std::memory_order_acquire) != 0;
+}
+
+bool SharedEntryTable::WaitForChange(uint32_t count, double timeout) const {
+  auto deadline = std::chrono::steady_clock::now() +
+                  std::chrono::duration_cast<std::chrono::nanoseconds>(
+                      std::chrono::duration<double>(timeout));
+  while (GetChangeCount() == count && !IsClosed()) {
+    auto left = deadline - std::chrono::steady_clock::now();
+    if (timeout >= 0 && left <= std::chrono::nanoseconds::zero()) {
+      return false;
+    }
+#ifdef __linux__
+    if (m_waiters) {
+      struct timespec ts;
+      auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(left);
+      ts.tv_sec = ns.count() / 1000000000;
+      ts.tv_nsec = ns.count() % 1000000000;
+      m_waiters->fetch_add(1);
+      ::syscall(SYS_futex, &m_header->changes, FUTEX_WAIT, count,
+                timeout >= 0 ? &ts : nullptr, nullptr, 0);
+      m_waiters->fetch_sub(1);
+      continue;
+    }
+#endif
+    // without a futex (or write access to register as a waiter), poll
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return true;
+}
@@ -0,0 +1,133 @@
+// Copyright (c) FIRST and other WPILib contributors.
+// Open Source Software; you can modify and/or share it under the terms of
+// the WPILib BSD license file in the root directory of this project.
+
+#ifndef NTCORE_SHAREDENTRYTABLE_H_
+#define NTCORE_SHAREDENTRYTABLE_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "networktables/NetworkTableValue.h"
+
+namespace nt {
+
+/**
+ * Entry values in a shared memory segment, written by a server and read by
+ * other processes on the same host.
+ *
+ * The segment holds a header, a fixed table of slots (one per local entry id)
+ * and a data area that names and values are allocated from.  Each slot is
+ * guarded by a sequence lock: the writer never waits for readers, and a
+ * reader copies the value and retries if the slot changed meanwhile.  The
+ * header counts changes; readers wait on the count (a futex on Linux, polling
+ * elsewhere).
+ *
+ * Readers map the segment read-only.  The writer keeps its allocator state
+ * in private memory and only mirrors it into the segment, so it never acts
+ * on values another process could have changed.  Waiting readers register
+ * in a second, small segment that readers may write.
+ *
+ * Not supported on Windows, where Create() and Open() return null.
+ */
+class SharedEntryTable {
+ public:
+  struct Header;
+  struct Slot;
+
+  /**
+   * Creates the segment for a server port, replacing any stale one.
+   *
+   * @param port  server port
+   * @param size  segment size in bytes
+   * @return Table for writing, or null on error (errno is set)
+   */
+  static std::unique_ptr<SharedEntryTable> Create(unsigned int port,
+                                                  size_t size);
+
+  /**
+   * Opens the segment of a server port.
+   *
+   * @param port  server port
+   * @return Table for reading, or null if there isn't one
+   */
+  static std::unique_ptr<SharedEntryTable> Open(unsigned int port);
+
+  // Closes the segment; the creator also marks it closed and removes it.
+  ~SharedEntryTable();
+
+  SharedEntryTable(const SharedEntryTable&) = delete;
+  SharedEntryTable& operator=(const SharedEntryTable&) = delete;
+
+  // Writer functions.  There may only be one writer at a time.
+
+  /**
+   * Stores an entry value, or marks the entry deleted if value is null.
+   *
+   * @return False if the slot or data area is exhausted
+   */
+  bool Write(unsigned int index, std::string_view name, const Value* value);
+
+  // Reader functions.
+
+  unsigned int GetNumSlots() const;
+
+  // Returns an empty name if the slot hasn't been written.
+  std::string_view GetName(unsigned int index) const;
+
+  std::shared_ptr<Value> Read(unsigned int index) const;
+  bool ReadDouble(unsigned int index, double* value) const;
+  bool ReadDoubleArray(unsigned int index, std::vector<double>* value) const;
+
+  uint32_t GetChangeCount() const;
+
+  // Waits until the change count differs from count or the segment is
+  // closed.  A negative timeout waits forever.  Returns false on timeout.
+  bool WaitForChange(uint32_t count, double timeout) const;
+
+  bool IsClosed() const;
+
+ private:
+  // writer state of a slot; mirrored into the segment
+  struct SlotState {
+    uint32_t seq = 0;
+    bool named = false;
+    uint64_t data_offset = 0;
+    uint64_t data_capacity = 0;
+  };
+
+  SharedEntryTable(std::string name, void* base, size_t size,
+                   uint64_t data_offset, unsigned int max_slots, void* waiters,
+                   bool owner);
+
+  template <typename F>
+  bool ReadSlot(unsigned int index, F&& copy) const;
+  uint64_t Allocate(uint64_t size);
+
+  std::string m_name;
+  void* m_base;
+  size_t m_size;
+  // waiter count segment; null if it couldn't be opened for writing
+  std::atomic<uint32_t>* m_waiters;
+  bool m_owner;
+  Header* m_header;
+  Slot* m_slots;
+  char* m_data;
+  uint64_t m_data_size;
+
+  unsigned int m_max_slots;
+
+  // writer only
+  unsigned int m_num_slots = 0;
+  uint64_t m_data_used = 0;
+  std::vector<SlotState> m_slot_state;
+};
+
+}  // namespace nt
+
+#endif  // NTCORE_SHAREDENTRYTABLE_H_
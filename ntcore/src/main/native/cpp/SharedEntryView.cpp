@@ -0,0 +1,95 @@
+// Copyright (c) FIRST and other WPILib contributors.
+// Open Source Software; you can modify and/or share it under the terms of
+// the WPILib BSD license file in the root directory of this project.
+
+#include "networktables/SharedEntryView.h"
+
+#include <utility>
+
+#include <wpi/StringExtras.h>
+
+#include "SharedEntryTable.h"
+
+using namespace nt;
+
+static bool IsLocal(std::string_view server) {
+  server = wpi::trim(server);
+  return server.empty() || server == "localhost" ||
+         wpi::starts_with(server, "127.") || server == "::1";
+}
+
+std::unique_ptr<SharedEntryView> SharedEntryView::Open(std::string_view server,
+                                                       unsigned int port) {
+  if (!IsLocal(server)) {
+    return nullptr;
+  }
+  auto table = SharedEntryTable::Open(port);
+  if (!table) {
+    return nullptr;
+  }
+  return std::unique_ptr<SharedEntryView>{
+      new SharedEntryView{std::move(table)}};
+}
+
+SharedEntryView::SharedEntryView(std::unique_ptr<SharedEntryTable> table)
+    : m_table{std::move(table)} {}
+
+SharedEntryView::~SharedEntryView() = default;
+
+int SharedEntryView::GetIndex(std::string_view name) {
+  auto it = m_indexes.find(name);
+  if (it != m_indexes.end()) {
+    return it->second;
+  }
+
+  // Slot names never change once written, so only rescan from the first
+  // slot that had no name yet.
+  unsigned int num = m_table->GetNumSlots();
+  unsigned int firstUnnamed = num;
+  for (unsigned int i = m_scanned; i < num; ++i) {
+    auto slotName = m_table->GetName(i);
+    if (slotName.empty()) {
+      if (firstUnnamed == num) {
+        firstUnnamed = i;
+      }
+      continue;
+    }
+    m_indexes.try_emplace(slotName, i);
+  }
+  m_scanned = firstUnnamed;
+
+  it = m_indexes.find(name);
+  return it == m_indexes.end() ? -1 : static_cast<int>(it->second);
+}
+
+std::shared_ptr<Value> SharedEntryView::GetValue(int index) const {
+  if (index < 0) {
+    return nullptr;
+  }
+  return m_table->Read(index);
+}
+
+double SharedEntryView::GetDouble(int index, double defaultValue) const {
+  double value;
+  if (index < 0 || !m_table->ReadDouble(index, &value)) {
+    return defaultValue;
+  }
+  return value;
+}
+
+bool SharedEntryView::GetDoubleArray(int index,
+                                     std::vector<double>* value) const {
+  return index >= 0 && m_table->ReadDoubleArray(index, value);
+}
+
+uint32_t SharedEntryView::GetChangeCount() const {
+  return m_table->GetChangeCount();
+}
+
+bool SharedEntryView::WaitForChange(uint32_t count, double timeout) const {
+  return m_table->WaitForChange(count, timeout);
+}
+
+bool SharedEntryView::IsClosed() const {
+  return m_table->IsClosed();
+}
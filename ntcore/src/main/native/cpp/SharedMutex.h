@@ -0,0 +1,56 @@
+// Copyright (c) FIRST and other WPILib contributors.
+// Open Source Software; you can modify and/or share it under the terms of
+// the WPILib BSD license file in the root directory of this project.
+
+#ifndef NTCORE_SHAREDMUTEX_H_
+#define NTCORE_SHAREDMUTEX_H_
+
+#include <atomic>
+#include <shared_mutex>
+
+#include <wpi/mutex.h>
+
+namespace nt {
+
+/**
+ * Reader-writer mutex where a waiting writer holds off new readers, so a
+ * steady stream of readers can't starve writers (the platform shared mutex
+ * commonly prefers readers).  Writers are serialized on a wpi::mutex, so they
+ * keep priority inheritance between each other where it is available.
+ *
+ * Usable with std::unique_lock, std::scoped_lock and std::shared_lock.
+ */
+class SharedMutex {
+ public:
+  void lock() {
+    m_writer.lock();
+    m_writer_waiting.store(true, std::memory_order_relaxed);
+    m_rw.lock();
+  }
+
+  void unlock() {
+    m_writer_waiting.store(false, std::memory_order_relaxed);
+    m_rw.unlock();
+    m_writer.unlock();
+  }
+
+  void lock_shared() {
+    if (m_writer_waiting.load(std::memory_order_relaxed)) {
+      // wait for the writer to finish
+      m_writer.lock();
+      m_writer.unlock();
+    }
+    m_rw.lock_shared();
+  }
+
+  void unlock_shared() { m_rw.unlock_shared(); }
+
+ private:
+  wpi::mutex m_writer;
+  std::atomic_bool m_writer_waiting{false};
+  std::shared_mutex m_rw;
+};
+
+}  // namespace nt
+
+#endif  // NTCORE_SHAREDMUTEX_H_
@@ -4,6 +4,13 @@
 
 #include "Storage.h"
 
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <type_traits>
+
 #include <wpi/DataLog.h>
 #include <wpi/StringExtras.h>
 #include <wpi/timestamp.h>
@@ -14,10 +21,79 @@
 #include "INetworkConnection.h"
 #include "IRpcServer.h"
 #include "Log.h"
+#include "Value_internal.h"
 #include "ntcore_c.h"
 
 using namespace nt;
 
+// Helpers for the typed setters.
+static bool ValueEquals(const Value& value, bool v) {
+  return value.GetBoolean() == v;
+}
+
+static bool ValueEquals(const Value& value, double v) {
+  return value.GetDouble() == v;
+}
+
+static bool ValueEquals(const Value& value, std::string_view v) {
+  return ConvertFromC(value.value().data.v_string) == v;
+}
+
+template <typename T>
+static bool ValueEquals(const Value& value, wpi::span<const T> v) {
+  wpi::span<const T> cur;
+  if constexpr (std::is_same_v<T, int>) {
+    cur = value.GetBooleanArray();
+  } else {
+    cur = value.GetDoubleArray();
+  }
+  return std::equal(cur.begin(), cur.end(), v.begin(), v.end());
+}
+
+static std::shared_ptr<Value> MakeValue(NT_Type, bool v, uint64_t time) {
+  return Value::MakeBoolean(v, time);
+}
+
+static std::shared_ptr<Value> MakeValue(NT_Type, double v, uint64_t time) {
+  return Value::MakeDouble(v, time);
+}
+
+static std::shared_ptr<Value> MakeValue(NT_Type type, std::string_view v,
+                                        uint64_t time) {
+  return type == NT_RAW ? Value::MakeRaw(v, time) : Value::MakeString(v, time);
+}
+
+static std::shared_ptr<Value> MakeValue(NT_Type, wpi::span<const int> v,
+                                        uint64_t time) {
+  return Value::MakeBooleanArray(v, time);
+}
+
+static std::shared_ptr<Value> MakeValue(NT_Type, wpi::span<const double> v,
+                                        uint64_t time) {
+  return Value::MakeDoubleArray(v, time);
+}
+
+static void UpdateValue(Value& value, bool v, uint64_t time) {
+  ValueUpdater::SetBoolean(value, v, time);
+}
+
+static void UpdateValue(Value& value, double v, uint64_t time) {
+  ValueUpdater::SetDouble(value, v, time);
+}
+
+static void UpdateValue(Value& value, std::string_view v, uint64_t time) {
+  ValueUpdater::SetString(value, v, time);
+}
+
+static void UpdateValue(Value& value, wpi::span<const int> v, uint64_t time) {
+  ValueUpdater::SetBooleanArray(value, v, time);
+}
+
+static void UpdateValue(Value& value, wpi::span<const double> v,
+                        uint64_t time) {
+  ValueUpdater::SetDoubleArray(value, v, time);
+}
+
 Storage::Storage(IEntryNotifier& notifier, IRpcServer& rpc_server,
                  wpi::Logger& logger)
     : m_notifier(notifier), m_rpc_server(rpc_server), m_logger(logger) {
@@ -33,6 +109,78 @@ void Storage::SetDispatcher(IDispatcher* dispatcher, bool server) {
   std::scoped_lock lock(m_mutex);
   m_dispatcher = dispatcher;
   m_server = server;
+  if (server) {
+    // clients can't resume from sync points of another server run
+    std::random_device rd;
+    m_epoch = (static_cast<uint64_t>(rd()) << 32) | rd();
+    if (m_epoch == 0) {
+      m_epoch = 1;
+    }
+    m_sync = {};
+  }
+}
+
+void Storage::StartSharedTable(unsigned int port, size_t size) {
+  auto table = SharedEntryTable::Create(port, size);
+  if (!table) {
+    WARNING("could not create shared memory for port {}: {}", port,
+            std::strerror(errno));
+    return;
+  }
+  std::scoped_lock lock(m_mutex);
+  m_shared = std::move(table);
+  for (auto&& entry : m_localmap) {
+    if (entry->value) {
+      m_shared->Write(entry->local_id, entry->name, entry->value.get());
+    }
+  }
+}
+
+void Storage::StopSharedTable() {
+  std::unique_ptr<SharedEntryTable> table;
+  std::scoped_lock lock(m_mutex);
+  table = std::move(m_shared);
+}
+
+void Storage::FlushPendingUpdates() {
+  std::unique_lock lock(m_mutex);
+  if (m_pending_updates.empty()) {
+    return;
+  }
+  std::vector<std::shared_ptr<Message>> msgs;
+  if (m_dispatcher) {
+    msgs.reserve(m_pending_updates.size());
+  }
+  // updates still held back are added to m_pending_updates again
+  std::vector<unsigned int> pending;
+  pending.swap(m_pending_updates);
+  for (auto local_id : pending) {
+    Entry* entry = m_localmap[local_id].get();
+    entry->pending_update = false;
+    // always send the current value; if the entry was deleted or assigned
+    // in the meantime, this is either skipped or a harmless repeat
+    if (!m_dispatcher || !entry->value || entry->id == 0xffff) {
+      continue;
+    }
+    if (ThrottleUpdate(entry)) {
+      continue;
+    }
+    msgs.emplace_back(Message::EntryUpdate(entry->id, entry->seq_num.value(),
+                                           entry->value));
+  }
+  if (m_pending_updates.empty()) {
+    // keep the allocation
+    pending.clear();
+    m_pending_updates.swap(pending);
+  }
+  if (msgs.empty()) {
+    return;
+  }
+  auto dispatcher = m_dispatcher;
+  lock.unlock();
+  for (auto& msg : msgs) {
+    dispatcher->QueueOutgoing(std::move(msg), nullptr, nullptr);
+  }
 }
 
 void Storage::ClearDispatcher() {
@@ -40,7 +188,7 @@ void Storage::ClearDispatcher() {
 }
 
 NT_Type Storage::GetMessageEntryType(unsigned int id) const {
-  std::scoped_lock lock(m_mutex);
+  std::shared_lock lock(m_mutex);
   if (id >= m_idmap.size()) {
     return NT_UNASSIGNED;
   }
@@ -85,6 +233,9 @@ void Storage::ProcessIncoming(std::shared_ptr<Message> msg,
     case Message::kRpcResponse:
       ProcessIncomingRpcResponse(std::move(msg), conn);
       break;
+    case Message::kSubscribe:
+      ProcessIncomingSubscribe(std::move(msg), conn);
+      break;
     default:
       break;
   }
@@ -104,8 +255,19 @@ void Storage::ProcessIncomingEntryAssign(std::shared_ptr<Message> msg,
     // the sender as well as all other connections.
     if (id == 0xffff) {
       entry = GetOrNew(name);
-      // see if it was already assigned; ignore if so.
+      // If it was already assigned, the sender didn't get the assignment
+      // (e.g. the entry is outside its subscriptions); answer the request
+      // so it learns the id.
       if (entry->id != 0xffff) {
+        if (!m_dispatcher || !entry->value) {
+          return;
+        }
+        auto dispatcher = m_dispatcher;
+        auto outmsg =
+            Message::EntryAssign(entry->name, entry->id, entry->seq_num.value(),
+                                 entry->value, entry->flags);
+        lock.unlock();
+        dispatcher->QueueOutgoing(outmsg, conn, nullptr);
         return;
       }
 
@@ -191,7 +353,7 @@ void Storage::ProcessIncomingEntryAssign(std::shared_ptr<Message> msg,
   if (!may_need_update && conn->proto_rev() >= 0x0300) {
     // update persistent dirty flag if persistent flag changed
     if ((entry->flags & NT_PERSISTENT) != (msg->flags() & NT_PERSISTENT)) {
-      m_persistent_dirty = true;
+      MarkPersistentDirty(entry);
     }
     if (entry->flags != msg->flags()) {
       notify_flags |= NT_NOTIFY_FLAGS;
@@ -201,7 +363,7 @@ void Storage::ProcessIncomingEntryAssign(std::shared_ptr<Message> msg,
 
   // update persistent dirty flag if the value changed and it's persistent
   if (entry->IsPersistent() && *entry->value != *msg->value()) {
-    m_persistent_dirty = true;
+    MarkPersistentDirty(entry);
   }
 
   // update local
@@ -247,7 +409,7 @@ void Storage::ProcessIncomingEntryUpdate(std::shared_ptr<Message> msg,
 
   // update persistent dirty flag if it's a persistent value
   if (entry->IsPersistent()) {
-    m_persistent_dirty = true;
+    MarkPersistentDirty(entry);
   }
 
   // notify
@@ -256,6 +418,9 @@ void Storage::ProcessIncomingEntryUpdate(std::shared_ptr<Message> msg,
   // broadcast to all other connections (note for client there won't
   // be any other connections, so don't bother)
   if (m_server && m_dispatcher) {
+    if (ThrottleUpdate(entry)) {
+      return;
+    }
     auto dispatcher = m_dispatcher;
     lock.unlock();
     dispatcher->QueueOutgoing(msg, nullptr, conn);
@@ -371,7 +536,7 @@ void Storage::ProcessIncomingExecuteRpc(
 
 void Storage::ProcessIncomingRpcResponse(std::shared_ptr<Message> msg,
                                          INetworkConnection* /*conn*/) {
-  std::unique_lock lock(m_mutex);
+  std::shared_lock lock(m_mutex);
   if (m_server) {
     return;  // only process on client
   }
@@ -389,13 +554,39 @@ void Storage::ProcessIncomingRpcResponse(std::shared_ptr<Message> msg,
     DEBUG0("{}", "received RPC response to non-RPC entry");
     return;
   }
-  m_rpc_results.insert({RpcIdPair{entry->local_id, msg->seq_num_uid()},
-                        std::string{msg->str()}});
+  unsigned int local_id = entry->local_id;
+  lock.unlock();
+
+  std::scoped_lock rpc_lock(m_rpc_mutex);
+  m_rpc_results.insert(
+      {RpcIdPair{local_id, msg->seq_num_uid()}, std::string{msg->str()}});
   m_rpc_results_cond.notify_all();
 }
 
+void Storage::ProcessIncomingSubscribe(std::shared_ptr<Message> msg,
+                                       INetworkConnection* conn) {
+  // Held while applying the subscription, so an update racing with it is
+  // either in the assignments or passes the new filter.
+  std::shared_lock lock(m_mutex);
+  if (!m_server) {
+    return;  // only process on server
+  }
+  std::vector<std::shared_ptr<Message>> assigns;
+  for (auto& i : m_entries) {
+    Entry* entry = i.getValue();
+    if (!entry->value || entry->id == 0xffff) {
+      continue;
+    }
+    assigns.emplace_back(Message::EntryAssign(i.getKey(), entry->id,
+                                              entry->seq_num.value(),
+                                              entry->value, entry->flags));
+  }
+  conn->SetSubscriptions(msg->value()->GetStringArray(), assigns);
+}
+
 void Storage::GetInitialAssignments(
-    INetworkConnection& conn, std::vector<std::shared_ptr<Message>>* msgs) {
+    INetworkConnection& conn, std::vector<std::shared_ptr<Message>>* msgs,
+    SyncPoint* sync) {
   std::scoped_lock lock(m_mutex);
   conn.set_state(INetworkConnection::kSynchronized);
   for (auto& i : m_entries) {
@@ -407,17 +598,53 @@ void Storage::GetInitialAssignments(
                                             entry->seq_num.value(),
                                             entry->value, entry->flags));
   }
+  *sync = {m_epoch, m_revision};
+}
+
+bool Storage::GetResumeAssignments(INetworkConnection& conn,
+                                   const SyncPoint& since,
+                                   std::vector<std::shared_ptr<Message>>* msgs,
+                                   SyncPoint* sync) {
+  std::scoped_lock lock(m_mutex);
+  if (!m_server || since.epoch != m_epoch ||
+      since.revision < m_deleted_floor || since.revision > m_revision) {
+    return false;
+  }
+  conn.set_state(INetworkConnection::kSynchronized);
+
+  // deletes go first, as an entry deleted and created again has a new id
+  auto deleted = std::upper_bound(
+      m_deleted.begin(), m_deleted.end(), since.revision,
+      [](uint64_t revision, const auto& del) { return revision < del.first; });
+  for (; deleted != m_deleted.end(); ++deleted) {
+    msgs->emplace_back(Message::EntryDelete(deleted->second));
+  }
+
+  for (auto& i : m_entries) {
+    Entry* entry = i.getValue();
+    if (!entry->value || entry->revision <= since.revision) {
+      continue;
+    }
+    msgs->emplace_back(Message::EntryAssign(i.getKey(), entry->id,
+                                            entry->seq_num.value(),
+                                            entry->value, entry->flags));
+  }
+  *sync = {m_epoch, m_revision};
+  return true;
 }
 
 void Storage::ApplyInitialAssignments(
     INetworkConnection& conn, wpi::span<std::shared_ptr<Message>> msgs,
-    bool /*new_server*/, std::vector<std::shared_ptr<Message>>* out_msgs) {
+    bool /*new_server*/, const SyncPoint& sync,
+    std::vector<std::shared_ptr<Message>>* out_msgs) {
   std::unique_lock lock(m_mutex);
   if (m_server) {
     return;  // should not do this on server
   }
 
   conn.set_state(INetworkConnection::kSynchronized);
+  m_sync = sync;
+  m_sync_revision = m_revision;
 
   std::vector<std::shared_ptr<Message>> update_msgs;
 
@@ -462,6 +689,8 @@ void Storage::ApplyInitialAssignments(
         ++entry->seq_num;
         update_msgs.emplace_back(Message::EntryUpdate(
             entry->id, entry->seq_num.value(), entry->value));
+        // sent after the handshake, so it may not reach the server
+        entry->revision = ++m_revision;
       } else {
         entry->value = msg->value();
         unsigned int notify_flags = NT_NOTIFY_UPDATE;
@@ -508,8 +737,112 @@ void Storage::ApplyInitialAssignments(
   }
 }
 
+void Storage::ApplyResumeAssignments(
+    INetworkConnection& conn, wpi::span<std::shared_ptr<Message>> msgs,
+    const SyncPoint& sync, std::vector<std::shared_ptr<Message>>* out_msgs) {
+  std::unique_lock lock(m_mutex);
+  if (m_server) {
+    return;  // should not do this on server
+  }
+
+  conn.set_state(INetworkConnection::kSynchronized);
+
+  // local changes since the last sync may not have reached the server
+  uint64_t since = m_sync_revision;
+  auto changed = [&](const Entry* entry) { return entry->revision > since; };
+
+  for (auto& msg : msgs) {
+    unsigned int id = msg->id();
+    if (msg->Is(Message::kEntryDelete)) {
+      if (id >= m_idmap.size() || !m_idmap[id]) {
+        continue;
+      }
+      Entry* entry = m_idmap[id];
+      m_idmap[id] = nullptr;
+      entry->id = 0xffff;
+      // a locally changed entry is assigned again below
+      if (entry->value && !changed(entry)) {
+        Notify(entry, NT_NOTIFY_DELETE, false);
+        entry->local_write = false;
+        entry->value.reset();
+      }
+      continue;
+    }
+    if (!msg->Is(Message::kEntryAssign) || id == 0xffff) {
+      DEBUG0("{}", "client: received unexpected message in resumed sync");
+      continue;
+    }
+
+    Entry* entry = GetOrNew(msg->str());
+    entry->seq_num = SequenceNumber(msg->seq_num_uid());
+    entry->id = id;
+    if (!entry->value) {
+      entry->value = msg->value();
+      entry->flags = msg->flags();
+      Notify(entry, NT_NOTIFY_NEW, false);
+    } else if (!changed(entry) || entry->IsPersistent()) {
+      // same resolution as the initial assignments: a local change wins
+      // unless the value is persistent
+      unsigned int notify_flags = NT_NOTIFY_UPDATE;
+      if (entry->flags != msg->flags()) {
+        notify_flags |= NT_NOTIFY_FLAGS;
+      }
+      entry->value = msg->value();
+      entry->flags = msg->flags();
+      entry->revision = 0;
+      Notify(entry, notify_flags, false);
+    }
+
+    if (id >= m_idmap.size()) {
+      m_idmap.resize(id + 1);
+    }
+    m_idmap[id] = entry;
+  }
+
+  // Local deletes first, as a deleted entry created again locally is sent
+  // as a new assignment.  Entries the server assigned above were changed
+  // there since, which wins over the delete.
+  auto deleted = std::upper_bound(
+      m_deleted.begin(), m_deleted.end(), since,
+      [](uint64_t revision, const auto& del) { return revision < del.first; });
+  for (; deleted != m_deleted.end(); ++deleted) {
+    unsigned int id = deleted->second;
+    if (id >= m_idmap.size() || !m_idmap[id]) {
+      out_msgs->emplace_back(Message::EntryDelete(id));
+    }
+  }
+
+  for (auto& entry : m_localmap) {
+    if (!entry->value || !changed(entry.get())) {
+      continue;
+    }
+    if (entry->id == 0xffff) {
+      out_msgs->emplace_back(Message::EntryAssign(entry->name, entry->id,
+                                                  entry->seq_num.value(),
+                                                  entry->value, entry->flags));
+    } else {
+      ++entry->seq_num;
+      out_msgs->emplace_back(Message::EntryUpdate(
+          entry->id, entry->seq_num.value(), entry->value));
+      out_msgs->emplace_back(Message::FlagsUpdate(entry->id, entry->flags));
+    }
+  }
+
+  m_sync = sync;
+  m_sync_revision = m_revision;
+}
+
+SyncPoint Storage::GetSyncPoint() const {
+  std::shared_lock lock(m_mutex);
+  // local deletes since the sync are sent on resume, so none may be dropped
+  if (m_server || m_deleted_floor > m_sync_revision) {
+    return {};
+  }
+  return m_sync;
+}
+
 std::shared_ptr<Value> Storage::GetEntryValue(std::string_view name) const {
-  std::scoped_lock lock(m_mutex);
+  std::shared_lock lock(m_mutex);
   auto i = m_entries.find(name);
   if (i == m_entries.end()) {
     return nullptr;
@@ -518,7 +851,7 @@ std::shared_ptr<Value> Storage::GetEntryValue(std::string_view name) const {
 }
 
 std::shared_ptr<Value> Storage::GetEntryValue(unsigned int local_id) const {
-  std::scoped_lock lock(m_mutex);
+  std::shared_lock lock(m_mutex);
   if (local_id >= m_localmap.size()) {
     return nullptr;
   }
@@ -603,8 +936,80 @@ bool Storage::SetEntryValue(unsigned int local_id,
   return true;
 }
 
+// Returns true if the update is within the deadband of the last value sent.
+static bool WithinDeadband(const Value& value, wpi::span<const double> sent,
+                           double deadband) {
+  if (value.IsDouble()) {
+    return sent.size() == 1 &&
+           std::abs(value.GetDouble() - sent[0]) <= deadband;
+  } else if (value.IsDoubleArray()) {
+    auto arr = value.GetDoubleArray();
+    if (arr.size() != sent.size()) {
+      return false;
+    }
+    for (size_t i = 0; i < arr.size(); ++i) {
+      if (!(std::abs(arr[i] - sent[i]) <= deadband)) {
+        return false;
+      }
+    }
+    return true;
+  }
+  return false;
+}
+
+void Storage::MarkPersistentDirty(Entry* entry) {
+  m_persistent_dirty = true;
+  if (!entry->persistent_changed) {
+    entry->persistent_changed = true;
+    m_persistent_changes.push_back(entry->local_id);
+  }
+}
+
+// Applies the entry's send options to an update of its current value.
+// Returns true if the update should not be sent now: either it is within the
+// deadband and dropped, or it is deferred to a later dispatch to respect the
+// send period.
+bool Storage::ThrottleUpdate(Entry* entry) {
+  if (entry->send_period == 0 && entry->send_deadband == 0) {
+    return false;
+  }
+  if (entry->send_deadband != 0 &&
+      WithinDeadband(*entry->value, entry->last_send_value,
+                     entry->send_deadband)) {
+    return true;
+  }
+  auto now = nt::Now();
+  if (entry->send_period != 0 &&
+      now - entry->last_send_time < entry->send_period) {
+    if (!entry->pending_update) {
+      entry->pending_update = true;
+      m_pending_updates.push_back(entry->local_id);
+    }
+    return true;
+  }
+  RecordSend(entry, now);
+  return false;
+}
+
+void Storage::RecordSend(Entry* entry, uint64_t now) {
+  if (entry->send_period == 0 && entry->send_deadband == 0) {
+    return;
+  }
+  entry->last_send_time = now;
+  entry->last_send_value.clear();
+  if (entry->send_deadband != 0) {
+    auto& value = *entry->value;
+    if (value.IsDouble()) {
+      entry->last_send_value.push_back(value.GetDouble());
+    } else if (value.IsDoubleArray()) {
+      auto arr = value.GetDoubleArray();
+      entry->last_send_value.assign(arr.begin(), arr.end());
+    }
+  }
+}
+
 void Storage::SetEntryValueImpl(Entry* entry, std::shared_ptr<Value> value,
-                                std::unique_lock<wpi::mutex>& lock,
+                                std::unique_lock<SharedMutex>& lock,
                                 bool local) {
   if (!value) {
     return;
@@ -621,7 +1026,7 @@ void Storage::SetEntryValueImpl(Entry* entry, std::shared_ptr<Value> value,
 
   // update persistent dirty flag if value changed and it's persistent
   if (entry->IsPersistent() && (!old_value || *old_value != *value)) {
-    m_persistent_dirty = true;
+    MarkPersistentDirty(entry);
   }
 
   // notify
@@ -645,6 +1050,7 @@ void Storage::SetEntryValueImpl(Entry* entry, std::shared_ptr<Value> value,
     if (local) {
       ++entry->seq_num;
     }
+    RecordSend(entry, nt::Now());
     auto msg = Message::EntryAssign(
         entry->name, entry->id, entry->seq_num.value(), value, entry->flags);
     lock.unlock();
@@ -654,7 +1060,7 @@ void Storage::SetEntryValueImpl(Entry* entry, std::shared_ptr<Value> value,
       ++entry->seq_num;
     }
     // don't send an update if we don't have an assigned id yet
-    if (entry->id != 0xffff) {
+    if (entry->id != 0xffff && !ThrottleUpdate(entry)) {
       auto msg = Message::EntryUpdate(entry->id, entry->seq_num.value(), value);
       lock.unlock();
       dispatcher->QueueOutgoing(msg, nullptr, nullptr);
@@ -693,6 +1099,191 @@ void Storage::SetEntryTypeValue(unsigned int local_id,
   SetEntryValueImpl(entry, value, lock, true);
 }
 
+bool Storage::SetEntryBoolean(unsigned int local_id, bool value,
+                              uint64_t time, bool force) {
+  std::unique_lock lock(m_mutex);
+  return SetEntryTypedImpl(local_id, NT_BOOLEAN, value, time, force, lock);
+}
+
+bool Storage::SetEntryDouble(unsigned int local_id, double value,
+                             uint64_t time, bool force) {
+  std::unique_lock lock(m_mutex);
+  return SetEntryTypedImpl(local_id, NT_DOUBLE, value, time, force, lock);
+}
+
+bool Storage::SetEntryString(unsigned int local_id, std::string_view value,
+                             uint64_t time, bool force) {
+  std::unique_lock lock(m_mutex);
+  return SetEntryTypedImpl(local_id, NT_STRING, value, time, force, lock);
+}
+
+bool Storage::SetEntryRaw(unsigned int local_id, std::string_view value,
+                          uint64_t time, bool force) {
+  std::unique_lock lock(m_mutex);
+  return SetEntryTypedImpl(local_id, NT_RAW, value, time, force, lock);
+}
+
+bool Storage::SetEntryBooleanArray(unsigned int local_id,
+                                   wpi::span<const int> value, uint64_t time,
+                                   bool force) {
+  std::unique_lock lock(m_mutex);
+  return SetEntryTypedImpl(local_id, NT_BOOLEAN_ARRAY, value, time, force,
+                           lock);
+}
+
+bool Storage::SetEntryDoubleArray(unsigned int local_id,
+                                  wpi::span<const double> value, uint64_t time,
+                                  bool force) {
+  std::unique_lock lock(m_mutex);
+  return SetEntryTypedImpl(local_id, NT_DOUBLE_ARRAY, value, time, force,
+                           lock);
+}
+
+void Storage::GetEntryDoubles(wpi::span<const unsigned int> local_ids,
+                              double defaultValue,
+                              wpi::span<double> values) const {
+  std::shared_lock lock(m_mutex);
+  size_t count = (std::min)(local_ids.size(), values.size());
+  for (size_t i = 0; i < count; ++i) {
+    values[i] = defaultValue;
+    if (local_ids[i] < m_localmap.size()) {
+      auto& value = m_localmap[local_ids[i]]->value;
+      if (value && value->IsDouble()) {
+        values[i] = value->GetDouble();
+      }
+    }
+  }
+}
+
+size_t Storage::SetEntryDoubles(wpi::span<const unsigned int> local_ids,
+                                wpi::span<const double> values,
+                                uint64_t time) {
+  std::unique_lock lock(m_mutex);
+  size_t count = (std::min)(local_ids.size(), values.size());
+  size_t set = 0;
+  for (size_t i = 0; i < count; ++i) {
+    // creating an entry value releases the lock
+    if (!lock.owns_lock()) {
+      lock.lock();
+    }
+    if (local_ids[i] < m_localmap.size() &&
+        SetEntryTypedImpl(local_ids[i], NT_DOUBLE, values[i], time, false,
+                          lock)) {
+      ++set;
+    }
+  }
+  return set;
+}
+
+size_t Storage::GetEntryDoubleArrays(wpi::span<const unsigned int> local_ids,
+                                     wpi::span<double> values,
+                                     wpi::span<int> lengths) const {
+  std::shared_lock lock(m_mutex);
+  size_t count = (std::min)(local_ids.size(), lengths.size());
+  size_t total = 0;
+  for (size_t i = 0; i < count; ++i) {
+    lengths[i] = -1;
+    if (local_ids[i] >= m_localmap.size()) {
+      continue;
+    }
+    auto& value = m_localmap[local_ids[i]]->value;
+    if (!value || !value->IsDoubleArray()) {
+      continue;
+    }
+    auto arr = value->GetDoubleArray();
+    lengths[i] = arr.size();
+    if (total + arr.size() <= values.size()) {
+      std::copy(arr.begin(), arr.end(), values.begin() + total);
+    }
+    total += arr.size();
+  }
+  return total;
+}
+
+size_t Storage::SetEntryDoubleArrays(wpi::span<const unsigned int> local_ids,
+                                     wpi::span<const double> values,
+                                     wpi::span<const int> lengths,
+                                     uint64_t time) {
+  std::unique_lock lock(m_mutex);
+  size_t count = (std::min)(local_ids.size(), lengths.size());
+  size_t set = 0;
+  size_t pos = 0;
+  for (size_t i = 0; i < count; ++i) {
+    if (lengths[i] < 0) {
+      continue;
+    }
+    size_t len = lengths[i];
+    if (len > values.size() - pos) {
+      break;
+    }
+    if (!lock.owns_lock()) {
+      lock.lock();
+    }
+    if (local_ids[i] < m_localmap.size() &&
+        SetEntryTypedImpl(local_ids[i], NT_DOUBLE_ARRAY,
+                          values.subspan(pos, len), time, false, lock)) {
+      ++set;
+    }
+    pos += len;
+  }
+  return set;
+}
+
+template <typename T>
+bool Storage::SetEntryTypedImpl(unsigned int local_id, NT_Type type, T value,
+                                uint64_t time, bool force,
+                                std::unique_lock<SharedMutex>& lock) {
+  if (local_id >= m_localmap.size()) {
+    return true;
+  }
+  Entry* entry = m_localmap[local_id].get();
+
+  // new entries and type changes take the normal path
+  if (!entry->value || entry->value->type() != type) {
+    if (entry->value && !force) {
+      return false;  // error on type mismatch
+    }
+    SetEntryValueImpl(entry, MakeValue(type, value, time), lock, true);
+    return true;
+  }
+
+  entry->local_write = true;
+  if (ValueEquals(*entry->value, value)) {
+    // like SetEntryValue, refresh the timestamp without notifying or sending
+    if (entry->value.use_count() == 1) {
+      ValueUpdater::SetTime(*entry->value, time);
+    } else {
+      entry->value = MakeValue(type, value, time);
+    }
+    return true;
+  }
+
+  // Overwrite the value if nothing else references it.  Other references are
+  // only taken with m_mutex held, so this can't race.  Otherwise (e.g. it is
+  // still queued for sending or held by a listener) replace it.
+  if (entry->value.use_count() == 1) {
+    UpdateValue(*entry->value, value, time);
+  } else {
+    entry->value = MakeValue(type, value, time);
+  }
+
+  if (entry->IsPersistent()) {
+    MarkPersistentDirty(entry);
+  }
+  Notify(entry, NT_NOTIFY_UPDATE, true);
+
+  // defer the update message to the next dispatch
+  if (!m_dispatcher) {
+    return true;
+  }
+  ++entry->seq_num;
+  if (!entry->pending_update) {
+    entry->pending_update = true;
+    m_pending_updates.push_back(local_id);
+  }
+  return true;
+}
+
 void Storage::SetEntryFlags(std::string_view name, unsigned int flags) {
   if (name.empty()) {
     return;
@@ -714,7 +1305,7 @@ void Storage::SetEntryFlags(unsigned int id_local, unsigned int flags) {
 }
 
 void Storage::SetEntryFlagsImpl(Entry* entry, unsigned int flags,
-                                std::unique_lock<wpi::mutex>& lock,
+                                std::unique_lock<SharedMutex>& lock,
                                 bool local) {
   if (!entry->value || entry->flags == flags) {
     return;
@@ -722,7 +1313,7 @@ void Storage::SetEntryFlagsImpl(Entry* entry, unsigned int flags,
 
   // update persistent dirty flag if persistent flag changed
   if ((entry->flags & NT_PERSISTENT) != (flags & NT_PERSISTENT)) {
-    m_persistent_dirty = true;
+    MarkPersistentDirty(entry);
   }
 
   entry->flags = flags;
@@ -744,8 +1335,65 @@ void Storage::SetEntryFlagsImpl(Entry* entry, unsigned int flags,
   }
 }
 
-unsigned int Storage::GetEntryFlags(std::string_view name) const {
+void Storage::SetEntrySendOptions(unsigned int local_id, double period,
+                                  double deadband) {
   std::scoped_lock lock(m_mutex);
+  if (local_id >= m_localmap.size()) {
+    return;
+  }
+  Entry* entry = m_localmap[local_id].get();
+  entry->send_period = period > 0 ? static_cast<uint64_t>(period * 1e6) : 0;
+  entry->send_deadband = deadband > 0 ? deadband : 0;
+  // start with the next update sent
+  entry->last_send_time = 0;
+  entry->last_send_value.clear();
+}
+
+void Storage::SetEntryHistory(unsigned int local_id, size_t depth) {
+  std::scoped_lock lock(m_mutex);
+  if (local_id >= m_localmap.size()) {
+    return;
+  }
+  Entry* entry = m_localmap[local_id].get();
+  if (depth == 0) {
+    entry->history.reset();
+    return;
+  }
+
+  // keep the most recent values, starting with the current one
+  auto history =
+      std::make_unique<wpi::circular_buffer<std::shared_ptr<Value>>>(depth);
+  if (entry->history) {
+    for (auto&& value : *entry->history) {
+      history->push_back(std::move(value));
+    }
+  } else if (entry->value) {
+    history->push_back(entry->value);
+  }
+  entry->history = std::move(history);
+}
+
+std::vector<std::shared_ptr<Value>> Storage::GetEntryHistory(
+    unsigned int local_id, uint64_t start, uint64_t end) const {
+  std::vector<std::shared_ptr<Value>> values;
+  std::shared_lock lock(m_mutex);
+  if (local_id >= m_localmap.size()) {
+    return values;
+  }
+  Entry* entry = m_localmap[local_id].get();
+  if (!entry->history) {
+    return values;
+  }
+  for (auto&& value : *entry->history) {
+    if (value->time() >= start && value->time() <= end) {
+      values.emplace_back(value);
+    }
+  }
+  return values;
+}
+
+unsigned int Storage::GetEntryFlags(std::string_view name) const {
+  std::shared_lock lock(m_mutex);
   auto i = m_entries.find(name);
   if (i == m_entries.end()) {
     return 0;
@@ -754,7 +1402,7 @@ unsigned int Storage::GetEntryFlags(std::string_view name) const {
 }
 
 unsigned int Storage::GetEntryFlags(unsigned int local_id) const {
-  std::scoped_lock lock(m_mutex);
+  std::shared_lock lock(m_mutex);
   if (local_id >= m_localmap.size()) {
     return 0;
   }
@@ -778,7 +1426,7 @@ void Storage::DeleteEntry(unsigned int local_id) {
   DeleteEntryImpl(m_localmap[local_id].get(), lock, true);
 }
 
-void Storage::DeleteEntryImpl(Entry* entry, std::unique_lock<wpi::mutex>& lock,
+void Storage::DeleteEntryImpl(Entry* entry, std::unique_lock<SharedMutex>& lock,
                               bool local) {
   unsigned int id = entry->id;
 
@@ -801,7 +1449,7 @@ void Storage::DeleteEntryImpl(Entry* entry, std::unique_lock<wpi::mutex>& lock,
 
   // update persistent dirty flag if it's a persistent value
   if (entry->IsPersistent()) {
-    m_persistent_dirty = true;
+    MarkPersistentDirty(entry);
   }
 
   // reset flags
@@ -812,6 +1460,7 @@ void Storage::DeleteEntryImpl(Entry* entry, std::unique_lock<wpi::mutex>& lock,
   }
 
   // notify
+  RecordDelete(id, local);
   Notify(entry, NT_NOTIFY_DELETE, local, old_value);
 
   // if it had a value, generate message
@@ -851,10 +1500,36 @@ void Storage::Notify(Entry* entry, unsigned int flags, bool local,
                      std::shared_ptr<Value> value) {
   auto& v = value ? value : entry->value;
 
+  if (m_server || local) {
+    entry->revision = ++m_revision;
+  }
+
   // notifications
   m_notifier.NotifyEntry(entry->local_id, entry->name, v,
                          flags | (local ? NT_NOTIFY_LOCAL : 0));
 
+  // shared memory mirror
+  if (m_shared) {
+    if (flags & NT_NOTIFY_DELETE) {
+      m_shared->Write(entry->local_id, entry->name, nullptr);
+    } else if ((flags & (NT_NOTIFY_NEW | NT_NOTIFY_UPDATE)) != 0 && v) {
+      m_shared->Write(entry->local_id, entry->name, v.get());
+    }
+  }
+
+  // value history
+  if (entry->history) {
+    if (flags & NT_NOTIFY_DELETE) {
+      // don't hold on to the values
+      for (auto&& old : *entry->history) {
+        old.reset();
+      }
+      entry->history->reset();
+    } else if ((flags & (NT_NOTIFY_NEW | NT_NOTIFY_UPDATE)) != 0 && v) {
+      entry->history->push_back(v);
+    }
+  }
+
   if (m_dataloggers.empty()) {
     return;
   }
@@ -973,12 +1648,25 @@ void Storage::Notify(Entry* entry, unsigned int flags, bool local,
   }
 }
 
+void Storage::RecordDelete(unsigned int id, bool local) {
+  if (id == 0xffff || (!m_server && !local)) {
+    return;
+  }
+  if (m_deleted.size() >= kMaxDeleted) {
+    auto half = m_deleted.begin() + kMaxDeleted / 2;
+    m_deleted_floor = (half - 1)->first;
+    m_deleted.erase(m_deleted.begin(), half);
+  }
+  m_deleted.emplace_back(++m_revision, id);
+}
+
 template <typename F>
 void Storage::DeleteAllEntriesImpl(bool local, F should_delete) {
   for (auto& i : m_entries) {
     Entry* entry = i.getValue();
     if (entry->value && should_delete(entry)) {
       // notify it's being deleted
+      RecordDelete(entry->id, local);
       Notify(entry, NT_NOTIFY_DELETE, local);
       // remove it from idmap
       if (entry->id < m_idmap.size()) {
@@ -1029,13 +1717,21 @@ unsigned int Storage::GetEntry(std::string_view name) {
   if (name.empty()) {
     return UINT_MAX;
   }
+  {
+    // most lookups are of existing entries
+    std::shared_lock lock(m_mutex);
+    auto i = m_entries.find(name);
+    if (i != m_entries.end()) {
+      return i->getValue()->local_id;
+    }
+  }
   std::unique_lock lock(m_mutex);
   return GetOrNew(name)->local_id;
 }
 
 std::vector<unsigned int> Storage::GetEntries(std::string_view prefix,
                                               unsigned int types) {
-  std::scoped_lock lock(m_mutex);
+  std::shared_lock lock(m_mutex);
   std::vector<unsigned int> ids;
   for (auto& i : m_entries) {
     Entry* entry = i.getValue();
@@ -1058,7 +1754,7 @@ EntryInfo Storage::GetEntryInfo(int inst, unsigned int local_id) const {
   info.flags = 0;
   info.last_change = 0;
 
-  std::unique_lock lock(m_mutex);
+  std::shared_lock lock(m_mutex);
   if (local_id >= m_localmap.size()) {
     return info;
   }
@@ -1076,7 +1772,7 @@ EntryInfo Storage::GetEntryInfo(int inst, unsigned int local_id) const {
 }
 
 std::string Storage::GetEntryName(unsigned int local_id) const {
-  std::unique_lock lock(m_mutex);
+  std::shared_lock lock(m_mutex);
   if (local_id >= m_localmap.size()) {
     return {};
   }
@@ -1084,7 +1780,7 @@ std::string Storage::GetEntryName(unsigned int local_id) const {
 }
 
 NT_Type Storage::GetEntryType(unsigned int local_id) const {
-  std::unique_lock lock(m_mutex);
+  std::shared_lock lock(m_mutex);
   if (local_id >= m_localmap.size()) {
     return NT_UNASSIGNED;
   }
@@ -1096,7 +1792,7 @@ NT_Type Storage::GetEntryType(unsigned int local_id) const {
 }
 
 uint64_t Storage::GetEntryLastChange(unsigned int local_id) const {
-  std::unique_lock lock(m_mutex);
+  std::shared_lock lock(m_mutex);
   if (local_id >= m_localmap.size()) {
     return 0;
   }
@@ -1109,7 +1805,7 @@ uint64_t Storage::GetEntryLastChange(unsigned int local_id) const {
 
 std::vector<EntryInfo> Storage::GetEntryInfo(int inst, std::string_view prefix,
                                              unsigned int types) {
-  std::scoped_lock lock(m_mutex);
+  std::shared_lock lock(m_mutex);
   std::vector<EntryInfo> infos;
   for (auto& i : m_entries) {
     Entry* entry = i.getValue();
@@ -1135,7 +1831,7 @@ unsigned int Storage::AddListener(
     std::string_view prefix,
     std::function<void(const EntryNotification& event)> callback,
     unsigned int flags) const {
-  std::scoped_lock lock(m_mutex);
+  std::shared_lock lock(m_mutex);
   unsigned int uid = m_notifier.Add(callback, prefix, flags);
   // perform immediate notifications
   if ((flags & NT_NOTIFY_IMMEDIATE) != 0 && (flags & NT_NOTIFY_NEW) != 0) {
@@ -1155,7 +1851,7 @@ unsigned int Storage::AddListener(
     unsigned int local_id,
     std::function<void(const EntryNotification& event)> callback,
     unsigned int flags) const {
-  std::scoped_lock lock(m_mutex);
+  std::shared_lock lock(m_mutex);
   unsigned int uid = m_notifier.Add(callback, local_id, flags);
   // perform immediate notifications
   if ((flags & NT_NOTIFY_IMMEDIATE) != 0 && (flags & NT_NOTIFY_NEW) != 0 &&
@@ -1169,10 +1865,30 @@ unsigned int Storage::AddListener(
   return uid;
 }
 
+unsigned int Storage::AddBatchListener(
+    std::string_view prefix,
+    std::function<void(wpi::span<const EntryNotification> events)> callback,
+    unsigned int flags) const {
+  std::shared_lock lock(m_mutex);
+  unsigned int uid = m_notifier.AddBatch(callback, prefix, flags);
+  // perform immediate notifications
+  if ((flags & NT_NOTIFY_IMMEDIATE) != 0 && (flags & NT_NOTIFY_NEW) != 0) {
+    for (auto& i : m_entries) {
+      Entry* entry = i.getValue();
+      if (!entry->value || !wpi::starts_with(i.getKey(), prefix)) {
+        continue;
+      }
+      m_notifier.NotifyEntry(entry->local_id, i.getKey(), entry->value,
+                             NT_NOTIFY_IMMEDIATE | NT_NOTIFY_NEW, uid);
+    }
+  }
+  return uid;
+}
+
 unsigned int Storage::AddPolledListener(unsigned int poller,
                                         std::string_view prefix,
                                         unsigned int flags) const {
-  std::scoped_lock lock(m_mutex);
+  std::shared_lock lock(m_mutex);
   unsigned int uid = m_notifier.AddPolled(poller, prefix, flags);
   // perform immediate notifications
   if ((flags & NT_NOTIFY_IMMEDIATE) != 0 && (flags & NT_NOTIFY_NEW) != 0) {
@@ -1194,7 +1910,7 @@ unsigned int Storage::AddPolledListener(unsigned int poller,
 unsigned int Storage::AddPolledListener(unsigned int poller,
                                         unsigned int local_id,
                                         unsigned int flags) const {
-  std::scoped_lock lock(m_mutex);
+  std::shared_lock lock(m_mutex);
   unsigned int uid = m_notifier.AddPolled(poller, local_id, flags);
   // perform immediate notifications
   if ((flags & NT_NOTIFY_IMMEDIATE) != 0 && (flags & NT_NOTIFY_NEW) != 0 &&
@@ -1309,6 +2025,13 @@ bool Storage::GetPersistentEntries(
       return false;
     }
     m_persistent_dirty = false;
+    // a periodic save rewrites the journal base, which covers every change
+    if (periodic) {
+      for (auto id : m_persistent_changes) {
+        m_localmap[id]->persistent_changed = false;
+      }
+      m_persistent_changes.clear();
+    }
     entries->reserve(m_entries.size());
     for (auto& i : m_entries) {
       Entry* entry = i.getValue();
@@ -1329,13 +2052,36 @@ bool Storage::GetPersistentEntries(
   return true;
 }
 
+bool Storage::GetPersistentChanges(
+    std::vector<std::pair<std::string, std::shared_ptr<Value>>>* changes)
+    const {
+  std::scoped_lock lock(m_mutex);
+  if (!m_persistent_dirty) {
+    return false;
+  }
+  m_persistent_dirty = false;
+  changes->reserve(m_persistent_changes.size());
+  for (auto id : m_persistent_changes) {
+    Entry* entry = m_localmap[id].get();
+    entry->persistent_changed = false;
+    // a null value records that the entry is no longer persistent
+    if (entry->value && entry->IsPersistent()) {
+      changes->emplace_back(entry->name, entry->value);
+    } else {
+      changes->emplace_back(entry->name, nullptr);
+    }
+  }
+  m_persistent_changes.clear();
+  return true;
+}
+
 bool Storage::GetEntries(
     std::string_view prefix,
     std::vector<std::pair<std::string, std::shared_ptr<Value>>>* entries)
     const {
   // copy values out of storage as quickly as possible so lock isn't held
   {
-    std::scoped_lock lock(m_mutex);
+    std::shared_lock lock(m_mutex);
     entries->reserve(m_entries.size());
     for (auto& i : m_entries) {
       Entry* entry = i.getValue();
@@ -1436,7 +2182,7 @@ unsigned int Storage::CallRpc(unsigned int local_id, std::string_view params) {
     m_rpc_server.ProcessRpc(
         local_id, call_uid, name, msg->str(), conn_info,
         [=](std::string_view result) {
-          std::scoped_lock lock(m_mutex);
+          std::scoped_lock lock(m_rpc_mutex);
           m_rpc_results.insert(std::make_pair(RpcIdPair{local_id, call_uid},
                                               std::string{result}));
           m_rpc_results_cond.notify_all();
@@ -1459,7 +2205,7 @@ bool Storage::GetRpcResult(unsigned int local_id, unsigned int call_uid,
 bool Storage::GetRpcResult(unsigned int local_id, unsigned int call_uid,
                            std::string* result, double timeout,
                            bool* timed_out) {
-  std::unique_lock lock(m_mutex);
+  std::unique_lock lock(m_rpc_mutex);
 
   RpcIdPair call_pair{local_id, call_uid};
 
@@ -1507,7 +2253,7 @@ bool Storage::GetRpcResult(unsigned int local_id, unsigned int call_uid,
 }
 
 void Storage::CancelRpcResult(unsigned int local_id, unsigned int call_uid) {
-  std::unique_lock lock(m_mutex);
+  std::scoped_lock lock(m_rpc_mutex);
   // safe to erase even if id does not exist
   m_rpc_blocking_calls.erase(RpcIdPair{local_id, call_uid});
   m_rpc_results_cond.notify_all();
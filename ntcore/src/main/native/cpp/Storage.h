@@ -21,6 +21,7 @@
 #include <wpi/SmallVector.h>
 #include <wpi/StringMap.h>
 #include <wpi/UidVector.h>
+#include <wpi/circular_buffer.h>
 #include <wpi/condition_variable.h>
 #include <wpi/mutex.h>
 #include <wpi/span.h>
@@ -28,6 +29,8 @@
 #include "IStorage.h"
 #include "Message.h"
 #include "SequenceNumber.h"
+#include "SharedEntryTable.h"
+#include "SharedMutex.h"
 #include "ntcore_cpp.h"
 
 namespace wpi {
@@ -66,13 +69,24 @@ class Storage : public IStorage {
 
   void ProcessIncoming(std::shared_ptr<Message> msg, INetworkConnection* conn,
                        std::weak_ptr<INetworkConnection> conn_weak) override;
-  void GetInitialAssignments(
-      INetworkConnection& conn,
-      std::vector<std::shared_ptr<Message>>* msgs) override;
+  void GetInitialAssignments(INetworkConnection& conn,
+                             std::vector<std::shared_ptr<Message>>* msgs,
+                             SyncPoint* sync) override;
   void ApplyInitialAssignments(
       INetworkConnection& conn, wpi::span<std::shared_ptr<Message>> msgs,
-      bool new_server,
+      bool new_server, const SyncPoint& sync,
       std::vector<std::shared_ptr<Message>>* out_msgs) override;
+  bool GetResumeAssignments(INetworkConnection& conn, const SyncPoint& since,
+                            std::vector<std::shared_ptr<Message>>* msgs,
+                            SyncPoint* sync) override;
+  void ApplyResumeAssignments(
+      INetworkConnection& conn, wpi::span<std::shared_ptr<Message>> msgs,
+      const SyncPoint& sync,
+      std::vector<std::shared_ptr<Message>>* out_msgs) override;
+  SyncPoint GetSyncPoint() const override;
+  void StartSharedTable(unsigned int port, size_t size) override;
+  void StopSharedTable() override;
+  void FlushPendingUpdates() override;
 
   // User functions.  These are the actual implementations of the corresponding
   // user API functions in ntcore_cpp.
@@ -90,9 +104,48 @@ class Storage : public IStorage {
   void SetEntryTypeValue(std::string_view name, std::shared_ptr<Value> value);
   void SetEntryTypeValue(unsigned int local_id, std::shared_ptr<Value> value);
 
+  // Typed setters.  If the entry already holds a value of the same type, it
+  // is updated in place when possible, and the outgoing update is deferred
+  // to the next dispatch so repeated changes are coalesced.  If force is
+  // set, behaves like SetEntryTypeValue() on type mismatch.
+  bool SetEntryBoolean(unsigned int local_id, bool value, uint64_t time,
+                       bool force);
+  bool SetEntryDouble(unsigned int local_id, double value, uint64_t time,
+                      bool force);
+  bool SetEntryString(unsigned int local_id, std::string_view value,
+                      uint64_t time, bool force);
+  bool SetEntryRaw(unsigned int local_id, std::string_view value,
+                   uint64_t time, bool force);
+  bool SetEntryBooleanArray(unsigned int local_id, wpi::span<const int> value,
+                            uint64_t time, bool force);
+  bool SetEntryDoubleArray(unsigned int local_id,
+                           wpi::span<const double> value, uint64_t time,
+                           bool force);
+
+  // Bulk accessors.  The lock is taken once for all of the entries; the
+  // setters behave like the typed setters without force.
+  void GetEntryDoubles(wpi::span<const unsigned int> local_ids,
+                       double defaultValue, wpi::span<double> values) const;
+  size_t SetEntryDoubles(wpi::span<const unsigned int> local_ids,
+                         wpi::span<const double> values, uint64_t time);
+  size_t GetEntryDoubleArrays(wpi::span<const unsigned int> local_ids,
+                              wpi::span<double> values,
+                              wpi::span<int> lengths) const;
+  size_t SetEntryDoubleArrays(wpi::span<const unsigned int> local_ids,
+                              wpi::span<const double> values,
+                              wpi::span<const int> lengths, uint64_t time);
+
   void SetEntryFlags(std::string_view name, unsigned int flags);
   void SetEntryFlags(unsigned int local_id, unsigned int flags);
 
+  void SetEntrySendOptions(unsigned int local_id, double period,
+                           double deadband);
+
+  void SetEntryHistory(unsigned int local_id, size_t depth);
+  std::vector<std::shared_ptr<Value>> GetEntryHistory(unsigned int local_id,
+                                                      uint64_t start,
+                                                      uint64_t end) const;
+
   unsigned int GetEntryFlags(std::string_view name) const;
   unsigned int GetEntryFlags(unsigned int local_id) const;
 
@@ -112,6 +165,10 @@ class Storage : public IStorage {
       unsigned int local_id,
       std::function<void(const EntryNotification& event)> callback,
       unsigned int flags) const;
+  unsigned int AddBatchListener(
+      std::string_view prefix,
+      std::function<void(wpi::span<const EntryNotification> events)> callback,
+      unsigned int flags) const;
 
   unsigned int AddPolledListener(unsigned int poller_uid,
                                  std::string_view prefix,
@@ -214,10 +271,30 @@ class Storage : public IStorage {
     // Sequence number for update resolution.
     SequenceNumber seq_num;
 
+    // Storage revision of the last change the remote may not have: any
+    // change on a server, local changes on a client.
+    uint64_t revision{0};
+
     // If value has been written locally.  Used during initial handshake
     // on client to determine whether or not to accept remote changes.
     bool local_write{false};
 
+    // If an update from a typed setter is waiting for the next dispatch.
+    bool pending_update{false};
+
+    // If the entry is in m_persistent_changes.
+    bool persistent_changed{false};
+
+    // Outgoing update throttling (see SetEntrySendOptions); times are in
+    // microseconds.  last_send_value is only kept if there is a deadband.
+    uint64_t send_period{0};
+    double send_deadband{0};
+    uint64_t last_send_time{0};
+    std::vector<double> last_send_value;
+
+    // Recent values, oldest first (see SetEntryHistory); null if disabled.
+    std::unique_ptr<wpi::circular_buffer<std::shared_ptr<Value>>> history;
+
     // RPC handle.
     unsigned int rpc_uid{UINT_MAX};
 
@@ -237,15 +314,55 @@ class Storage : public IStorage {
   using RpcResultMap = wpi::DenseMap<RpcIdPair, std::string>;
   using RpcBlockingCallSet = wpi::SmallSet<RpcIdPair, 12>;
 
-  mutable wpi::mutex m_mutex;
+  // Guards the entries and everything else below except the RPC results.
+  // Functions that only read entries take it shared.
+  mutable SharedMutex m_mutex;
   EntriesMap m_entries;
   IdMap m_idmap;
   LocalMap m_localmap;
-  RpcResultMap m_rpc_results;
-  RpcBlockingCallSet m_rpc_blocking_calls;
   wpi::UidVector<DataLogger, 4> m_dataloggers;
+  // Shared memory mirror of the entry values, indexed by local id
+  std::unique_ptr<SharedEntryTable> m_shared;
   // If any persistent values have changed
   mutable bool m_persistent_dirty = false;
+  // Local ids of entries whose persistent value or flag changed since the
+  // last periodic save; these are appended to the journal
+  mutable std::vector<unsigned int> m_persistent_changes;
+  // Local ids of entries with a pending_update; these are either coalesced
+  // or held back by the entry's send period
+  std::vector<unsigned int> m_pending_updates;
+
+  // Resumable synchronization (see SyncPoint).  m_revision counts the
+  // changes that stamp Entry::revision.  Deletes are recorded as (revision,
+  // id) pairs, since deleted entries lose their id; only the most recent are
+  // kept, and sync points older than m_deleted_floor can't be resumed from.
+  static constexpr size_t kMaxDeleted = 4096;
+  uint64_t m_epoch = 0;
+  uint64_t m_revision = 0;
+  std::vector<std::pair<uint64_t, unsigned int>> m_deleted;
+  uint64_t m_deleted_floor = 0;
+  // client: the server's sync point and m_revision at the last sync
+  SyncPoint m_sync;
+  uint64_t m_sync_revision = 0;
+
+  // Periodic saves append changes to a journal next to the persistent file
+  // and only rewrite the file (compacting the journal) once the journal
+  // outgrows it.  The journal's header id must match the id recorded in the
+  // file, so a journal left over from an older file is never replayed.
+  // Guarded by m_save_mutex, which serializes saves.
+  static constexpr std::string_view kJournalMagic{"NTJRNL30"};
+  static constexpr uint64_t kJournalMinCompact = 4096;
+  mutable wpi::mutex m_save_mutex;
+  mutable std::string m_journal_base;
+  mutable uint64_t m_journal_id = 0;
+  mutable uint64_t m_journal_size = 0;
+  mutable uint64_t m_journal_limit = 0;
+
+  // RPC results have their own lock so blocking on a result doesn't hold up
+  // entry access.
+  wpi::mutex m_rpc_mutex;
+  RpcResultMap m_rpc_results;
+  RpcBlockingCallSet m_rpc_blocking_calls;
 
   // condition variable and termination flag for blocking on a RPC result
   std::atomic_bool m_terminating;
@@ -274,23 +391,42 @@ class Storage : public IStorage {
                                  std::weak_ptr<INetworkConnection> conn_weak);
   void ProcessIncomingRpcResponse(std::shared_ptr<Message> msg,
                                   INetworkConnection* conn);
+  void ProcessIncomingSubscribe(std::shared_ptr<Message> msg,
+                                INetworkConnection* conn);
 
   bool GetPersistentEntries(
       bool periodic,
       std::vector<std::pair<std::string, std::shared_ptr<Value>>>* entries)
       const;
+  bool GetPersistentChanges(
+      std::vector<std::pair<std::string, std::shared_ptr<Value>>>* changes)
+      const;
   bool GetEntries(std::string_view prefix,
                   std::vector<std::pair<std::string, std::shared_ptr<Value>>>*
                       entries) const;
+  void MarkPersistentDirty(Entry* entry);
+  const char* SaveFull(std::string_view filename, bool periodic,
+                       bool journal) const;
+  const char* AppendJournal(std::string_view filename) const;
+  void ApplyEntries(
+      std::vector<std::pair<std::string, std::shared_ptr<Value>>>& entries,
+      bool persistent);
+  bool ThrottleUpdate(Entry* entry);
+  void RecordSend(Entry* entry, uint64_t now);
   void SetEntryValueImpl(Entry* entry, std::shared_ptr<Value> value,
-                         std::unique_lock<wpi::mutex>& lock, bool local);
+                         std::unique_lock<SharedMutex>& lock, bool local);
+  template <typename T>
+  bool SetEntryTypedImpl(unsigned int local_id, NT_Type type, T value,
+                         uint64_t time, bool force,
+                         std::unique_lock<SharedMutex>& lock);
   void SetEntryFlagsImpl(Entry* entry, unsigned int flags,
-                         std::unique_lock<wpi::mutex>& lock, bool local);
-  void DeleteEntryImpl(Entry* entry, std::unique_lock<wpi::mutex>& lock,
+                         std::unique_lock<SharedMutex>& lock, bool local);
+  void DeleteEntryImpl(Entry* entry, std::unique_lock<SharedMutex>& lock,
                        bool local);
 
   void Notify(Entry* entry, unsigned int flags, bool local,
               std::shared_ptr<Value> value = {});
+  void RecordDelete(unsigned int id, bool local);
 
   // Must be called with m_mutex held
   template <typename F>
@@ -2,13 +2,20 @@
 // Open Source Software; you can modify and/or share it under the terms of
 // the WPILib BSD license file in the root directory of this project.
 
+#include <algorithm>
 #include <cctype>
+#include <cstring>
 #include <string>
 #include <utility>
 
+#include <fmt/format.h>
 #include <wpi/Base64.h>
+#include <wpi/Endian.h>
+#include <wpi/MemoryBuffer.h>
 #include <wpi/SmallString.h>
 #include <wpi/StringExtras.h>
+#include <wpi/StringMap.h>
+#include <wpi/fs.h>
 #include <wpi/raw_istream.h>
 
 #include "IDispatcher.h"
@@ -29,6 +36,9 @@ class LoadPersistentImpl {
 
   bool Load(std::string_view prefix, std::vector<Entry>* entries);
 
+  // Journal id from the "; journal" comment, or 0 if there was none.
+  uint64_t journal_id() const { return m_journal_id; }
+
  private:
   bool ReadLine();
   bool ReadHeader();
@@ -55,6 +65,44 @@ class LoadPersistentImpl {
   std::string_view m_line;
   wpi::SmallString<128> m_line_buf;
   size_t m_line_num = 0;
+  uint64_t m_journal_id = 0;
+
+  std::vector<int> m_buf_boolean_array;
+  std::vector<double> m_buf_double_array;
+  std::vector<std::string> m_buf_string_array;
+};
+
+// Reads the binary records written by SaveJournalImpl.
+class LoadJournalImpl {
+ public:
+  using Entry = LoadPersistentImpl::Entry;
+  using WarnFunc = LoadPersistentImpl::WarnFunc;
+
+  LoadJournalImpl(wpi::span<const uint8_t> data, WarnFunc warn)
+      : m_data(reinterpret_cast<const char*>(data.data()), data.size()),
+        m_warn(std::move(warn)) {}
+
+  bool ReadHeader(std::string_view magic, uint64_t journal_id);
+
+  // Replays the records over entries.  Returns false if the journal ends
+  // partway through a record (as when a save was interrupted).
+  bool Load(std::vector<Entry>* entries);
+
+ private:
+  bool ReadUleb128(uint64_t* val);
+  bool ReadString(std::string_view* str);
+  bool ReadDouble(double* val);
+  bool ReadValue(NT_Type type, std::shared_ptr<Value>* value);
+
+  void Warn(const char* msg) {
+    if (m_warn) {
+      m_warn(m_record_num, msg);
+    }
+  }
+
+  std::string_view m_data;
+  WarnFunc m_warn;
+  size_t m_record_num = 0;
 
   std::vector<int> m_buf_boolean_array;
   std::vector<double> m_buf_double_array;
@@ -187,6 +235,10 @@ bool LoadPersistentImpl::ReadLine() {
     if (!m_line.empty() && m_line.front() != ';' && m_line.front() != '#') {
       return true;
     }
+    if (wpi::starts_with(m_line, "; journal ")) {
+      m_journal_id =
+          wpi::parse_integer<uint64_t>(wpi::substr(m_line, 10), 16).value_or(0);
+    }
   }
   return false;
 }
@@ -375,6 +427,159 @@ std::shared_ptr<Value> LoadPersistentImpl::ReadStringArrayValue() {
   return Value::MakeStringArray(std::move(m_buf_string_array));
 }
 
+bool LoadJournalImpl::ReadHeader(std::string_view magic,
+                                 uint64_t journal_id) {
+  if (m_data.size() < magic.size() + 8 ||
+      !wpi::starts_with(m_data, magic) ||
+      wpi::support::endian::read64le(m_data.data() + magic.size()) !=
+          journal_id) {
+    return false;
+  }
+  m_data.remove_prefix(magic.size() + 8);
+  return true;
+}
+
+bool LoadJournalImpl::Load(std::vector<Entry>* entries) {
+  wpi::StringMap<size_t> index;
+  for (size_t i = 0; i < entries->size(); ++i) {
+    index[(*entries)[i].first] = i;
+  }
+
+  while (!m_data.empty()) {
+    ++m_record_num;
+    auto type = static_cast<NT_Type>(static_cast<uint8_t>(m_data.front()));
+    m_data.remove_prefix(1);
+
+    std::string_view name;
+    std::shared_ptr<Value> value;
+    if (!ReadString(&name) ||
+        (type != NT_UNASSIGNED && !ReadValue(type, &value))) {
+      Warn("journal ends partway through a record, ignoring it");
+      return false;
+    }
+    if (type != NT_UNASSIGNED && !value) {
+      Warn("unrecognized type, ignoring rest of journal");
+      return false;
+    }
+
+    // a null value removes the entry (it's skipped when applied)
+    auto [it, added] = index.try_emplace(name, entries->size());
+    if (added) {
+      if (value) {
+        entries->emplace_back(name, std::move(value));
+      } else {
+        index.erase(it);
+      }
+    } else {
+      (*entries)[it->second].second = std::move(value);
+    }
+  }
+  return true;
+}
+
+bool LoadJournalImpl::ReadUleb128(uint64_t* val) {
+  uint64_t result = 0;
+  unsigned int shift = 0;
+  while (!m_data.empty() && shift < 64) {
+    uint8_t byte = m_data.front();
+    m_data.remove_prefix(1);
+    result |= static_cast<uint64_t>(byte & 0x7f) << shift;
+    if ((byte & 0x80) == 0) {
+      *val = result;
+      return true;
+    }
+    shift += 7;
+  }
+  return false;
+}
+
+bool LoadJournalImpl::ReadString(std::string_view* str) {
+  uint64_t len;
+  if (!ReadUleb128(&len) || len > m_data.size()) {
+    return false;
+  }
+  *str = m_data.substr(0, len);
+  m_data.remove_prefix(len);
+  return true;
+}
+
+bool LoadJournalImpl::ReadDouble(double* val) {
+  if (m_data.size() < 8) {
+    return false;
+  }
+  uint64_t bits = wpi::support::endian::read64le(m_data.data());
+  std::memcpy(val, &bits, sizeof(bits));
+  m_data.remove_prefix(8);
+  return true;
+}
+
+bool LoadJournalImpl::ReadValue(NT_Type type, std::shared_ptr<Value>* value) {
+  uint64_t size = 0;
+  switch (type) {
+    case NT_BOOLEAN:
+      if (m_data.empty()) {
+        return false;
+      }
+      *value = Value::MakeBoolean(m_data.front() != 0);
+      m_data.remove_prefix(1);
+      return true;
+    case NT_DOUBLE: {
+      double val;
+      if (!ReadDouble(&val)) {
+        return false;
+      }
+      *value = Value::MakeDouble(val);
+      return true;
+    }
+    case NT_STRING:
+    case NT_RAW: {
+      std::string_view str;
+      if (!ReadString(&str)) {
+        return false;
+      }
+      *value = type == NT_STRING ? Value::MakeString(str) : Value::MakeRaw(str);
+      return true;
+    }
+    case NT_BOOLEAN_ARRAY:
+      if (!ReadUleb128(&size) || size > m_data.size()) {
+        return false;
+      }
+      m_buf_boolean_array.clear();
+      for (auto ch : m_data.substr(0, size)) {
+        m_buf_boolean_array.push_back(ch != 0 ? 1 : 0);
+      }
+      m_data.remove_prefix(size);
+      *value = Value::MakeBooleanArray(std::move(m_buf_boolean_array));
+      return true;
+    case NT_DOUBLE_ARRAY:
+      if (!ReadUleb128(&size) || size > m_data.size() / 8) {
+        return false;
+      }
+      m_buf_double_array.resize(size);
+      for (auto& elem : m_buf_double_array) {
+        ReadDouble(&elem);
+      }
+      *value = Value::MakeDoubleArray(std::move(m_buf_double_array));
+      return true;
+    case NT_STRING_ARRAY:
+      if (!ReadUleb128(&size) || size > m_data.size()) {
+        return false;
+      }
+      m_buf_string_array.clear();
+      for (uint64_t i = 0; i < size; ++i) {
+        std::string_view str;
+        if (!ReadString(&str)) {
+          return false;
+        }
+        m_buf_string_array.emplace_back(str);
+      }
+      *value = Value::MakeStringArray(std::move(m_buf_string_array));
+      return true;
+    default:
+      return true;  // unrecognized; leaves value null
+  }
+}
+
 bool Storage::LoadEntries(
     wpi::raw_istream& is, std::string_view prefix, bool persistent,
     std::function<void(size_t line, const char* msg)> warn) {
@@ -386,10 +591,20 @@ bool Storage::LoadEntries(
     return false;
   }
 
+  ApplyEntries(entries, persistent);
+  return true;
+}
+
+void Storage::ApplyEntries(
+    std::vector<std::pair<std::string, std::shared_ptr<Value>>>& entries,
+    bool persistent) {
   // copy values into storage as quickly as possible so lock isn't held
   std::vector<std::shared_ptr<Message>> msgs;
   std::unique_lock lock(m_mutex);
   for (auto& i : entries) {
+    if (!i.second) {
+      continue;  // removed by the journal
+    }
     Entry* entry = GetOrNew(i.first);
     auto old_value = entry->value;
     entry->value = i.second;
@@ -451,8 +666,6 @@ bool Storage::LoadEntries(
       dispatcher->QueueOutgoing(std::move(msg), nullptr, nullptr);
     }
   }
-
-  return true;
 }
 
 const char* Storage::LoadPersistent(
@@ -463,9 +676,40 @@ const char* Storage::LoadPersistent(
   if (ec.value() != 0) {
     return "could not open file";
   }
-  if (!LoadEntries(is, "", true, warn)) {
+  std::vector<LoadPersistentImpl::Entry> entries;
+  LoadPersistentImpl loader(is, warn);
+  if (!loader.Load("", &entries)) {
     return "error reading file";
   }
+
+  // replay the journal of changes saved since the file was written, and
+  // continue it if it is intact
+  std::scoped_lock lock(m_save_mutex);
+  m_journal_base.clear();
+  if (loader.journal_id() != 0) {
+    bool intact = true;
+    uint64_t size = 0;
+    std::error_code jec;
+    if (auto buf = wpi::MemoryBuffer::GetFile(
+            fmt::format("{}.journal", filename), jec)) {
+      LoadJournalImpl journal(buf->GetBuffer(), warn);
+      if (journal.ReadHeader(kJournalMagic, loader.journal_id())) {
+        intact = journal.Load(&entries);
+        size = buf->size();
+      }
+    }
+    // otherwise the next save rewrites the file and starts a new journal
+    if (intact) {
+      m_journal_base = filename;
+      m_journal_id = loader.journal_id();
+      m_journal_size = size;
+      auto file_size = fs::file_size(fs::path{filename}, jec);
+      m_journal_limit = jec ? kJournalMinCompact
+                            : std::max<uint64_t>(file_size, kJournalMinCompact);
+    }
+  }
+
+  ApplyEntries(entries, true);
   return nullptr;
 }
 
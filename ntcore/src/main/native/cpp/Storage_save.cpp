@@ -2,15 +2,20 @@
 // Open Source Software; you can modify and/or share it under the terms of
 // the WPILib BSD license file in the root directory of this project.
 
+#include <algorithm>
 #include <cctype>
+#include <cstring>
 #include <string>
 
 #include <fmt/format.h>
 #include <wpi/Base64.h>
+#include <wpi/Endian.h>
 #include <wpi/SmallString.h>
 #include <wpi/StringExtras.h>
 #include <wpi/fs.h>
+#include <wpi/leb128.h>
 #include <wpi/raw_ostream.h>
+#include <wpi/timestamp.h>
 
 #include "Log.h"
 #include "Storage.h"
@@ -25,11 +30,11 @@ class SavePersistentImpl {
 
   explicit SavePersistentImpl(wpi::raw_ostream& os) : m_os(os) {}
 
-  void Save(wpi::span<const Entry> entries);
+  void Save(wpi::span<const Entry> entries, uint64_t journal_id = 0);
 
  private:
   void WriteString(std::string_view str);
-  void WriteHeader();
+  void WriteHeader(uint64_t journal_id);
   void WriteEntries(wpi::span<const Entry> entries);
   void WriteEntry(std::string_view name, const Value& value);
   bool WriteType(NT_Type type);
@@ -38,6 +43,26 @@ class SavePersistentImpl {
   wpi::raw_ostream& m_os;
 };
 
+// Binary journal records: the value type (NT_UNASSIGNED if the entry is no
+// longer persistent), the name, then the value.  Lengths and array sizes are
+// ULEB128 and doubles are little-endian IEEE 754, so values round-trip
+// exactly and arrays aren't limited to 255 elements.
+class SaveJournalImpl {
+ public:
+  using Entry = SavePersistentImpl::Entry;
+
+  explicit SaveJournalImpl(wpi::SmallVectorImpl<char>& buf) : m_buf(buf) {}
+
+  void WriteEntry(std::string_view name, const Value* value);
+
+ private:
+  void WriteString(std::string_view str);
+  void WriteDouble(double val);
+  void WriteValue(const Value& value);
+
+  wpi::SmallVectorImpl<char>& m_buf;
+};
+
 }  // namespace
 
 /* Escapes and writes a string, including start and end double quotes */
@@ -72,13 +97,18 @@ void SavePersistentImpl::WriteString(std::string_view str) {
   m_os << '"';
 }
 
-void SavePersistentImpl::Save(wpi::span<const Entry> entries) {
-  WriteHeader();
+void SavePersistentImpl::Save(wpi::span<const Entry> entries,
+                              uint64_t journal_id) {
+  WriteHeader(journal_id);
   WriteEntries(entries);
 }
 
-void SavePersistentImpl::WriteHeader() {
+void SavePersistentImpl::WriteHeader(uint64_t journal_id) {
   m_os << "[NetworkTables Storage 3.0]\n";
+  // a comment, so older versions still read the file
+  if (journal_id != 0) {
+    m_os << fmt::format("; journal {:016x}\n", journal_id);
+  }
 }
 
 void SavePersistentImpl::WriteEntries(wpi::span<const Entry> entries) {
@@ -182,6 +212,67 @@ void SavePersistentImpl::WriteValue(const Value& value) {
   }
 }
 
+void SaveJournalImpl::WriteEntry(std::string_view name, const Value* value) {
+  if (!value) {
+    m_buf.push_back(NT_UNASSIGNED);
+    WriteString(name);
+    return;
+  }
+  m_buf.push_back(value->type());
+  WriteString(name);
+  WriteValue(*value);
+}
+
+void SaveJournalImpl::WriteString(std::string_view str) {
+  wpi::WriteUleb128(m_buf, str.size());
+  m_buf.append(str.begin(), str.end());
+}
+
+void SaveJournalImpl::WriteDouble(double val) {
+  uint64_t bits;
+  std::memcpy(&bits, &val, sizeof(bits));
+  char buf[8];
+  wpi::support::endian::write64le(buf, bits);
+  m_buf.append(buf, buf + 8);
+}
+
+void SaveJournalImpl::WriteValue(const Value& value) {
+  switch (value.type()) {
+    case NT_BOOLEAN:
+      m_buf.push_back(value.GetBoolean() ? 1 : 0);
+      break;
+    case NT_DOUBLE:
+      WriteDouble(value.GetDouble());
+      break;
+    case NT_STRING:
+      WriteString(value.GetString());
+      break;
+    case NT_RAW:
+      WriteString(value.GetRaw());
+      break;
+    case NT_BOOLEAN_ARRAY:
+      wpi::WriteUleb128(m_buf, value.GetBooleanArray().size());
+      for (auto elem : value.GetBooleanArray()) {
+        m_buf.push_back(elem ? 1 : 0);
+      }
+      break;
+    case NT_DOUBLE_ARRAY:
+      wpi::WriteUleb128(m_buf, value.GetDoubleArray().size());
+      for (auto elem : value.GetDoubleArray()) {
+        WriteDouble(elem);
+      }
+      break;
+    case NT_STRING_ARRAY:
+      wpi::WriteUleb128(m_buf, value.GetStringArray().size());
+      for (auto& elem : value.GetStringArray()) {
+        WriteString(elem);
+      }
+      break;
+    default:
+      break;
+  }
+}
+
 void Storage::SavePersistent(wpi::raw_ostream& os, bool periodic) const {
   std::vector<SavePersistentImpl::Entry> entries;
   if (!GetPersistentEntries(periodic, &entries)) {
@@ -192,6 +283,18 @@ void Storage::SavePersistent(wpi::raw_ostream& os, bool periodic) const {
 
 const char* Storage::SavePersistent(std::string_view filename,
                                     bool periodic) const {
+  std::scoped_lock lock(m_save_mutex);
+  // only periodic saves use the journal; an explicit save of the same file
+  // starts a new one
+  if (periodic && filename == m_journal_base &&
+      m_journal_size < m_journal_limit) {
+    return AppendJournal(filename);
+  }
+  return SaveFull(filename, periodic, periodic || filename == m_journal_base);
+}
+
+const char* Storage::SaveFull(std::string_view filename, bool periodic,
+                              bool journal) const {
   std::string fn{filename};
   auto tmp = fmt::format("{}.tmp", filename);
   auto bak = fmt::format("{}.bak", filename);
@@ -203,6 +306,10 @@ const char* Storage::SavePersistent(std::string_view filename,
   }
 
   const char* err = nullptr;
+  uint64_t journal_id = 0;
+  if (journal) {
+    journal_id = std::max<uint64_t>(wpi::Now(), m_journal_id + 1);
+  }
 
   // start by writing to temporary file
   std::error_code ec;
@@ -212,7 +319,7 @@ const char* Storage::SavePersistent(std::string_view filename,
     goto done;
   }
   DEBUG0("saving persistent file '{}'", filename);
-  SavePersistentImpl(os).Save(entries);
+  SavePersistentImpl(os).Save(entries, journal_id);
   os.close();
   if (os.has_error()) {
     std::remove(tmp.c_str());
@@ -229,7 +336,20 @@ const char* Storage::SavePersistent(std::string_view filename,
     goto done;
   }
 
+  // The old journal no longer matches the file, so it's safe to remove even
+  // if this fails partway.
+  if (journal) {
+    std::remove(fmt::format("{}.journal", filename).c_str());
+    m_journal_base = fn;
+    m_journal_id = journal_id;
+    m_journal_size = 0;
+    m_journal_limit = std::max(os.tell(), kJournalMinCompact);
+  }
+
 done:
+  if (err && filename == m_journal_base) {
+    m_journal_base.clear();
+  }
   // try again if there was an error
   if (err && periodic) {
     m_persistent_dirty = true;
@@ -237,6 +357,45 @@ done:
   return err;
 }
 
+const char* Storage::AppendJournal(std::string_view filename) const {
+  std::vector<SavePersistentImpl::Entry> changes;
+  if (!GetPersistentChanges(&changes)) {
+    return nullptr;
+  }
+
+  wpi::SmallString<256> buf;
+  if (m_journal_size == 0) {
+    char id[8];
+    wpi::support::endian::write64le(id, m_journal_id);
+    buf.append(kJournalMagic.begin(), kJournalMagic.end());
+    buf.append(id, id + 8);
+  }
+  SaveJournalImpl journal{buf};
+  for (auto& change : changes) {
+    journal.WriteEntry(change.first, change.second.get());
+  }
+
+  // a new journal replaces any stale one
+  std::error_code ec;
+  wpi::raw_fd_ostream os(
+      fmt::format("{}.journal", filename), ec,
+      m_journal_size == 0 ? fs::CD_CreateAlways : fs::CD_OpenAlways,
+      fs::FA_Write, m_journal_size == 0 ? fs::OF_None : fs::OF_Append);
+  if (ec.value() == 0) {
+    DEBUG4("appending {} persistent changes to journal", changes.size());
+    os << buf.str();
+    os.close();
+    if (!os.has_error()) {
+      m_journal_size += buf.size();
+      return nullptr;
+    }
+  }
+
+  // the changes have been taken, so fall back to saving everything
+  m_persistent_dirty = true;
+  return SaveFull(filename, true, true);
+}
+
 void Storage::SaveEntries(wpi::raw_ostream& os, std::string_view prefix) const {
   std::vector<SavePersistentImpl::Entry> entries;
   if (!GetEntries(prefix, &entries)) {
@@ -0,0 +1,256 @@
+// Copyright (c) FIRST and other WPILib contributors.
+// Open Source Software; you can modify and/or share it under the terms of
+// the WPILib BSD license file in the root directory of this project.
+
+#include "UvNetworkConnection.h"
+
+#include <cstring>
+#include <utility>
+
+#include <wpi/SmallVector.h>
+#include <wpi/raw_istream.h>
+#include <wpinet/uv/Tcp.h>
+#include <wpinet/uv/util.h>
+
+#include "IConnectionNotifier.h"
+#include "Log.h"
+#include "WireDecoder.h"
+
+using namespace nt;
+namespace uv = wpi::uv;
+
+// Reads from the receive buffer.  Reading past the end of the received data
+// sets the error flag instead of blocking; the partial message is decoded
+// again once more data arrives.
+class UvNetworkConnection::RecvStream : public wpi::raw_istream {
+ public:
+  void Reset(const char* data, size_t len) {
+    m_cur = data;
+    m_left = len;
+    clear_error();
+  }
+
+  void close() override {}
+  size_t in_avail() const override { return m_left; }
+
+ private:
+  void read_impl(void* data, size_t len) override {
+    if (len > m_left) {
+      error_detected();
+      len = m_left;
+    }
+    std::memcpy(data, m_cur, len);
+    m_cur += len;
+    m_left -= len;
+    set_read_count(len);
+  }
+
+  const char* m_cur = nullptr;
+  size_t m_left = 0;
+};
+
+UvNetworkConnection::UvNetworkConnection(
+    unsigned int uid, std::shared_ptr<uv::Tcp> stream,
+    IConnectionNotifier& notifier, wpi::Logger& logger,
+    HandshakeFunc handshake, Message::GetEntryTypeFunc get_entry_type)
+    : m_uid(uid),
+      m_stream(std::move(stream)),
+      m_notifier(notifier),
+      m_logger(logger),
+      m_handshake(std::move(handshake)),
+      m_get_entry_type(std::move(get_entry_type)),
+      m_state(kCreated),
+      m_is(std::make_unique<RecvStream>()),
+      m_encoder(0x0300) {
+  m_proto_rev = 0x0300;
+  m_last_update = 0;
+  m_decoder = std::make_unique<WireDecoder>(*m_is, m_proto_rev, m_logger);
+  uv::AddrToName(m_stream->GetPeer(), &m_remote_ip, &m_remote_port);
+
+  // turn off Nagle algorithm; we bundle packets for transmission
+  m_stream->SetNoDelay(true);
+}
+
+UvNetworkConnection::~UvNetworkConnection() {
+  set_state(kDead);
+}
+
+void UvNetworkConnection::Start() {
+  set_state(kHandshake);
+  m_stream->data.connect(
+      [this](uv::Buffer& buf, size_t len) { ProcessData(buf.base, len); });
+  m_stream->end.connect([this] {
+    DEBUG2("{}", "connection closed by peer");
+    Close();
+  });
+  m_stream->error.connect([this](uv::Error err) {
+    DEBUG2("connection error: {}", err.str());
+    Close();
+  });
+  m_stream->StartRead();
+}
+
+ConnectionInfo UvNetworkConnection::info() const {
+  return ConnectionInfo{remote_id(), m_remote_ip, m_remote_port,
+                        m_last_update, m_proto_rev};
+}
+
+unsigned int UvNetworkConnection::proto_rev() const {
+  return m_proto_rev;
+}
+
+void UvNetworkConnection::set_proto_rev(unsigned int proto_rev) {
+  m_proto_rev = proto_rev;
+}
+
+UvNetworkConnection::State UvNetworkConnection::state() const {
+  std::scoped_lock lock(m_state_mutex);
+  return m_state;
+}
+
+void UvNetworkConnection::set_state(State state) {
+  std::scoped_lock lock(m_state_mutex);
+  // Don't update state any more once we've died
+  if (m_state == kDead) {
+    return;
+  }
+  // One-shot notify state changes
+  if (m_state != kActive && state == kActive) {
+    m_notifier.NotifyConnection(true, info());
+  }
+  if (m_state != kDead && state == kDead) {
+    m_notifier.NotifyConnection(false, info());
+  }
+  m_state = state;
+}
+
+std::string UvNetworkConnection::remote_id() const {
+  std::scoped_lock lock(m_remote_id_mutex);
+  return m_remote_id;
+}
+
+void UvNetworkConnection::set_remote_id(std::string_view remote_id) {
+  std::scoped_lock lock(m_remote_id_mutex);
+  m_remote_id = remote_id;
+}
+
+void UvNetworkConnection::QueueOutgoing(std::shared_ptr<Message> msg) {
+  std::scoped_lock lock(m_pending_mutex);
+  m_pending.Add(std::move(msg));
+}
+
+void UvNetworkConnection::SetSubscriptions(
+    wpi::span<const std::string> prefixes,
+    wpi::span<const std::shared_ptr<Message>> assigns) {
+  std::scoped_lock lock(m_pending_mutex);
+  m_pending.SetSubscriptions(prefixes, assigns);
+}
+
+void UvNetworkConnection::PostOutgoing(bool keep_alive) {
+  Outgoing msgs;
+  auto now = std::chrono::steady_clock::now();
+  {
+    std::scoped_lock lock(m_pending_mutex);
+    if (m_pending.empty()) {
+      if (!keep_alive) {
+        return;
+      }
+      // send keep-alives once a second (if no other messages have been sent)
+      if ((now - m_last_post) < std::chrono::seconds(1)) {
+        return;
+      }
+      msgs.emplace_back(Message::KeepAlive());
+    } else {
+      msgs = m_pending.Take();
+    }
+  }
+  m_last_post = now;
+  DEBUG3("sending {} messages", msgs.size());
+  Send(msgs);
+}
+
+void UvNetworkConnection::ProcessData(const char* data, size_t len) {
+  m_inbuf.insert(m_inbuf.end(), data, data + len);
+
+  // decode as many complete messages as have been received
+  size_t pos = 0;
+  while (pos < m_inbuf.size()) {
+    m_is->Reset(m_inbuf.data() + pos, m_inbuf.size() - pos);
+    m_decoder->set_proto_rev(m_proto_rev);
+    m_decoder->Reset();
+    auto msg = Message::Read(*m_decoder, m_get_entry_type);
+    if (!msg) {
+      if (m_decoder->error()) {
+        // terminate connection on bad message
+        INFO("read error: {}", m_decoder->error());
+        Close();
+        return;
+      }
+      break;  // incomplete message
+    }
+    pos = m_inbuf.size() - m_is->in_avail();
+
+    DEBUG3("received type={} with str={} id={} seq_num={}", msg->type(),
+           msg->str(), msg->id(), msg->seq_num_uid());
+    m_last_update = Now();
+    auto state = this->state();
+    if (state == kDead) {
+      return;
+    } else if (state == kActive) {
+      if (msg->Is(Message::kEntryAssign) && msg->id() == 0xffff) {
+        std::scoped_lock lock(m_pending_mutex);
+        m_pending.AddRequest(msg->str());
+      }
+      m_process_incoming(std::move(msg), this);
+    } else if (!m_handshake(*this, std::move(msg),
+                            [this](auto msgs) { Send(msgs); })) {
+      Close();
+      return;
+    }
+  }
+  m_inbuf.erase(m_inbuf.begin(), m_inbuf.begin() + pos);
+}
+
+void UvNetworkConnection::Send(wpi::span<std::shared_ptr<Message>> msgs) {
+  if (m_proto_rev >= 0x0300) {
+    // write the shared encodings, keeping the messages and the copy buffer
+    // alive until the write completes
+    auto buf = std::make_shared<std::string>();
+    std::vector<std::string_view> views;
+    if (Message::GatherEncoded(msgs, buf.get(), &views) == 0) {
+      return;
+    }
+    wpi::SmallVector<uv::Buffer, 16> bufs(views.begin(), views.end());
+    m_stream->Write(bufs, [buf, keep = Outgoing(msgs.begin(), msgs.end())](
+                              auto, uv::Error) {});
+    return;
+  }
+
+  m_encoder.set_proto_rev(m_proto_rev);
+  m_encoder.Reset();
+  for (auto& msg : msgs) {
+    if (msg) {
+      msg->Write(m_encoder);
+    }
+  }
+  if (m_encoder.size() == 0) {
+    return;
+  }
+  // the encoder is reused, so give the write its own copy
+  auto buf = uv::Buffer::Allocate(m_encoder.size());
+  std::memcpy(buf.base, m_encoder.data(), m_encoder.size());
+  m_stream->Write({buf}, [](auto bufs, uv::Error) {
+    for (auto buf : bufs) {
+      buf.Deallocate();
+    }
+  });
+}
+
+void UvNetworkConnection::Close() {
+  if (m_stream->IsClosing()) {
+    return;
+  }
+  DEBUG2("UvNetworkConnection closing ({})", fmt::ptr(this));
+  m_stream->Close();
+  set_state(kDead);
+}
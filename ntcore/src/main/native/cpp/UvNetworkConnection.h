@@ -0,0 +1,136 @@
+// Copyright (c) FIRST and other WPILib contributors.
+// Open Source Software; you can modify and/or share it under the terms of
+// the WPILib BSD license file in the root directory of this project.
+
+#ifndef NTCORE_UVNETWORKCONNECTION_H_
+#define NTCORE_UVNETWORKCONNECTION_H_
+
+#include <stdint.h>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <wpi/mutex.h>
+#include <wpi/span.h>
+
+#include "INetworkConnection.h"
+#include "Message.h"
+#include "PendingOutgoing.h"
+#include "WireEncoder.h"
+#include "ntcore_cpp.h"
+
+namespace wpi {
+class Logger;
+namespace uv {
+class Tcp;
+}  // namespace uv
+}  // namespace wpi
+
+namespace nt {
+
+class IConnectionNotifier;
+class WireDecoder;
+
+/**
+ * Network connection serviced by a libuv event loop rather than by dedicated
+ * read and write threads.  Everything other than QueueOutgoing must be called
+ * from the loop thread.
+ */
+class UvNetworkConnection
+    : public INetworkConnection,
+      public std::enable_shared_from_this<UvNetworkConnection> {
+ public:
+  using SendMsgsFunc = std::function<void(wpi::span<std::shared_ptr<Message>>)>;
+  // Called on the loop thread for each message received while the connection
+  // is not yet active.  Returns false to close the connection.  The handshake
+  // is complete once it sets the state to kActive.
+  using HandshakeFunc =
+      std::function<bool(UvNetworkConnection& conn, std::shared_ptr<Message>,
+                         SendMsgsFunc send_msgs)>;
+  using ProcessIncomingFunc =
+      std::function<void(std::shared_ptr<Message>, UvNetworkConnection*)>;
+  using Outgoing = std::vector<std::shared_ptr<Message>>;
+
+  UvNetworkConnection(unsigned int uid, std::shared_ptr<wpi::uv::Tcp> stream,
+                      IConnectionNotifier& notifier, wpi::Logger& logger,
+                      HandshakeFunc handshake,
+                      Message::GetEntryTypeFunc get_entry_type);
+  ~UvNetworkConnection() override;
+
+  // Set the input processor function.  This must be called before Start().
+  void set_process_incoming(ProcessIncomingFunc func) {
+    m_process_incoming = func;
+  }
+
+  // Starts reading.  Must be called on the loop thread.
+  void Start();
+
+  ConnectionInfo info() const final;
+
+  void QueueOutgoing(std::shared_ptr<Message> msg) final;
+  void PostOutgoing(bool keep_alive) override;
+  void SetSubscriptions(
+      wpi::span<const std::string> prefixes,
+      wpi::span<const std::shared_ptr<Message>> assigns) final;
+
+  unsigned int uid() const { return m_uid; }
+
+  unsigned int proto_rev() const final;
+  void set_proto_rev(unsigned int proto_rev) final;
+
+  State state() const final;
+  void set_state(State state) final;
+
+  std::string remote_id() const;
+  void set_remote_id(std::string_view remote_id);
+
+  // Initial entry assignments received during the handshake.  Only accessed
+  // from the loop thread.
+  Outgoing& handshake_incoming() { return m_handshake_incoming; }
+
+  UvNetworkConnection(const UvNetworkConnection&) = delete;
+  UvNetworkConnection& operator=(const UvNetworkConnection&) = delete;
+
+ private:
+  class RecvStream;
+
+  void ProcessData(const char* data, size_t len);
+  void Send(wpi::span<std::shared_ptr<Message>> msgs);
+  void Close();
+
+  unsigned int m_uid;
+  std::shared_ptr<wpi::uv::Tcp> m_stream;
+  IConnectionNotifier& m_notifier;
+  wpi::Logger& m_logger;
+  HandshakeFunc m_handshake;
+  Message::GetEntryTypeFunc m_get_entry_type;
+  ProcessIncomingFunc m_process_incoming;
+  std::atomic_uint m_proto_rev;
+  mutable wpi::mutex m_state_mutex;
+  State m_state;
+  mutable wpi::mutex m_remote_id_mutex;
+  std::string m_remote_id;
+  std::string m_remote_ip;
+  unsigned int m_remote_port = 0;
+  std::atomic_ullong m_last_update;
+
+  // loop thread only
+  std::unique_ptr<RecvStream> m_is;
+  std::unique_ptr<WireDecoder> m_decoder;
+  std::vector<char> m_inbuf;
+  Outgoing m_handshake_incoming;
+  WireEncoder m_encoder;
+  std::chrono::steady_clock::time_point m_last_post;
+
+  wpi::mutex m_pending_mutex;
+  PendingOutgoing m_pending;
+};
+
+}  // namespace nt
+
+#endif  // NTCORE_UVNETWORKCONNECTION_H_
@@ -4,6 +4,7 @@
 
 #include <stdint.h>
 
+#include <algorithm>
 #include <cstring>
 
 #include <wpi/MemAlloc.h>
@@ -196,6 +197,57 @@ std::shared_ptr<Value> nt::ConvertFromC(const NT_Value& value) {
   }
 }
 
+static uint64_t UpdateTime(uint64_t time) {
+  return time == 0 ? wpi::Now() : time;
+}
+
+void ValueUpdater::SetTime(Value& value, uint64_t time) {
+  value.m_val.last_change = UpdateTime(time);
+}
+
+void ValueUpdater::SetBoolean(Value& value, bool v, uint64_t time) {
+  value.m_val.data.v_boolean = v;
+  value.m_val.last_change = UpdateTime(time);
+}
+
+void ValueUpdater::SetDouble(Value& value, double v, uint64_t time) {
+  value.m_val.data.v_double = v;
+  value.m_val.last_change = UpdateTime(time);
+}
+
+void ValueUpdater::SetString(Value& value, std::string_view v,
+                             uint64_t time) {
+  // assign() keeps the existing capacity, but may still move the buffer
+  value.m_string.assign(v.data(), v.size());
+  value.m_val.data.v_string.str = const_cast<char*>(value.m_string.c_str());
+  value.m_val.data.v_string.len = value.m_string.size();
+  value.m_val.last_change = UpdateTime(time);
+}
+
+void ValueUpdater::SetBooleanArray(Value& value, wpi::span<const int> v,
+                                   uint64_t time) {
+  auto& arr = value.m_val.data.arr_boolean;
+  if (arr.size != v.size()) {
+    delete[] arr.arr;
+    arr.arr = new int[v.size()];
+    arr.size = v.size();
+  }
+  std::copy(v.begin(), v.end(), arr.arr);
+  value.m_val.last_change = UpdateTime(time);
+}
+
+void ValueUpdater::SetDoubleArray(Value& value, wpi::span<const double> v,
+                                  uint64_t time) {
+  auto& arr = value.m_val.data.arr_double;
+  if (arr.size != v.size()) {
+    delete[] arr.arr;
+    arr.arr = new double[v.size()];
+    arr.size = v.size();
+  }
+  std::copy(v.begin(), v.end(), arr.arr);
+  value.m_val.last_change = UpdateTime(time);
+}
+
 bool nt::operator==(const Value& lhs, const Value& rhs) {
   if (lhs.type() != rhs.type()) {
     return false;
@@ -5,10 +5,14 @@
 #ifndef NTCORE_VALUE_INTERNAL_H_
 #define NTCORE_VALUE_INTERNAL_H_
 
+#include <stdint.h>
+
 #include <memory>
 #include <string>
 #include <string_view>
 
+#include <wpi/span.h>
+
 #include "ntcore_c.h"
 
 namespace nt {
@@ -22,6 +26,25 @@ inline std::string_view ConvertFromC(const NT_String& str) {
   return {str.str, str.len};
 }
 
+/**
+ * Overwrites the contents of an existing value, reusing its storage where
+ * possible.  The new contents must be of the value's type, and the caller
+ * must hold the only reference to the value, as values are otherwise treated
+ * as immutable.  If time is zero, the current time is used.
+ */
+class ValueUpdater {
+ public:
+  static void SetTime(Value& value, uint64_t time);
+  static void SetBoolean(Value& value, bool v, uint64_t time);
+  static void SetDouble(Value& value, double v, uint64_t time);
+  // For both string and raw values.
+  static void SetString(Value& value, std::string_view v, uint64_t time);
+  static void SetBooleanArray(Value& value, wpi::span<const int> v,
+                              uint64_t time);
+  static void SetDoubleArray(Value& value, wpi::span<const double> v,
+                             uint64_t time);
+};
+
 }  // namespace nt
 
 #endif  // NTCORE_VALUE_INTERNAL_H_
@@ -30,7 +30,7 @@ void WireEncoder::WriteDouble(double val) {
        static_cast<char>((v >> 8) & 0xff), static_cast<char>(v & 0xff)});
 }
 
-void WireEncoder::WriteUleb128(uint32_t val) {
+void WireEncoder::WriteUleb128(uint64_t val) {
   wpi::WriteUleb128(m_data, val);
 }
 
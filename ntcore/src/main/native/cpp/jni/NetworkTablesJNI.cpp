@@ -4,10 +4,12 @@
 
 #include <jni.h>
 
+#include <algorithm>
 #include <cassert>
 
 #include <fmt/format.h>
 #include <wpi/ConvertUTF.h>
+#include <wpi/SmallVector.h>
 #include <wpi/jni_util.h>
 
 #include "edu_wpi_first_networktables_NetworkTablesJNI.h"
@@ -125,6 +127,27 @@ inline std::shared_ptr<nt::Value> FromJavaRawBB(JNIEnv* env, jobject jbb,
   return nt::Value::MakeRaw(ref.str(), time);
 }
 
+// Copies entry handles from a Java array, at most max of them.
+static void FromJavaEntries(JNIEnv* env, jintArray jarr, jsize max,
+                            wpi::SmallVectorImpl<NT_Entry>& out) {
+  static_assert(sizeof(NT_Entry) == sizeof(jint));
+  out.resize((std::min)(env->GetArrayLength(jarr), max));
+  env->GetIntArrayRegion(jarr, 0, out.size(),
+                         reinterpret_cast<jint*>(out.data()));
+}
+
+// Views a direct ByteBuffer as doubles.  Throws and returns an empty span if
+// the buffer isn't direct.
+static wpi::span<double> FromJavaDoubleBuffer(JNIEnv* env, jobject jbb) {
+  auto data = static_cast<double*>(env->GetDirectBufferAddress(jbb));
+  if (!data) {
+    illegalArgEx.Throw(env, "values must be a direct ByteBuffer");
+    return {};
+  }
+  return {data, static_cast<size_t>(env->GetDirectBufferCapacity(jbb)) /
+                    sizeof(double)};
+}
+
 inline std::shared_ptr<nt::Value> FromJavaRpc(JNIEnv* env, jbyteArray jarr,
                                               jlong time) {
   CriticalJByteArrayRef ref{env, jarr};
@@ -490,13 +513,8 @@ JNIEXPORT jboolean JNICALL
 Java_edu_wpi_first_networktables_NetworkTablesJNI_setBoolean
   (JNIEnv*, jclass, jint entry, jlong time, jboolean value, jboolean force)
 {
-  if (force) {
-    nt::SetEntryTypeValue(entry,
-                          nt::Value::MakeBoolean(value != JNI_FALSE, time));
-    return JNI_TRUE;
-  }
-  return nt::SetEntryValue(entry,
-                           nt::Value::MakeBoolean(value != JNI_FALSE, time));
+  return nt::SetEntryBoolean(entry, value != JNI_FALSE, time, force) ||
+         force;
 }
 
 /*
@@ -508,11 +526,7 @@ JNIEXPORT jboolean JNICALL
 Java_edu_wpi_first_networktables_NetworkTablesJNI_setDouble
   (JNIEnv*, jclass, jint entry, jlong time, jdouble value, jboolean force)
 {
-  if (force) {
-    nt::SetEntryTypeValue(entry, nt::Value::MakeDouble(value, time));
-    return JNI_TRUE;
-  }
-  return nt::SetEntryValue(entry, nt::Value::MakeDouble(value, time));
+  return nt::SetEntryDouble(entry, value, time, force) || force;
 }
 
 /*
@@ -528,13 +542,9 @@ Java_edu_wpi_first_networktables_NetworkTablesJNI_setString
     nullPointerEx.Throw(env, "value cannot be null");
     return false;
   }
-  if (force) {
-    nt::SetEntryTypeValue(
-        entry, nt::Value::MakeString(JStringRef{env, value}.str(), time));
-    return JNI_TRUE;
-  }
-  return nt::SetEntryValue(
-      entry, nt::Value::MakeString(JStringRef{env, value}.str(), time));
+  return nt::SetEntryString(entry, JStringRef{env, value}.str(), time,
+                            force) ||
+         force;
 }
 
 /*
@@ -787,6 +797,100 @@ Java_edu_wpi_first_networktables_NetworkTablesJNI_getStringArray
   return MakeJStringArray(env, val->GetStringArray());
 }
 
+/*
+ * Class:     edu_wpi_first_networktables_NetworkTablesJNI
+ * Method:    getDoubles
+ * Signature: ([ID[D)V
+ */
+JNIEXPORT void JNICALL
+Java_edu_wpi_first_networktables_NetworkTablesJNI_getDoubles
+  (JNIEnv* env, jclass, jintArray entries, jdouble defaultValue,
+   jdoubleArray values)
+{
+  if (!entries || !values) {
+    nullPointerEx.Throw(env, "entries and values cannot be null");
+    return;
+  }
+  wpi::SmallVector<NT_Entry, 128> handles;
+  FromJavaEntries(env, entries, env->GetArrayLength(values), handles);
+  wpi::SmallVector<double, 128> buf(handles.size());
+  nt::GetEntryDoubles(handles, defaultValue, buf);
+  env->SetDoubleArrayRegion(values, 0, buf.size(), buf.data());
+}
+
+/*
+ * Class:     edu_wpi_first_networktables_NetworkTablesJNI
+ * Method:    setDoubles
+ * Signature: ([IJ[D)I
+ */
+JNIEXPORT jint JNICALL
+Java_edu_wpi_first_networktables_NetworkTablesJNI_setDoubles
+  (JNIEnv* env, jclass, jintArray entries, jlong time, jdoubleArray values)
+{
+  if (!entries || !values) {
+    nullPointerEx.Throw(env, "entries and values cannot be null");
+    return 0;
+  }
+  wpi::SmallVector<NT_Entry, 128> handles;
+  FromJavaEntries(env, entries, env->GetArrayLength(values), handles);
+  wpi::SmallVector<double, 128> buf(handles.size());
+  env->GetDoubleArrayRegion(values, 0, buf.size(), buf.data());
+  return nt::SetEntryDoubles(handles, buf, time);
+}
+
+/*
+ * Class:     edu_wpi_first_networktables_NetworkTablesJNI
+ * Method:    getDoubleArrays
+ * Signature: ([ILjava/nio/ByteBuffer;[I)I
+ */
+JNIEXPORT jint JNICALL
+Java_edu_wpi_first_networktables_NetworkTablesJNI_getDoubleArrays
+  (JNIEnv* env, jclass, jintArray entries, jobject values, jintArray lengths)
+{
+  if (!entries || !values || !lengths) {
+    nullPointerEx.Throw(env, "entries, values and lengths cannot be null");
+    return 0;
+  }
+  auto buf = FromJavaDoubleBuffer(env, values);
+  if (!buf.data()) {
+    return 0;
+  }
+  wpi::SmallVector<NT_Entry, 128> handles;
+  FromJavaEntries(env, entries, env->GetArrayLength(lengths), handles);
+  wpi::SmallVector<int, 128> lens(handles.size());
+  size_t total = nt::GetEntryDoubleArrays(handles, buf, lens);
+  static_assert(sizeof(int) == sizeof(jint));
+  env->SetIntArrayRegion(lengths, 0, lens.size(),
+                         reinterpret_cast<const jint*>(lens.data()));
+  return total;
+}
+
+/*
+ * Class:     edu_wpi_first_networktables_NetworkTablesJNI
+ * Method:    setDoubleArrays
+ * Signature: ([IJLjava/nio/ByteBuffer;[I)I
+ */
+JNIEXPORT jint JNICALL
+Java_edu_wpi_first_networktables_NetworkTablesJNI_setDoubleArrays
+  (JNIEnv* env, jclass, jintArray entries, jlong time, jobject values,
+   jintArray lengths)
+{
+  if (!entries || !values || !lengths) {
+    nullPointerEx.Throw(env, "entries, values and lengths cannot be null");
+    return 0;
+  }
+  auto buf = FromJavaDoubleBuffer(env, values);
+  if (!buf.data()) {
+    return 0;
+  }
+  wpi::SmallVector<NT_Entry, 128> handles;
+  FromJavaEntries(env, entries, env->GetArrayLength(lengths), handles);
+  wpi::SmallVector<int, 128> lens(handles.size());
+  env->GetIntArrayRegion(lengths, 0, lens.size(),
+                         reinterpret_cast<jint*>(lens.data()));
+  return nt::SetEntryDoubleArrays(handles, buf, lens, time);
+}
+
 /*
  * Class:     edu_wpi_first_networktables_NetworkTablesJNI
  * Method:    setDefaultBoolean
@@ -48,6 +48,13 @@ NT_EntryListener NetworkTableInstance::AddEntryListener(
   return ::nt::AddEntryListener(m_handle, prefix, callback, flags);
 }
 
+NT_EntryListener NetworkTableInstance::AddEntryListenerBatch(
+    std::string_view prefix,
+    std::function<void(wpi::span<const EntryNotification> events)> callback,
+    unsigned int flags) const {
+  return ::nt::AddEntryListenerBatch(m_handle, prefix, callback, flags);
+}
+
 NT_ConnectionListener NetworkTableInstance::AddConnectionListener(
     std::function<void(const ConnectionNotification& event)> callback,
     bool immediate_notify) const {
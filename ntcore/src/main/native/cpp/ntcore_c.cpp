@@ -257,6 +257,10 @@ unsigned int NT_GetEntryFlags(NT_Entry entry) {
   return nt::GetEntryFlags(entry);
 }
 
+void NT_SetEntrySendOptions(NT_Entry entry, double period, double deadband) {
+  nt::SetEntrySendOptions(entry, period, deadband);
+}
+
 void NT_DeleteEntry(NT_Entry entry) {
   nt::DeleteEntry(entry);
 }
@@ -591,6 +595,10 @@ void NT_StartServer(NT_Inst inst, const char* persist_filename,
   nt::StartServer(inst, persist_filename, listen_address, port);
 }
 
+void NT_SetServerEventLoop(NT_Inst inst, NT_Bool enable) {
+  nt::SetServerEventLoop(inst, enable);
+}
+
 void NT_StopServer(NT_Inst inst) {
   nt::StopServer(inst);
 }
@@ -931,65 +939,33 @@ void NT_FreeStringArray(struct NT_String* v_string, size_t arr_size) {
 
 NT_Bool NT_SetEntryDouble(NT_Entry entry, uint64_t time, double v_double,
                           NT_Bool force) {
-  if (force != 0) {
-    nt::SetEntryTypeValue(entry, Value::MakeDouble(v_double, time));
-    return 1;
-  } else {
-    return nt::SetEntryValue(entry, Value::MakeDouble(v_double, time));
-  }
+  return nt::SetEntryDouble(entry, v_double, time, force != 0);
 }
 
 NT_Bool NT_SetEntryBoolean(NT_Entry entry, uint64_t time, NT_Bool v_boolean,
                            NT_Bool force) {
-  if (force != 0) {
-    nt::SetEntryTypeValue(entry, Value::MakeBoolean(v_boolean != 0, time));
-    return 1;
-  } else {
-    return nt::SetEntryValue(entry, Value::MakeBoolean(v_boolean != 0, time));
-  }
+  return nt::SetEntryBoolean(entry, v_boolean != 0, time, force != 0);
 }
 
 NT_Bool NT_SetEntryString(NT_Entry entry, uint64_t time, const char* str,
                           size_t str_len, NT_Bool force) {
-  if (force != 0) {
-    nt::SetEntryTypeValue(entry, Value::MakeString({str, str_len}, time));
-    return 1;
-  } else {
-    return nt::SetEntryValue(entry, Value::MakeString({str, str_len}, time));
-  }
+  return nt::SetEntryString(entry, {str, str_len}, time, force != 0);
 }
 
 NT_Bool NT_SetEntryRaw(NT_Entry entry, uint64_t time, const char* raw,
                        size_t raw_len, NT_Bool force) {
-  if (force != 0) {
-    nt::SetEntryTypeValue(entry, Value::MakeRaw({raw, raw_len}, time));
-    return 1;
-  } else {
-    return nt::SetEntryValue(entry, Value::MakeRaw({raw, raw_len}, time));
-  }
+  return nt::SetEntryRaw(entry, {raw, raw_len}, time, force != 0);
 }
 
 NT_Bool NT_SetEntryBooleanArray(NT_Entry entry, uint64_t time,
                                 const NT_Bool* arr, size_t size,
                                 NT_Bool force) {
-  if (force != 0) {
-    nt::SetEntryTypeValue(entry,
-                          Value::MakeBooleanArray(wpi::span(arr, size), time));
-    return 1;
-  } else {
-    return nt::SetEntryValue(
-        entry, Value::MakeBooleanArray(wpi::span(arr, size), time));
-  }
+  return nt::SetEntryBooleanArray(entry, {arr, size}, time, force != 0);
 }
 
 NT_Bool NT_SetEntryDoubleArray(NT_Entry entry, uint64_t time, const double* arr,
                                size_t size, NT_Bool force) {
-  if (force != 0) {
-    nt::SetEntryTypeValue(entry, Value::MakeDoubleArray({arr, size}, time));
-    return 1;
-  } else {
-    return nt::SetEntryValue(entry, Value::MakeDoubleArray({arr, size}, time));
-  }
+  return nt::SetEntryDoubleArray(entry, {arr, size}, time, force != 0);
 }
 
 NT_Bool NT_SetEntryStringArray(NT_Entry entry, uint64_t time,
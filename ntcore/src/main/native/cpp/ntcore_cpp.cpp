@@ -4,10 +4,13 @@
 
 #include <stdint.h>
 
+#include <algorithm>
 #include <cassert>
+#include <climits>
 #include <cstdio>
 #include <cstdlib>
 
+#include <wpi/SmallVector.h>
 #include <wpi/timestamp.h>
 
 #include "Handle.h"
@@ -160,6 +163,144 @@ void SetEntryTypeValue(NT_Entry entry, std::shared_ptr<Value> value) {
   ii->storage.SetEntryTypeValue(id, value);
 }
 
+bool SetEntryBoolean(NT_Entry entry, bool value, uint64_t time, bool force) {
+  Handle handle{entry};
+  int id = handle.GetTypedIndex(Handle::kEntry);
+  auto ii = InstanceImpl::Get(handle.GetInst());
+  if (id < 0 || !ii) {
+    return false;
+  }
+
+  return ii->storage.SetEntryBoolean(id, value, time, force);
+}
+
+bool SetEntryDouble(NT_Entry entry, double value, uint64_t time, bool force) {
+  Handle handle{entry};
+  int id = handle.GetTypedIndex(Handle::kEntry);
+  auto ii = InstanceImpl::Get(handle.GetInst());
+  if (id < 0 || !ii) {
+    return false;
+  }
+
+  return ii->storage.SetEntryDouble(id, value, time, force);
+}
+
+bool SetEntryString(NT_Entry entry, std::string_view value, uint64_t time,
+                    bool force) {
+  Handle handle{entry};
+  int id = handle.GetTypedIndex(Handle::kEntry);
+  auto ii = InstanceImpl::Get(handle.GetInst());
+  if (id < 0 || !ii) {
+    return false;
+  }
+
+  return ii->storage.SetEntryString(id, value, time, force);
+}
+
+bool SetEntryRaw(NT_Entry entry, std::string_view value, uint64_t time,
+                 bool force) {
+  Handle handle{entry};
+  int id = handle.GetTypedIndex(Handle::kEntry);
+  auto ii = InstanceImpl::Get(handle.GetInst());
+  if (id < 0 || !ii) {
+    return false;
+  }
+
+  return ii->storage.SetEntryRaw(id, value, time, force);
+}
+
+bool SetEntryBooleanArray(NT_Entry entry, wpi::span<const int> value,
+                          uint64_t time, bool force) {
+  Handle handle{entry};
+  int id = handle.GetTypedIndex(Handle::kEntry);
+  auto ii = InstanceImpl::Get(handle.GetInst());
+  if (id < 0 || !ii) {
+    return false;
+  }
+
+  return ii->storage.SetEntryBooleanArray(id, value, time, force);
+}
+
+bool SetEntryDoubleArray(NT_Entry entry, wpi::span<const double> value,
+                         uint64_t time, bool force) {
+  Handle handle{entry};
+  int id = handle.GetTypedIndex(Handle::kEntry);
+  auto ii = InstanceImpl::Get(handle.GetInst());
+  if (id < 0 || !ii) {
+    return false;
+  }
+
+  return ii->storage.SetEntryDoubleArray(id, value, time, force);
+}
+
+// Maps entry handles to local ids of the first entry's instance.  Entries of
+// other instances get an id past the end of the entry table.
+static InstanceImpl* GetBulkIds(wpi::span<const NT_Entry> entries,
+                                wpi::SmallVectorImpl<unsigned int>& ids) {
+  if (entries.empty()) {
+    return nullptr;
+  }
+  int inst = Handle{entries[0]}.GetInst();
+  auto ii = InstanceImpl::Get(inst);
+  if (!ii) {
+    return nullptr;
+  }
+  ids.reserve(entries.size());
+  for (auto entry : entries) {
+    Handle handle{entry};
+    int id = handle.GetTypedIndex(Handle::kEntry);
+    ids.push_back(id < 0 || handle.GetInst() != inst ? UINT_MAX : id);
+  }
+  return ii;
+}
+
+void GetEntryDoubles(wpi::span<const NT_Entry> entries, double defaultValue,
+                     wpi::span<double> values) {
+  wpi::SmallVector<unsigned int, 128> ids;
+  auto ii = GetBulkIds(entries, ids);
+  if (!ii) {
+    std::fill(values.begin(), values.end(), defaultValue);
+    return;
+  }
+
+  ii->storage.GetEntryDoubles(ids, defaultValue, values);
+}
+
+size_t SetEntryDoubles(wpi::span<const NT_Entry> entries,
+                       wpi::span<const double> values, uint64_t time) {
+  wpi::SmallVector<unsigned int, 128> ids;
+  auto ii = GetBulkIds(entries, ids);
+  if (!ii) {
+    return 0;
+  }
+
+  return ii->storage.SetEntryDoubles(ids, values, time);
+}
+
+size_t GetEntryDoubleArrays(wpi::span<const NT_Entry> entries,
+                            wpi::span<double> values, wpi::span<int> lengths) {
+  wpi::SmallVector<unsigned int, 128> ids;
+  auto ii = GetBulkIds(entries, ids);
+  if (!ii) {
+    std::fill(lengths.begin(), lengths.end(), -1);
+    return 0;
+  }
+
+  return ii->storage.GetEntryDoubleArrays(ids, values, lengths);
+}
+
+size_t SetEntryDoubleArrays(wpi::span<const NT_Entry> entries,
+                            wpi::span<const double> values,
+                            wpi::span<const int> lengths, uint64_t time) {
+  wpi::SmallVector<unsigned int, 128> ids;
+  auto ii = GetBulkIds(entries, ids);
+  if (!ii) {
+    return 0;
+  }
+
+  return ii->storage.SetEntryDoubleArrays(ids, values, lengths, time);
+}
+
 void SetEntryFlags(NT_Entry entry, unsigned int flags) {
   Handle handle{entry};
   int id = handle.GetTypedIndex(Handle::kEntry);
@@ -182,6 +323,41 @@ unsigned int GetEntryFlags(NT_Entry entry) {
   return ii->storage.GetEntryFlags(id);
 }
 
+void SetEntrySendOptions(NT_Entry entry, double period, double deadband) {
+  Handle handle{entry};
+  int id = handle.GetTypedIndex(Handle::kEntry);
+  auto ii = InstanceImpl::Get(handle.GetInst());
+  if (id < 0 || !ii) {
+    return;
+  }
+
+  ii->storage.SetEntrySendOptions(id, period, deadband);
+}
+
+void SetEntryHistory(NT_Entry entry, size_t depth) {
+  Handle handle{entry};
+  int id = handle.GetTypedIndex(Handle::kEntry);
+  auto ii = InstanceImpl::Get(handle.GetInst());
+  if (id < 0 || !ii) {
+    return;
+  }
+
+  ii->storage.SetEntryHistory(id, depth);
+}
+
+std::vector<std::shared_ptr<Value>> GetEntryHistory(NT_Entry entry,
+                                                    uint64_t start,
+                                                    uint64_t end) {
+  Handle handle{entry};
+  int id = handle.GetTypedIndex(Handle::kEntry);
+  auto ii = InstanceImpl::Get(handle.GetInst());
+  if (id < 0 || !ii) {
+    return {};
+  }
+
+  return ii->storage.GetEntryHistory(id, start, end);
+}
+
 void DeleteEntry(NT_Entry entry) {
   Handle handle{entry};
   int id = handle.GetTypedIndex(Handle::kEntry);
@@ -265,6 +441,20 @@ NT_EntryListener AddEntryListener(
   return Handle(i, uid, Handle::kEntryListener);
 }
 
+NT_EntryListener AddEntryListenerBatch(
+    NT_Inst inst, std::string_view prefix,
+    std::function<void(wpi::span<const EntryNotification> events)> callback,
+    unsigned int flags) {
+  int i = Handle{inst}.GetTypedInst(Handle::kInstance);
+  auto ii = InstanceImpl::Get(i);
+  if (i < 0 || !ii) {
+    return 0;
+  }
+
+  unsigned int uid = ii->storage.AddBatchListener(prefix, callback, flags);
+  return Handle(i, uid, Handle::kEntryListener);
+}
+
 NT_EntryListenerPoller CreateEntryListenerPoller(NT_Inst inst) {
   int i = Handle{inst}.GetTypedInst(Handle::kInstance);
   auto ii = InstanceImpl::Get(i);
@@ -884,6 +1074,16 @@ void SetNetworkIdentity(NT_Inst inst, std::string_view name) {
   ii->dispatcher.SetIdentity(name);
 }
 
+void SetNetworkSubscriptions(NT_Inst inst,
+                             wpi::span<const std::string_view> prefixes) {
+  auto ii = InstanceImpl::Get(Handle{inst}.GetTypedInst(Handle::kInstance));
+  if (!ii) {
+    return;
+  }
+
+  ii->dispatcher.SetSubscriptions(prefixes);
+}
+
 unsigned int GetNetworkMode(NT_Inst inst) {
   auto ii = InstanceImpl::Get(Handle{inst}.GetTypedInst(Handle::kInstance));
   if (!ii) {
@@ -921,6 +1121,24 @@ void StartServer(NT_Inst inst, std::string_view persist_filename,
   ii->dispatcher.StartServer(persist_filename, listen_address, port);
 }
 
+void SetServerEventLoop(NT_Inst inst, bool enable) {
+  auto ii = InstanceImpl::Get(Handle{inst}.GetTypedInst(Handle::kInstance));
+  if (!ii) {
+    return;
+  }
+
+  ii->dispatcher.SetServerEventLoop(enable);
+}
+
+void SetServerSharedMemory(NT_Inst inst, size_t size) {
+  auto ii = InstanceImpl::Get(Handle{inst}.GetTypedInst(Handle::kInstance));
+  if (!ii) {
+    return;
+  }
+
+  ii->dispatcher.SetServerSharedMemory(size);
+}
+
 void StopServer(NT_Inst inst) {
   auto ii = InstanceImpl::Get(Handle{inst}.GetTypedInst(Handle::kInstance));
   if (!ii) {
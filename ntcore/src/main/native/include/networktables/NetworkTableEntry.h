@@ -566,6 +566,35 @@ class NetworkTableEntry final {
    */
   bool IsPersistent() const;
 
+  /**
+   * Limits how often changes to the value are sent over the network.
+   * See nt::SetEntrySendOptions() for details.
+   *
+   * @param period minimum time between updates, in seconds (0 for no limit)
+   * @param deadband for double and double array values, changes no larger
+   *                 than this from the last value sent are not sent
+   */
+  void SetSendOptions(double period, double deadband = 0);
+
+  /**
+   * Keeps the entry's most recent values.  See nt::SetEntryHistory() for
+   * details.
+   *
+   * @param depth number of values to keep (0 to stop keeping history)
+   */
+  void SetHistory(size_t depth);
+
+  /**
+   * Gets the entry's retained values with timestamps in a range.  See
+   * nt::GetEntryHistory() for details.
+   *
+   * @param start earliest timestamp, in microseconds
+   * @param end latest timestamp, in microseconds
+   * @return values, oldest first
+   */
+  std::vector<std::shared_ptr<Value>> GetHistory(
+      uint64_t start = 0, uint64_t end = UINT64_MAX) const;
+
   /**
    * Deletes the entry.
    */
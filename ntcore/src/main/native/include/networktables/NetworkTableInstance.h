@@ -192,6 +192,21 @@ class NetworkTableInstance final {
       std::function<void(const EntryNotification& event)> callback,
       unsigned int flags) const;
 
+  /**
+   * Add a listener for all entries starting with a certain prefix that
+   * receives notifications in batches.  See nt::AddEntryListenerBatch() for
+   * details.
+   *
+   * @param prefix            UTF-8 string prefix
+   * @param callback          listener to add
+   * @param flags             EntryListenerFlags bitmask
+   * @return Listener handle
+   */
+  NT_EntryListener AddEntryListenerBatch(
+      std::string_view prefix,
+      std::function<void(wpi::span<const EntryNotification> events)> callback,
+      unsigned int flags) const;
+
   /**
    * Remove an entry listener.
    *
@@ -284,6 +299,15 @@ class NetworkTableInstance final {
    */
   void SetNetworkIdentity(std::string_view name);
 
+  /**
+   * Limits the entries a server sends to this client to those whose names
+   * start with one of the given prefixes.  An empty list (the default)
+   * receives all entries.  See nt::SetNetworkSubscriptions() for details.
+   *
+   * @param prefixes  entry name prefixes to receive
+   */
+  void SetNetworkSubscriptions(wpi::span<const std::string_view> prefixes);
+
   /**
    * Get the current network mode.
    *
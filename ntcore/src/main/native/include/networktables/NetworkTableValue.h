@@ -470,6 +470,7 @@ class Value final {
   Value(const Value&) = delete;
   Value& operator=(const Value&) = delete;
   friend bool operator==(const Value& lhs, const Value& rhs);
+  friend class ValueUpdater;
 
  private:
   NT_Value m_val;
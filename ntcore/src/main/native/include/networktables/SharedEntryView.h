@@ -0,0 +1,123 @@
+// Copyright (c) FIRST and other WPILib contributors.
+// Open Source Software; you can modify and/or share it under the terms of
+// the WPILib BSD license file in the root directory of this project.
+
+#ifndef NTCORE_NETWORKTABLES_SHAREDENTRYVIEW_H_
+#define NTCORE_NETWORKTABLES_SHAREDENTRYVIEW_H_
+
+#include <stdint.h>
+
+#include <memory>
+#include <string_view>
+#include <vector>
+
+#include <wpi/StringMap.h>
+
+#include "networktables/NetworkTableValue.h"
+#include "ntcore_c.h"
+
+namespace nt {
+
+class SharedEntryTable;
+
+/**
+ * Read-only view of the entry values of a server on the same host, read
+ * directly from the shared memory segment it publishes (see
+ * SetServerSharedMemory) instead of over a network connection.
+ *
+ * Reads never block the server.  Values are only those of the server; use a
+ * regular client connection to write values or call RPCs.
+ *
+ * Not supported on Windows.
+ * @ingroup ntcore_cpp_api
+ */
+class SharedEntryView final {
+ public:
+  /**
+   * Opens the segment of a server.
+   *
+   * @param server  server address; must be empty, "localhost" or a loopback
+   *                address
+   * @param port    server port
+   * @return View, or null if the server is not local or doesn't publish a
+   *         segment
+   */
+  static std::unique_ptr<SharedEntryView> Open(
+      std::string_view server, unsigned int port = NT_DEFAULT_PORT);
+
+  ~SharedEntryView();
+
+  SharedEntryView(const SharedEntryView&) = delete;
+  SharedEntryView& operator=(const SharedEntryView&) = delete;
+
+  /**
+   * Looks up an entry.  Indexes stay valid as long as the view is open.
+   *
+   * @param name  entry name
+   * @return Entry index, or -1 if the server has no such entry
+   */
+  int GetIndex(std::string_view name);
+
+  /**
+   * Gets the value of an entry.
+   *
+   * @param index  entry index
+   * @return Entry value, or null if the entry doesn't exist or was deleted
+   */
+  std::shared_ptr<Value> GetValue(int index) const;
+
+  /**
+   * Gets the value of an entry as a double, without allocating.
+   *
+   * @param index         entry index
+   * @param defaultValue  value to return if the entry isn't a double
+   * @return Entry value
+   */
+  double GetDouble(int index, double defaultValue) const;
+
+  /**
+   * Gets the value of an entry as a double array.  Reuses the storage of
+   * value, so repeated reads don't allocate.
+   *
+   * @param index  entry index
+   * @param value  receives the entry value
+   * @return False if the entry isn't a double array
+   */
+  bool GetDoubleArray(int index, std::vector<double>* value) const;
+
+  /**
+   * Gets the number of changes the server has published so far.
+   *
+   * @return Change count
+   */
+  uint32_t GetChangeCount() const;
+
+  /**
+   * Waits for the server to publish a change.
+   *
+   * @param count    change count previously returned by GetChangeCount()
+   * @param timeout  timeout, in seconds; negative to wait forever
+   * @return True if the change count differs from count or the server
+   *         stopped, false on timeout
+   */
+  bool WaitForChange(uint32_t count, double timeout) const;
+
+  /**
+   * Determines if the server has stopped publishing.  A stopped view keeps
+   * the last values; open a new one after the server restarts.
+   *
+   * @return True if the server stopped
+   */
+  bool IsClosed() const;
+
+ private:
+  explicit SharedEntryView(std::unique_ptr<SharedEntryTable> table);
+
+  std::unique_ptr<SharedEntryTable> m_table;
+  wpi::StringMap<unsigned int> m_indexes;
+  unsigned int m_scanned = 0;
+};
+
+}  // namespace nt
+
+#endif  // NTCORE_NETWORKTABLES_SHAREDENTRYVIEW_H_
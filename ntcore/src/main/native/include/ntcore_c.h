@@ -438,6 +438,18 @@ void NT_SetEntryFlags(NT_Entry entry, unsigned int flags);
  */
 unsigned int NT_GetEntryFlags(NT_Entry entry);
 
+/**
+ * Set Entry Send Options.
+ * Limits how often changes to the entry's value are sent over the network.
+ *
+ * @param entry     entry handle
+ * @param period    minimum time between updates, in seconds (0 for no limit)
+ * @param deadband  for double and double array values, changes no larger
+ *                  than this from the last value sent are not sent (0 to
+ *                  send all changes)
+ */
+void NT_SetEntrySendOptions(NT_Entry entry, double period, double deadband);
+
 /**
  * Delete Entry.
  *
@@ -1064,6 +1076,17 @@ void NT_StopLocal(NT_Inst inst);
 void NT_StartServer(NT_Inst inst, const char* persist_filename,
                     const char* listen_address, unsigned int port);
 
+/**
+ * Selects the connection engine used by subsequent NT_StartServer calls.  By
+ * default each client connection is serviced by its own read and write
+ * threads; when enabled, all client connections are instead multiplexed on a
+ * single event loop thread.
+ *
+ * @param inst    instance handle
+ * @param enable  true to use the event loop engine
+ */
+void NT_SetServerEventLoop(NT_Inst inst, NT_Bool enable);
+
 /**
  * Stops the server if it is running.
  *
@@ -426,6 +426,102 @@ bool SetEntryValue(NT_Entry entry, std::shared_ptr<Value> value);
  */
 void SetEntryTypeValue(NT_Entry entry, std::shared_ptr<Value> value);
 
+/**
+ * @defgroup ntcore_typed_set_func Typed Entry Setters
+ *
+ * Set the entry value from a plain value.  These behave like SetEntryValue()
+ * (or SetEntryTypeValue() if force is true), but when the entry already
+ * holds a value of the same type, it is updated without allocating and the
+ * network update is coalesced with any other changes made before the next
+ * periodic update or Flush().
+ *
+ * @param entry     entry handle
+ * @param value     new entry value
+ * @param time      if nonzero, the creation time to use (instead of the
+ *                  current time)
+ * @param force     if true, overwrite the entry type on mismatch
+ * @return False on error (type mismatch), True on success
+ *
+ * @{
+ */
+bool SetEntryBoolean(NT_Entry entry, bool value, uint64_t time = 0,
+                     bool force = false);
+bool SetEntryDouble(NT_Entry entry, double value, uint64_t time = 0,
+                    bool force = false);
+bool SetEntryString(NT_Entry entry, std::string_view value, uint64_t time = 0,
+                    bool force = false);
+bool SetEntryRaw(NT_Entry entry, std::string_view value, uint64_t time = 0,
+                 bool force = false);
+bool SetEntryBooleanArray(NT_Entry entry, wpi::span<const int> value,
+                          uint64_t time = 0, bool force = false);
+bool SetEntryDoubleArray(NT_Entry entry, wpi::span<const double> value,
+                         uint64_t time = 0, bool force = false);
+/** @} */
+
+/**
+ * @defgroup ntcore_bulk_func Bulk Entry Functions
+ *
+ * Get or set the values of many entries at once, locking the entry storage
+ * once rather than once per entry.  All of the entries should belong to the
+ * same instance; entries of any other instance than the first are treated as
+ * nonexistent.  The setters behave like the typed setters (without force)
+ * for each entry.
+ *
+ * @{
+ */
+
+/**
+ * Gets the values of double entries.
+ *
+ * @param entries       entry handles
+ * @param defaultValue  value to use for entries that don't hold a double
+ * @param values        receives the value of each entry
+ */
+void GetEntryDoubles(wpi::span<const NT_Entry> entries, double defaultValue,
+                     wpi::span<double> values);
+
+/**
+ * Sets the values of double entries.
+ *
+ * @param entries  entry handles
+ * @param values   new value of each entry
+ * @param time     if nonzero, the creation time to use (instead of the
+ *                 current time)
+ * @return Number of entries set; entries of another type are left unchanged
+ */
+size_t SetEntryDoubles(wpi::span<const NT_Entry> entries,
+                       wpi::span<const double> values, uint64_t time = 0);
+
+/**
+ * Gets the values of double array entries.  The arrays are copied one after
+ * another; an array that doesn't fit in the remaining space is not copied.
+ *
+ * @param entries  entry handles
+ * @param values   receives the arrays, concatenated in entry order
+ * @param lengths  receives the length of each array, or -1 if the entry
+ *                 doesn't hold a double array
+ * @return Total length of the arrays; if greater than the size of values,
+ *         not every array was copied
+ */
+size_t GetEntryDoubleArrays(wpi::span<const NT_Entry> entries,
+                            wpi::span<double> values, wpi::span<int> lengths);
+
+/**
+ * Sets the values of double array entries.
+ *
+ * @param entries  entry handles
+ * @param values   new arrays, concatenated in entry order
+ * @param lengths  length of each array; entries with a negative length are
+ *                 skipped
+ * @param time     if nonzero, the creation time to use (instead of the
+ *                 current time)
+ * @return Number of entries set; entries of another type are left unchanged
+ */
+size_t SetEntryDoubleArrays(wpi::span<const NT_Entry> entries,
+                            wpi::span<const double> values,
+                            wpi::span<const int> lengths, uint64_t time = 0);
+/** @} */
+
 /**
  * Set Entry Flags.
  *
@@ -442,6 +538,53 @@ void SetEntryFlags(NT_Entry entry, unsigned int flags);
  */
 unsigned int GetEntryFlags(NT_Entry entry);
 
+/**
+ * Set Entry Send Options.
+ *
+ * Limits how often changes to the entry's value are sent over the network.
+ * Changes held back by the period are sent once it has elapsed, so the
+ * latest value is always sent eventually; changes within the deadband are
+ * not sent at all.  Local listeners are notified of every change either way.
+ * Options are local to this node; on a server they also apply to updates
+ * received from clients and sent on to the others.
+ *
+ * @param entry     entry handle
+ * @param period    minimum time between updates, in seconds (0 for no limit)
+ * @param deadband  for double and double array values, changes no larger
+ *                  than this from the last value sent are not sent (0 to
+ *                  send all changes)
+ */
+void SetEntrySendOptions(NT_Entry entry, double period, double deadband);
+
+/**
+ * Set Entry History Depth.
+ *
+ * Keeps the entry's most recent values (local and remote changes), so they
+ * can be retrieved with GetEntryHistory() without a listener.  Values are
+ * kept in a fixed-size ring; once it is full the oldest value is dropped.
+ * History is kept only on this node and is cleared if the entry is deleted.
+ *
+ * @param entry     entry handle
+ * @param depth     number of values to keep (0 to stop keeping history)
+ */
+void SetEntryHistory(NT_Entry entry, size_t depth);
+
+/**
+ * Get Entry History.
+ *
+ * Returns the entry's retained values (see SetEntryHistory()) with
+ * timestamps (Value::time()) in the range [start, end], oldest first.
+ *
+ * @param entry     entry handle
+ * @param start     earliest timestamp, in microseconds (0 for no limit)
+ * @param end       latest timestamp, in microseconds (UINT64_MAX for no
+ *                  limit)
+ * @return values, oldest first
+ */
+std::vector<std::shared_ptr<Value>> GetEntryHistory(NT_Entry entry,
+                                                    uint64_t start,
+                                                    uint64_t end);
+
 /**
  * Delete Entry.
  *
@@ -550,6 +693,27 @@ NT_EntryListener AddEntryListener(
     std::function<void(const EntryNotification& event)> callback,
     unsigned int flags);
 
+/**
+ * Add a listener for all entries starting with a certain prefix that is
+ * called with notifications in batches rather than one at a time.  A batch
+ * is delivered once the notifications queued so far have been processed (or
+ * the batch reaches 1024 notifications), so a listener on a busy prefix is
+ * woken once per burst of changes.  The span (and the notifications in it)
+ * is only valid for the duration of the callback.
+ *
+ * The listener is removed with RemoveEntryListener().
+ *
+ * @param inst              instance handle
+ * @param prefix            UTF-8 string prefix
+ * @param callback          listener to add
+ * @param flags             NotifyKind bitmask
+ * @return Listener handle
+ */
+NT_EntryListener AddEntryListenerBatch(
+    NT_Inst inst, std::string_view prefix,
+    std::function<void(wpi::span<const EntryNotification> events)> callback,
+    unsigned int flags);
+
 /**
  * Create a entry listener poller.
  *
@@ -988,6 +1152,23 @@ std::vector<std::shared_ptr<Value>> UnpackRpcValues(
  */
 void SetNetworkIdentity(NT_Inst inst, std::string_view name);
 
+/**
+ * Limits the entries a server sends to this client to those whose names
+ * start with one of the given prefixes, so clients that only use part of the
+ * table don't receive every update.  An empty list (the default) receives
+ * all entries.  Takes effect immediately if connected.
+ *
+ * The server still sends all entries during the initial connection
+ * handshake, and servers that don't support subscriptions always send all
+ * entries.  Entries created by this client are assigned, but later changes
+ * to them by other nodes are only received if subscribed.
+ *
+ * @param inst      instance handle
+ * @param prefixes  entry name prefixes to receive
+ */
+void SetNetworkSubscriptions(NT_Inst inst,
+                             wpi::span<const std::string_view> prefixes);
+
 /**
  * Get the current network mode.
  *
@@ -1022,6 +1203,29 @@ void StopLocal(NT_Inst inst);
 void StartServer(NT_Inst inst, std::string_view persist_filename,
                  const char* listen_address, unsigned int port);
 
+/**
+ * Selects the connection engine used by subsequent StartServer calls.  By
+ * default each client connection is serviced by its own read and write
+ * threads; when enabled, all client connections are instead multiplexed on a
+ * single event loop thread.
+ *
+ * @param inst    instance handle
+ * @param enable  true to use the event loop engine
+ */
+void SetServerEventLoop(NT_Inst inst, bool enable);
+
+/**
+ * Makes subsequent StartServer calls also publish entry values to a shared
+ * memory segment, so processes on the same host can read them without a
+ * network connection (see SharedEntryView).  Not supported on Windows.
+ *
+ * @param inst  instance handle
+ * @param size  segment size in bytes; about a quarter of it is used for the
+ *              entry table, the rest for names and values.  0 (the default)
+ *              disables the segment.
+ */
+void SetServerSharedMemory(NT_Inst inst, size_t size);
+
 /**
  * Stops the server if it is running.
  *
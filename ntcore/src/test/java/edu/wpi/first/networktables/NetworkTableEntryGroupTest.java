@@ -0,0 +1,70 @@
+// Copyright (c) FIRST and other WPILib contributors.
+// Open Source Software; you can modify and/or share it under the terms of
+// the WPILib BSD license file in the root directory of this project.
+
+package edu.wpi.first.networktables;
+
+import static org.junit.jupiter.api.Assertions.assertArrayEquals;
+import static org.junit.jupiter.api.Assertions.assertEquals;
+import static org.junit.jupiter.api.Assertions.assertThrows;
+
+import java.nio.ByteBuffer;
+import org.junit.jupiter.api.AfterEach;
+import org.junit.jupiter.api.BeforeEach;
+import org.junit.jupiter.api.Test;
+
+class NetworkTableEntryGroupTest {
+  private NetworkTableInstance m_inst;
+
+  @BeforeEach
+  void setUp() {
+    m_inst = NetworkTableInstance.create();
+  }
+
+  @AfterEach
+  void tearDown() {
+    m_inst.close();
+  }
+
+  @Test
+  void doublesTest() {
+    NetworkTableEntry str = m_inst.getEntry("str");
+    str.setString("hello");
+    NetworkTableEntryGroup group =
+        new NetworkTableEntryGroup(m_inst.getEntry("a"), m_inst.getEntry("b"), str);
+
+    assertEquals(2, group.setDoubles(new double[] {1.0, 2.0, 3.0}));
+    assertEquals("hello", str.getString(""));
+
+    double[] values = new double[3];
+    group.getDoubles(-1.0, values);
+    assertArrayEquals(new double[] {1.0, 2.0, -1.0}, values);
+  }
+
+  @Test
+  void doubleArraysTest() {
+    NetworkTableEntryGroup group =
+        new NetworkTableEntryGroup(m_inst.getEntry("a"), m_inst.getEntry("b"));
+
+    ByteBuffer buf = NetworkTableEntryGroup.allocateArrayBuffer(5);
+    buf.asDoubleBuffer().put(new double[] {1.0, 2.0, 3.0, 4.0, 5.0});
+    assertEquals(2, group.setDoubleArrays(buf, new int[] {3, 2}));
+    assertArrayEquals(new double[] {4.0, 5.0}, group.getEntry(1).getDoubleArray(new double[0]));
+
+    // too small for both arrays
+    ByteBuffer small = NetworkTableEntryGroup.allocateArrayBuffer(4);
+    int[] lengths = new int[2];
+    assertEquals(5, group.getDoubleArrays(small, lengths));
+    assertArrayEquals(new int[] {3, 2}, lengths);
+    assertEquals(3.0, small.getDouble(2 * Double.BYTES));
+  }
+
+  @Test
+  void mixedInstancesTest() {
+    try (NetworkTableInstance other = NetworkTableInstance.create()) {
+      assertThrows(
+          IllegalArgumentException.class,
+          () -> new NetworkTableEntryGroup(m_inst.getEntry("a"), other.getEntry("a")));
+    }
+  }
+}
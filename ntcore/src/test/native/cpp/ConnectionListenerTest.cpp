@@ -22,14 +22,15 @@ class ConnectionListenerTest : public ::testing::Test {
     nt::DestroyInstance(client_inst);
   }
 
-  void Connect(unsigned int port);
+  void Connect(unsigned int port, bool eventLoop = false);
 
  protected:
   NT_Inst server_inst;
   NT_Inst client_inst;
 };
 
-void ConnectionListenerTest::Connect(unsigned int port) {
+void ConnectionListenerTest::Connect(unsigned int port, bool eventLoop) {
+  nt::SetServerEventLoop(server_inst, eventLoop);
   nt::StartServer(server_inst, "connectionlistenertest.ini", "127.0.0.1", port);
   nt::StartClient(client_inst, "127.0.0.1", port);
 
@@ -103,3 +104,47 @@ TEST_F(ConnectionListenerTest, Threaded) {
   EXPECT_EQ(handle, result[0].listener);
   EXPECT_FALSE(result[0].connected);
 }
+
+TEST_F(ConnectionListenerTest, EventLoopServer) {
+  std::vector<nt::ConnectionNotification> result;
+  auto handle = nt::AddConnectionListener(
+      server_inst,
+      [&](const nt::ConnectionNotification& event) { result.push_back(event); },
+      false);
+
+  // trigger a connect event
+  Connect(10002, true);
+
+  ASSERT_TRUE(nt::WaitForConnectionListenerQueue(server_inst, 1.0));
+
+  // get the event
+  ASSERT_EQ(result.size(), 1u);
+  EXPECT_EQ(handle, result[0].listener);
+  EXPECT_TRUE(result[0].connected);
+  EXPECT_EQ(result[0].conn.remote_id, "client");
+  result.clear();
+
+  // values flow in both directions
+  nt::SetEntryValue(nt::GetEntry(server_inst, "/server"),
+                    nt::Value::MakeDouble(1.0));
+  nt::SetEntryValue(nt::GetEntry(client_inst, "/client"),
+                    nt::Value::MakeDouble(2.0));
+  nt::Flush(server_inst);
+  nt::Flush(client_inst);
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  auto value = nt::GetEntryValue(nt::GetEntry(client_inst, "/server"));
+  ASSERT_TRUE(value);
+  EXPECT_EQ(value->GetDouble(), 1.0);
+  value = nt::GetEntryValue(nt::GetEntry(server_inst, "/client"));
+  ASSERT_TRUE(value);
+  EXPECT_EQ(value->GetDouble(), 2.0);
+
+  // trigger a disconnect event
+  nt::StopClient(client_inst);
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+  // get the event
+  ASSERT_EQ(result.size(), 1u);
+  EXPECT_EQ(handle, result[0].listener);
+  EXPECT_FALSE(result[0].connected);
+}
@@ -0,0 +1,64 @@
+// Copyright (c) FIRST and other WPILib contributors.
+// Open Source Software; you can modify and/or share it under the terms of
+// the WPILib BSD license file in the root directory of this project.
+
+#include <atomic>
+#include <vector>
+
+#include <wpi/timestamp.h>
+
+#include "fmt/format.h"
+#include "gtest/gtest.h"
+#include "ntcore_cpp.h"
+
+// Measures the rate notifications are delivered to a prefix listener
+// covering 1000 entries, one callback per notification vs batched.
+// Timing only, so it is disabled by default.
+TEST(EntryNotifierBench, DISABLED_Prefix) {
+  constexpr int kEntries = 1000;
+  constexpr int kRounds = 100;
+
+  for (bool batch : {false, true}) {
+    auto inst = nt::CreateInstance();
+    std::vector<NT_Entry> entries;
+    for (int i = 0; i < kEntries; ++i) {
+      entries.emplace_back(nt::GetEntry(inst, fmt::format("/bench/{}", i)));
+      nt::SetEntryDouble(entries.back(), 0);
+    }
+
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> wakeups{0};
+    unsigned int flags = NT_NOTIFY_UPDATE | NT_NOTIFY_LOCAL;
+    if (batch) {
+      nt::AddEntryListenerBatch(
+          inst, "/bench/",
+          [&](auto events) {
+            count.fetch_add(events.size(), std::memory_order_relaxed);
+            wakeups.fetch_add(1, std::memory_order_relaxed);
+          },
+          flags);
+    } else {
+      nt::AddEntryListener(
+          inst, "/bench/",
+          [&](auto&) {
+            count.fetch_add(1, std::memory_order_relaxed);
+            wakeups.fetch_add(1, std::memory_order_relaxed);
+          },
+          flags);
+    }
+
+    auto start = wpi::Now();
+    for (int i = 1; i <= kRounds; ++i) {
+      for (auto entry : entries) {
+        nt::SetEntryDouble(entry, i);
+      }
+    }
+    ASSERT_TRUE(nt::WaitForEntryListenerQueue(inst, 10.0));
+    auto elapsed = wpi::Now() - start;
+    nt::DestroyInstance(inst);
+
+    fmt::print("EntryNotifier {}: {:.0f} notifications/s, {} callbacks\n",
+               batch ? "batch" : "callback", count * 1.0e6 / elapsed,
+               wakeups.load());
+  }
+}
@@ -2,6 +2,10 @@
 // Open Source Software; you can modify and/or share it under the terms of
 // the WPILib BSD license file in the root directory of this project.
 
+#include <algorithm>
+#include <string>
+#include <vector>
+
 #include <wpi/Logger.h>
 #include <wpi/StringExtras.h>
 
@@ -220,6 +224,81 @@ TEST_F(EntryNotifierTest, PollPrefixMultiple) {
   }
 }
 
+TEST_F(EntryNotifierTest, BatchPrefix) {
+  std::vector<std::vector<EntryNotification>> batches1;
+  std::vector<std::vector<EntryNotification>> batches2;
+  auto h1 = notifier.AddBatch(
+      [&](auto events) { batches1.emplace_back(events.begin(), events.end()); },
+      "/foo", NT_NOTIFY_NEW);
+  notifier.AddBatch(
+      [&](auto events) { batches2.emplace_back(events.begin(), events.end()); },
+      "/b", NT_NOTIFY_UPDATE);
+
+  ASSERT_FALSE(notifier.local_notifiers());
+
+  GenerateNotifications();
+  ASSERT_TRUE(notifier.WaitForQueue(1.0));
+
+  // how the notifications are split into batches depends on timing
+  std::vector<EntryNotification> results1;
+  for (auto&& batch : batches1) {
+    EXPECT_FALSE(batch.empty());
+    results1.insert(results1.end(), batch.begin(), batch.end());
+  }
+  ASSERT_EQ(results1.size(), 2u);
+  for (const auto& result : results1) {
+    SCOPED_TRACE(::testing::PrintToString(result));
+    EXPECT_EQ(result.name, "/foo/bar");
+    EXPECT_THAT(result.value, ValueEq(Value::MakeDouble(1)));
+    EXPECT_EQ(Handle{result.entry}.GetIndex(), 5);
+    EXPECT_EQ(Handle{result.listener}.GetIndex(), static_cast<int>(h1));
+    EXPECT_TRUE((result.flags & NT_NOTIFY_NEW) != 0);
+  }
+
+  std::vector<std::string> names2;
+  for (auto&& batch : batches2) {
+    for (auto&& result : batch) {
+      names2.emplace_back(result.name);
+    }
+  }
+  EXPECT_EQ(names2, (std::vector<std::string>{"/baz", "/baz", "/boo", "/boo"}));
+}
+
+TEST_F(EntryNotifierTest, BatchLimit) {
+  size_t count = 0;
+  size_t max_size = 0;
+  notifier.AddBatch(
+      [&](auto events) {
+        count += events.size();
+        max_size = (std::max)(max_size, events.size());
+      },
+      "", NT_NOTIFY_UPDATE);
+
+  auto val = Value::MakeDouble(1);
+  constexpr size_t kCount = 3 * impl::EntryNotifierThread::kMaxBatch;
+  for (size_t i = 0; i < kCount; ++i) {
+    notifier.NotifyEntry(i % 10, "/foo", val, NT_NOTIFY_UPDATE);
+  }
+  ASSERT_TRUE(notifier.WaitForQueue(1.0));
+  EXPECT_EQ(count, kCount);
+  EXPECT_LE(max_size, impl::EntryNotifierThread::kMaxBatch);
+}
+
+TEST_F(EntryNotifierTest, BatchRemove) {
+  size_t count = 0;
+  auto h = notifier.AddBatch([&](auto events) { count += events.size(); },
+                             "/foo", NT_NOTIFY_NEW);
+
+  GenerateNotifications();
+  ASSERT_TRUE(notifier.WaitForQueue(1.0));
+  EXPECT_EQ(count, 2u);
+
+  notifier.Remove(h);
+  GenerateNotifications();
+  ASSERT_TRUE(notifier.WaitForQueue(1.0));
+  EXPECT_EQ(count, 2u);
+}
+
 TEST_F(EntryNotifierTest, PollPrefixBasic) {
   auto poller = notifier.CreatePoller();
   auto g1 = notifier.AddPolled(poller, "/foo", NT_NOTIFY_NEW);
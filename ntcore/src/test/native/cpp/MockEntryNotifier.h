@@ -29,6 +29,11 @@ class MockEntryNotifier : public IEntryNotifier {
   MOCK_METHOD3(AddPolled,
                unsigned int(unsigned int poller_uid, unsigned int local_id,
                             unsigned int flags));
+  MOCK_METHOD3(AddBatch,
+               unsigned int(std::function<void(
+                                wpi::span<const EntryNotification> events)>
+                                callback,
+                            std::string_view prefix, unsigned int flags));
   MOCK_METHOD5(NotifyEntry,
                void(unsigned int local_id, std::string_view name,
                     std::shared_ptr<Value> value, unsigned int flags,
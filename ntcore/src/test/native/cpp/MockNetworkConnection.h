@@ -6,6 +6,7 @@
 #define NTCORE_MOCKNETWORKCONNECTION_H_
 
 #include <memory>
+#include <string>
 
 #include "INetworkConnection.h"
 #include "gmock/gmock.h"
@@ -18,6 +19,9 @@ class MockNetworkConnection : public INetworkConnection {
 
   MOCK_METHOD1(QueueOutgoing, void(std::shared_ptr<Message> msg));
   MOCK_METHOD1(PostOutgoing, void(bool keep_alive));
+  MOCK_METHOD2(SetSubscriptions,
+               void(wpi::span<const std::string> prefixes,
+                    wpi::span<const std::shared_ptr<Message>> assigns));
 
   MOCK_CONST_METHOD0(proto_rev, unsigned int());
   MOCK_METHOD1(set_proto_rev, void(unsigned int proto_rev));
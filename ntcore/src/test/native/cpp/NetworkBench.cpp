@@ -0,0 +1,236 @@
+// Copyright (c) FIRST and other WPILib contributors.
+// Open Source Software; you can modify and/or share it under the terms of
+// the WPILib BSD license file in the root directory of this project.
+
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <wpi/Logger.h>
+#include <wpi/condition_variable.h>
+#include <wpi/mutex.h>
+#include <wpi/timestamp.h>
+#include <wpinet/NetworkStream.h>
+#include <wpinet/TCPConnector.h>
+#include <wpinet/raw_socket_istream.h>
+
+#include "Message.h"
+#include "WireDecoder.h"
+#include "WireEncoder.h"
+#include "fmt/format.h"
+#include "gtest/gtest.h"
+#include "ntcore_cpp.h"
+
+namespace {
+
+// Shared state for measuring when each client receives an update.
+struct Receipts {
+  wpi::mutex mutex;
+  wpi::condition_variable cv;
+  std::vector<uint64_t> latencies;
+  uint64_t sendTime = 0;
+  double sendValue = -1;
+};
+
+// Minimal protocol 3.0 client speaking directly over a socket, so many more
+// clients can be run than the limit on instances allows.
+class BenchClient {
+ public:
+  BenchClient(unsigned int port, int index, Receipts& receipts)
+      : m_receipts{receipts} {
+    m_stream = wpi::TCPConnector::connect("127.0.0.1", port, m_logger, 5);
+    if (!m_stream) {
+      return;
+    }
+    m_stream->setNoDelay();
+    nt::WireEncoder encoder{0x0300};
+    nt::Message::ClientHello(0x0300, fmt::format("client{}", index))
+        ->Write(encoder);
+    nt::Message::ClientHelloDone()->Write(encoder);
+    wpi::NetworkStream::Error err;
+    m_stream->send(encoder.data(), encoder.size(), &err);
+    m_thread = std::thread([this] { ThreadMain(); });
+  }
+
+  ~BenchClient() {
+    if (m_stream) {
+      m_stream->close();
+    }
+    if (m_thread.joinable()) {
+      m_thread.join();
+    }
+  }
+
+ private:
+  void ThreadMain() {
+    wpi::raw_socket_istream is{*m_stream};
+    nt::WireDecoder decoder{is, 0x0300, m_logger};
+    for (;;) {
+      auto msg = nt::Message::Read(decoder, [](unsigned int) {
+        return NT_DOUBLE;
+      });
+      if (!msg) {
+        break;
+      }
+      if (!msg->Is(nt::Message::kEntryAssign) &&
+          !msg->Is(nt::Message::kEntryUpdate)) {
+        continue;
+      }
+      auto now = wpi::Now();
+      auto value = msg->value();
+      std::scoped_lock lock(m_receipts.mutex);
+      if (value && value->IsDouble() &&
+          value->GetDouble() == m_receipts.sendValue) {
+        m_receipts.latencies.push_back(now - m_receipts.sendTime);
+        m_receipts.cv.notify_all();
+      }
+    }
+  }
+
+  Receipts& m_receipts;
+  wpi::Logger m_logger;
+  std::unique_ptr<wpi::NetworkStream> m_stream;
+  std::thread m_thread;
+};
+
+}  // namespace
+
+// Measures update latency from a server value change to its arrival at every
+// client, and process CPU time, for both server connection engines.
+// Slow, so it only runs on request (--gtest_also_run_disabled_tests).
+TEST(NetworkBench, DISABLED_ServerEngines) {
+  constexpr int kUpdates = 50;
+  unsigned int port = 10100;
+
+  for (bool eventLoop : {false, true}) {
+    for (int numClients : {1, 4, 8, 16, 32}) {
+      auto server = nt::CreateInstance();
+      nt::SetServerEventLoop(server, eventLoop);
+      nt::StartServer(server, "", "127.0.0.1", port);
+      while ((nt::GetNetworkMode(server) & NT_NET_MODE_STARTING) != 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      }
+
+      Receipts receipts;
+      std::vector<std::unique_ptr<BenchClient>> clients;
+      for (int i = 0; i < numClients; ++i) {
+        clients.emplace_back(
+            std::make_unique<BenchClient>(port, i, receipts));
+      }
+
+      // wait for all clients to connect
+      auto timeout =
+          std::chrono::steady_clock::now() + std::chrono::seconds(10);
+      while (nt::GetConnections(server).size() <
+                 static_cast<size_t>(numClients) &&
+             std::chrono::steady_clock::now() < timeout) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      }
+      ASSERT_EQ(nt::GetConnections(server).size(),
+                static_cast<size_t>(numClients));
+
+      auto entry = nt::GetEntry(server, "/bench");
+      auto cpuStart = std::clock();
+      for (int i = 0; i < kUpdates; ++i) {
+        std::unique_lock lock(receipts.mutex);
+        size_t expected = receipts.latencies.size() + numClients;
+        receipts.sendValue = i;
+        receipts.sendTime = wpi::Now();
+        lock.unlock();
+        nt::SetEntryValue(entry, nt::Value::MakeDouble(i));
+        nt::Flush(server);
+        lock.lock();
+        receipts.cv.wait_for(lock, std::chrono::seconds(1), [&] {
+          return receipts.latencies.size() >= expected;
+        });
+        lock.unlock();
+        // flushes are rate limited to one per 5 ms
+        std::this_thread::sleep_for(std::chrono::milliseconds(6));
+      }
+      auto cpuMs = (std::clock() - cpuStart) * 1000.0 / CLOCKS_PER_SEC;
+
+      clients.clear();
+      nt::DestroyInstance(server);
+      ++port;
+
+      auto& latencies = receipts.latencies;
+      ASSERT_FALSE(latencies.empty());
+      std::sort(latencies.begin(), latencies.end());
+      fmt::print(
+          "NT server {}, {} clients: p50 {} us p99 {} us, {}/{} received, "
+          "cpu {:.1f} ms\n",
+          eventLoop ? "event loop" : "threaded", numClients,
+          latencies[latencies.size() / 2],
+          latencies[latencies.size() * 99 / 100], latencies.size(),
+          kUpdates * numClients, cpuMs);
+    }
+  }
+}
+
+// Measures a server fanning out many entry updates to many clients, where the
+// encoding of each update is shared between connections.
+TEST(NetworkBench, DISABLED_Fanout) {
+  constexpr int kClients = 10;
+  constexpr int kEntries = 500;
+  constexpr int kRounds = 20;
+  unsigned int port = 10150;
+
+  auto server = nt::CreateInstance();
+  nt::StartServer(server, "", "127.0.0.1", port);
+  while ((nt::GetNetworkMode(server) & NT_NET_MODE_STARTING) != 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  Receipts receipts;
+  std::vector<std::unique_ptr<BenchClient>> clients;
+  for (int i = 0; i < kClients; ++i) {
+    clients.emplace_back(std::make_unique<BenchClient>(port, i, receipts));
+  }
+  auto timeout = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  while (nt::GetConnections(server).size() < kClients &&
+         std::chrono::steady_clock::now() < timeout) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  ASSERT_EQ(nt::GetConnections(server).size(), static_cast<size_t>(kClients));
+
+  std::vector<NT_Entry> entries;
+  for (int i = 0; i < kEntries; ++i) {
+    entries.emplace_back(nt::GetEntry(server, fmt::format("/fanout/{}", i)));
+  }
+
+  std::vector<uint64_t> roundTimes;
+  auto cpuStart = std::clock();
+  for (int round = 0; round < kRounds; ++round) {
+    std::unique_lock lock(receipts.mutex);
+    size_t expected = receipts.latencies.size() + kClients * kEntries;
+    receipts.sendValue = round;
+    receipts.sendTime = wpi::Now();
+    lock.unlock();
+    for (auto entry : entries) {
+      nt::SetEntryDouble(entry, round);
+    }
+    nt::Flush(server);
+    lock.lock();
+    receipts.cv.wait_for(lock, std::chrono::seconds(2), [&] {
+      return receipts.latencies.size() >= expected;
+    });
+    roundTimes.push_back(wpi::Now() - receipts.sendTime);
+    lock.unlock();
+    // flushes are rate limited to one per 5 ms
+    std::this_thread::sleep_for(std::chrono::milliseconds(6));
+  }
+  auto cpuMs = (std::clock() - cpuStart) * 1000.0 / CLOCKS_PER_SEC;
+
+  clients.clear();
+  nt::DestroyInstance(server);
+
+  std::sort(roundTimes.begin(), roundTimes.end());
+  fmt::print(
+      "NT fanout {} entries to {} clients: round p50 {} us max {} us, "
+      "{}/{} received, cpu {:.1f} ms\n",
+      kEntries, kClients, roundTimes[roundTimes.size() / 2], roundTimes.back(),
+      receipts.latencies.size(), kRounds * kClients * kEntries, cpuMs);
+}
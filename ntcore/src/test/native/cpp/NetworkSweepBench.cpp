@@ -0,0 +1,260 @@
+// Copyright (c) FIRST and other WPILib contributors.
+// Open Source Software; you can modify and/or share it under the terms of
+// the WPILib BSD license file in the root directory of this project.
+
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <wpi/StringExtras.h>
+#include <wpi/mutex.h>
+#include <wpi/timestamp.h>
+
+#include "fmt/format.h"
+#include "gtest/gtest.h"
+#include "ntcore_cpp.h"
+
+// End-to-end sweeps between a server and real client instances over loopback.
+// Each run changes one parameter of a baseline configuration.  The sweeps take
+// a while, so they are disabled by default; run them with
+//   ntcore_test --gtest_also_run_disabled_tests --gtest_filter='NetworkSweep*'
+
+namespace {
+
+enum class Kind { kDouble, kDoubleArray, kString };
+
+struct SweepConfig {
+  int entries = 100;
+  Kind kind = Kind::kDouble;
+  size_t size = 1;  // array elements or string length
+  int clients = 1;
+  int rate = 50;  // rounds per second, each updating every entry
+};
+
+constexpr auto kDuration = std::chrono::seconds(1);
+unsigned int gPort = 10200;
+
+// Latency samples shared between the sending thread and client listeners.
+struct Samples {
+  wpi::mutex mutex;
+  std::vector<uint64_t> sendTimes;  // indexed by round, 0 if not yet sent
+  std::vector<uint64_t> latencies;
+  uint64_t lastArrival = 0;
+};
+
+// Every value carries the round it was sent in.
+class RoundValue {
+ public:
+  explicit RoundValue(const SweepConfig& config)
+      : m_kind{config.kind},
+        m_array(config.size, 0.0),
+        m_str(std::max<size_t>(config.size, 8), 'x') {}
+
+  void Set(NT_Entry entry, int round) {
+    switch (m_kind) {
+      case Kind::kDouble:
+        nt::SetEntryDouble(entry, round);
+        break;
+      case Kind::kDoubleArray:
+        m_array[0] = round;
+        nt::SetEntryDoubleArray(entry, m_array);
+        break;
+      case Kind::kString:
+        m_str.replace(0, 8, fmt::format("{:08}", round));
+        nt::SetEntryString(entry, m_str);
+        break;
+    }
+  }
+
+  static int Get(const nt::Value& value) {
+    switch (value.type()) {
+      case NT_DOUBLE:
+        return static_cast<int>(value.GetDouble());
+      case NT_DOUBLE_ARRAY:
+        return static_cast<int>(value.GetDoubleArray()[0]);
+      case NT_STRING:
+        return wpi::parse_integer<int>(value.GetString().substr(0, 8), 10)
+            .value_or(0);
+      default:
+        return 0;
+    }
+  }
+
+ private:
+  Kind m_kind;
+  std::vector<double> m_array;
+  std::string m_str;
+};
+
+uint64_t Percentile(const std::vector<uint64_t>& sorted, int pct) {
+  return sorted[(sorted.size() - 1) * pct / 100];
+}
+
+std::string Describe(const SweepConfig& config) {
+  std::string_view kind;
+  switch (config.kind) {
+    case Kind::kDouble:
+      return fmt::format("{} double, {} clients, {} Hz", config.entries,
+                         config.clients, config.rate);
+    case Kind::kDoubleArray:
+      kind = "double[]";
+      break;
+    case Kind::kString:
+      kind = "string";
+      break;
+  }
+  return fmt::format("{} {}({}), {} clients, {} Hz", config.entries, kind,
+                     config.size, config.clients, config.rate);
+}
+
+void RunSweep(const SweepConfig& config) {
+  unsigned int port = gPort++;
+  int rounds = static_cast<int>(config.rate * kDuration.count());
+  RoundValue value{config};
+
+  auto server = nt::CreateInstance();
+  std::vector<NT_Entry> entries;
+  for (int i = 0; i < config.entries; ++i) {
+    entries.emplace_back(nt::GetEntry(server, fmt::format("/bench/{}", i)));
+    value.Set(entries.back(), 0);
+  }
+  nt::StartServer(server, "", "127.0.0.1", port);
+  while ((nt::GetNetworkMode(server) & NT_NET_MODE_STARTING) != 0) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  Samples samples;
+  samples.sendTimes.resize(rounds + 1, 0);
+  std::vector<NT_Inst> clients;
+  std::vector<NT_EntryListener> listeners;
+  for (int i = 0; i < config.clients; ++i) {
+    auto client = nt::CreateInstance();
+    listeners.emplace_back(nt::AddEntryListenerBatch(
+        client, "/bench/",
+        [&](auto events) {
+          auto now = wpi::Now();
+          std::scoped_lock lock(samples.mutex);
+          for (auto&& event : events) {
+            int round = RoundValue::Get(*event.value);
+            if (round < 1 || round > rounds || samples.sendTimes[round] == 0) {
+              continue;
+            }
+            samples.latencies.push_back(now - samples.sendTimes[round]);
+          }
+          samples.lastArrival = now;
+        },
+        NT_NOTIFY_UPDATE));
+    nt::StartClient(client, "127.0.0.1", port);
+    clients.emplace_back(client);
+  }
+
+  // wait for every client to connect and receive the initial values
+  auto timeout = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+  for (auto client : clients) {
+    while ((!nt::IsConnected(client) ||
+            nt::GetEntries(client, "/bench/", 0).size() < entries.size()) &&
+           std::chrono::steady_clock::now() < timeout) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    ASSERT_EQ(nt::GetEntries(client, "/bench/", 0).size(), entries.size());
+  }
+
+  auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+      std::chrono::duration<double>(1.0 / config.rate));
+  auto cpuStart = std::clock();
+  auto start = wpi::Now();
+  auto next = std::chrono::steady_clock::now();
+  for (int round = 1; round <= rounds; ++round) {
+    {
+      std::scoped_lock lock(samples.mutex);
+      samples.sendTimes[round] = wpi::Now();
+    }
+    for (auto entry : entries) {
+      value.Set(entry, round);
+    }
+    nt::Flush(server);
+    next += period;
+    std::this_thread::sleep_until(next);
+  }
+  auto cpuUs = (std::clock() - cpuStart) * 1.0e6 / CLOCKS_PER_SEC;
+
+  // give the last rounds time to arrive
+  size_t expected = static_cast<size_t>(rounds) * config.entries *
+                    config.clients;
+  timeout = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+  while (std::chrono::steady_clock::now() < timeout) {
+    {
+      std::scoped_lock lock(samples.mutex);
+      if (samples.latencies.size() >= expected) {
+        break;
+      }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+
+  // saturated runs leave a backlog, so detach the listeners from it first
+  nt::StopServer(server);
+  for (size_t i = 0; i < clients.size(); ++i) {
+    nt::StopClient(clients[i]);
+    nt::RemoveEntryListener(listeners[i]);
+    nt::WaitForEntryListenerQueue(clients[i], 1.0);
+    nt::DestroyInstance(clients[i]);
+  }
+  nt::DestroyInstance(server);
+
+  // listeners are gone, so the samples are no longer shared
+  auto& latencies = samples.latencies;
+  ASSERT_FALSE(latencies.empty());
+  std::sort(latencies.begin(), latencies.end());
+  fmt::print(
+      "NT sweep {}: p50 {} us p90 {} us p99 {} us max {} us, {}/{} received, "
+      "{:.0f} msgs/s, cpu {:.2f} us/update\n",
+      Describe(config), Percentile(latencies, 50), Percentile(latencies, 90),
+      Percentile(latencies, 99), latencies.back(), latencies.size(), expected,
+      latencies.size() * 1.0e6 / (samples.lastArrival - start),
+      cpuUs / (static_cast<double>(rounds) * config.entries));
+}
+
+}  // namespace
+
+TEST(NetworkSweepBench, DISABLED_Entries) {
+  for (int entries : {10, 100, 1000, 10000}) {
+    SweepConfig config;
+    config.entries = entries;
+    RunSweep(config);
+  }
+}
+
+TEST(NetworkSweepBench, DISABLED_Types) {
+  const std::pair<Kind, size_t> types[] = {
+      {Kind::kDouble, 1},       {Kind::kDoubleArray, 1},
+      {Kind::kDoubleArray, 16}, {Kind::kDoubleArray, 256},
+      {Kind::kString, 16},      {Kind::kString, 1024}};
+  for (auto [kind, size] : types) {
+    SweepConfig config;
+    config.kind = kind;
+    config.size = size;
+    RunSweep(config);
+  }
+}
+
+TEST(NetworkSweepBench, DISABLED_Clients) {
+  for (int clients : {1, 2, 4, 8}) {
+    SweepConfig config;
+    config.clients = clients;
+    RunSweep(config);
+  }
+}
+
+TEST(NetworkSweepBench, DISABLED_Rate) {
+  for (int rate : {10, 50, 100}) {
+    SweepConfig config;
+    config.rate = rate;
+    RunSweep(config);
+  }
+}
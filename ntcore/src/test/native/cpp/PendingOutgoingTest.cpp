@@ -0,0 +1,123 @@
+// Copyright (c) FIRST and other WPILib contributors.
+// Open Source Software; you can modify and/or share it under the terms of
+// the WPILib BSD license file in the root directory of this project.
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <wpi/Logger.h>
+#include <wpi/raw_istream.h>
+
+#include "MessageMatcher.h"
+#include "PendingOutgoing.h"
+#include "TestPrinters.h"
+#include "WireDecoder.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using ::testing::ElementsAre;
+
+namespace nt {
+
+class PendingOutgoingTest : public ::testing::Test {
+ protected:
+  std::shared_ptr<Message> Assign(std::string_view name, unsigned int id) {
+    return Message::EntryAssign(name, id, 1, Value::MakeDouble(id), 0);
+  }
+  std::shared_ptr<Message> Update(unsigned int id) {
+    return Message::EntryUpdate(id, 2, Value::MakeDouble(id));
+  }
+
+  std::vector<std::shared_ptr<Message>> Assigns() {
+    return {Assign("/vision/x", 0), Assign("/drive/y", 1),
+            Assign("/vision2/z", 2)};
+  }
+
+  PendingOutgoing pending;
+};
+
+TEST_F(PendingOutgoingTest, NoSubscriptions) {
+  pending.Add(Update(0));
+  pending.Add(Update(1));
+  EXPECT_THAT(pending.Take(),
+              ElementsAre(MessageEq(Update(0)), MessageEq(Update(1))));
+}
+
+TEST_F(PendingOutgoingTest, Subscribed) {
+  std::vector<std::string> prefixes{"/vision/"};
+  // the remote had everything, so nothing is resent
+  pending.SetSubscriptions(prefixes, Assigns());
+  EXPECT_TRUE(pending.empty());
+
+  pending.Add(Update(0));
+  pending.Add(Update(1));
+  pending.Add(Message::FlagsUpdate(1, 1));
+  pending.Add(Update(2));
+  pending.Add(Assign("/drive/new", 3));
+  pending.Add(Assign("/vision/new", 4));
+  pending.Add(Message::EntryDelete(1));  // known to the remote
+  EXPECT_THAT(pending.Take(),
+              ElementsAre(MessageEq(Update(0)),
+                          MessageEq(Assign("/vision/new", 4)),
+                          MessageEq(Message::EntryDelete(1))));
+
+  // never sent, so not deleted
+  pending.Add(Message::EntryDelete(3));
+  EXPECT_TRUE(pending.empty());
+}
+
+TEST_F(PendingOutgoingTest, Resubscribe) {
+  std::vector<std::string> vision{"/vision"};
+  pending.SetSubscriptions(vision, Assigns());
+
+  std::vector<std::string> drive{"/drive/"};
+  pending.SetSubscriptions(drive, Assigns());
+  EXPECT_THAT(pending.Take(), ElementsAre(MessageEq(Assign("/drive/y", 1))));
+  pending.Add(Update(0));
+  pending.Add(Update(1));
+  EXPECT_THAT(pending.Take(), ElementsAre(MessageEq(Update(1))));
+
+  // back to everything; only what was filtered is resent
+  pending.SetSubscriptions({}, Assigns());
+  EXPECT_THAT(pending.Take(), ElementsAre(MessageEq(Assign("/vision/x", 0)),
+                                          MessageEq(Assign("/vision2/z", 2))));
+  pending.Add(Update(2));
+  EXPECT_THAT(pending.Take(), ElementsAre(MessageEq(Update(2))));
+}
+
+TEST_F(PendingOutgoingTest, Request) {
+  std::vector<std::string> prefixes{"/vision/"};
+  pending.SetSubscriptions(prefixes, Assigns());
+
+  // the remote created the entry, so it needs the id, but not later updates
+  pending.AddRequest("/drive/new");
+  pending.Add(Assign("/drive/new", 3));
+  pending.Add(Update(3));
+  EXPECT_THAT(pending.Take(), ElementsAre(MessageEq(Assign("/drive/new", 3))));
+
+  pending.Add(Message::EntryDelete(3));
+  EXPECT_THAT(pending.Take(), ElementsAre(MessageEq(Message::EntryDelete(3))));
+}
+
+TEST_F(PendingOutgoingTest, SubscribeMessage) {
+  std::vector<std::string> prefixes{"/vision/", "/status"};
+  auto msg = Message::Subscribe(prefixes);
+  auto encoded = msg->GetEncoded();
+
+  wpi::raw_mem_istream is(encoded.data(), encoded.size());
+  wpi::Logger logger;
+  WireDecoder d(is, 0x0300u, logger);
+  auto decoded = Message::Read(d, nullptr);
+  ASSERT_TRUE(decoded);
+  EXPECT_THAT(decoded, MessageEq(msg));
+  EXPECT_THAT(decoded->value()->GetStringArray(),
+              ElementsAre("/vision/", "/status"));
+
+  // not part of protocol 2.0
+  wpi::raw_mem_istream is2(encoded.data(), encoded.size());
+  WireDecoder d2(is2, 0x0200u, logger);
+  EXPECT_FALSE(Message::Read(d2, nullptr));
+}
+
+}  // namespace nt
@@ -0,0 +1,132 @@
+// Copyright (c) FIRST and other WPILib contributors.
+// Open Source Software; you can modify and/or share it under the terms of
+// the WPILib BSD license file in the root directory of this project.
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <thread>
+
+#include "TestPrinters.h"
+#include "fmt/format.h"
+#include "gtest/gtest.h"
+#include "ntcore_cpp.h"
+
+// Reconnects between real server and client instances over loopback, which
+// resume from the client's last sync instead of resending every entry.
+class ResumeSyncTest : public ::testing::TestWithParam<bool> {
+ public:
+  ResumeSyncTest()
+      : server_inst(nt::CreateInstance()), client_inst(nt::CreateInstance()) {
+    nt::SetServerEventLoop(server_inst, GetParam());
+    for (int i = 0; i < kEntries; ++i) {
+      nt::SetEntryValue(nt::GetEntry(server_inst, fmt::format("/e/{}", i)),
+                        nt::Value::MakeDouble(i));
+    }
+    port = nextPort++;
+    nt::StartServer(server_inst, "", "127.0.0.1", port);
+    listener = nt::AddEntryListener(
+        client_inst, "/e/", [&](const auto&) { ++updates; },
+        NT_NOTIFY_NEW | NT_NOTIFY_UPDATE | NT_NOTIFY_DELETE);
+  }
+
+  ~ResumeSyncTest() override {
+    nt::StopClient(client_inst);
+    nt::StopServer(server_inst);
+    nt::RemoveEntryListener(listener);
+    nt::DestroyInstance(server_inst);
+    nt::DestroyInstance(client_inst);
+  }
+
+  // Connects the client and waits for the initial entries to be notified.
+  bool Connect() {
+    nt::StartClient(client_inst, "127.0.0.1", port);
+    return WaitFor([&] { return nt::IsConnected(client_inst); }) &&
+           nt::WaitForEntryListenerQueue(client_inst, 1.0);
+  }
+
+  static bool WaitFor(std::function<bool()> cond) {
+    auto timeout = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!cond()) {
+      if (std::chrono::steady_clock::now() > timeout) {
+        return false;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return true;
+  }
+
+  double GetDouble(NT_Inst inst, int i) {
+    auto value = nt::GetEntryValue(
+        nt::GetEntry(inst, fmt::format("/e/{}", i)));
+    return value && value->IsDouble() ? value->GetDouble() : -1;
+  }
+
+  static constexpr int kEntries = 100;
+  static inline unsigned int nextPort = 10240;
+
+  NT_Inst server_inst;
+  NT_Inst client_inst;
+  unsigned int port;
+  NT_EntryListener listener;
+  std::atomic_int updates{0};
+};
+
+TEST_P(ResumeSyncTest, OnlyChangesResent) {
+  ASSERT_TRUE(Connect());
+  ASSERT_TRUE(WaitFor([&] { return updates == kEntries; }));
+
+  nt::StopClient(client_inst);
+  ASSERT_TRUE(WaitFor([&] {
+    return nt::GetConnections(server_inst).empty();
+  }));
+
+  // server changes while disconnected
+  nt::SetEntryValue(nt::GetEntry(server_inst, "/e/1"),
+                    nt::Value::MakeDouble(100));
+  nt::DeleteEntry(nt::GetEntry(server_inst, "/e/2"));
+  nt::SetEntryValue(nt::GetEntry(server_inst, "/e/new"),
+                    nt::Value::MakeDouble(200));
+  // client changes while disconnected
+  nt::SetEntryValue(nt::GetEntry(client_inst, "/e/3"),
+                    nt::Value::MakeDouble(300));
+  nt::DeleteEntry(nt::GetEntry(client_inst, "/e/4"));
+  ASSERT_TRUE(nt::WaitForEntryListenerQueue(client_inst, 1.0));
+  updates = 0;
+
+  ASSERT_TRUE(Connect());
+  // only the three server changes are notified; a full sync updates all
+  ASSERT_TRUE(WaitFor([&] {
+    return nt::GetEntryValue(nt::GetEntry(client_inst, "/e/new")) != nullptr;
+  }));
+  ASSERT_TRUE(nt::WaitForEntryListenerQueue(client_inst, 1.0));
+  EXPECT_EQ(updates, 3);
+  EXPECT_EQ(GetDouble(client_inst, 1), 100);
+  EXPECT_EQ(GetDouble(client_inst, 2), -1);
+  EXPECT_EQ(GetDouble(client_inst, 5), 5);
+
+  // and the client's changes reached the server
+  EXPECT_TRUE(WaitFor([&] { return GetDouble(server_inst, 3) == 300; }));
+  EXPECT_TRUE(WaitFor([&] { return GetDouble(server_inst, 4) == -1; }));
+
+  // the connection works as usual afterwards
+  nt::SetEntryValue(nt::GetEntry(server_inst, "/e/6"),
+                    nt::Value::MakeDouble(600));
+  EXPECT_TRUE(WaitFor([&] { return GetDouble(client_inst, 6) == 600; }));
+}
+
+TEST_P(ResumeSyncTest, ServerRestartSyncsFully) {
+  ASSERT_TRUE(Connect());
+  ASSERT_TRUE(WaitFor([&] { return updates == kEntries; }));
+  nt::StopClient(client_inst);
+
+  // a new server run can't resume the client's sync point
+  nt::StopServer(server_inst);
+  nt::StartServer(server_inst, "", "127.0.0.1", port);
+  updates = 0;
+
+  ASSERT_TRUE(Connect());
+  EXPECT_TRUE(WaitFor([&] { return updates == kEntries; }));
+}
+
+INSTANTIATE_TEST_SUITE_P(ResumeSyncTests, ResumeSyncTest, ::testing::Bool());
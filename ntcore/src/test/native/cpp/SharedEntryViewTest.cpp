@@ -0,0 +1,147 @@
+// Copyright (c) FIRST and other WPILib contributors.
+// Open Source Software; you can modify and/or share it under the terms of
+// the WPILib BSD license file in the root directory of this project.
+
+#ifndef _WIN32
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "TestPrinters.h"
+#include "fmt/format.h"
+#include "gtest/gtest.h"
+#include "networktables/SharedEntryView.h"
+#include "ntcore_cpp.h"
+
+class SharedEntryViewTest : public ::testing::Test {
+ public:
+  SharedEntryViewTest() : server{nt::CreateInstance()} {
+    nt::SetServerSharedMemory(server, 1 << 16);
+  }
+
+  ~SharedEntryViewTest() override {
+    nt::StopServer(server);
+    nt::DestroyInstance(server);
+  }
+
+  void StartServer() {
+    nt::StartServer(server, "", "127.0.0.1", kPort);
+    while ((nt::GetNetworkMode(server) & NT_NET_MODE_STARTING) != 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+  }
+
+  static constexpr unsigned int kPort = 10230;
+  NT_Inst server;
+};
+
+TEST_F(SharedEntryViewTest, ExistingValues) {
+  nt::SetEntryValue(nt::GetEntry(server, "/d"), nt::Value::MakeDouble(1.5));
+  nt::SetEntryValue(nt::GetEntry(server, "/a"),
+                    nt::Value::MakeDoubleArray({1, 2, 3}));
+  nt::SetEntryValue(nt::GetEntry(server, "/s"),
+                    nt::Value::MakeStringArray({"x", "yz"}));
+  StartServer();
+
+  auto view = nt::SharedEntryView::Open("localhost", kPort);
+  ASSERT_TRUE(view);
+  EXPECT_EQ(view->GetIndex("/missing"), -1);
+
+  int d = view->GetIndex("/d");
+  ASSERT_GE(d, 0);
+  EXPECT_EQ(view->GetDouble(d, 0), 1.5);
+  EXPECT_EQ(*view->GetValue(d), *nt::Value::MakeDouble(1.5));
+  nt::SetEntryDouble(nt::GetEntry(server, "/d"), 2.5);
+  EXPECT_EQ(view->GetDouble(d, 0), 2.5);
+
+  std::vector<double> arr;
+  int a = view->GetIndex("/a");
+  ASSERT_TRUE(view->GetDoubleArray(a, &arr));
+  EXPECT_EQ(arr, std::vector<double>({1, 2, 3}));
+  EXPECT_FALSE(view->GetDoubleArray(d, &arr));
+  EXPECT_EQ(view->GetDouble(a, -1), -1);
+
+  EXPECT_EQ(*view->GetValue(view->GetIndex("/s")),
+            *nt::Value::MakeStringArray({"x", "yz"}));
+}
+
+TEST_F(SharedEntryViewTest, Updates) {
+  auto entry = nt::GetEntry(server, "/a");
+  nt::SetEntryValue(entry, nt::Value::MakeDoubleArray({1}));
+  StartServer();
+
+  auto view = nt::SharedEntryView::Open("127.0.0.1", kPort);
+  ASSERT_TRUE(view);
+  int a = view->GetIndex("/a");
+  uint32_t count = view->GetChangeCount();
+  EXPECT_FALSE(view->WaitForChange(count, 0.01));
+
+  // growing the array moves it in the data area
+  std::vector<double> big(100, 2.0);
+  nt::SetEntryValue(entry, nt::Value::MakeDoubleArray(big));
+  ASSERT_TRUE(view->WaitForChange(count, 1.0));
+  std::vector<double> arr;
+  ASSERT_TRUE(view->GetDoubleArray(a, &arr));
+  EXPECT_EQ(arr, big);
+
+  // entries created after the view was opened are found too
+  nt::SetEntryValue(nt::GetEntry(server, "/new"), nt::Value::MakeString("v"));
+  EXPECT_EQ(*view->GetValue(view->GetIndex("/new")),
+            *nt::Value::MakeString("v"));
+
+  nt::DeleteEntry(entry);
+  EXPECT_FALSE(view->GetValue(a));
+
+  nt::StopServer(server);
+  EXPECT_TRUE(view->IsClosed());
+  EXPECT_TRUE(view->WaitForChange(view->GetChangeCount(), -1));
+  EXPECT_FALSE(nt::SharedEntryView::Open("localhost", kPort));
+}
+
+TEST_F(SharedEntryViewTest, NotLocal) {
+  StartServer();
+  EXPECT_FALSE(nt::SharedEntryView::Open("10.0.0.2", kPort));
+  EXPECT_FALSE(nt::SharedEntryView::Open("localhost", kPort + 1));
+}
+
+TEST_F(SharedEntryViewTest, CorruptSegment) {
+  auto entry = nt::GetEntry(server, "/a");
+  nt::SetEntryValue(entry, nt::Value::MakeDoubleArray({1}));
+  StartServer();
+
+  // another process of the same user can write the segment; scribble over
+  // everything after the magic, including the allocator mirror and slots
+  int fd = ::shm_open(fmt::format("/ntcore-{}", kPort).c_str(), O_RDWR, 0);
+  ASSERT_GE(fd, 0);
+  struct stat st;
+  ASSERT_EQ(::fstat(fd, &st), 0);
+  void* base = ::mmap(nullptr, st.st_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                      fd, 0);
+  ::close(fd);
+  ASSERT_NE(base, MAP_FAILED);
+  std::memset(static_cast<char*>(base) + 8, 0x7f, st.st_size - 8);
+
+  // the server only writes within its own allocations
+  std::vector<double> big(100, 2.0);
+  nt::SetEntryValue(entry, nt::Value::MakeDoubleArray(big));
+  nt::SetEntryValue(nt::GetEntry(server, "/new"), nt::Value::MakeString("v"));
+  ::munmap(base, st.st_size);
+}
+
+TEST(SharedEntryViewDisabledTest, NoSegment) {
+  auto server = nt::CreateInstance();
+  nt::StartServer(server, "", "127.0.0.1", 10231);
+  EXPECT_FALSE(nt::SharedEntryView::Open("", 10231));
+  nt::StopServer(server);
+  nt::DestroyInstance(server);
+}
+
+#endif  // _WIN32
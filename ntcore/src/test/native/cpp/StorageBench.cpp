@@ -0,0 +1,75 @@
+// Copyright (c) FIRST and other WPILib contributors.
+// Open Source Software; you can modify and/or share it under the terms of
+// the WPILib BSD license file in the root directory of this project.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <wpi/timestamp.h>
+
+#include "fmt/format.h"
+#include "gtest/gtest.h"
+#include "ntcore_cpp.h"
+
+// Measures how long a control loop style writer takes to update a set of
+// entries while other threads continuously read them (as dashboards and
+// network connections do).
+// Not part of the regular test run; see --gtest_also_run_disabled_tests.
+TEST(StorageBench, DISABLED_Contention) {
+  constexpr int kEntries = 200;
+  constexpr int kIterations = 500;
+
+  for (int numReaders : {0, 1, 2, 4, 8}) {
+    auto inst = nt::CreateInstance();
+    std::vector<NT_Entry> entries;
+    for (int i = 0; i < kEntries; ++i) {
+      entries.emplace_back(nt::GetEntry(inst, fmt::format("/bench/{}", i)));
+      nt::SetEntryDouble(entries.back(), 0);
+    }
+
+    std::atomic_bool stop{false};
+    std::atomic<uint64_t> reads{0};
+    std::vector<std::thread> readers;
+    for (int i = 0; i < numReaders; ++i) {
+      readers.emplace_back([&] {
+        while (!stop) {
+          for (auto entry : entries) {
+            auto value = nt::GetEntryValue(entry);
+            if (!value) {
+              ADD_FAILURE();
+            }
+          }
+          reads.fetch_add(kEntries, std::memory_order_relaxed);
+        }
+      });
+    }
+
+    std::vector<uint64_t> times;
+    auto start = wpi::Now();
+    for (int i = 0; i < kIterations; ++i) {
+      auto loopStart = wpi::Now();
+      for (auto entry : entries) {
+        nt::SetEntryDouble(entry, i);
+      }
+      times.push_back(wpi::Now() - loopStart);
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    auto elapsed = wpi::Now() - start;
+
+    stop = true;
+    for (auto&& reader : readers) {
+      reader.join();
+    }
+    nt::DestroyInstance(inst);
+
+    std::sort(times.begin(), times.end());
+    fmt::print(
+        "Storage {} readers: write loop p50 {} us p99 {} us max {} us, "
+        "{:.0f} reads/s\n",
+        numReaders, times[times.size() / 2], times[times.size() * 99 / 100],
+        times.back(), reads * 1.0e6 / elapsed);
+  }
+}
@@ -4,8 +4,10 @@
 
 #include "StorageTest.h"
 
+#include <fmt/format.h>
 #include <wpi/SmallString.h>
 #include <wpi/StringExtras.h>
+#include <wpi/fs.h>
 #include <wpi/raw_istream.h>
 #include <wpi/raw_ostream.h>
 
@@ -19,6 +21,7 @@
 
 using ::testing::_;
 using ::testing::AnyNumber;
+using ::testing::ElementsAre;
 using ::testing::IsNull;
 using ::testing::Return;
 
@@ -312,6 +315,256 @@ TEST_P(StorageEmptyTest, SetEntryValueEmptyValue) {
   EXPECT_TRUE(idmap().empty());
 }
 
+TEST_P(StorageEmptyTest, SetEntryDoubleAssignNew) {
+  // brand new entry takes the normal path and is assigned immediately
+  auto value = Value::MakeDouble(1.0);
+  unsigned int local_id = storage.GetEntry("foo");
+
+  EXPECT_CALL(dispatcher,
+              QueueOutgoing(MessageEq(Message::EntryAssign(
+                                "foo", GetParam() ? 0 : 0xffff, 1, value, 0)),
+                            IsNull(), IsNull()));
+  EXPECT_CALL(notifier, NotifyEntry(0, std::string_view("foo"), ValueEq(value),
+                                    NT_NOTIFY_NEW | NT_NOTIFY_LOCAL, UINT_MAX));
+
+  EXPECT_TRUE(storage.SetEntryDouble(local_id, 1.0, 0, false));
+  EXPECT_EQ(*value, *GetEntry("foo")->value);
+}
+
+TEST_P(StoragePopulatedTest, SetEntryDoubleCoalesced) {
+  // updates are made in place and only the latest is sent on flush
+  Value* orig = GetEntry("foo2")->value.get();
+  EXPECT_CALL(notifier, NotifyEntry(1, std::string_view("foo2"), _,
+                                    NT_NOTIFY_UPDATE | NT_NOTIFY_LOCAL,
+                                    UINT_MAX))
+      .Times(3);
+  EXPECT_TRUE(storage.SetEntryDouble(1, 1.0, 0, false));
+  EXPECT_TRUE(storage.SetEntryDouble(1, 2.0, 0, false));
+  EXPECT_TRUE(storage.SetEntryDouble(1, 3.0, 0, false));
+  EXPECT_EQ(orig, GetEntry("foo2")->value.get());
+  EXPECT_EQ(3.0, GetEntry("foo2")->value->GetDouble());
+  EXPECT_EQ(4u, GetEntry("foo2")->seq_num.value());
+  ::testing::Mock::VerifyAndClearExpectations(&dispatcher);
+
+  // client shouldn't send an update as id not assigned yet
+  if (GetParam()) {
+    EXPECT_CALL(dispatcher, QueueOutgoing(MessageEq(Message::EntryUpdate(
+                                              1, 4, Value::MakeDouble(3.0))),
+                                          IsNull(), IsNull()));
+  }
+  storage.FlushPendingUpdates();
+  ::testing::Mock::VerifyAndClearExpectations(&dispatcher);
+
+  // nothing left to send
+  storage.FlushPendingUpdates();
+}
+
+TEST_P(StoragePopulatedTest, SetEntryDoubleReferenced) {
+  // a value referenced elsewhere is replaced rather than modified
+  auto old = GetEntry("foo2")->value;
+  EXPECT_CALL(notifier, NotifyEntry(1, std::string_view("foo2"), _,
+                                    NT_NOTIFY_UPDATE | NT_NOTIFY_LOCAL,
+                                    UINT_MAX));
+  EXPECT_TRUE(storage.SetEntryDouble(1, 1.0, 0, false));
+  EXPECT_NE(old, GetEntry("foo2")->value);
+  EXPECT_EQ(0.0, old->GetDouble());
+  EXPECT_EQ(1.0, GetEntry("foo2")->value->GetDouble());
+}
+
+TEST_P(StoragePopulatedTest, SetEntryDoubleEqualValue) {
+  // no notification or update for an unchanged value, but the last change
+  // time is still refreshed
+  EXPECT_TRUE(storage.SetEntryDouble(1, 0.0, 1234, false));
+  EXPECT_EQ(1234u, GetEntry("foo2")->value->last_change());
+  storage.FlushPendingUpdates();
+
+  // also when the value is referenced elsewhere
+  auto old = GetEntry("foo2")->value;
+  EXPECT_TRUE(storage.SetEntryDouble(1, 0.0, 5678, false));
+  EXPECT_EQ(1234u, old->last_change());
+  EXPECT_EQ(5678u, GetEntry("foo2")->value->last_change());
+  EXPECT_EQ(0.0, GetEntry("foo2")->value->GetDouble());
+  storage.FlushPendingUpdates();
+}
+
+TEST_P(StoragePopulatedTest, SetEntryDoubleTypeMismatch) {
+  EXPECT_FALSE(storage.SetEntryDouble(0, 1.0, 0, false));
+  EXPECT_TRUE(GetEntry("foo")->value->IsBoolean());
+}
+
+TEST_P(StoragePopulatedTest, SetEntryDoubleForce) {
+  // forcing a type change results in an immediate assignment
+  auto value = Value::MakeDouble(1.0);
+  EXPECT_CALL(dispatcher,
+              QueueOutgoing(MessageEq(Message::EntryAssign(
+                                "foo", GetParam() ? 0 : 0xffff, 2, value, 0)),
+                            IsNull(), IsNull()));
+  EXPECT_CALL(notifier, NotifyEntry(0, std::string_view("foo"), ValueEq(value),
+                                    NT_NOTIFY_UPDATE | NT_NOTIFY_LOCAL,
+                                    UINT_MAX));
+  EXPECT_TRUE(storage.SetEntryDouble(0, 1.0, 0, true));
+  EXPECT_EQ(*value, *GetEntry("foo")->value);
+}
+
+TEST_P(StorageEmptyTest, SetEntryArraysInPlace) {
+  EXPECT_CALL(dispatcher, QueueOutgoing(_, _, _)).Times(AnyNumber());
+  EXPECT_CALL(notifier, NotifyEntry(_, _, _, _, _)).Times(AnyNumber());
+  unsigned int d = storage.GetEntry("d");
+  unsigned int s = storage.GetEntry("s");
+  double darr[] = {1.0, 2.0};
+  EXPECT_TRUE(storage.SetEntryDoubleArray(d, darr, 0, false));
+  EXPECT_TRUE(storage.SetEntryString(s, "hello", 0, false));
+  Value* dorig = GetEntry("d")->value.get();
+  Value* sorig = GetEntry("s")->value.get();
+
+  double darr2[] = {3.0, 4.0, 5.0};
+  EXPECT_TRUE(storage.SetEntryDoubleArray(d, darr2, 0, false));
+  EXPECT_TRUE(storage.SetEntryString(s, "world!", 0, false));
+  EXPECT_EQ(dorig, GetEntry("d")->value.get());
+  EXPECT_EQ(sorig, GetEntry("s")->value.get());
+  EXPECT_EQ(*Value::MakeDoubleArray(darr2), *GetEntry("d")->value);
+  EXPECT_EQ(*Value::MakeString("world!"), *GetEntry("s")->value);
+}
+
+TEST_P(StoragePopulatedTest, BulkDoubles) {
+  EXPECT_CALL(dispatcher, QueueOutgoing(_, _, _)).Times(AnyNumber());
+  EXPECT_CALL(notifier, NotifyEntry(_, _, _, _, _)).Times(AnyNumber());
+  // foo is a boolean, and 99 doesn't exist
+  unsigned int ids[] = {0, 1, 2, 99};
+  double values[4];
+  storage.GetEntryDoubles(ids, -1.0, values);
+  EXPECT_THAT(values, ElementsAre(-1.0, 0.0, 1.0, -1.0));
+
+  double newValues[] = {5.0, 6.0, 7.0, 8.0};
+  EXPECT_EQ(2u, storage.SetEntryDoubles(ids, newValues, 0));
+  EXPECT_TRUE(GetEntry("foo")->value->IsBoolean());
+  EXPECT_EQ(6.0, GetEntry("foo2")->value->GetDouble());
+  EXPECT_EQ(7.0, GetEntry("bar")->value->GetDouble());
+}
+
+TEST_P(StorageEmptyTest, BulkDoubleArrays) {
+  EXPECT_CALL(dispatcher, QueueOutgoing(_, _, _)).Times(AnyNumber());
+  EXPECT_CALL(notifier, NotifyEntry(_, _, _, _, _)).Times(AnyNumber());
+  unsigned int ids[] = {storage.GetEntry("a"), storage.GetEntry("b"),
+                        storage.GetEntry("c")};
+  EXPECT_TRUE(storage.SetEntryString(ids[2], "x", 0, false));
+
+  // c is skipped
+  double values[] = {1.0, 2.0, 3.0, 4.0, 5.0};
+  int lengths[] = {3, 2, -1};
+  EXPECT_EQ(2u, storage.SetEntryDoubleArrays(ids, values, lengths, 0));
+  EXPECT_EQ(*Value::MakeDoubleArray({4.0, 5.0}), *GetEntry("b")->value);
+
+  // only the arrays that fit are copied
+  double small[4];
+  int outLengths[3];
+  EXPECT_EQ(5u, storage.GetEntryDoubleArrays(ids, small, outLengths));
+  EXPECT_THAT(outLengths, ElementsAre(3, 2, -1));
+  EXPECT_THAT(std::vector<double>(small, small + 3),
+              ElementsAre(1.0, 2.0, 3.0));
+
+  double out[5];
+  EXPECT_EQ(5u, storage.GetEntryDoubleArrays(ids, out, outLengths));
+  EXPECT_THAT(out, ElementsAre(1.0, 2.0, 3.0, 4.0, 5.0));
+}
+
+TEST_P(StoragePopulatedTest, SendOptionsDeadband) {
+  EXPECT_CALL(notifier, NotifyEntry(_, _, _, _, _)).Times(AnyNumber());
+  storage.SetEntrySendOptions(1, 0, 0.5);
+
+  // client shouldn't send updates as id not assigned yet
+  if (GetParam()) {
+    EXPECT_CALL(dispatcher, QueueOutgoing(MessageEq(Message::EntryUpdate(
+                                              1, 2, Value::MakeDouble(1.0))),
+                                          IsNull(), IsNull()));
+  }
+  EXPECT_TRUE(storage.SetEntryValue("foo2", Value::MakeDouble(1.0)));
+  ::testing::Mock::VerifyAndClearExpectations(&dispatcher);
+
+  // within the deadband of the last value sent
+  EXPECT_TRUE(storage.SetEntryValue("foo2", Value::MakeDouble(1.3)));
+  EXPECT_TRUE(storage.SetEntryDouble(1, 0.6, 0, false));
+  storage.FlushPendingUpdates();
+  EXPECT_EQ(0.6, GetEntry("foo2")->value->GetDouble());
+  ::testing::Mock::VerifyAndClearExpectations(&dispatcher);
+
+  if (GetParam()) {
+    EXPECT_CALL(dispatcher, QueueOutgoing(MessageEq(Message::EntryUpdate(
+                                              1, 5, Value::MakeDouble(1.6))),
+                                          IsNull(), IsNull()));
+  }
+  EXPECT_TRUE(storage.SetEntryValue("foo2", Value::MakeDouble(1.6)));
+}
+
+TEST_P(StoragePopulatedTest, EntryHistory) {
+  EXPECT_CALL(dispatcher, QueueOutgoing(_, _, _)).Times(AnyNumber());
+  EXPECT_CALL(notifier, NotifyEntry(_, _, _, _, _)).Times(AnyNumber());
+  auto values = [&](uint64_t start, uint64_t end) {
+    std::vector<double> out;
+    for (auto&& value : storage.GetEntryHistory(1, start, end)) {
+      out.push_back(value->GetDouble());
+    }
+    return out;
+  };
+
+  // starts with the current value
+  storage.SetEntryHistory(1, 3);
+  EXPECT_THAT(values(0, UINT64_MAX), ElementsAre(0.0));
+
+  storage.SetEntryValue("foo2", Value::MakeDouble(1.0, 100));
+  storage.SetEntryValue("foo2", Value::MakeDouble(2.0, 200));
+  EXPECT_TRUE(storage.SetEntryDouble(1, 3.0, 300, false));
+  storage.SetEntryFlags("foo2", NT_PERSISTENT);  // not a value change
+  EXPECT_THAT(values(0, UINT64_MAX), ElementsAre(1.0, 2.0, 3.0));
+  EXPECT_THAT(values(150, 300), ElementsAre(2.0, 3.0));
+  EXPECT_THAT(values(301, UINT64_MAX), ElementsAre());
+
+  // the typed setter doesn't overwrite values in the history
+  EXPECT_TRUE(storage.SetEntryDouble(1, 4.0, 400, false));
+  EXPECT_THAT(values(0, UINT64_MAX), ElementsAre(2.0, 3.0, 4.0));
+
+  // shrinking keeps the most recent
+  storage.SetEntryHistory(1, 2);
+  EXPECT_THAT(values(0, UINT64_MAX), ElementsAre(3.0, 4.0));
+
+  storage.DeleteEntry("foo2");
+  EXPECT_THAT(values(0, UINT64_MAX), ElementsAre());
+
+  storage.SetEntryHistory(1, 0);
+  storage.SetEntryValue("foo2", Value::MakeDouble(5.0, 500));
+  EXPECT_THAT(values(0, UINT64_MAX), ElementsAre());
+}
+
+TEST_P(StoragePopulatedTest, SendOptionsPeriod) {
+  EXPECT_CALL(notifier, NotifyEntry(_, _, _, _, _)).Times(AnyNumber());
+  storage.SetEntrySendOptions(1, 10.0, 0);
+
+  if (GetParam()) {
+    EXPECT_CALL(dispatcher, QueueOutgoing(MessageEq(Message::EntryUpdate(
+                                              1, 2, Value::MakeDouble(1.0))),
+                                          IsNull(), IsNull()));
+  }
+  EXPECT_TRUE(storage.SetEntryValue("foo2", Value::MakeDouble(1.0)));
+  ::testing::Mock::VerifyAndClearExpectations(&dispatcher);
+
+  // held back until the period has elapsed
+  EXPECT_TRUE(storage.SetEntryValue("foo2", Value::MakeDouble(2.0)));
+  EXPECT_TRUE(storage.SetEntryDouble(1, 3.0, 0, false));
+  storage.FlushPendingUpdates();
+  ::testing::Mock::VerifyAndClearExpectations(&dispatcher);
+
+  // then only the latest value is sent
+  GetEntry("foo2")->last_send_time = 0;
+  if (GetParam()) {
+    EXPECT_CALL(dispatcher, QueueOutgoing(MessageEq(Message::EntryUpdate(
+                                              1, 4, Value::MakeDouble(3.0))),
+                                          IsNull(), IsNull()));
+  }
+  storage.FlushPendingUpdates();
+  ::testing::Mock::VerifyAndClearExpectations(&dispatcher);
+  storage.FlushPendingUpdates();
+}
+
 TEST_P(StorageEmptyTest, SetDefaultEntryAssignNew) {
   // brand new entry
   auto value = Value::MakeBoolean(true);
@@ -508,6 +761,91 @@ TEST_P(StoragePopulatedTest, DeleteAllEntriesPersistent) {
   EXPECT_NE(nullptr, entries()["foo2"]->value);
 }
 
+TEST_P(StoragePopulatedTest, ResumeAssignments) {
+  EXPECT_CALL(dispatcher, QueueOutgoing(_, _, _)).Times(AnyNumber());
+  EXPECT_CALL(notifier, NotifyEntry(_, _, _, _, _)).Times(AnyNumber());
+  auto conn = std::make_shared<MockNetworkConnection>();
+  EXPECT_CALL(*conn, set_state(_)).Times(AnyNumber());
+  std::vector<std::shared_ptr<Message>> msgs;
+  SyncPoint sync;
+  storage.GetInitialAssignments(*conn, &msgs, &sync);
+  if (!GetParam()) {
+    // only servers resume
+    EXPECT_FALSE(storage.GetResumeAssignments(*conn, sync, &msgs, &sync));
+    return;
+  }
+  EXPECT_EQ(4u, msgs.size());
+
+  storage.SetEntryValue("bar", Value::MakeDouble(2.0));
+  storage.DeleteEntry("foo2");
+  msgs.clear();
+  SyncPoint resumed;
+  ASSERT_TRUE(storage.GetResumeAssignments(*conn, sync, &msgs, &resumed));
+  EXPECT_EQ(sync.epoch, resumed.epoch);
+  EXPECT_GT(resumed.revision, sync.revision);
+  // deletes come first
+  ASSERT_EQ(2u, msgs.size());
+  EXPECT_THAT(msgs[0], MessageEq(Message::EntryDelete(1)));
+  EXPECT_EQ("bar", msgs[1]->str());
+  EXPECT_EQ(2u, msgs[1]->id());
+  EXPECT_THAT(msgs[1]->value(), ValueEq(Value::MakeDouble(2.0)));
+
+  msgs.clear();
+  ASSERT_TRUE(storage.GetResumeAssignments(*conn, resumed, &msgs, &resumed));
+  EXPECT_TRUE(msgs.empty());
+
+  // sync points of another server run, or from before dropped delete
+  // records, can't be resumed from
+  EXPECT_FALSE(storage.GetResumeAssignments(
+      *conn, {sync.epoch + 1, sync.revision}, &msgs, &resumed));
+  for (int i = 0; i < 5000; ++i) {
+    storage.SetEntryValue("tmp", Value::MakeDouble(i));
+    storage.DeleteEntry("tmp");
+  }
+  EXPECT_FALSE(storage.GetResumeAssignments(*conn, sync, &msgs, &resumed));
+}
+
+TEST_P(StorageEmptyTest, ClientResumeAssignments) {
+  if (GetParam()) {
+    return;
+  }
+  EXPECT_CALL(dispatcher, QueueOutgoing(_, _, _)).Times(AnyNumber());
+  EXPECT_CALL(notifier, NotifyEntry(_, _, _, _, _)).Times(AnyNumber());
+  auto conn = std::make_shared<MockNetworkConnection>();
+  EXPECT_CALL(*conn, set_state(_)).Times(AnyNumber());
+  std::shared_ptr<Message> initial[] = {
+      Message::EntryAssign("a", 0, 1, Value::MakeDouble(1), 0),
+      Message::EntryAssign("b", 1, 1, Value::MakeDouble(1), 0),
+      Message::EntryAssign("c", 2, 1, Value::MakeDouble(1), 0)};
+  std::vector<std::shared_ptr<Message>> out;
+  storage.ApplyInitialAssignments(*conn, initial, false, {5, 10}, &out);
+  EXPECT_TRUE(out.empty());
+  EXPECT_EQ(10u, storage.GetSyncPoint().revision);
+
+  // local changes while disconnected
+  storage.SetEntryValue("a", Value::MakeDouble(2));
+  storage.DeleteEntry("b");
+  storage.SetEntryValue("new", Value::MakeDouble(3));
+
+  // the server deleted c meanwhile
+  std::shared_ptr<Message> resume[] = {Message::EntryDelete(2)};
+  storage.ApplyResumeAssignments(*conn, resume, {5, 12}, &out);
+  EXPECT_EQ(nullptr, GetEntry("c")->value);
+  ASSERT_EQ(4u, out.size());
+  EXPECT_THAT(out[0], MessageEq(Message::EntryDelete(1)));
+  EXPECT_THAT(out[1],
+              MessageEq(Message::EntryUpdate(0, 3, Value::MakeDouble(2))));
+  EXPECT_THAT(out[2], MessageEq(Message::FlagsUpdate(0, 0)));
+  EXPECT_THAT(out[3], MessageEq(Message::EntryAssign(
+                          "new", 0xffff, 1, Value::MakeDouble(3), 0)));
+  EXPECT_EQ(12u, storage.GetSyncPoint().revision);
+
+  // what was sent in the handshake isn't sent again
+  out.clear();
+  storage.ApplyResumeAssignments(*conn, {}, {5, 13}, &out);
+  EXPECT_TRUE(out.empty());
+}
+
 TEST_P(StoragePopulatedTest, GetEntryInfoAll) {
   auto info = storage.GetEntryInfo(0, "", 0u);
   ASSERT_EQ(4u, info.size());
@@ -619,6 +957,97 @@ TEST_P(StoragePersistentTest, SavePersistent) {
   ASSERT_EQ("", line);
 }
 
+TEST_P(StoragePersistentTest, SavePersistentJournal) {
+  EXPECT_CALL(dispatcher, QueueOutgoing(_, _, _)).Times(AnyNumber());
+  EXPECT_CALL(notifier, NotifyEntry(_, _, _, _, _)).Times(AnyNumber());
+  for (auto& i : entries()) {
+    storage.SetEntryFlags(i.getKey(), NT_PERSISTENT);
+  }
+  auto filename = (fs::temp_directory_path() /
+                   fmt::format("ntjournal{}.ini", GetParam()))
+                      .string();
+  auto journal = filename + ".journal";
+  ASSERT_EQ(storage.SavePersistent(filename, true), nullptr);
+  EXPECT_FALSE(fs::exists(journal));
+  auto size = fs::file_size(filename);
+
+  // periodic saves only append the changes
+  storage.SetEntryValue("double/neg", Value::MakeDouble(0.1));
+  storage.SetEntryValue("doublearr/two",
+                        Value::MakeDoubleArray(std::vector<double>(300, 0.3)));
+  storage.SetEntryFlags("string/normal", 0);
+  storage.DeleteEntry("raw/normal");
+  storage.SetEntryTypeValue("new", Value::MakeString("added"));
+  storage.SetEntryFlags("new", NT_PERSISTENT);
+  ASSERT_EQ(storage.SavePersistent(filename, true), nullptr);
+  EXPECT_EQ(fs::file_size(filename), size);
+  ASSERT_TRUE(fs::exists(journal));
+
+  Storage loaded(notifier, rpc_server, logger);
+  ASSERT_EQ(loaded.LoadPersistent(filename, nullptr), nullptr);
+  for (auto& i : entries()) {
+    auto value = loaded.GetEntryValue(i.getKey());
+    if (i.getValue()->value && i.getValue()->IsPersistent()) {
+      ASSERT_TRUE(value) << i.getKey();
+      EXPECT_EQ(*value, *i.getValue()->value) << i.getKey();
+    } else {
+      EXPECT_FALSE(value) << i.getKey();
+    }
+  }
+  EXPECT_EQ(*loaded.GetEntryValue("double/neg"), *Value::MakeDouble(0.1));
+
+  // an explicit save rewrites the file and drops the journal
+  ASSERT_EQ(storage.SavePersistent(filename, false), nullptr);
+  EXPECT_FALSE(fs::exists(journal));
+  std::remove(filename.c_str());
+  std::remove((filename + ".bak").c_str());
+}
+
+TEST_P(StoragePersistentTest, LoadPersistentJournalTruncated) {
+  EXPECT_CALL(dispatcher, QueueOutgoing(_, _, _)).Times(AnyNumber());
+  EXPECT_CALL(notifier, NotifyEntry(_, _, _, _, _)).Times(AnyNumber());
+  storage.SetEntryFlags("double/neg", NT_PERSISTENT);
+  storage.SetEntryFlags("string/normal", NT_PERSISTENT);
+  auto filename = (fs::temp_directory_path() /
+                   fmt::format("ntjournaltrunc{}.ini", GetParam()))
+                      .string();
+  auto journal = filename + ".journal";
+  ASSERT_EQ(storage.SavePersistent(filename, true), nullptr);
+  storage.SetEntryValue("double/neg", Value::MakeDouble(2));
+  ASSERT_EQ(storage.SavePersistent(filename, true), nullptr);
+  storage.SetEntryValue("string/normal", Value::MakeString("goodbye"));
+  ASSERT_EQ(storage.SavePersistent(filename, true), nullptr);
+
+  // as if the last save was interrupted
+  fs::resize_file(journal, fs::file_size(journal) - 1);
+
+  MockLoadWarn warn;
+  auto warn_func = [&](size_t line, const char* msg) { warn.Warn(line, msg); };
+  EXPECT_CALL(warn, Warn(2, std::string_view("journal ends partway through a "
+                                             "record, ignoring it")));
+  Storage loaded(notifier, rpc_server, logger);
+  ASSERT_EQ(loaded.LoadPersistent(filename, warn_func), nullptr);
+  EXPECT_EQ(*loaded.GetEntryValue("double/neg"), *Value::MakeDouble(2));
+  EXPECT_EQ(*loaded.GetEntryValue("string/normal"),
+            *Value::MakeString("hello"));
+
+  // a journal from an older file is ignored
+  ASSERT_EQ(storage.SavePersistent(filename, false), nullptr);
+  fs::copy_file(filename, filename + ".old");
+  storage.SetEntryValue("double/neg", Value::MakeDouble(3));
+  ASSERT_EQ(storage.SavePersistent(filename, false), nullptr);
+  storage.SetEntryValue("double/neg", Value::MakeDouble(4));
+  ASSERT_EQ(storage.SavePersistent(filename, true), nullptr);
+  std::rename((filename + ".old").c_str(), filename.c_str());
+  Storage stale(notifier, rpc_server, logger);
+  ASSERT_EQ(stale.LoadPersistent(filename, nullptr), nullptr);
+  EXPECT_EQ(*stale.GetEntryValue("double/neg"), *Value::MakeDouble(2));
+
+  std::remove(filename.c_str());
+  std::remove(journal.c_str());
+  std::remove((filename + ".bak").c_str());
+}
+
 TEST_P(StorageEmptyTest, LoadPersistentBadHeader) {
   MockLoadWarn warn;
   auto warn_func = [&](size_t line, const char* msg) { warn.Warn(line, msg); };
@@ -908,8 +1337,19 @@ TEST_P(StoragePopulateOneTest, ProcessIncomingEntryAssign) {
 TEST_P(StoragePopulateOneTest, ProcessIncomingEntryAssignIgnore) {
   auto conn = std::make_shared<MockNetworkConnection>();
   auto value = Value::MakeDouble(1.0);
+  if (GetParam()) {
+    // server answers the id request with the existing assignment, to the
+    // requester only, and keeps its value
+    auto entry = GetEntry("foo");
+    EXPECT_CALL(dispatcher,
+                QueueOutgoing(MessageEq(Message::EntryAssign(
+                                  "foo", 0, entry->seq_num.value(),
+                                  entry->value, 0)),
+                              conn.get(), IsNull()));
+  }
   storage.ProcessIncoming(Message::EntryAssign("foo", 0xffff, 1, value, 0),
                           conn.get(), conn);
+  EXPECT_TRUE(GetEntry("foo")->value->IsBoolean());
 }
 
 TEST_P(StoragePopulateOneTest, ProcessIncomingEntryAssignWithFlags) {
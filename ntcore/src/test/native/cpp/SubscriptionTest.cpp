@@ -0,0 +1,97 @@
+// Copyright (c) FIRST and other WPILib contributors.
+// Open Source Software; you can modify and/or share it under the terms of
+// the WPILib BSD license file in the root directory of this project.
+
+#include <chrono>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "TestPrinters.h"
+#include "fmt/format.h"
+#include "gtest/gtest.h"
+#include "ntcore_cpp.h"
+
+// Subscription filtering between real server and client instances over
+// loopback.
+class SubscriptionTest : public ::testing::TestWithParam<bool> {
+ public:
+  SubscriptionTest()
+      : server_inst(nt::CreateInstance()), client_inst(nt::CreateInstance()) {
+    nt::SetServerEventLoop(server_inst, GetParam());
+    port = nextPort++;
+    nt::StartServer(server_inst, "", "127.0.0.1", port);
+  }
+
+  ~SubscriptionTest() override {
+    nt::StopClient(client_inst);
+    nt::StopServer(server_inst);
+    nt::DestroyInstance(server_inst);
+    nt::DestroyInstance(client_inst);
+  }
+
+  static bool WaitFor(std::function<bool()> cond) {
+    auto timeout = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while (!cond()) {
+      if (std::chrono::steady_clock::now() > timeout) {
+        return false;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return true;
+  }
+
+  static double GetDouble(NT_Inst inst, std::string_view name) {
+    auto value = nt::GetEntryValue(nt::GetEntry(inst, name));
+    return value && value->IsDouble() ? value->GetDouble() : -1;
+  }
+
+  static void SetDouble(NT_Inst inst, std::string_view name, double v) {
+    nt::SetEntryValue(nt::GetEntry(inst, name), nt::Value::MakeDouble(v));
+  }
+
+  static inline unsigned int nextPort = 10280;
+
+  NT_Inst server_inst;
+  NT_Inst client_inst;
+  unsigned int port;
+};
+
+TEST_P(SubscriptionTest, WriteUnsubscribedEntry) {
+  nt::StartClient(client_inst, "127.0.0.1", port);
+  ASSERT_TRUE(WaitFor([&] { return nt::IsConnected(client_inst); }));
+  std::string_view prefixes[] = {"/sub/"};
+  nt::SetNetworkSubscriptions(client_inst, prefixes);
+
+  // wait until the server applies the subscription: a marker arrives
+  // without the unsubscribed entry created along with it
+  int n = 0;
+  ASSERT_TRUE(WaitFor([&] {
+    if (GetDouble(client_inst, fmt::format("/sub/marker{}", n)) == n &&
+        GetDouble(client_inst, fmt::format("/other/probe{}", n)) == -1) {
+      return true;
+    }
+    ++n;
+    SetDouble(server_inst, fmt::format("/other/probe{}", n), n);
+    SetDouble(server_inst, fmt::format("/sub/marker{}", n), n);
+    return false;
+  }));
+
+  // the client is never sent this assignment
+  SetDouble(server_inst, "/other/x", 1);
+  std::this_thread::sleep_for(std::chrono::milliseconds(200));
+  ASSERT_EQ(GetDouble(client_inst, "/other/x"), -1);
+
+  // so writing it from the client requests an id, which must be answered
+  SetDouble(client_inst, "/other/x", 2);
+  SetDouble(client_inst, "/other/x", 3);
+  EXPECT_TRUE(WaitFor([&] { return GetDouble(server_inst, "/other/x") == 3; }));
+
+  // and later writes go through as updates
+  SetDouble(client_inst, "/other/x", 4);
+  EXPECT_TRUE(WaitFor([&] { return GetDouble(server_inst, "/other/x") == 4; }));
+}
+
+INSTANTIATE_TEST_SUITE_P(SubscriptionTests, SubscriptionTest,
+                         ::testing::Bool());
@@ -31,7 +31,10 @@ class HALSimHttpConnection
                        std::shared_ptr<wpi::uv::Stream> stream)
       : wpi::HttpWebSocketServerConnection<HALSimHttpConnection>(stream, {}),
         m_server(std::move(server)),
-        m_buffers(128) {}
+        m_buffers(128) {
+    // sim messages are verbose JSON, so compress them for browsers
+    m_deflateOptions.emplace();
+  }
 
  public:
   // callable from any thread
@@ -31,10 +31,15 @@
 #else
 #include <arpa/inet.h>
 #include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #endif
 
 #include <cerrno>
+#include <climits>
+
+#include <wpi/SmallVector.h>
 
 using namespace wpi;
 
@@ -114,6 +119,95 @@ size_t TCPStream::send(const char* buffer, size_t len, Error* err) {
   return static_cast<size_t>(rv);
 }
 
+size_t TCPStream::sendv(span<const std::string_view> bufs, Error* err) {
+  if (m_sd < 0) {
+    *err = kConnectionClosed;
+    return 0;
+  }
+#ifdef _WIN32
+  SmallVector<WSABUF, 64> wsaBufs;
+  for (auto buf : bufs) {
+    if (!buf.empty()) {
+      WSABUF wsaBuf;
+      wsaBuf.buf = const_cast<char*>(buf.data());
+      wsaBuf.len = (ULONG)buf.size();
+      wsaBufs.push_back(wsaBuf);
+    }
+  }
+  DWORD rv;
+  while (WSASend(m_sd, wsaBufs.data(), (DWORD)wsaBufs.size(), &rv, 0, nullptr,
+                 nullptr) == SOCKET_ERROR) {
+    if (WSAGetLastError() != WSAEWOULDBLOCK) {
+      *err = kConnectionReset;
+      return 0;
+    }
+    if (!m_blocking) {
+      *err = kWouldBlock;
+      return 0;
+    }
+    Sleep(1);
+  }
+  return static_cast<size_t>(rv);
+#else
+#ifdef IOV_MAX
+  constexpr size_t kMaxIov = IOV_MAX;
+#else
+  constexpr size_t kMaxIov = 1024;
+#endif
+  SmallVector<iovec, 64> iov;
+  size_t total = 0;
+  size_t i = 0;       // current buffer
+  size_t offset = 0;  // bytes of the current buffer already sent
+  while (i < bufs.size()) {
+    // gather up to kMaxIov buffers, starting with the unsent part of the
+    // current one
+    iov.clear();
+    for (size_t j = i; j < bufs.size() && iov.size() < kMaxIov; ++j) {
+      size_t skip = j == i ? offset : 0;
+      if (bufs[j].size() > skip) {
+        iov.push_back({const_cast<char*>(bufs[j].data()) + skip,
+                       bufs[j].size() - skip});
+      }
+    }
+    if (iov.empty()) {
+      break;
+    }
+
+    msghdr msg{};
+    msg.msg_iov = iov.data();
+    msg.msg_iovlen = iov.size();
+#ifdef MSG_NOSIGNAL
+    // disable SIGPIPE on Linux
+    ssize_t rv = ::sendmsg(m_sd, &msg, MSG_NOSIGNAL);
+#else
+    ssize_t rv = ::sendmsg(m_sd, &msg, 0);
+#endif
+    if (rv < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (!m_blocking && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        *err = kWouldBlock;
+      } else {
+        *err = kConnectionReset;
+      }
+      return total;
+    }
+    total += rv;
+
+    // advance past what was sent; a partial send resumes mid-buffer
+    size_t sent = rv;
+    while (i < bufs.size() && sent >= bufs[i].size() - offset) {
+      sent -= bufs[i].size() - offset;
+      ++i;
+      offset = 0;
+    }
+    offset += sent;
+  }
+  return total;
+#endif
+}
+
 size_t TCPStream::receive(char* buffer, size_t len, Error* err, int timeout) {
   if (m_sd < 0) {
     *err = kConnectionClosed;
@@ -4,10 +4,13 @@
 
 #include "wpinet/WebSocket.h"
 
+#include <iterator>
 #include <random>
+#include <vector>
 
 #include <fmt/format.h>
 #include <wpi/Base64.h>
+#include <wpi/Deflate.h>
 #include <wpi/SmallString.h>
 #include <wpi/SmallVector.h>
 #include <wpi/StringExtras.h>
@@ -63,6 +66,7 @@ class WebSocket::ClientHandshakeData {
 
   SmallString<64> key;                       // the key sent to the server
   SmallVector<std::string, 2> protocols;     // valid protocols
+  std::optional<DeflateOptions> deflate;     // offered compression options
   HttpParser parser{HttpParser::kResponse};  // server response parser
   bool hasUpgrade = false;
   bool hasConnection = false;
@@ -72,6 +76,113 @@ class WebSocket::ClientHandshakeData {
   std::weak_ptr<uv::Timer> timer;
 };
 
+class WebSocket::Deflate {
+ public:
+  Deflate(const DeflateOptions& options, int windowBits,
+          bool noContextTakeover)
+      : compressor{windowBits},
+        threshold{options.threshold},
+        noContextTakeover{noContextTakeover} {}
+
+  // Compresses a complete message; the result is valid until the next call.
+  uv::Buffer Compress(span<const uv::Buffer> data) {
+    if (noContextTakeover) {
+      compressor.Reset();
+    }
+    span<const uint8_t> bytes;
+    if (data.size() == 1) {
+      bytes = {reinterpret_cast<const uint8_t*>(data[0].base), data[0].len};
+    } else {
+      in.clear();
+      for (auto&& buf : data) {
+        auto p = reinterpret_cast<const uint8_t*>(buf.base);
+        in.insert(in.end(), p, p + buf.len);
+      }
+      bytes = in;
+    }
+    sent.clear();
+    compressor.Compress(bytes, &sent);
+    // the end of the sync flush (00 00 ff ff) is not sent (RFC 7692 7.2.1)
+    sent.resize(sent.size() - 4);
+    return uv::Buffer{sent};
+  }
+
+  DeflateCompressor compressor;
+  DeflateDecompressor decompressor;
+  size_t threshold;
+  bool noContextTakeover;
+  std::vector<uint8_t> in;        // gathered message to compress
+  std::vector<uint8_t> sent;      // compressed message being sent
+  std::vector<uint8_t> received;  // decompressed received message
+};
+
+namespace {
+struct DeflateParams {
+  bool serverNoContextTakeover = false;
+  bool clientNoContextTakeover = false;
+  int serverMaxWindowBits = 0;  // 0 if not present
+  int clientMaxWindowBits = 0;  // 0 if not present, 15 if no value
+};
+}  // namespace
+
+// Parses a single permessage-deflate offer (or response if !offer).
+// Returns false if it is a different extension or has invalid parameters.
+static bool ParseDeflateParams(std::string_view ext, bool offer,
+                               DeflateParams* params) {
+  auto [name, rest] = split(ext, ';');
+  if (!equals_lower(trim(name), "permessage-deflate")) {
+    return false;
+  }
+  bool seenServerNoContext = false;
+  bool seenClientNoContext = false;
+  while (!rest.empty()) {
+    std::string_view param;
+    std::tie(param, rest) = split(rest, ';');
+    auto [key, value] = split(param, '=');
+    key = trim(key);
+    bool hasValue = param.find('=') != std::string_view::npos;
+    value = trim(value);
+    if (value.size() >= 2 && value.front() == '"' && value.back() == '"') {
+      value = value.substr(1, value.size() - 2);
+    }
+    if (equals_lower(key, "server_no_context_takeover") ||
+        equals_lower(key, "client_no_context_takeover")) {
+      bool server = key[0] == 's' || key[0] == 'S';
+      bool& seen = server ? seenServerNoContext : seenClientNoContext;
+      if (hasValue || seen) {
+        return false;
+      }
+      seen = true;
+      (server ? params->serverNoContextTakeover
+              : params->clientNoContextTakeover) = true;
+    } else if (equals_lower(key, "server_max_window_bits") ||
+               equals_lower(key, "client_max_window_bits")) {
+      bool server = key[0] == 's' || key[0] == 'S';
+      int& bits =
+          server ? params->serverMaxWindowBits : params->clientMaxWindowBits;
+      if (bits != 0) {
+        return false;
+      }
+      if (!hasValue) {
+        // only a client may offer this without a value
+        if (server || !offer) {
+          return false;
+        }
+        bits = 15;
+        continue;
+      }
+      auto v = parse_integer<int>(value, 10);
+      if (!v || *v < 8 || *v > 15) {
+        return false;
+      }
+      bits = *v;
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
 static std::string_view AcceptHash(std::string_view key,
                                    SmallVectorImpl<char>& buf) {
   SHA1 hash;
@@ -109,13 +220,13 @@ std::shared_ptr<WebSocket> WebSocket::CreateClient(
   return ws;
 }
 
-std::shared_ptr<WebSocket> WebSocket::CreateServer(uv::Stream& stream,
-                                                   std::string_view key,
-                                                   std::string_view version,
-                                                   std::string_view protocol) {
+std::shared_ptr<WebSocket> WebSocket::CreateServer(
+    uv::Stream& stream, std::string_view key, std::string_view version,
+    std::string_view protocol, std::string_view extensions,
+    const std::optional<DeflateOptions>& deflate) {
   auto ws = std::make_shared<WebSocket>(stream, true, private_init{});
   stream.SetData(ws);
-  ws->StartServer(key, version, protocol);
+  ws->StartServer(key, version, protocol, extensions, deflate);
   return ws;
 }
 
@@ -177,6 +288,21 @@ void WebSocket::StartClient(std::string_view uri, std::string_view host,
     os << "\r\n";
   }
 
+  // compression offer (if requested); we can't decompress with less than the
+  // full window, so don't limit the server's window size
+  if (options.deflate) {
+    os << "Sec-WebSocket-Extensions: permessage-deflate; "
+          "client_max_window_bits";
+    if (options.deflate->noContextTakeover) {
+      os << "; client_no_context_takeover";
+    }
+    if (options.deflate->peerNoContextTakeover) {
+      os << "; server_no_context_takeover";
+    }
+    os << "\r\n";
+    m_clientHandshake->deflate = options.deflate;
+  }
+
   // other headers
   for (auto&& header : options.extraHeaders) {
     os << header.first << ": " << header.second << "\r\n";
@@ -220,10 +346,21 @@ void WebSocket::StartClient(std::string_view uri, std::string_view host,
           }
           m_clientHandshake->hasAccept = true;
         } else if (equals_lower(name, "sec-websocket-extensions")) {
-          // No extensions are supported
-          if (!value.empty()) {
+          // Only permessage-deflate is supported, and only if offered
+          if (value.empty()) {
+            return;
+          }
+          DeflateParams params;
+          if (!m_clientHandshake->deflate || m_deflate ||
+              !ParseDeflateParams(value, false, &params)) {
             return Terminate(1010, "unsupported extension");
           }
+          auto& options = *m_clientHandshake->deflate;
+          m_deflate = std::make_unique<Deflate>(
+              options,
+              params.clientMaxWindowBits == 0 ? 15
+                                              : params.clientMaxWindowBits,
+              params.clientNoContextTakeover || options.noContextTakeover);
         } else if (equals_lower(name, "sec-websocket-protocol")) {
           // Make sure it was one of the provided protocols
           bool match = false;
@@ -264,7 +401,9 @@ void WebSocket::StartClient(std::string_view uri, std::string_view host,
 }
 
 void WebSocket::StartServer(std::string_view key, std::string_view version,
-                            std::string_view protocol) {
+                            std::string_view protocol,
+                            std::string_view extensions,
+                            const std::optional<DeflateOptions>& deflate) {
   m_protocol = protocol;
 
   // Build server response
@@ -299,6 +438,37 @@ void WebSocket::StartServer(std::string_view key, std::string_view version,
     os << "Sec-WebSocket-Protocol: " << protocol << "\r\n";
   }
 
+  // accept the first valid permessage-deflate offer (if enabled)
+  if (deflate) {
+    while (!extensions.empty()) {
+      std::string_view ext;
+      std::tie(ext, extensions) = split(extensions, ',');
+      DeflateParams params;
+      if (!ParseDeflateParams(ext, true, &params)) {
+        continue;
+      }
+      bool noContextTakeover =
+          params.serverNoContextTakeover || deflate->noContextTakeover;
+      os << "Sec-WebSocket-Extensions: permessage-deflate";
+      if (noContextTakeover) {
+        os << "; server_no_context_takeover";
+      }
+      if (params.clientNoContextTakeover || deflate->peerNoContextTakeover) {
+        os << "; client_no_context_takeover";
+      }
+      if (params.serverMaxWindowBits != 0) {
+        os << fmt::format("; server_max_window_bits={}",
+                          params.serverMaxWindowBits);
+      }
+      os << "\r\n";
+      m_deflate = std::make_unique<Deflate>(
+          *deflate,
+          params.serverMaxWindowBits == 0 ? 15 : params.serverMaxWindowBits,
+          noContextTakeover);
+      break;
+    }
+  }
+
   // end headers
   os << "\r\n";
 
@@ -383,8 +553,9 @@ void WebSocket::HandleIncoming(uv::Buffer& buf, size_t size) {
           return;  // need more data
         }
 
-        // Validate RSV bits are zero
-        if ((m_header[0] & 0x70) != 0) {
+        // Validate RSV bits are zero, other than RSV1 for permessage-deflate
+        uint8_t rsv = m_header[0] & 0x70;
+        if (rsv != 0 && (rsv != kFlagRsv1 || !m_deflate)) {
           return Fail(1002, "nonzero RSV");
         }
       }
@@ -458,35 +629,25 @@ void WebSocket::HandleIncoming(uv::Buffer& buf, size_t size) {
         // We have a complete frame
         // If the message had masking, unmask it
         if ((m_header[1] & kFlagMasking) != 0) {
-          uint8_t key[4] = {
-              m_header[m_headerSize - 4], m_header[m_headerSize - 3],
-              m_header[m_headerSize - 2], m_header[m_headerSize - 1]};
-          int n = 0;
-          for (uint8_t& ch : span{m_payload}.subspan(m_frameStart)) {
-            ch ^= key[n++];
-            if (n >= 4) {
-              n = 0;
-            }
-          }
+          WebSocketMask(span{m_payload}.subspan(m_frameStart),
+                        span<const uint8_t, 4>{&m_header[m_headerSize - 4], 4});
         }
 
         // Handle message
         bool fin = (m_header[0] & kFlagFin) != 0;
         uint8_t opcode = m_header[0] & kOpMask;
+        // RSV1 marks the first frame of a compressed message
+        bool compressed = (m_header[0] & kFlagRsv1) != 0;
+        if (compressed && opcode != kOpText && opcode != kOpBinary) {
+          return Fail(1002, "invalid RSV1");
+        }
         switch (opcode) {
           case kOpCont:
             switch (m_fragmentOpcode) {
               case kOpText:
-                if (!m_combineFragments || fin) {
-                  text(std::string_view{reinterpret_cast<char*>(
-                                            m_payload.data()),
-                                        m_payload.size()},
-                       fin);
-                }
-                break;
               case kOpBinary:
-                if (!m_combineFragments || fin) {
-                  binary(m_payload, fin);
+                if (!HandleData(m_fragmentOpcode, fin)) {
+                  return;
                 }
                 break;
               default:
@@ -498,24 +659,14 @@ void WebSocket::HandleIncoming(uv::Buffer& buf, size_t size) {
             }
             break;
           case kOpText:
-            if (m_fragmentOpcode != 0) {
-              return Fail(1002, "incomplete fragment");
-            }
-            if (!m_combineFragments || fin) {
-              text(std::string_view{reinterpret_cast<char*>(m_payload.data()),
-                                    m_payload.size()},
-                   fin);
-            }
-            if (!fin) {
-              m_fragmentOpcode = opcode;
-            }
-            break;
           case kOpBinary:
             if (m_fragmentOpcode != 0) {
               return Fail(1002, "incomplete fragment");
             }
-            if (!m_combineFragments || fin) {
-              binary(m_payload, fin);
+            m_messageCompressed = compressed;
+            m_utf8.Reset();
+            if (!HandleData(opcode, fin)) {
+              return;
             }
             if (!fin) {
               m_fragmentOpcode = opcode;
@@ -566,7 +717,8 @@ void WebSocket::HandleIncoming(uv::Buffer& buf, size_t size) {
         // Prepare for next message
         m_header.clear();
         m_headerSize = 0;
-        if (!m_combineFragments || fin) {
+        // compressed messages are decompressed as a whole
+        if ((!m_combineFragments && !m_messageCompressed) || fin) {
           m_payload.clear();
         }
         m_frameStart = m_payload.size();
@@ -576,6 +728,61 @@ void WebSocket::HandleIncoming(uv::Buffer& buf, size_t size) {
   }
 }
 
+bool WebSocket::HandleData(uint8_t opcode, bool fin) {
+  if (m_messageCompressed) {
+    if (!fin) {
+      return true;  // wait for the rest of the message
+    }
+    // restore the end of the sync flush the sender removed
+    static constexpr uint8_t kTail[] = {0x00, 0x00, 0xff, 0xff};
+    m_payload.append(std::begin(kTail), std::end(kTail));
+    auto& buf = m_deflate->received;
+    buf.clear();
+    switch (m_deflate->decompressor.Decompress(m_payload, &buf,
+                                               m_maxMessageSize)) {
+      case DeflateDecompressor::kOk:
+        break;
+      case DeflateDecompressor::kTooLarge:
+        Fail(1009, "message too large");
+        return false;
+      default:
+        Fail(1002, "invalid compressed data");
+        return false;
+    }
+    if (opcode == kOpText) {
+      std::string_view str{reinterpret_cast<char*>(buf.data()), buf.size()};
+      if (!IsValidUtf8(str)) {
+        Fail(1007, "invalid UTF-8");
+        return false;
+      }
+      text(str, true);
+    } else {
+      binary(buf, true);
+    }
+    return true;
+  }
+
+  if (opcode == kOpText) {
+    std::string_view frame{
+        reinterpret_cast<char*>(m_payload.data()) + m_frameStart,
+        m_payload.size() - m_frameStart};
+    if (!m_utf8.Validate(frame) || (fin && !m_utf8.IsComplete())) {
+      Fail(1007, "invalid UTF-8");
+      return false;
+    }
+  }
+  if (!m_combineFragments || fin) {
+    if (opcode == kOpText) {
+      text(std::string_view{reinterpret_cast<char*>(m_payload.data()),
+                            m_payload.size()},
+           fin);
+    } else {
+      binary(m_payload, fin);
+    }
+  }
+  return true;
+}
+
 void WebSocket::Send(
     uint8_t opcode, span<const uv::Buffer> data,
     std::function<void(span<uv::Buffer>, uv::Error)> callback) {
@@ -592,17 +799,28 @@ void WebSocket::Send(
     return;
   }
 
-  auto req = std::make_shared<WebSocketWriteReq>(std::move(callback));
-  raw_uv_ostream os{req->m_bufs, 4096};
-
-  // opcode (includes FIN bit)
-  os << static_cast<unsigned char>(opcode);
-
   // payload length
   uint64_t size = 0;
   for (auto&& buf : data) {
     size += buf.len;
   }
+
+  // compress complete data messages
+  span<const uv::Buffer> payload = data;
+  uv::Buffer compressedBuf;
+  if (m_deflate && size >= m_deflate->threshold &&
+      (opcode == (kFlagFin | kOpText) || opcode == (kFlagFin | kOpBinary))) {
+    compressedBuf = m_deflate->Compress(data);
+    payload = span{&compressedBuf, 1};
+    size = compressedBuf.len;
+    opcode |= kFlagRsv1;
+  }
+
+  auto req = std::make_shared<WebSocketWriteReq>(std::move(callback));
+  raw_uv_ostream os{req->m_bufs, 4096};
+
+  // opcode (includes FIN bit)
+  os << static_cast<unsigned char>(opcode);
   if (size < 126) {
     os << static_cast<unsigned char>((m_server ? 0x00 : kFlagMasking) | size);
   } else if (size <= 0xffff) {
@@ -623,25 +841,33 @@ void WebSocket::Send(
     os << span{sizeMsb};
   }
 
-  // clients need to mask the input data
-  if (!m_server) {
+  // clients need to mask the input data; compressed data is also copied
+  if (!m_server || payload.data() != data.data()) {
     // generate masking key
-    static std::random_device rd;
-    static std::default_random_engine gen{rd()};
-    std::uniform_int_distribution<unsigned int> dist(0, 255);
     uint8_t key[4];
-    for (uint8_t& v : key) {
-      v = dist(gen);
+    if (!m_server) {
+      static std::random_device rd;
+      static std::default_random_engine gen{rd()};
+      std::uniform_int_distribution<unsigned int> dist(0, 255);
+      for (uint8_t& v : key) {
+        v = dist(gen);
+      }
+      os << span<const uint8_t>{key, 4};
+    }
+    // copy data, then mask it in place; the header fits in the first buffer
+    size_t headerSize = req->m_bufs[0].len;
+    for (auto&& buf : payload) {
+      os << std::string_view{buf.base, buf.len};
     }
-    os << span<const uint8_t>{key, 4};
-    // copy and mask data
-    int n = 0;
-    for (auto&& buf : data) {
-      for (auto&& ch : buf.data()) {
-        os << static_cast<unsigned char>(static_cast<uint8_t>(ch) ^ key[n++]);
-        if (n >= 4) {
-          n = 0;
+    if (!m_server) {
+      size_t pos = 0;
+      for (auto&& buf : req->m_bufs) {
+        auto bytes = span{reinterpret_cast<uint8_t*>(buf.base), buf.len};
+        if (headerSize > 0) {
+          bytes = bytes.subspan(headerSize);
+          headerSize = 0;
         }
+        pos = WebSocketMask(bytes, key, pos);
       }
     }
     req->m_startUser = req->m_bufs.size();
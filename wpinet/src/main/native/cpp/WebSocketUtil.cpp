@@ -0,0 +1,94 @@
+// Copyright (c) FIRST and other WPILib contributors.
+// Open Source Software; you can modify and/or share it under the terms of
+// the WPILib BSD license file in the root directory of this project.
+
+#include "wpinet/WebSocketUtil.h"
+
+#include <cstring>
+
+using namespace wpi;
+
+static constexpr uint64_t kHighBits = 0x8080808080808080;
+
+size_t wpi::WebSocketMask(span<uint8_t> data, span<const uint8_t, 4> key,
+                          size_t offset) {
+  // key repeated to word size, starting at the key byte for data[0]; words
+  // are a multiple of the key size, so it lines up for every word
+  uint8_t pattern[sizeof(uint64_t)];
+  for (size_t i = 0; i < sizeof(pattern); ++i) {
+    pattern[i] = key[(offset + i) % 4];
+  }
+  uint64_t word;
+  std::memcpy(&word, pattern, sizeof(word));
+
+  uint8_t* p = data.data();
+  size_t len = data.size();
+  for (; len >= sizeof(word); p += sizeof(word), len -= sizeof(word)) {
+    uint64_t v;
+    std::memcpy(&v, p, sizeof(v));
+    v ^= word;
+    std::memcpy(p, &v, sizeof(v));
+  }
+  for (size_t i = 0; i < len; ++i) {
+    p[i] ^= pattern[i];
+  }
+  return offset + data.size();
+}
+
+bool Utf8Validator::Validate(std::string_view str) {
+  auto p = reinterpret_cast<const uint8_t*>(str.data());
+  auto end = p + str.size();
+  while (p != end) {
+    if (m_need != 0) {
+      uint8_t ch = *p++;
+      if (ch < m_lo || ch > m_hi) {
+        return false;
+      }
+      --m_need;
+      m_lo = 0x80;
+      m_hi = 0xbf;
+      continue;
+    }
+
+    // skip ASCII a word at a time
+    while (end - p >= static_cast<ptrdiff_t>(sizeof(uint64_t))) {
+      uint64_t v;
+      std::memcpy(&v, p, sizeof(v));
+      if ((v & kHighBits) != 0) {
+        break;
+      }
+      p += sizeof(v);
+    }
+    if (p == end) {
+      break;
+    }
+
+    // lead byte; restrict the first continuation byte to rule out overlong
+    // encodings, surrogates, and code points past U+10FFFF
+    uint8_t ch = *p++;
+    if (ch < 0x80) {
+      continue;
+    } else if (ch < 0xc2) {
+      return false;
+    } else if (ch < 0xe0) {
+      m_need = 1;
+    } else if (ch < 0xf0) {
+      m_need = 2;
+      if (ch == 0xe0) {
+        m_lo = 0xa0;
+      } else if (ch == 0xed) {
+        m_hi = 0x9f;
+      }
+    } else if (ch < 0xf5) {
+      m_need = 3;
+      if (ch == 0xf0) {
+        m_lo = 0x90;
+      } else if (ch == 0xf4) {
+        m_hi = 0x8f;
+      }
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
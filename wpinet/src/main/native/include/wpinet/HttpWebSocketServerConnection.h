@@ -7,6 +7,7 @@
 
 #include <initializer_list>
 #include <memory>
+#include <optional>
 #include <string>
 #include <string_view>
 
@@ -81,6 +82,12 @@ class HttpWebSocketServerConnection
    */
   WebSocket* m_websocket = nullptr;
 
+  /**
+   * If set, permessage-deflate compression offered by the client is accepted
+   * with these options.  Set before the upgrade (e.g. in the constructor).
+   */
+  std::optional<WebSocket::DeflateOptions> m_deflateOptions;
+
  private:
   WebSocketServerHelper m_helper;
   SmallVector<std::string, 2> m_protocols;
@@ -8,6 +8,8 @@
 #include <cstddef>
 #include <string_view>
 
+#include <wpi/span.h>
+
 namespace wpi {
 
 class NetworkStream {
@@ -23,6 +25,26 @@ class NetworkStream {
   };
 
   virtual size_t send(const char* buffer, size_t len, Error* err) = 0;
+
+  /**
+   * Sends multiple buffers in order as a single write (scatter-gather).
+   * Returns the total number of bytes sent, or 0 on error.  The default
+   * implementation calls send() for each buffer.
+   */
+  virtual size_t sendv(span<const std::string_view> bufs, Error* err) {
+    size_t total = 0;
+    for (auto buf : bufs) {
+      if (buf.empty()) {
+        continue;
+      }
+      size_t sent = send(buf.data(), buf.size(), err);
+      if (sent == 0) {
+        return 0;
+      }
+      total += sent;
+    }
+    return total;
+  }
   virtual size_t receive(char* buffer, size_t len, Error* err,
                          int timeout = 0) = 0;
   virtual void close() = 0;
@@ -47,6 +47,7 @@ class TCPStream : public NetworkStream {
   ~TCPStream() override;
 
   size_t send(const char* buffer, size_t len, Error* err) override;
+  size_t sendv(span<const std::string_view> bufs, Error* err) override;
   size_t receive(char* buffer, size_t len, Error* err,
                  int timeout = 0) override;
   void close() final;
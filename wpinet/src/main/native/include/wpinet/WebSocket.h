@@ -10,6 +10,7 @@
 #include <functional>
 #include <initializer_list>
 #include <memory>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <utility>
@@ -18,6 +19,7 @@
 #include <wpi/SmallVector.h>
 #include <wpi/span.h>
 
+#include "wpinet/WebSocketUtil.h"
 #include "wpinet/uv/Buffer.h"
 #include "wpinet/uv/Error.h"
 #include "wpinet/uv/Timer.h"
@@ -42,6 +44,7 @@ class WebSocket : public std::enable_shared_from_this<WebSocket> {
   static constexpr uint8_t kOpPong = 0x0A;
   static constexpr uint8_t kOpMask = 0x0F;
   static constexpr uint8_t kFlagFin = 0x80;
+  static constexpr uint8_t kFlagRsv1 = 0x40;
   static constexpr uint8_t kFlagMasking = 0x80;
   static constexpr uint8_t kLenMask = 0x7f;
 
@@ -69,6 +72,25 @@ class WebSocket : public std::enable_shared_from_this<WebSocket> {
     CLOSED
   };
 
+  /**
+   * permessage-deflate (RFC 7692) compression options.  Only complete text
+   * and binary messages are compressed; messages sent as fragments are sent
+   * uncompressed.
+   */
+  struct DeflateOptions {
+    /** Messages smaller than this many bytes are sent uncompressed. */
+    size_t threshold = 128;
+
+    /**
+     * Compress each sent message on its own instead of referring back to
+     * earlier messages.  Lowers the compression ratio.
+     */
+    bool noContextTakeover = false;
+
+    /** Ask the peer to compress each message on its own. */
+    bool peerNoContextTakeover = false;
+  };
+
   /**
    * Client connection options.
    */
@@ -80,6 +102,9 @@ class WebSocket : public std::enable_shared_from_this<WebSocket> {
 
     /** Additional headers to include in handshake. */
     span<const std::pair<std::string_view, std::string_view>> extraHeaders;
+
+    /** If set, offer permessage-deflate compression with these options. */
+    std::optional<DeflateOptions> deflate;
   };
 
   /**
@@ -127,10 +152,15 @@ class WebSocket : public std::enable_shared_from_this<WebSocket> {
    *                client request
    * @param protocol The subprotocol to send to the client (in the
    *                 Sec-WebSocket-Protocol header field).
+   * @param extensions The value of the Sec-WebSocket-Extensions header field
+   *                   in the client request
+   * @param deflate If set, accept a permessage-deflate offer in extensions
+   *                with these options
    */
   static std::shared_ptr<WebSocket> CreateServer(
       uv::Stream& stream, std::string_view key, std::string_view version,
-      std::string_view protocol = {});
+      std::string_view protocol = {}, std::string_view extensions = {},
+      const std::optional<DeflateOptions>& deflate = {});
 
   /**
    * Get connection state.
@@ -153,6 +183,12 @@ class WebSocket : public std::enable_shared_from_this<WebSocket> {
    */
   std::string_view GetProtocol() const { return m_protocol; }
 
+  /**
+   * Get whether permessage-deflate compression was negotiated.  Only valid in
+   * or after the open() event.
+   */
+  bool IsDeflate() const { return m_deflate != nullptr; }
+
   /**
    * Set the maximum message size.  Default is 128 KB.  If configured to combine
    * fragments this maximum applies to the entire message (all combined
@@ -456,6 +492,12 @@ class WebSocket : public std::enable_shared_from_this<WebSocket> {
   size_t m_frameStart = 0;
   uint64_t m_frameSize = UINT64_MAX;
   uint8_t m_fragmentOpcode = 0;
+  bool m_messageCompressed = false;
+  Utf8Validator m_utf8;  // validates the current text message
+
+  // permessage-deflate state, if negotiated
+  class Deflate;
+  std::unique_ptr<Deflate> m_deflate;
 
   // temporary data used only during client handshake
   class ClientHandshakeData;
@@ -465,10 +507,12 @@ class WebSocket : public std::enable_shared_from_this<WebSocket> {
                    span<const std::string_view> protocols,
                    const ClientOptions& options);
   void StartServer(std::string_view key, std::string_view version,
-                   std::string_view protocol);
+                   std::string_view protocol, std::string_view extensions,
+                   const std::optional<DeflateOptions>& deflate);
   void SendClose(uint16_t code, std::string_view reason);
   void SetClosed(uint16_t code, std::string_view reason, bool failed = false);
   void HandleIncoming(uv::Buffer& buf, size_t size);
+  bool HandleData(uint8_t opcode, bool fin);
   void Send(uint8_t opcode, span<const uv::Buffer> data,
             std::function<void(span<uv::Buffer>, uv::Error)> callback);
 };
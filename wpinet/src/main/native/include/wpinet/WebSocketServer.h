@@ -8,6 +8,7 @@
 #include <functional>
 #include <initializer_list>
 #include <memory>
+#include <optional>
 #include <string>
 #include <string_view>
 #include <utility>
@@ -75,10 +76,14 @@ class WebSocketServerHelper {
    * reader) before calling this.  See also WebSocket::CreateServer().
    * @param stream Connection stream
    * @param protocol The subprotocol to send to the client
+   * @param deflate If set, accept a permessage-deflate offer from the client
+   *                with these options
    */
-  std::shared_ptr<WebSocket> Accept(uv::Stream& stream,
-                                    std::string_view protocol = {}) {
-    return WebSocket::CreateServer(stream, m_key, m_version, protocol);
+  std::shared_ptr<WebSocket> Accept(
+      uv::Stream& stream, std::string_view protocol = {},
+      const std::optional<WebSocket::DeflateOptions>& deflate = {}) {
+    return WebSocket::CreateServer(stream, m_key, m_version, protocol,
+                                   m_extensions, deflate);
   }
 
   bool IsUpgrade() const { return m_gotHost && m_websocket; }
@@ -94,6 +99,7 @@ class WebSocketServerHelper {
   SmallVector<std::string, 2> m_protocols;
   SmallString<64> m_key;
   SmallString<16> m_version;
+  SmallString<64> m_extensions;
 };
 
 /**
@@ -118,6 +124,12 @@ class WebSocketServer : public std::enable_shared_from_this<WebSocketServer> {
      * default all hosts are accepted.
      */
     std::function<bool(std::string_view)> checkHost;
+
+    /**
+     * If set, accept permessage-deflate compression offered by clients with
+     * these options.
+     */
+    std::optional<WebSocket::DeflateOptions> deflate;
   };
 
   /**
@@ -0,0 +1,81 @@
+// Copyright (c) FIRST and other WPILib contributors.
+// Open Source Software; you can modify and/or share it under the terms of
+// the WPILib BSD license file in the root directory of this project.
+
+#ifndef WPINET_WEBSOCKETUTIL_H_
+#define WPINET_WEBSOCKETUTIL_H_
+
+#include <stdint.h>
+
+#include <string_view>
+
+#include <wpi/span.h>
+
+namespace wpi {
+
+/**
+ * Applies a WebSocket masking key to data in place (RFC 6455 section 5.3).
+ * Masking is its own inverse, so this also unmasks.  Works a word at a time.
+ *
+ * @param data    data to mask
+ * @param key     masking key
+ * @param offset  position of data within the payload, for masking a payload
+ *                split across several buffers
+ * @return Position following data within the payload (offset + data size)
+ */
+size_t WebSocketMask(span<uint8_t> data, span<const uint8_t, 4> key,
+                     size_t offset = 0);
+
+/**
+ * Incremental UTF-8 validator.  Text may be validated in pieces that split
+ * code points, e.g. one WebSocket frame at a time.  Overlong encodings,
+ * surrogates and code points past U+10FFFF are rejected.
+ */
+class Utf8Validator {
+ public:
+  /**
+   * Validates the next piece of text.  Once this fails, Reset() must be
+   * called before validating other text.
+   *
+   * @param str  text
+   * @return False if the text so far isn't valid UTF-8
+   */
+  bool Validate(std::string_view str);
+
+  /**
+   * Determines if the text so far ends on a code point boundary.
+   *
+   * @return False if the text ends in the middle of a code point
+   */
+  bool IsComplete() const { return m_need == 0; }
+
+  /**
+   * Starts validating new text.
+   */
+  void Reset() {
+    m_need = 0;
+    m_lo = 0x80;
+    m_hi = 0xbf;
+  }
+
+ private:
+  // continuation bytes still needed, and the valid range of the next one
+  uint8_t m_need = 0;
+  uint8_t m_lo = 0x80;
+  uint8_t m_hi = 0xbf;
+};
+
+/**
+ * Determines if a string is valid UTF-8.
+ *
+ * @param str  string
+ * @return True if valid
+ */
+inline bool IsValidUtf8(std::string_view str) {
+  Utf8Validator validator;
+  return validator.Validate(str) && validator.IsComplete();
+}
+
+}  // namespace wpi
+
+#endif  // WPINET_WEBSOCKETUTIL_H_
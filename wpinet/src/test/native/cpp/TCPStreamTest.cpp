@@ -0,0 +1,58 @@
+// Copyright (c) FIRST and other WPILib contributors.
+// Open Source Software; you can modify and/or share it under the terms of
+// the WPILib BSD license file in the root directory of this project.
+
+#include "wpinet/TCPStream.h"  // NOLINT(build/include_order)
+
+#include "gtest/gtest.h"  // NOLINT(build/include_order)
+
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <wpi/Logger.h>
+
+#include "wpinet/TCPAcceptor.h"
+#include "wpinet/TCPConnector.h"
+
+namespace wpi {
+
+TEST(TCPStreamTest, SendV) {
+  Logger logger;
+  TCPAcceptor acceptor{10300, "127.0.0.1", logger};
+  ASSERT_EQ(acceptor.start(), 0);
+
+  // more buffers than fit in a single sendmsg() call, including empty ones
+  std::vector<std::string> data;
+  std::string expected;
+  for (int i = 0; i < 3000; ++i) {
+    data.emplace_back(i % 7, static_cast<char>('a' + i % 26));
+    expected += data.back();
+  }
+  std::vector<std::string_view> bufs(data.begin(), data.end());
+
+  std::string received;
+  std::thread server{[&] {
+    auto stream = acceptor.accept();
+    ASSERT_TRUE(stream);
+    char buf[1024];
+    NetworkStream::Error err;
+    while (received.size() < expected.size()) {
+      size_t len = stream->receive(buf, sizeof(buf), &err);
+      if (len == 0) {
+        break;
+      }
+      received.append(buf, len);
+    }
+  }};
+
+  auto stream = TCPConnector::connect("127.0.0.1", 10300, logger, 1);
+  ASSERT_TRUE(stream);
+  NetworkStream::Error err;
+  EXPECT_EQ(stream->sendv(bufs, &err), expected.size());
+  server.join();
+  EXPECT_EQ(received, expected);
+}
+
+}  // namespace wpi
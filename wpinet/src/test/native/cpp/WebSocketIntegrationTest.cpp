@@ -4,6 +4,9 @@
 
 #include "wpinet/WebSocketServer.h"  // NOLINT(build/include_order)
 
+#include <string>
+#include <vector>
+
 #include <wpi/SmallString.h>
 
 #include "WebSocketTest.h"
@@ -147,4 +150,152 @@ TEST_F(WebSocketIntegrationTest, ClientSendText) {
   ASSERT_EQ(gotData, 1);
 }
 
+TEST_F(WebSocketIntegrationTest, Deflate) {
+  int gotData = 0;
+  std::string text(1000, 'x');
+  for (size_t i = 0; i < text.size(); i += 10) {
+    text[i] = 'a' + (i / 10) % 26;
+  }
+  std::vector<uint8_t> binary(text.begin(), text.end());
+
+  serverPipe->Listen([&]() {
+    auto conn = serverPipe->Accept();
+    WebSocketServer::ServerOptions options;
+    options.deflate.emplace();
+    auto server = WebSocketServer::Create(*conn, {}, options);
+    server->connected.connect([&](std::string_view, WebSocket& ws) {
+      ASSERT_TRUE(ws.IsDeflate());
+      // echo everything back
+      ws.text.connect([&](std::string_view data, bool fin) {
+        ASSERT_TRUE(fin);
+        ws.SendText({uv::Buffer::Dup(data)}, [](auto bufs, uv::Error) {
+          bufs[0].Deallocate();
+        });
+      });
+      ws.binary.connect([&](span<const uint8_t> data, bool fin) {
+        ASSERT_TRUE(fin);
+        ws.SendBinary({uv::Buffer::Dup(data)}, [](auto bufs, uv::Error) {
+          bufs[0].Deallocate();
+        });
+      });
+    });
+  });
+
+  clientPipe->Connect(pipeName, [&] {
+    WebSocket::ClientOptions options;
+    options.deflate.emplace();
+    auto ws =
+        WebSocket::CreateClient(*clientPipe, "/test", pipeName, {}, options);
+    ws->closed.connect([&](uint16_t code, std::string_view reason) {
+      Finish();
+      if (code != 1005 && code != 1006) {
+        FAIL() << "Code: " << code << " Reason: " << reason;
+      }
+    });
+    ws->open.connect([&, s = ws.get()](std::string_view) {
+      ASSERT_TRUE(s->IsDeflate());
+      // the second copy refers back to the first; the last is too small to
+      // be compressed
+      s->SendText({{text}}, [](auto, uv::Error) {});
+      s->SendText({{std::string_view{text}.substr(0, 500)},
+                   {std::string_view{text}.substr(500)}},
+                  [](auto, uv::Error) {});
+      s->SendBinary({{binary}}, [](auto, uv::Error) {});
+      s->SendText({{"hello"}}, [](auto, uv::Error) {});
+    });
+    ws->text.connect([&, s = ws.get()](std::string_view data, bool) {
+      ++gotData;
+      if (gotData <= 2) {
+        ASSERT_EQ(data, text);
+      } else {
+        ASSERT_EQ(data, "hello");
+        s->Close();
+      }
+    });
+    ws->binary.connect([&](span<const uint8_t> data, bool) {
+      ++gotData;
+      ASSERT_EQ(std::vector<uint8_t>(data.begin(), data.end()), binary);
+    });
+  });
+
+  loop->Run();
+
+  ASSERT_EQ(gotData, 4);
+}
+
+TEST_F(WebSocketIntegrationTest, DeflateNotAccepted) {
+  int gotServerOpen = 0;
+  int gotClientOpen = 0;
+
+  serverPipe->Listen([&]() {
+    auto conn = serverPipe->Accept();
+    auto server = WebSocketServer::Create(*conn);
+    server->connected.connect([&](std::string_view, WebSocket& ws) {
+      ++gotServerOpen;
+      ASSERT_FALSE(ws.IsDeflate());
+    });
+  });
+
+  clientPipe->Connect(pipeName, [&] {
+    WebSocket::ClientOptions options;
+    options.deflate.emplace();
+    auto ws =
+        WebSocket::CreateClient(*clientPipe, "/test", pipeName, {}, options);
+    ws->closed.connect([&](uint16_t code, std::string_view reason) {
+      Finish();
+      if (code != 1005 && code != 1006) {
+        FAIL() << "Code: " << code << " Reason: " << reason;
+      }
+    });
+    ws->open.connect([&, s = ws.get()](std::string_view) {
+      ++gotClientOpen;
+      ASSERT_FALSE(s->IsDeflate());
+      s->Close();
+    });
+  });
+
+  loop->Run();
+
+  ASSERT_EQ(gotServerOpen, 1);
+  ASSERT_EQ(gotClientOpen, 1);
+}
+
+TEST_F(WebSocketIntegrationTest, DeflateNotOffered) {
+  int gotData = 0;
+
+  serverPipe->Listen([&]() {
+    auto conn = serverPipe->Accept();
+    WebSocketServer::ServerOptions options;
+    options.deflate.emplace();
+    auto server = WebSocketServer::Create(*conn, {}, options);
+    server->connected.connect([&](std::string_view, WebSocket& ws) {
+      ASSERT_FALSE(ws.IsDeflate());
+      ws.text.connect([&](std::string_view data, bool) {
+        ++gotData;
+        ASSERT_EQ(data, std::string(200, 'x'));
+      });
+    });
+  });
+
+  clientPipe->Connect(pipeName, [&] {
+    auto ws = WebSocket::CreateClient(*clientPipe, "/test", pipeName);
+    ws->closed.connect([&](uint16_t code, std::string_view reason) {
+      Finish();
+      if (code != 1005 && code != 1006) {
+        FAIL() << "Code: " << code << " Reason: " << reason;
+      }
+    });
+    ws->open.connect([&, s = ws.get()](std::string_view) {
+      ASSERT_FALSE(s->IsDeflate());
+      s->SendText({uv::Buffer::Dup(std::string(200, 'x'))},
+                  [](auto bufs, uv::Error) { bufs[0].Deallocate(); });
+      s->Close();
+    });
+  });
+
+  loop->Run();
+
+  ASSERT_EQ(gotData, 1);
+}
+
 }  // namespace wpi
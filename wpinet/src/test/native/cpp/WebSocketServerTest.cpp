@@ -471,6 +471,117 @@ TEST_F(WebSocketServerTest, ReceiveFragmentSeparate) {
   ASSERT_EQ(gotCallback, 3);
 }
 
+//
+// Text messages must be valid UTF-8.
+//
+
+TEST_F(WebSocketServerTest, ReceiveTextInvalidUtf8) {
+  int gotCallback = 0;
+  setupWebSocket = [&] {
+    ws->text.connect([&](std::string_view, bool) {
+      ws->Terminate();
+      FAIL() << "Should not have gotten invalid text";
+    });
+    ws->closed.connect([&](uint16_t code, std::string_view reason) {
+      ++gotCallback;
+      ASSERT_EQ(code, 1007) << "reason: " << reason;
+    });
+  };
+  // overlong encoding of '/'
+  const uint8_t data[] = {'a', 0xc0, 0xaf};
+  auto message = BuildMessage(0x01, true, true, data);
+  resp.headersComplete.connect([&](bool) {
+    clientPipe->Write({{message}}, [&](auto bufs, uv::Error) {});
+  });
+
+  loop->Run();
+
+  ASSERT_EQ(gotCallback, 1);
+}
+
+TEST_F(WebSocketServerTest, ReceiveTextIncompleteUtf8) {
+  int gotCallback = 0;
+  setupWebSocket = [&] {
+    ws->closed.connect([&](uint16_t code, std::string_view reason) {
+      ++gotCallback;
+      ASSERT_EQ(code, 1007) << "reason: " << reason;
+    });
+  };
+  // first two bytes of U+20AC
+  const uint8_t data[] = {0xe2, 0x82};
+  auto message = BuildMessage(0x01, true, true, data);
+  resp.headersComplete.connect([&](bool) {
+    clientPipe->Write({{message}}, [&](auto bufs, uv::Error) {});
+  });
+
+  loop->Run();
+
+  ASSERT_EQ(gotCallback, 1);
+}
+
+// Fragments may split code points
+TEST_F(WebSocketServerTest, ReceiveTextFragmentSplitUtf8) {
+  int gotCallback = 0;
+  const uint8_t data[] = {'a', 0xe2};
+  const uint8_t data2[] = {0x82, 0xac};
+
+  setupWebSocket = [&] {
+    ws->SetCombineFragments(false);
+    ws->text.connect([&](std::string_view inData, bool fin) {
+      switch (++gotCallback) {
+        case 1:
+          ASSERT_FALSE(fin);
+          ASSERT_EQ(inData, "a\xe2");
+          break;
+        case 2:
+          ws->Terminate();
+          ASSERT_TRUE(fin);
+          ASSERT_EQ(inData, "\x82\xac");
+          break;
+        default:
+          FAIL() << "too many callbacks";
+          break;
+      }
+    });
+  };
+
+  auto message = BuildMessage(0x01, false, true, data);
+  auto message2 = BuildMessage(0x00, true, true, data2);
+  resp.headersComplete.connect([&](bool) {
+    clientPipe->Write({{message}, {message2}}, [&](auto bufs, uv::Error) {});
+  });
+
+  loop->Run();
+
+  ASSERT_EQ(gotCallback, 2);
+}
+
+// RSV1 (compressed) is only valid if permessage-deflate was negotiated
+TEST_F(WebSocketServerTest, ReceiveCompressedNotNegotiated) {
+  int gotCallback = 0;
+  setupWebSocket = [&] {
+    ws->binary.connect([&](auto, bool) {
+      ws->Terminate();
+      FAIL() << "Should not have gotten compressed data";
+    });
+    ws->closed.connect([&](uint16_t code, std::string_view reason) {
+      ++gotCallback;
+      ASSERT_EQ(code, 1002) << "reason: " << reason;
+    });
+  };
+  // "a" compressed with a fixed Huffman block
+  const uint8_t data[] = {0x4b, 0x04, 0x00};
+  auto message = BuildMessage(0x42, true, true, data);
+  resp.headersComplete.connect([&](bool) {
+    clientPipe->Write({{message}}, [&](auto bufs, uv::Error) {});
+  });
+
+  loop->Run();
+
+  ASSERT_FALSE(ws->IsDeflate());
+  ASSERT_EQ(gotCallback, 1);
+}
+
 //
 // Maximum message size is limited.
 //
@@ -0,0 +1,69 @@
+// Copyright (c) FIRST and other WPILib contributors.
+// Open Source Software; you can modify and/or share it under the terms of
+// the WPILib BSD license file in the root directory of this project.
+
+#include <chrono>
+#include <string_view>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include "gtest/gtest.h"
+#include "wpinet/WebSocketUtil.h"
+
+// Measures masking and UTF-8 validation throughput for 1 KB to 1 MB
+// payloads, masking against the previous byte at a time loop.
+// Processes 256 MB per case, so it is disabled by default.
+TEST(WebSocketUtilBench, DISABLED_Throughput) {
+  using Clock = std::chrono::steady_clock;
+  constexpr size_t kTotal = 256 * 1024 * 1024;  // bytes processed per case
+  const uint8_t key[4] = {0x12, 0x34, 0x56, 0x78};
+
+  auto rate = [](size_t bytes, Clock::duration elapsed) {
+    return bytes /
+           std::chrono::duration<double, std::micro>(elapsed).count();
+  };
+
+  for (size_t size = 1024; size <= 1024 * 1024; size *= 4) {
+    std::vector<uint8_t> data(size, 'x');
+    // mostly ASCII JSON-like text with some multi-byte code points
+    for (size_t i = 0; i + 3 <= size; i += 64) {
+      data[i] = 0xe2;
+      data[i + 1] = 0x82;
+      data[i + 2] = 0xac;
+    }
+    std::string_view text{reinterpret_cast<const char*>(data.data()), size};
+    size_t rounds = kTotal / size;
+
+    auto start = Clock::now();
+    for (size_t r = 0; r < rounds; ++r) {
+      int n = 0;
+      for (uint8_t& ch : data) {
+        ch ^= key[n++];
+        if (n >= 4) {
+          n = 0;
+        }
+      }
+    }
+    auto bytewise = Clock::now() - start;
+
+    start = Clock::now();
+    for (size_t r = 0; r < rounds; ++r) {
+      wpi::WebSocketMask(data, key);
+    }
+    auto word = Clock::now() - start;
+
+    // an even number of rounds of each leaves the text unmasked
+    ASSERT_EQ(rounds % 2, 0u);
+    start = Clock::now();
+    for (size_t r = 0; r < rounds; ++r) {
+      ASSERT_TRUE(wpi::IsValidUtf8(text));
+    }
+    auto utf8 = Clock::now() - start;
+
+    fmt::print(
+        "{:>8} bytes: mask bytewise {:.0f} MB/s, word {:.0f} MB/s; "
+        "UTF-8 {:.0f} MB/s\n",
+        size, rate(kTotal, bytewise), rate(kTotal, word), rate(kTotal, utf8));
+  }
+}
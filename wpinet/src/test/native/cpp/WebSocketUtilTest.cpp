@@ -0,0 +1,86 @@
+// Copyright (c) FIRST and other WPILib contributors.
+// Open Source Software; you can modify and/or share it under the terms of
+// the WPILib BSD license file in the root directory of this project.
+
+#include "wpinet/WebSocketUtil.h"  // NOLINT(build/include_order)
+
+#include <string_view>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace wpi {
+
+TEST(WebSocketMaskTest, MatchesBytewise) {
+  const uint8_t key[4] = {0x11, 0x22, 0x33, 0x44};
+  for (size_t offset = 0; offset < 4; ++offset) {
+    for (size_t len = 0; len < 40; ++len) {
+      std::vector<uint8_t> data(len);
+      for (size_t i = 0; i < len; ++i) {
+        data[i] = static_cast<uint8_t>(i * 7);
+      }
+      auto expected = data;
+      for (size_t i = 0; i < len; ++i) {
+        expected[i] ^= key[(offset + i) % 4];
+      }
+      EXPECT_EQ(WebSocketMask(data, key, offset), offset + len);
+      EXPECT_EQ(data, expected) << "offset " << offset << " len " << len;
+    }
+  }
+}
+
+TEST(WebSocketMaskTest, Split) {
+  const uint8_t key[4] = {0x01, 0x02, 0x04, 0x08};
+  std::vector<uint8_t> whole(37, 0xf0);
+  auto split = whole;
+  WebSocketMask(whole, key);
+  size_t pos = WebSocketMask(span{split}.subspan(0, 5), key);
+  pos = WebSocketMask(span{split}.subspan(5, 11), key, pos);
+  WebSocketMask(span{split}.subspan(16), key, pos);
+  EXPECT_EQ(whole, split);
+}
+
+TEST(Utf8ValidatorTest, Valid) {
+  EXPECT_TRUE(IsValidUtf8(""));
+  EXPECT_TRUE(IsValidUtf8("plain ascii text that is longer than a word"));
+  EXPECT_TRUE(IsValidUtf8("\xc2\x80"));                      // U+0080
+  EXPECT_TRUE(IsValidUtf8("caf\xc3\xa9 \xe2\x82\xac 100"));  // cafe, euro
+  EXPECT_TRUE(IsValidUtf8("\xed\x9f\xbf"));                  // U+D7FF
+  EXPECT_TRUE(IsValidUtf8("\xef\xbf\xbf"));                  // U+FFFF
+  EXPECT_TRUE(IsValidUtf8("\xf0\x90\x80\x80"));              // U+10000
+  EXPECT_TRUE(IsValidUtf8("\xf4\x8f\xbf\xbf"));              // U+10FFFF
+  EXPECT_TRUE(IsValidUtf8(std::string_view{"a\0b", 3}));
+}
+
+TEST(Utf8ValidatorTest, Invalid) {
+  EXPECT_FALSE(IsValidUtf8("\x80"));              // lone continuation
+  EXPECT_FALSE(IsValidUtf8("\xc0\xaf"));          // overlong
+  EXPECT_FALSE(IsValidUtf8("\xe0\x9f\xbf"));      // overlong
+  EXPECT_FALSE(IsValidUtf8("\xf0\x8f\xbf\xbf"));  // overlong
+  EXPECT_FALSE(IsValidUtf8("\xed\xa0\x80"));      // surrogate
+  EXPECT_FALSE(IsValidUtf8("\xf4\x90\x80\x80"));  // past U+10FFFF
+  EXPECT_FALSE(IsValidUtf8("\xf5\x80\x80\x80"));
+  EXPECT_FALSE(IsValidUtf8("\xff"));
+  EXPECT_FALSE(IsValidUtf8("\xc3"));              // truncated
+  EXPECT_FALSE(IsValidUtf8("\xe2\x82"));
+  EXPECT_FALSE(IsValidUtf8("\xe2\x82z"));
+  EXPECT_FALSE(IsValidUtf8("twelve bytes\xc3(ascii after"));
+}
+
+TEST(Utf8ValidatorTest, Incremental) {
+  // U+1F600 split after every byte
+  Utf8Validator validator;
+  for (std::string_view piece : {"ab\xf0", "\x9f", "\x98", "\x80"}) {
+    ASSERT_TRUE(validator.Validate(piece));
+  }
+  EXPECT_TRUE(validator.IsComplete());
+
+  ASSERT_TRUE(validator.Validate("\xe2\x82"));
+  EXPECT_FALSE(validator.IsComplete());
+  EXPECT_FALSE(validator.Validate("a"));
+  validator.Reset();
+  EXPECT_TRUE(validator.Validate("a"));
+  EXPECT_TRUE(validator.IsComplete());
+}
+
+}  // namespace wpi
@@ -214,9 +214,10 @@ class DataLogReader:
         return self.isValid()
 
     def isValid(self) -> bool:
-        """Returns true if the data log is valid (e.g. has a valid header)."""
+        """Returns true if the data log is valid (e.g. has a valid header).
+        Version 2.0 logs (which may contain compressed blocks) are not supported."""
         return (len(self.buf) >= 12 and self.buf[0:6] == b"WPILOG" and
-                self.getVersion() >= 0x0100)
+                0x0100 <= self.getVersion() < 0x0200)
 
     def getVersion(self) -> int:
         """Gets the data log version. Returns 0 if data log is invalid.
@@ -103,6 +103,69 @@ public final class DataLog implements AutoCloseable {
     DataLogJNI.resume(m_impl);
   }
 
+  /**
+   * Sets how often written data is synced to storage. Data that has been synced survives a power
+   * loss, so the most data that can be lost is what was appended in the last flush period plus
+   * sync period. The default (0) syncs after every flush.
+   *
+   * @param period minimum time between syncs, in seconds; 0 to sync after every flush, negative to
+   *     only sync when the log is closed
+   */
+  public void setSyncPeriod(double period) {
+    DataLogJNI.setSyncPeriod(m_impl, period);
+  }
+
+  /**
+   * Sets the amount of file space to preallocate ahead of the written data. This reduces write
+   * stalls on slow media. The file size is not changed, and unused space is released when the log
+   * is closed. Only supported on Linux; ignored elsewhere.
+   *
+   * @param size preallocation size in bytes; 0 to disable
+   */
+  public void setPreallocation(long size) {
+    DataLogJNI.setPreallocation(m_impl, size);
+  }
+
+  /**
+   * What to do with data records when the buffer limit set by setBufferLimit() is reached. Control
+   * records (entry starts, finishes, and metadata changes) are never discarded.
+   */
+  public enum BufferPolicy {
+    /** Discard the oldest buffered data records to make room. */
+    kDropOldest,
+    /** Discard newly appended data records until there is room. */
+    kDropNewest,
+    /**
+     * Keep only every Nth record of each entry once the buffers are half full, and discard newly
+     * appended data records once they are full.
+     */
+    kDecimate
+  }
+
+  /**
+   * Limits the amount of memory used to buffer data waiting to be written. Without a limit, buffers
+   * grow without bound if the output falls behind (e.g. during a slow disk period). Each appending
+   * thread also has a fixed size buffer of its own, so the limit may be exceeded by up to that
+   * amount per thread.
+   *
+   * @param size maximum buffered bytes; 0 (the default) for no limit
+   * @param policy what to do with data records when the limit is reached
+   * @param decimation for BufferPolicy.kDecimate, keep one out of this many records of each entry
+   */
+  public void setBufferLimit(long size, BufferPolicy policy, int decimation) {
+    DataLogJNI.setBufferLimit(m_impl, size, policy.ordinal(), decimation);
+  }
+
+  /**
+   * Limits the amount of memory used to buffer data waiting to be written. When the limit is
+   * reached, the oldest buffered data records are discarded.
+   *
+   * @param size maximum buffered bytes; 0 (the default) for no limit
+   */
+  public void setBufferLimit(long size) {
+    setBufferLimit(size, BufferPolicy.kDropOldest, 4);
+  }
+
   /**
    * Start an entry. Duplicate names are allowed (with the same type), and result in the same index
    * being returned (start/finish are reference counted). A duplicate name with a different type
@@ -17,6 +17,12 @@ public class DataLogJNI extends WPIUtilJNI {
 
   static native void resume(long impl);
 
+  static native void setSyncPeriod(long impl, double period);
+
+  static native void setPreallocation(long impl, long size);
+
+  static native void setBufferLimit(long impl, long size, int policy, int decimation);
+
   static native int start(long impl, String name, String type, String metadata, long timestamp);
 
   static native void finish(long impl, int entry, long timestamp);
@@ -44,7 +44,8 @@ public class DataLogReader implements Iterable<DataLogRecord> {
   }
 
   /**
-   * Returns true if the data log is valid (e.g. has a valid header).
+   * Returns true if the data log is valid (e.g. has a valid header). Only version 1.x logs are
+   * supported; version 2.0 logs (which may contain compressed blocks) are not.
    *
    * @return True if valid, false otherwise
    */
@@ -56,7 +57,8 @@ public class DataLogReader implements Iterable<DataLogRecord> {
         && m_buf.get(3) == 'L'
         && m_buf.get(4) == 'O'
         && m_buf.get(5) == 'G'
-        && m_buf.getShort(6) >= 0x0100;
+        && m_buf.getShort(6) >= 0x0100
+        && m_buf.getShort(6) < 0x0200;
   }
 
   /**
@@ -7,6 +7,8 @@
 #include "wpi/Synchronization.h"
 
 #ifndef _WIN32
+#include <fcntl.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #endif
 
@@ -19,17 +21,21 @@
 
 #endif
 
+#include <algorithm>
 #include <atomic>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <iterator>
 #include <random>
 #include <vector>
 
 #include "fmt/format.h"
 #include "wpi/Endian.h"
+#include "wpi/LZ4.h"
 #include "wpi/Logger.h"
 #include "wpi/MathExtras.h"
+#include "wpi/SmallVector.h"
 #include "wpi/fs.h"
 #include "wpi/timestamp.h"
 
@@ -37,6 +43,10 @@ using namespace wpi::log;
 
 static constexpr size_t kBlockSize = 16 * 1024;
 static constexpr size_t kRecordMaxHeaderSize = 17;
+// must be a power of 2
+static constexpr size_t kThreadBufferSize = 64 * 1024;
+
+static std::atomic<uint64_t> gNextInstance{1};
 
 template <typename T>
 static unsigned int WriteVarInt(uint8_t* buf, T val) {
@@ -118,6 +128,85 @@ class DataLog::Buffer {
   size_t m_maxLen;
 };
 
+// Single-producer, single-consumer byte ring of complete records.  The
+// producer is the thread that owns it; the consumer is whoever holds m_mutex.
+class DataLog::ThreadBuffer {
+ public:
+  ThreadBuffer() : m_buf{new uint8_t[kThreadBufferSize]} {}
+
+  // Returns false if there is not enough space for the whole record.  Sets
+  // *wake if this write pushed the buffer over half full.
+  bool Write(wpi::span<const uint8_t> header,
+             wpi::span<const wpi::span<const uint8_t>> data, bool* wake) {
+    size_t size = header.size();
+    for (auto&& chunk : data) {
+      size += chunk.size();
+    }
+    size_t tail = m_tail.load(std::memory_order_relaxed);
+    size_t used = tail - m_head.load(std::memory_order_acquire);
+    if (size > (kThreadBufferSize - used)) {
+      return false;
+    }
+    Copy(tail, header);
+    tail += header.size();
+    for (auto&& chunk : data) {
+      Copy(tail, chunk);
+      tail += chunk.size();
+    }
+    m_tail.store(tail, std::memory_order_release);
+    *wake = used < (kThreadBufferSize / 2) &&
+            (used + size) >= (kThreadBufferSize / 2);
+    return true;
+  }
+
+  // Calls func with the buffered data (in one or two pieces) and empties it.
+  template <typename F>
+  void Drain(F&& func) {
+    size_t head = m_head.load(std::memory_order_relaxed);
+    size_t tail = m_tail.load(std::memory_order_acquire);
+    if (head == tail) {
+      return;
+    }
+    size_t start = head % kThreadBufferSize;
+    size_t len = tail - head;
+    size_t first = (std::min)(len, kThreadBufferSize - start);
+    func(wpi::span<const uint8_t>{m_buf.get() + start, first});
+    if (first < len) {
+      func(wpi::span<const uint8_t>{m_buf.get(), len - first});
+    }
+    m_head.store(tail, std::memory_order_release);
+  }
+
+  // owning thread has exited
+  void Abandon() { m_abandoned.store(true, std::memory_order_release); }
+  bool IsAbandoned() const {
+    return m_abandoned.load(std::memory_order_acquire);
+  }
+
+  // owning log has been destroyed
+  void Close() { m_closed.store(true, std::memory_order_release); }
+  bool IsClosed() const { return m_closed.load(std::memory_order_acquire); }
+
+ private:
+  void Copy(size_t pos, wpi::span<const uint8_t> data) {
+    if (data.empty()) {
+      return;
+    }
+    pos %= kThreadBufferSize;
+    size_t first = (std::min)(data.size(), kThreadBufferSize - pos);
+    std::memcpy(m_buf.get() + pos, data.data(), first);
+    if (first < data.size()) {
+      std::memcpy(m_buf.get(), data.data() + first, data.size() - first);
+    }
+  }
+
+  std::unique_ptr<uint8_t[]> m_buf;
+  alignas(64) std::atomic<size_t> m_head{0};
+  alignas(64) std::atomic<size_t> m_tail{0};
+  std::atomic_bool m_abandoned{false};
+  std::atomic_bool m_closed{false};
+};
+
 static void DefaultLog(unsigned int level, const char* file, unsigned int line,
                        const char* msg) {
   if (level > wpi::WPI_LOG_INFO) {
@@ -130,28 +219,36 @@ static void DefaultLog(unsigned int level, const char* file, unsigned int line,
 static wpi::Logger defaultMessageLog{DefaultLog};
 
 DataLog::DataLog(std::string_view dir, std::string_view filename, double period,
-                 std::string_view extraHeader)
-    : DataLog{defaultMessageLog, dir, filename, period, extraHeader} {}
+                 std::string_view extraHeader, bool compress)
+    : DataLog{defaultMessageLog, dir, filename, period, extraHeader,
+              compress} {}
 
 DataLog::DataLog(wpi::Logger& msglog, std::string_view dir,
                  std::string_view filename, double period,
-                 std::string_view extraHeader)
+                 std::string_view extraHeader, bool compress)
     : m_msglog{msglog},
+      m_compressible{compress},
+      m_compress{compress},
       m_period{period},
       m_extraHeader{extraHeader},
       m_newFilename{filename},
+      m_instance{gNextInstance++},
       m_thread{[this, dir = std::string{dir}] { WriterThreadMain(dir); }} {}
 
 DataLog::DataLog(std::function<void(wpi::span<const uint8_t> data)> write,
-                 double period, std::string_view extraHeader)
-    : DataLog{defaultMessageLog, std::move(write), period, extraHeader} {}
+                 double period, std::string_view extraHeader, bool compress)
+    : DataLog{defaultMessageLog, std::move(write), period, extraHeader,
+              compress} {}
 
 DataLog::DataLog(wpi::Logger& msglog,
                  std::function<void(wpi::span<const uint8_t> data)> write,
-                 double period, std::string_view extraHeader)
+                 double period, std::string_view extraHeader, bool compress)
     : m_msglog{msglog},
+      m_compressible{compress},
+      m_compress{compress},
       m_period{period},
       m_extraHeader{extraHeader},
+      m_instance{gNextInstance++},
       m_thread{[this, write = std::move(write)] {
         WriterThreadMain(std::move(write));
       }} {}
@@ -164,6 +261,9 @@ DataLog::~DataLog() {
   }
   m_cond.notify_all();
   m_thread.join();
+  for (auto&& buf : m_threadBuffers) {
+    buf->Close();
+  }
 }
 
 void DataLog::SetFilename(std::string_view filename) {
@@ -183,27 +283,112 @@ void DataLog::Flush() {
 }
 
 void DataLog::Pause() {
-  std::scoped_lock lock{m_mutex};
   m_paused = true;
 }
 
 void DataLog::Resume() {
-  std::scoped_lock lock{m_mutex};
   m_paused = false;
 }
 
-static void WriteToFile(fs::file_t f, wpi::span<const uint8_t> data,
-                        std::string_view filename, wpi::Logger& msglog) {
-  do {
+void DataLog::SetCompression(bool enable) {
+  m_compress = enable;
+}
+
+void DataLog::SetSyncPeriod(double period) {
+  m_syncPeriod = period;
+}
+
+void DataLog::SetPreallocation(size_t size) {
+  m_preallocate = size;
+}
+
+void DataLog::SetBufferLimit(size_t size, BufferPolicy policy,
+                             unsigned int decimation) {
+  m_decimation = decimation == 0 ? 1 : decimation;
+  m_bufferPolicy = policy;
+  m_bufferLimit = size;
+}
+
+DataLog::WriteStats DataLog::GetWriteStats() const {
+  std::scoped_lock lock{m_mutex};
+  WriteStats stats = m_stats;
+  stats.pendingBytes = 0;
+  for (auto&& buf : m_outgoing) {
+    stats.pendingBytes += buf.GetData().size();
+  }
+  stats.droppedRecords = m_droppedRecords;
+  stats.droppedBytes = m_droppedBytes;
+  return stats;
+}
+
+size_t DataLog::UpdatePendingStats(wpi::span<const Buffer> bufs) {
+  size_t size = 0;
+  for (auto&& buf : bufs) {
+    size += buf.GetData().size();
+  }
+  m_stats.maxPendingBytes = (std::max)(m_stats.maxPendingBytes, size);
+  return size;
+}
+
+void DataLog::UpdateWriteStats(size_t bytes, uint64_t writeTime) {
+  m_stats.bytesWritten += bytes;
+  ++m_stats.writes;
+  m_stats.writeTime += writeTime;
+  m_stats.maxWriteTime = (std::max)(m_stats.maxWriteTime, writeTime);
+  if (writeTime > kStallTime) {
+    ++m_stats.stalls;
+  }
+}
+
+void DataLog::UpdateSyncStats(uint64_t syncTime) {
+  ++m_stats.syncs;
+  m_stats.syncTime += syncTime;
+  m_stats.maxSyncTime = (std::max)(m_stats.maxSyncTime, syncTime);
+  if (syncTime > kStallTime) {
+    ++m_stats.stalls;
+  }
+}
+
 #ifdef _WIN32
+static size_t WriteToFile(fs::file_t f, wpi::span<const uint8_t> data,
+                          std::string_view filename, wpi::Logger& msglog) {
+  size_t total = data.size();
+  do {
     DWORD ret;
     if (!WriteFile(f, data.data(), data.size(), &ret, nullptr)) {
       WPI_ERROR(msglog, "Error writing to log file '{}': {}", filename,
                 GetLastError());
       break;
     }
+
+    // The write may have written some or all of the data
+    data = data.subspan(ret);
+  } while (data.size() > 0);
+  return total - data.size();
+}
+#endif
+
+// writes multiple buffers, batching them into as few system calls as possible
+static size_t WriteToFile(fs::file_t f,
+                          wpi::span<const wpi::span<const uint8_t>> chunks,
+                          std::string_view filename, wpi::Logger& msglog) {
+  size_t total = 0;
+#ifdef _WIN32
+  for (auto&& chunk : chunks) {
+    total += WriteToFile(f, chunk, filename, msglog);
+  }
 #else
-    ssize_t ret = ::write(f, data.data(), data.size());
+  static constexpr size_t kMaxIov = 64;
+  wpi::SmallVector<iovec, 16> iov;
+  for (auto&& chunk : chunks) {
+    if (!chunk.empty()) {
+      iov.push_back({const_cast<uint8_t*>(chunk.data()), chunk.size()});
+    }
+  }
+  size_t i = 0;
+  while (i < iov.size()) {
+    ssize_t ret =
+        ::writev(f, &iov[i], (std::min)(iov.size() - i, kMaxIov));
     if (ret < 0) {
       // If it's a recoverable error, swallow it and retry the write
       if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK) {
@@ -215,11 +400,76 @@ static void WriteToFile(fs::file_t f, wpi::span<const uint8_t> data,
                 std::strerror(errno));
       break;
     }
-#endif
+    total += ret;
 
     // The write may have written some or all of the data
-    data = data.subspan(ret);
-  } while (data.size() > 0);
+    size_t len = ret;
+    while (i < iov.size() && len >= iov[i].iov_len) {
+      len -= iov[i].iov_len;
+      ++i;
+    }
+    if (len > 0) {
+      iov[i].iov_base = static_cast<uint8_t*>(iov[i].iov_base) + len;
+      iov[i].iov_len -= len;
+    }
+  }
+#endif
+  return total;
+}
+
+// flushes file data (and the file size) to storage
+static void SyncFile(fs::file_t f) {
+#if defined(__linux__)
+  ::fdatasync(f);
+#elif defined(__APPLE__)
+  ::fsync(f);
+#elif defined(_WIN32)
+  FlushFileBuffers(f);
+#endif
+}
+
+// flushes the directory entry so a new or renamed file survives power loss
+static void SyncDirectory(const fs::path& dir) {
+#ifndef _WIN32
+  int fd = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY);
+  if (fd >= 0) {
+    ::fsync(fd);
+    ::close(fd);
+  }
+#endif
+}
+
+// Allocates file space in [offset, offset + len) without changing the file
+// size.  Returns false if not supported.
+static bool PreallocateFile(fs::file_t f, uint64_t offset, uint64_t len) {
+#ifdef __linux__
+  return ::fallocate(f, FALLOC_FL_KEEP_SIZE, offset, len) == 0;
+#else
+  return false;
+#endif
+}
+
+// Releases preallocated space past the end of the file.  Truncating to the
+// current size frees blocks allocated with FALLOC_FL_KEEP_SIZE; punching a
+// hole past EOF does not on all filesystems (e.g. ext4).
+static void ReleasePreallocation(fs::file_t f, uint64_t size) {
+#ifdef __linux__
+  ::ftruncate(f, size);
+#endif
+}
+
+// Builds the file header; the version depends on whether the log may contain
+// compressed blocks.
+static std::vector<uint8_t> MakeHeader(std::string_view extraHeader,
+                                       bool compressed) {
+  uint16_t version =
+      compressed ? impl::kCompressedFormatVersion : impl::kFormatVersion;
+  std::vector<uint8_t> header{'W', 'P', 'I', 'L', 'O', 'G'};
+  header.resize(12 + extraHeader.size());
+  wpi::support::endian::write16le(&header[6], version);
+  wpi::support::endian::write32le(&header[8], extraHeader.size());
+  std::memcpy(&header[12], extraHeader.data(), extraHeader.size());
+  return header;
 }
 
 static std::string MakeRandomFilename() {
@@ -279,33 +529,50 @@ void DataLog::WriterThreadMain(std::string_view dir) {
     WPI_ERROR(m_msglog, "{}", "Could not open log file, no log being saved");
   } else {
     WPI_INFO(m_msglog, "Logging to '{}'", (dirPath / filename).string());
+    SyncDirectory(dirPath);
   }
 
-  // write header (version 1.0)
+  // bytes written to file, and bytes of file space allocated
+  uint64_t fileSize = 0;
+  uint64_t allocated = 0;
+  bool preallocFailed = false;
+
+  uint64_t lastSync = wpi::Now();
+  bool unsynced = false;
+
+  // write header
   if (f != fs::kInvalidFile) {
-    const uint8_t header[] = {'W', 'P', 'I', 'L', 'O', 'G', 0, 1};
-    WriteToFile(f, header, filename, m_msglog);
-    uint8_t extraLen[4];
-    support::endian::write32le(extraLen, m_extraHeader.size());
-    WriteToFile(f, extraLen, filename, m_msglog);
-    if (m_extraHeader.size() > 0) {
-      WriteToFile(f,
-                  {reinterpret_cast<const uint8_t*>(m_extraHeader.data()),
-                   m_extraHeader.size()},
-                  filename, m_msglog);
-    }
+    auto header = MakeHeader(m_extraHeader, m_compressible);
+    const wpi::span<const uint8_t> headerChunks[] = {header};
+    fileSize += WriteToFile(f, headerChunks, filename, m_msglog);
+    unsynced = true;
   }
 
   std::vector<Buffer> toWrite;
+  std::vector<uint8_t> raw;
+  std::vector<uint8_t> compressed;
+  wpi::SmallVector<wpi::span<const uint8_t>, 16> chunks;
 
   std::unique_lock lock{m_mutex};
-  while (m_active) {
+  auto timeoutTime = std::chrono::steady_clock::now() + periodTime;
+  bool active = true;
+  while (active) {
     bool doFlush = false;
-    auto timeoutTime = std::chrono::steady_clock::now() + periodTime;
-    if (m_cond.wait_until(lock, timeoutTime) == std::cv_status::timeout) {
+    if (!m_active) {
+      // do a final flush before exiting
+      active = false;
       doFlush = true;
+    } else if (m_cond.wait_until(lock, timeoutTime) ==
+               std::cv_status::timeout) {
+      doFlush = true;
+      timeoutTime = std::chrono::steady_clock::now() + periodTime;
     }
 
+    // merge per-thread buffers; this is also done when a thread buffer
+    // passes half full, so it happens more often than flushes
+    DrainThreadBuffers();
+    EnforceBufferLimit();
+
     if (!m_newFilename.empty()) {
       auto newFilename = std::move(m_newFilename);
       m_newFilename.clear();
@@ -322,44 +589,103 @@ void DataLog::WriterThreadMain(std::string_view dir) {
                  newFilename);
       }
       filename = std::move(newFilename);
+      SyncDirectory(dirPath);
       lock.lock();
     }
 
     if (doFlush || m_doFlush) {
       // flush to file
       m_doFlush = false;
-      if (m_outgoing.empty()) {
+
+      // sync to storage at most once per sync period (and always at exit)
+      double syncPeriod = m_syncPeriod;
+      bool doSync = !active || (syncPeriod >= 0 &&
+                                (wpi::Now() - lastSync) >=
+                                    static_cast<uint64_t>(syncPeriod * 1e6));
+
+      if (m_outgoing.empty() && !(unsynced && doSync)) {
         continue;
       }
       // swap outgoing with empty vector
       toWrite.swap(m_outgoing);
+      size_t pending = UpdatePendingStats(toWrite);
+      size_t size = pending;
+      m_writingBytes = pending;
 
       if (f != fs::kInvalidFile) {
         lock.unlock();
-        // write buffers to file
-        for (auto&& buf : toWrite) {
-          WriteToFile(f, buf.GetData(), filename, m_msglog);
+        // write buffers to file in a single batch
+        auto block = m_compressible && m_compress
+                         ? CompressBlock(toWrite, &raw, &compressed)
+                         : wpi::span<const uint8_t>{};
+        chunks.clear();
+        if (!block.empty()) {
+          chunks.emplace_back(block);
+          size = block.size();
+        } else {
+          for (auto&& buf : toWrite) {
+            chunks.emplace_back(buf.GetData());
+          }
         }
 
-        // sync to storage
-#if defined(__linux__)
-        ::fdatasync(f);
-#elif defined(__APPLE__)
-        ::fsync(f);
-#endif
+        // preallocate well ahead of the data
+        size_t preallocate = m_preallocate;
+        if (preallocate > 0 && !preallocFailed &&
+            (fileSize + size) > allocated) {
+          uint64_t end = fileSize + size + preallocate;
+          if (PreallocateFile(f, fileSize, end - fileSize)) {
+            allocated = end;
+          } else {
+            preallocFailed = true;
+            WPI_WARNING(m_msglog, "{}",
+                        "File preallocation not supported, disabling");
+          }
+        }
+
+        size_t written = 0;
+        uint64_t writeTime = 0;
+        if (!chunks.empty()) {
+          uint64_t start = wpi::Now();
+          written = WriteToFile(f, chunks, filename, m_msglog);
+          writeTime = wpi::Now() - start;
+          fileSize += written;
+          unsynced = true;
+        }
+
+        uint64_t syncTime = 0;
+        if (doSync && unsynced) {
+          uint64_t start = wpi::Now();
+          SyncFile(f);
+          lastSync = wpi::Now();
+          syncTime = lastSync - start;
+          unsynced = false;
+        } else {
+          doSync = false;
+        }
         lock.lock();
+
+        if (!chunks.empty()) {
+          UpdateWriteStats(written, writeTime);
+        }
+        if (doSync) {
+          UpdateSyncStats(syncTime);
+        }
       }
 
       // release buffers back to free list
+      m_bufferedBytes -= pending;
+      m_writingBytes = 0;
       for (auto&& buf : toWrite) {
-        buf.Clear();
-        m_free.emplace_back(std::move(buf));
+        ReleaseBuffer(std::move(buf));
       }
       toWrite.resize(0);
     }
   }
 
   if (f != fs::kInvalidFile) {
+    if (allocated > fileSize) {
+      ReleasePreallocation(f, fileSize);
+    }
     fs::CloseFile(f);
   }
 }
@@ -368,29 +694,33 @@ void DataLog::WriterThreadMain(
     std::function<void(wpi::span<const uint8_t> data)> write) {
   std::chrono::duration<double> periodTime{m_period};
 
-  // write header (version 1.0)
-  {
-    const uint8_t header[] = {'W', 'P', 'I', 'L', 'O', 'G', 0, 1};
-    write(header);
-    uint8_t extraLen[4];
-    support::endian::write32le(extraLen, m_extraHeader.size());
-    write(extraLen);
-    if (m_extraHeader.size() > 0) {
-      write({reinterpret_cast<const uint8_t*>(m_extraHeader.data()),
-             m_extraHeader.size()});
-    }
-  }
+  // write header
+  write(MakeHeader(m_extraHeader, m_compressible));
 
   std::vector<Buffer> toWrite;
+  std::vector<uint8_t> raw;
+  std::vector<uint8_t> compressed;
 
   std::unique_lock lock{m_mutex};
-  while (m_active) {
+  auto timeoutTime = std::chrono::steady_clock::now() + periodTime;
+  bool active = true;
+  while (active) {
     bool doFlush = false;
-    auto timeoutTime = std::chrono::steady_clock::now() + periodTime;
-    if (m_cond.wait_until(lock, timeoutTime) == std::cv_status::timeout) {
+    if (!m_active) {
+      // do a final flush before exiting
+      active = false;
       doFlush = true;
+    } else if (m_cond.wait_until(lock, timeoutTime) ==
+               std::cv_status::timeout) {
+      doFlush = true;
+      timeoutTime = std::chrono::steady_clock::now() + periodTime;
     }
 
+    // merge per-thread buffers; this is also done when a thread buffer
+    // passes half full, so it happens more often than flushes
+    DrainThreadBuffers();
+    EnforceBufferLimit();
+
     if (doFlush || m_doFlush) {
       // flush to file
       m_doFlush = false;
@@ -400,19 +730,35 @@ void DataLog::WriterThreadMain(
       // swap outgoing with empty vector
       toWrite.swap(m_outgoing);
 
+      size_t pending = UpdatePendingStats(toWrite);
+      size_t size = pending;
+      m_writingBytes = pending;
+
       lock.unlock();
       // write buffers
-      for (auto&& buf : toWrite) {
-        if (!buf.GetData().empty()) {
-          write(buf.GetData());
+      uint64_t start = wpi::Now();
+      auto block = m_compressible && m_compress
+                       ? CompressBlock(toWrite, &raw, &compressed)
+                       : wpi::span<const uint8_t>{};
+      if (!block.empty()) {
+        write(block);
+        size = block.size();
+      } else {
+        for (auto&& buf : toWrite) {
+          if (!buf.GetData().empty()) {
+            write(buf.GetData());
+          }
         }
       }
+      uint64_t writeTime = wpi::Now() - start;
       lock.lock();
+      UpdateWriteStats(size, writeTime);
 
       // release buffers back to free list
+      m_bufferedBytes -= pending;
+      m_writingBytes = 0;
       for (auto&& buf : toWrite) {
-        buf.Clear();
-        m_free.emplace_back(std::move(buf));
+        ReleaseBuffer(std::move(buf));
       }
       toWrite.resize(0);
     }
@@ -421,6 +767,46 @@ void DataLog::WriterThreadMain(
   write({});  // indicate EOF
 }
 
+// Compressed block records are control records containing:
+// 1-byte type
+// 4-byte uncompressed size
+// LZ4 block compressed sequence of records
+
+wpi::span<const uint8_t> DataLog::CompressBlock(
+    wpi::span<const Buffer> bufs, std::vector<uint8_t>* raw,
+    std::vector<uint8_t>* out) {
+  wpi::span<const uint8_t> data;
+  if (bufs.size() == 1) {
+    data = bufs[0].GetData();
+  } else {
+    raw->clear();
+    for (auto&& buf : bufs) {
+      raw->insert(raw->end(), buf.GetData().begin(), buf.GetData().end());
+    }
+    data = *raw;
+  }
+  if (data.empty()) {
+    return {};
+  }
+
+  // leave room at the front for the record header and control data
+  out->resize(kRecordMaxHeaderSize + 5);
+  wpi::LZ4Compress(data, out);
+  size_t payloadSize = out->size() - kRecordMaxHeaderSize;
+  if (payloadSize >= data.size()) {
+    return {};
+  }
+  uint8_t* buf = out->data() + kRecordMaxHeaderSize;
+  buf[0] = impl::kControlCompressedBlock;
+  wpi::support::endian::write32le(buf + 1, data.size());
+
+  uint8_t header[kRecordMaxHeaderSize];
+  auto headerLen = WriteRecordHeader(header, 0, 0, payloadSize);
+  size_t start = kRecordMaxHeaderSize - headerLen;
+  std::memcpy(out->data() + start, header, headerLen);
+  return {out->data() + start, out->size() - start};
+}
+
 // Control records use the following format:
 // 1-byte type
 // 4-byte entry
@@ -470,6 +856,9 @@ void DataLog::Finish(int entry, int64_t timestamp) {
     return;
   }
   m_entryCounts.erase(entry);
+  m_decimateCounts.erase(entry);
+  // data records for this entry must precede the finish record
+  DrainThreadBuffers();
   uint8_t* buf = StartRecord(0, timestamp, 5, 5);
   *buf++ = impl::kControlFinish;
   wpi::support::endian::write32le(buf, entry);
@@ -481,7 +870,8 @@ void DataLog::SetMetadata(int entry, std::string_view metadata,
     return;
   }
   std::scoped_lock lock{m_mutex};
-  uint8_t* buf = StartRecord(entry, timestamp, 5 + 4 + metadata.size(), 5);
+  DrainThreadBuffers();
+  uint8_t* buf = StartRecord(0, timestamp, 5 + 4 + metadata.size(), 5);
   *buf++ = impl::kControlSetMetadata;
   wpi::support::endian::write32le(buf, entry);
   AppendStringImpl(metadata);
@@ -497,14 +887,18 @@ uint8_t* DataLog::Reserve(size_t size) {
       m_free.pop_back();
     }
   }
+  m_bufferedBytes += size;
   return m_outgoing.back().Reserve(size);
 }
 
 uint8_t* DataLog::StartRecord(uint32_t entry, uint64_t timestamp,
                               uint32_t payloadSize, size_t reserveSize) {
+  // m_outgoing ends on a record boundary here
+  EnforceBufferLimit();
   uint8_t* buf = Reserve(kRecordMaxHeaderSize + reserveSize);
   auto headerLen = WriteRecordHeader(buf, entry, timestamp, payloadSize);
   m_outgoing.back().Unreserve(kRecordMaxHeaderSize - headerLen);
+  m_bufferedBytes -= kRecordMaxHeaderSize - headerLen;
   buf += headerLen;
   return buf;
 }
@@ -525,95 +919,290 @@ void DataLog::AppendStringImpl(std::string_view str) {
   AppendImpl({reinterpret_cast<const uint8_t*>(str.data()), str.size()});
 }
 
-void DataLog::AppendRaw(int entry, wpi::span<const uint8_t> data,
-                        int64_t timestamp) {
-  if (entry <= 0) {
+void DataLog::DrainThreadBuffer(ThreadBuffer& buf) {
+  buf.Drain([&](auto data) { AppendImpl(data); });
+}
+
+void DataLog::EnforceBufferLimit() {
+  size_t limit = m_bufferLimit;
+  if (limit == 0 || m_bufferPolicy != BufferPolicy::kDropOldest) {
     return;
   }
-  std::scoped_lock lock{m_mutex};
-  if (m_paused) {
+  // only m_outgoing can be dropped from; bytes the writer holds are excluded
+  // so a stalled write doesn't make every record a candidate for dropping.
+  // Drop down to 3/4 of the limit so this doesn't happen on every record.
+  size_t buffered = m_bufferedBytes - m_writingBytes;
+  if (buffered > limit) {
+    DropOldest(buffered - limit / 4 * 3);
+  }
+}
+
+// Discards the oldest data records in m_outgoing until at least size bytes
+// have been freed.  Control records are kept, and the remaining records are
+// moved down in place, so no additional memory is needed.  m_outgoing always
+// starts and (when this is called) ends on a record boundary, but records
+// may span buffers, and buffers may not be full.
+void DataLog::DropOldest(size_t size) {
+  struct Pos {
+    size_t buf = 0;
+    size_t off = 0;
+  };
+  auto advance = [&](Pos& pos, size_t n) {
+    pos.off += n;
+    while (pos.buf < m_outgoing.size() &&
+           pos.off >= m_outgoing[pos.buf].GetData().size()) {
+      pos.off -= m_outgoing[pos.buf].GetData().size();
+      ++pos.buf;
+    }
+  };
+  auto read = [&](Pos pos, uint8_t* out, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+      if (pos.buf >= m_outgoing.size()) {
+        return false;
+      }
+      out[i] = m_outgoing[pos.buf].GetData()[pos.off];
+      advance(pos, 1);
+    }
+    return true;
+  };
+  // dst is never past src, so this only ever moves data towards the front
+  auto move = [&](Pos& dst, Pos& src, size_t n) {
+    while (n > 0 && src.buf < m_outgoing.size()) {
+      auto to = m_outgoing[dst.buf].GetData().subspan(dst.off);
+      auto from = m_outgoing[src.buf].GetData().subspan(src.off);
+      size_t len = (std::min)({n, to.size(), from.size()});
+      if (to.data() != from.data()) {
+        std::memmove(to.data(), from.data(), len);
+      }
+      advance(dst, len);
+      advance(src, len);
+      n -= len;
+    }
+  };
+
+  Pos src;
+  Pos dst;
+  advance(src, 0);
+  advance(dst, 0);
+  size_t freed = 0;
+  uint64_t dropped = 0;
+  while (freed < size && src.buf < m_outgoing.size()) {
+    uint8_t header[kRecordMaxHeaderSize];
+    if (!read(src, header, 1)) {
+      break;
+    }
+    unsigned int entryLen = (header[0] & 0x3) + 1;
+    unsigned int sizeLen = ((header[0] >> 2) & 0x3) + 1;
+    unsigned int timestampLen = ((header[0] >> 4) & 0x7) + 1;
+    size_t headerLen = 1 + entryLen + sizeLen + timestampLen;
+    if (!read(src, header, headerLen)) {
+      break;
+    }
+    uint32_t entry = 0;
+    for (unsigned int i = 0; i < entryLen; ++i) {
+      entry |= static_cast<uint32_t>(header[1 + i]) << (i * 8);
+    }
+    uint32_t payloadSize = 0;
+    for (unsigned int i = 0; i < sizeLen; ++i) {
+      payloadSize |= static_cast<uint32_t>(header[1 + entryLen + i])
+                     << (i * 8);
+    }
+    size_t len = headerLen + payloadSize;
+    if (entry == 0) {
+      move(dst, src, len);
+    } else {
+      advance(src, len);
+      freed += len;
+      ++dropped;
+    }
+  }
+  if (freed == 0) {
     return;
   }
-  StartRecord(entry, timestamp, data.size(), 0);
-  AppendImpl(data);
+  move(dst, src, SIZE_MAX);
+
+  // trim the buffers to the remaining data
+  size_t keep = dst.buf;
+  if (dst.buf < m_outgoing.size() && dst.off > 0) {
+    auto& buf = m_outgoing[dst.buf];
+    buf.Unreserve(buf.GetData().size() - dst.off);
+    ++keep;
+  }
+  for (size_t i = keep; i < m_outgoing.size(); ++i) {
+    ReleaseBuffer(std::move(m_outgoing[i]));
+  }
+  m_outgoing.resize(keep);
+
+  m_bufferedBytes -= freed;
+  m_droppedRecords += dropped;
+  m_droppedBytes += freed;
 }
 
-void DataLog::AppendRaw2(int entry,
-                         wpi::span<const wpi::span<const uint8_t>> data,
-                         int64_t timestamp) {
-  if (entry <= 0) {
+void DataLog::ReleaseBuffer(Buffer&& buf) {
+  // only keep as many free buffers as fit within the limit
+  size_t limit = m_bufferLimit;
+  if (limit != 0 &&
+      (m_bufferedBytes + (m_free.size() + 1) * kBlockSize) > limit) {
     return;
   }
-  std::scoped_lock lock{m_mutex};
-  if (m_paused) {
+  buf.Clear();
+  m_free.emplace_back(std::move(buf));
+}
+
+void DataLog::DrainThreadBuffers() {
+  auto it = m_threadBuffers.begin();
+  while (it != m_threadBuffers.end()) {
+    // check before draining so we don't miss a final write
+    bool abandoned = (*it)->IsAbandoned();
+    DrainThreadBuffer(**it);
+    if (abandoned) {
+      it = m_threadBuffers.erase(it);
+    } else {
+      ++it;
+    }
+  }
+}
+
+DataLog::ThreadBuffer* DataLog::GetThreadBuffer(bool create) {
+  struct ThreadCache {
+    ~ThreadCache() {
+      for (auto&& buf : buffers) {
+        buf.second->Abandon();
+      }
+    }
+    std::vector<std::pair<uint64_t, std::shared_ptr<ThreadBuffer>>> buffers;
+  };
+  thread_local ThreadCache cache;
+
+  for (auto&& buf : cache.buffers) {
+    if (buf.first == m_instance) {
+      return buf.second.get();
+    }
+  }
+  if (!create) {
+    return nullptr;
+  }
+
+  // forget buffers of logs that have been destroyed
+  cache.buffers.erase(
+      std::remove_if(cache.buffers.begin(), cache.buffers.end(),
+                     [](auto&& buf) { return buf.second->IsClosed(); }),
+      cache.buffers.end());
+
+  auto buf = std::make_shared<ThreadBuffer>();
+  {
+    std::scoped_lock lock{m_mutex};
+    m_threadBuffers.emplace_back(buf);
+  }
+  cache.buffers.emplace_back(m_instance, buf);
+  return buf.get();
+}
+
+bool DataLog::DropRecord(int entry, size_t size) {
+  size_t limit = m_bufferLimit;
+  if (limit == 0) {
+    return false;
+  }
+  size_t buffered = m_bufferedBytes;
+  bool drop = false;
+  switch (m_bufferPolicy) {
+    case BufferPolicy::kDropOldest:
+      break;
+    case BufferPolicy::kDropNewest:
+      drop = buffered >= limit;
+      break;
+    case BufferPolicy::kDecimate:
+      if (buffered >= limit) {
+        drop = true;
+      } else if (buffered >= limit / 2) {
+        std::scoped_lock lock{m_mutex};
+        drop = (m_decimateCounts[entry]++ % m_decimation) != 0;
+      }
+      break;
+  }
+  if (drop) {
+    ++m_droppedRecords;
+    m_droppedBytes += size;
+  }
+  return drop;
+}
+
+void DataLog::AppendRecord(int entry, int64_t timestamp,
+                           wpi::span<const wpi::span<const uint8_t>> data) {
+  if (entry <= 0 || m_paused) {
     return;
   }
   size_t size = 0;
   for (auto&& chunk : data) {
     size += chunk.size();
   }
-  StartRecord(entry, timestamp, size, 0);
+  if (DropRecord(entry, size)) {
+    return;
+  }
+  uint8_t header[kRecordMaxHeaderSize];
+  auto headerLen = WriteRecordHeader(header, entry, timestamp, size);
+
+  ThreadBuffer* tbuf = GetThreadBuffer(true);
+  bool wake = false;
+  if (tbuf->Write({header, headerLen}, data, &wake)) {
+    if (wake) {
+      m_cond.notify_all();
+    }
+    return;
+  }
+
+  // doesn't fit; write through the shared buffers, preserving thread order
+  std::scoped_lock lock{m_mutex};
+  DrainThreadBuffer(*tbuf);
+  EnforceBufferLimit();
+  AppendImpl({header, headerLen});
   for (auto chunk : data) {
     AppendImpl(chunk);
   }
 }
 
+void DataLog::AppendRaw(int entry, wpi::span<const uint8_t> data,
+                        int64_t timestamp) {
+  AppendRecord(entry, timestamp, {&data, 1});
+}
+
+void DataLog::AppendRaw2(int entry,
+                         wpi::span<const wpi::span<const uint8_t>> data,
+                         int64_t timestamp) {
+  AppendRecord(entry, timestamp, data);
+}
+
 void DataLog::AppendBoolean(int entry, bool value, int64_t timestamp) {
-  if (entry <= 0) {
-    return;
-  }
-  std::scoped_lock lock{m_mutex};
-  if (m_paused) {
-    return;
-  }
-  uint8_t* buf = StartRecord(entry, timestamp, 1, 1);
-  buf[0] = value ? 1 : 0;
+  uint8_t buf[1] = {static_cast<uint8_t>(value ? 1 : 0)};
+  AppendRaw(entry, buf, timestamp);
 }
 
 void DataLog::AppendInteger(int entry, int64_t value, int64_t timestamp) {
-  if (entry <= 0) {
-    return;
-  }
-  std::scoped_lock lock{m_mutex};
-  if (m_paused) {
-    return;
-  }
-  uint8_t* buf = StartRecord(entry, timestamp, 8, 8);
+  uint8_t buf[8];
   wpi::support::endian::write64le(buf, value);
+  AppendRaw(entry, buf, timestamp);
 }
 
 void DataLog::AppendFloat(int entry, float value, int64_t timestamp) {
-  if (entry <= 0) {
-    return;
-  }
-  std::scoped_lock lock{m_mutex};
-  if (m_paused) {
-    return;
-  }
-  uint8_t* buf = StartRecord(entry, timestamp, 4, 4);
+  uint8_t buf[4];
   if constexpr (wpi::support::endian::system_endianness() ==
                 wpi::support::little) {
     std::memcpy(buf, &value, 4);
   } else {
     wpi::support::endian::write32le(buf, wpi::FloatToBits(value));
   }
+  AppendRaw(entry, buf, timestamp);
 }
 
 void DataLog::AppendDouble(int entry, double value, int64_t timestamp) {
-  if (entry <= 0) {
-    return;
-  }
-  std::scoped_lock lock{m_mutex};
-  if (m_paused) {
-    return;
-  }
-  uint8_t* buf = StartRecord(entry, timestamp, 8, 8);
+  uint8_t buf[8];
   if constexpr (wpi::support::endian::system_endianness() ==
                 wpi::support::little) {
     std::memcpy(buf, &value, 8);
   } else {
     wpi::support::endian::write64le(buf, wpi::DoubleToBits(value));
   }
+  AppendRaw(entry, buf, timestamp);
 }
 
 void DataLog::AppendString(int entry, std::string_view value,
@@ -625,12 +1214,13 @@ void DataLog::AppendString(int entry, std::string_view value,
 
 void DataLog::AppendBooleanArray(int entry, wpi::span<const bool> arr,
                                  int64_t timestamp) {
-  if (entry <= 0) {
+  if (entry <= 0 || m_paused || DropRecord(entry, arr.size())) {
     return;
   }
+  ThreadBuffer* tbuf = GetThreadBuffer(false);
   std::scoped_lock lock{m_mutex};
-  if (m_paused) {
-    return;
+  if (tbuf) {
+    DrainThreadBuffer(*tbuf);
   }
   StartRecord(entry, timestamp, arr.size(), 0);
   uint8_t* buf;
@@ -649,12 +1239,13 @@ void DataLog::AppendBooleanArray(int entry, wpi::span<const bool> arr,
 
 void DataLog::AppendBooleanArray(int entry, wpi::span<const int> arr,
                                  int64_t timestamp) {
-  if (entry <= 0) {
+  if (entry <= 0 || m_paused || DropRecord(entry, arr.size())) {
     return;
   }
+  ThreadBuffer* tbuf = GetThreadBuffer(false);
   std::scoped_lock lock{m_mutex};
-  if (m_paused) {
-    return;
+  if (tbuf) {
+    DrainThreadBuffer(*tbuf);
   }
   StartRecord(entry, timestamp, arr.size(), 0);
   uint8_t* buf;
@@ -684,12 +1275,13 @@ void DataLog::AppendIntegerArray(int entry, wpi::span<const int64_t> arr,
               {reinterpret_cast<const uint8_t*>(arr.data()), arr.size() * 8},
               timestamp);
   } else {
-    if (entry <= 0) {
+    if (entry <= 0 || m_paused || DropRecord(entry, arr.size() * 8)) {
       return;
     }
+    ThreadBuffer* tbuf = GetThreadBuffer(false);
     std::scoped_lock lock{m_mutex};
-    if (m_paused) {
-      return;
+    if (tbuf) {
+      DrainThreadBuffer(*tbuf);
     }
     StartRecord(entry, timestamp, arr.size() * 8, 0);
     uint8_t* buf;
@@ -717,12 +1309,13 @@ void DataLog::AppendFloatArray(int entry, wpi::span<const float> arr,
               {reinterpret_cast<const uint8_t*>(arr.data()), arr.size() * 4},
               timestamp);
   } else {
-    if (entry <= 0) {
+    if (entry <= 0 || m_paused || DropRecord(entry, arr.size() * 4)) {
       return;
     }
+    ThreadBuffer* tbuf = GetThreadBuffer(false);
     std::scoped_lock lock{m_mutex};
-    if (m_paused) {
-      return;
+    if (tbuf) {
+      DrainThreadBuffer(*tbuf);
     }
     StartRecord(entry, timestamp, arr.size() * 4, 0);
     uint8_t* buf;
@@ -750,12 +1343,13 @@ void DataLog::AppendDoubleArray(int entry, wpi::span<const double> arr,
               {reinterpret_cast<const uint8_t*>(arr.data()), arr.size() * 8},
               timestamp);
   } else {
-    if (entry <= 0) {
+    if (entry <= 0 || m_paused || DropRecord(entry, arr.size() * 8)) {
       return;
     }
+    ThreadBuffer* tbuf = GetThreadBuffer(false);
     std::scoped_lock lock{m_mutex};
-    if (m_paused) {
-      return;
+    if (tbuf) {
+      DrainThreadBuffer(*tbuf);
     }
     StartRecord(entry, timestamp, arr.size() * 8, 0);
     uint8_t* buf;
@@ -777,7 +1371,7 @@ void DataLog::AppendDoubleArray(int entry, wpi::span<const double> arr,
 
 void DataLog::AppendStringArray(int entry, wpi::span<const std::string> arr,
                                 int64_t timestamp) {
-  if (entry <= 0) {
+  if (entry <= 0 || m_paused) {
     return;
   }
   // storage: 4-byte array length, each string prefixed by 4-byte length
@@ -786,10 +1380,14 @@ void DataLog::AppendStringArray(int entry, wpi::span<const std::string> arr,
   for (auto&& str : arr) {
     size += 4 + str.size();
   }
-  std::scoped_lock lock{m_mutex};
-  if (m_paused) {
+  if (DropRecord(entry, size)) {
     return;
   }
+  ThreadBuffer* tbuf = GetThreadBuffer(false);
+  std::scoped_lock lock{m_mutex};
+  if (tbuf) {
+    DrainThreadBuffer(*tbuf);
+  }
   uint8_t* buf = StartRecord(entry, timestamp, size, 4);
   wpi::support::endian::write32le(buf, arr.size());
   for (auto&& str : arr) {
@@ -800,7 +1398,7 @@ void DataLog::AppendStringArray(int entry, wpi::span<const std::string> arr,
 void DataLog::AppendStringArray(int entry,
                                 wpi::span<const std::string_view> arr,
                                 int64_t timestamp) {
-  if (entry <= 0) {
+  if (entry <= 0 || m_paused) {
     return;
   }
   // storage: 4-byte array length, each string prefixed by 4-byte length
@@ -809,13 +1407,151 @@ void DataLog::AppendStringArray(int entry,
   for (auto&& str : arr) {
     size += 4 + str.size();
   }
-  std::scoped_lock lock{m_mutex};
-  if (m_paused) {
+  if (DropRecord(entry, size)) {
     return;
   }
+  ThreadBuffer* tbuf = GetThreadBuffer(false);
+  std::scoped_lock lock{m_mutex};
+  if (tbuf) {
+    DrainThreadBuffer(*tbuf);
+  }
   uint8_t* buf = StartRecord(entry, timestamp, size, 4);
   wpi::support::endian::write32le(buf, arr.size());
   for (auto sv : arr) {
     AppendStringImpl(sv);
   }
 }
+
+void impl::PackedSeriesEncoder::WriteBits(uint64_t value, unsigned int nbits) {
+  // bits are packed MSB first
+  while (nbits > 0) {
+    if (m_freeBits == 0) {
+      m_buf.push_back(0);
+      m_freeBits = 8;
+    }
+    unsigned int n = (std::min)(nbits, m_freeBits);
+    uint8_t bits = (value >> (nbits - n)) & ((1u << n) - 1);
+    m_buf.back() |= bits << (m_freeBits - n);
+    m_freeBits -= n;
+    nbits -= n;
+  }
+}
+
+void impl::PackedSeriesEncoder::WriteDelta(int64_t value) {
+  // variable-length prefix code: 0, 10, 110, 1110, 11110, 11111
+  uint64_t bits = static_cast<uint64_t>(value);
+  if (value == 0) {
+    WriteBits(0, 1);
+  } else if (value >= -(1 << 6) && value < (1 << 6)) {
+    WriteBits(0b10, 2);
+    WriteBits(bits & 0x7f, 7);
+  } else if (value >= -(1 << 8) && value < (1 << 8)) {
+    WriteBits(0b110, 3);
+    WriteBits(bits & 0x1ff, 9);
+  } else if (value >= -(1 << 11) && value < (1 << 11)) {
+    WriteBits(0b1110, 4);
+    WriteBits(bits & 0xfff, 12);
+  } else if (value >= -(1 << 19) && value < (1 << 19)) {
+    WriteBits(0b11110, 5);
+    WriteBits(bits & 0xfffff, 20);
+  } else {
+    WriteBits(0b11111, 5);
+    WriteBits(bits, 64);
+  }
+}
+
+void impl::PackedSeriesEncoder::Add(int64_t timestamp, uint64_t value) {
+  // storage: 4-byte count, 8-byte first value, then bit-packed deltas
+  if (m_count == 0) {
+    m_buf.assign(12, 0);
+    wpi::support::endian::write64le(&m_buf[4], value);
+    m_freeBits = 0;
+    m_leading = 64;  // no previous XOR window
+    m_trailing = 0;
+    m_firstTimestamp = timestamp;
+    m_prevTimestamp = timestamp;
+    m_prevDelta = 0;
+    m_prevValue = value;
+    m_prevValueDelta = 0;
+    m_count = 1;
+    return;
+  }
+
+  // unsigned arithmetic so wraparound is well defined
+  int64_t delta = static_cast<int64_t>(static_cast<uint64_t>(timestamp) -
+                                       static_cast<uint64_t>(m_prevTimestamp));
+  WriteDelta(static_cast<int64_t>(static_cast<uint64_t>(delta) -
+                                  static_cast<uint64_t>(m_prevDelta)));
+  m_prevTimestamp = timestamp;
+  m_prevDelta = delta;
+
+  if (m_xor) {
+    uint64_t x = value ^ m_prevValue;
+    if (x == 0) {
+      WriteBits(0, 1);
+    } else {
+      unsigned int leading = wpi::countLeadingZeros(x);
+      unsigned int trailing = wpi::countTrailingZeros(x);
+      if (leading >= m_leading && trailing >= m_trailing) {
+        // fits in previous window
+        WriteBits(0b10, 2);
+        WriteBits(x >> m_trailing, 64 - m_leading - m_trailing);
+      } else {
+        unsigned int len = 64 - leading - trailing;
+        WriteBits(0b11, 2);
+        WriteBits(leading, 6);
+        WriteBits(len - 1, 6);
+        WriteBits(x >> trailing, len);
+        m_leading = leading;
+        m_trailing = trailing;
+      }
+    }
+  } else {
+    int64_t vdelta = static_cast<int64_t>(value - m_prevValue);
+    WriteDelta(static_cast<int64_t>(static_cast<uint64_t>(vdelta) -
+                                    static_cast<uint64_t>(m_prevValueDelta)));
+    m_prevValueDelta = vdelta;
+  }
+  m_prevValue = value;
+  ++m_count;
+}
+
+wpi::span<const uint8_t> impl::PackedSeriesEncoder::GetData() {
+  if (m_count == 0) {
+    return {};
+  }
+  wpi::support::endian::write32le(m_buf.data(), m_count);
+  return m_buf;
+}
+
+void PackedDoubleLogEntry::Append(double value, int64_t timestamp) {
+  m_encoder.Add(timestamp == 0 ? wpi::Now() : timestamp,
+                wpi::DoubleToBits(value));
+  if (m_encoder.GetCount() >= kMaxValues) {
+    Flush();
+  }
+}
+
+void PackedDoubleLogEntry::Flush() {
+  if (m_log && m_encoder.GetCount() > 0) {
+    m_log->AppendRaw(m_entry, m_encoder.GetData(),
+                     m_encoder.GetFirstTimestamp());
+  }
+  m_encoder.Clear();
+}
+
+void PackedIntegerLogEntry::Append(int64_t value, int64_t timestamp) {
+  m_encoder.Add(timestamp == 0 ? wpi::Now() : timestamp,
+                static_cast<uint64_t>(value));
+  if (m_encoder.GetCount() >= kMaxValues) {
+    Flush();
+  }
+}
+
+void PackedIntegerLogEntry::Flush() {
+  if (m_log && m_encoder.GetCount() > 0) {
+    m_log->AppendRaw(m_entry, m_encoder.GetData(),
+                     m_encoder.GetFirstTimestamp());
+  }
+  m_encoder.Clear();
+}
@@ -4,12 +4,44 @@
 
 #include "wpi/DataLogReader.h"
 
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+
+#include <windows.h>  // NOLINT(build/include_order)
+
+#else
+#include <poll.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
 #include "wpi/DataLog.h"
+#include "wpi/DenseMap.h"
 #include "wpi/Endian.h"
+#include "wpi/LZ4.h"
+#include "wpi/MappedFileRegion.h"
 #include "wpi/MathExtras.h"
+#include "wpi/fs.h"
+#include "wpi/mutex.h"
+#include "wpi/raw_istream.h"
+#include "wpi/raw_ostream.h"
 
 using namespace wpi::log;
 
+// Major versions 1 (uncompressed) and 2 (compressed blocks) are supported.
+static bool IsSupportedVersion(uint16_t version) {
+  return version >= impl::kFormatVersion &&
+         (version >> 8) <= (impl::kCompressedFormatVersion >> 8);
+}
+
 static bool ReadString(wpi::span<const uint8_t>* buf, std::string_view* str) {
   if (buf->size() < 4) {
     *str = {};
@@ -159,6 +191,162 @@ bool DataLogRecord::GetDoubleArray(std::vector<double>* arr) const {
   return true;
 }
 
+namespace {
+class BitReader {
+ public:
+  explicit BitReader(wpi::span<const uint8_t> data) : m_data{data} {}
+
+  // returns false if data runs out
+  bool Read(unsigned int nbits, uint64_t* value) {
+    if (nbits > ((m_data.size() * 8) - m_pos)) {
+      return false;
+    }
+    uint64_t v = 0;
+    while (nbits > 0) {
+      unsigned int avail = 8 - (m_pos % 8);
+      unsigned int n = (std::min)(nbits, avail);
+      uint8_t byte = m_data[m_pos / 8];
+      v = (v << n) | ((byte >> (avail - n)) & ((1u << n) - 1));
+      m_pos += n;
+      nbits -= n;
+    }
+    *value = v;
+    return true;
+  }
+
+  bool ReadDelta(int64_t* value) {
+    // count prefix 1 bits (up to 5)
+    unsigned int prefix = 0;
+    uint64_t bit;
+    while (prefix < 5) {
+      if (!Read(1, &bit)) {
+        return false;
+      }
+      if (bit == 0) {
+        break;
+      }
+      ++prefix;
+    }
+    static constexpr unsigned int kBits[] = {0, 7, 9, 12, 20, 64};
+    unsigned int nbits = kBits[prefix];
+    if (nbits == 0) {
+      *value = 0;
+      return true;
+    }
+    uint64_t v;
+    if (!Read(nbits, &v)) {
+      return false;
+    }
+    if (nbits < 64 && (v & (uint64_t{1} << (nbits - 1))) != 0) {
+      v |= ~uint64_t{0} << nbits;  // sign extend
+    }
+    *value = static_cast<int64_t>(v);
+    return true;
+  }
+
+ private:
+  wpi::span<const uint8_t> m_data;
+  size_t m_pos = 0;
+};
+}  // namespace
+
+template <typename F>
+static bool DecodePacked(wpi::span<const uint8_t> data, int64_t timestamp,
+                         bool xorValues, F&& func) {
+  if (data.size() < 12) {
+    return false;
+  }
+  uint32_t count = wpi::support::endian::read32le(data.data());
+  uint64_t value = wpi::support::endian::read64le(&data[4]);
+  BitReader reader{data.subspan(12)};
+  // each value after the first takes at least 2 bits
+  if (count == 0 || (count - 1) > (data.size() - 12) * 4) {
+    return false;
+  }
+  func(timestamp, value);
+
+  int64_t delta = 0;
+  int64_t valueDelta = 0;
+  unsigned int leading = 0;
+  unsigned int trailing = 0;
+  bool haveWindow = false;
+  for (uint32_t i = 1; i < count; ++i) {
+    int64_t dod;
+    if (!reader.ReadDelta(&dod)) {
+      return false;
+    }
+    delta = static_cast<int64_t>(static_cast<uint64_t>(delta) +
+                                 static_cast<uint64_t>(dod));
+    timestamp = static_cast<int64_t>(static_cast<uint64_t>(timestamp) +
+                                     static_cast<uint64_t>(delta));
+
+    if (xorValues) {
+      uint64_t control;
+      if (!reader.Read(1, &control)) {
+        return false;
+      }
+      if (control != 0) {
+        if (!reader.Read(1, &control)) {
+          return false;
+        }
+        if (control != 0) {
+          uint64_t lead, len;
+          if (!reader.Read(6, &lead) || !reader.Read(6, &len) ||
+              lead + len + 1 > 64) {
+            return false;
+          }
+          leading = lead;
+          trailing = 64 - lead - len - 1;
+          haveWindow = true;
+        } else if (!haveWindow) {
+          return false;  // no previous window
+        }
+        uint64_t x;
+        if (!reader.Read(64 - leading - trailing, &x)) {
+          return false;
+        }
+        value ^= x << trailing;
+      }
+    } else {
+      int64_t dodValue;
+      if (!reader.ReadDelta(&dodValue)) {
+        return false;
+      }
+      valueDelta = static_cast<int64_t>(static_cast<uint64_t>(valueDelta) +
+                                        static_cast<uint64_t>(dodValue));
+      value += static_cast<uint64_t>(valueDelta);
+    }
+    func(timestamp, value);
+  }
+  return true;
+}
+
+bool DataLogRecord::GetPackedDoubles(
+    std::vector<TimestampedValue<double>>* arr) const {
+  arr->clear();
+  if (!DecodePacked(m_data, m_timestamp, true,
+                    [&](int64_t timestamp, uint64_t value) {
+                      arr->push_back({timestamp, wpi::BitsToDouble(value)});
+                    })) {
+    arr->clear();
+    return false;
+  }
+  return true;
+}
+
+bool DataLogRecord::GetPackedIntegers(
+    std::vector<TimestampedValue<int64_t>>* arr) const {
+  arr->clear();
+  if (!DecodePacked(m_data, m_timestamp, false,
+                    [&](int64_t timestamp, uint64_t value) {
+                      arr->push_back({timestamp, static_cast<int64_t>(value)});
+                    })) {
+    arr->clear();
+    return false;
+  }
+  return true;
+}
+
 bool DataLogRecord::GetStringArray(std::vector<std::string_view>* arr) const {
   arr->clear();
   if (m_data.size() < 4) {
@@ -187,8 +375,178 @@ bool DataLogRecord::GetStringArray(std::vector<std::string_view>* arr) const {
   return true;
 }
 
+static uint64_t ReadVarInt(wpi::span<const uint8_t> buf) {
+  uint64_t val = 0;
+  int shift = 0;
+  for (auto v : buf) {
+    val |= static_cast<uint64_t>(v) << shift;
+    shift += 8;
+  }
+  return val;
+}
+
+static bool ParseRecord(wpi::span<const uint8_t> buf, size_t* pos,
+                        DataLogRecord* out) {
+  if (*pos >= buf.size()) {
+    return false;
+  }
+  buf = buf.subspan(*pos);
+  if (buf.size() < 4) {  // minimum header length
+    return false;
+  }
+  unsigned int entryLen = (buf[0] & 0x3) + 1;
+  unsigned int sizeLen = ((buf[0] >> 2) & 0x3) + 1;
+  unsigned int timestampLen = ((buf[0] >> 4) & 0x7) + 1;
+  unsigned int headerLen = 1 + entryLen + sizeLen + timestampLen;
+  if (buf.size() < headerLen) {
+    return false;
+  }
+  int entry = ReadVarInt(buf.subspan(1, entryLen));
+  uint32_t size = ReadVarInt(buf.subspan(1 + entryLen, sizeLen));
+  if (size > (buf.size() - headerLen)) {
+    return false;
+  }
+  int64_t timestamp =
+      ReadVarInt(buf.subspan(1 + entryLen + sizeLen, timestampLen));
+  *out = DataLogRecord{entry, timestamp, buf.subspan(headerLen, size)};
+  *pos += headerLen + size;
+  return true;
+}
+
+static bool IsCompressedBlock(const DataLogRecord& record) {
+  auto data = record.GetRaw();
+  return record.IsControl() && data.size() >= 5 &&
+         data[0] == impl::kControlCompressedBlock;
+}
+
+// out is left empty if the block is corrupt
+static void DecompressBlock(wpi::span<const uint8_t> data,
+                            std::vector<uint8_t>* out) {
+  size_t size = wpi::support::endian::read32le(&data[1]);
+  out->clear();
+  // LZ4 can't expand more than 255x; don't trust larger sizes
+  if (size / 255 > data.size()) {
+    return;
+  }
+  out->resize(size);
+  auto len = wpi::LZ4Decompress(data.subspan(5), *out);
+  if (!len || *len != size) {
+    out->clear();
+  }
+}
+
+// a new index block is started after this many bytes of records
+static constexpr size_t kIndexBlockSize = 32 * 1024;
+
+struct DataLogReader::Index {
+  struct Block {
+    size_t pos;
+    int64_t minTimestamp;
+    int64_t maxTimestamp;
+    // maximum timestamp of this and all previous blocks
+    int64_t prefixMaxTimestamp;
+  };
+
+  struct Control {
+    // position in the log; for records within a compressed block, this is
+    // the position of the block
+    size_t pos;
+    // position within the decompressed block
+    size_t blockPos;
+    // copy of the record if within a compressed block, otherwise empty
+    std::vector<uint8_t> data;
+  };
+
+  void Clear() {
+    built = false;
+    blocks.clear();
+    controls.clear();
+    entryBlocks.clear();
+  }
+
+  void UpdatePrefixMax() {
+    int64_t prefixMax = INT64_MIN;
+    for (auto&& block : blocks) {
+      prefixMax = (std::max)(prefixMax, block.maxTimestamp);
+      block.prefixMaxTimestamp = prefixMax;
+    }
+  }
+
+  wpi::mutex mutex;
+  bool built = false;
+  std::vector<Block> blocks;
+  // start, finish, and set metadata control records
+  std::vector<Control> controls;
+  // block numbers containing each entry
+  wpi::DenseMap<int, std::vector<uint32_t>> entryBlocks;
+};
+
 DataLogReader::DataLogReader(std::unique_ptr<MemoryBuffer> buffer)
-    : m_buf{std::move(buffer)} {}
+    : m_buf{std::move(buffer)}, m_index{std::make_unique<Index>()} {}
+
+namespace {
+class MappedMemoryBuffer : public wpi::MemoryBuffer {
+ public:
+  MappedMemoryBuffer(wpi::MappedFileRegion&& map, std::string_view name)
+      : m_map{std::move(map)}, m_name{name} {
+    Init(m_map.const_data(), m_map.const_data() + m_map.size());
+  }
+
+  std::string_view GetBufferIdentifier() const override { return m_name; }
+  BufferKind GetBufferKind() const override { return MemoryBuffer_MMap; }
+
+  const wpi::MappedFileRegion& GetMapping() const { return m_map; }
+
+ private:
+  wpi::MappedFileRegion m_map;
+  std::string m_name;
+};
+}  // namespace
+
+DataLogReader::DataLogReader(std::string_view filename, std::error_code& ec)
+    : m_index{std::make_unique<Index>()} {
+  auto size = fs::file_size(fs::path{filename}, ec);
+  if (ec) {
+    return;
+  }
+  fs::file_t f = fs::OpenFileForRead(filename, ec);
+  if (ec) {
+    return;
+  }
+  // can't map an empty file
+  if (size == 0) {
+    m_buf = wpi::MemoryBuffer::GetMemBuffer({}, filename);
+    fs::CloseFile(f);
+    return;
+  }
+  // the mapping keeps the file open
+  wpi::MappedFileRegion map{f, size, 0, wpi::MappedFileRegion::kReadOnly, ec};
+  fs::CloseFile(f);
+  if (ec) {
+    return;
+  }
+  map.Advise(0, size, wpi::MappedFileRegion::kSequential);
+  auto buf = std::make_unique<MappedMemoryBuffer>(std::move(map), filename);
+  m_map = &buf->GetMapping();
+  m_buf = std::move(buf);
+}
+
+DataLogReader::DataLogReader(DataLogReader&&) = default;
+DataLogReader& DataLogReader::operator=(DataLogReader&&) = default;
+DataLogReader::~DataLogReader() = default;
+
+void DataLogReader::AdvanceWindow(size_t start, size_t pos) const {
+  // read the next window ahead, and release the one before the previous one
+  // if the iterator read all of it; iterators started elsewhere (e.g. by
+  // Split()) may still need windows that begin before start
+  size_t window = pos / kWindowSize * kWindowSize;
+  m_map->Advise(window + kWindowSize, kWindowSize,
+                wpi::MappedFileRegion::kWillNeed);
+  if (window >= 2 * kWindowSize && (window - 2 * kWindowSize) >= start) {
+    m_map->Advise(window - 2 * kWindowSize, kWindowSize,
+                  wpi::MappedFileRegion::kDontNeed);
+  }
+}
 
 bool DataLogReader::IsValid() const {
   if (!m_buf) {
@@ -198,7 +556,7 @@ bool DataLogReader::IsValid() const {
   return buf.size() >= 12 &&
          std::string_view{reinterpret_cast<const char*>(buf.data()), 6} ==
              "WPILOG" &&
-         wpi::support::endian::read16le(&buf[6]) >= 0x0100;
+         IsSupportedVersion(wpi::support::endian::read16le(&buf[6]));
 }
 
 uint16_t DataLogReader::GetVersion() const {
@@ -226,62 +584,403 @@ std::string_view DataLogReader::GetExtraHeader() const {
   return rv;
 }
 
-DataLogReader::iterator DataLogReader::begin() const {
+size_t DataLogReader::GetDataStart() const {
   if (!m_buf) {
-    return end();
+    return SIZE_MAX;
   }
   auto buf = m_buf->GetBuffer();
   if (buf.size() < 12) {
-    return end();
+    return SIZE_MAX;
   }
   uint32_t size = wpi::support::endian::read32le(&buf[8]);
   if (buf.size() < (12 + size)) {
-    return end();
+    return SIZE_MAX;
   }
-  return DataLogIterator{this, 12 + size};
+  return 12 + size;
 }
 
-static uint64_t ReadVarInt(wpi::span<const uint8_t> buf) {
-  uint64_t val = 0;
-  int shift = 0;
-  for (auto v : buf) {
-    val |= static_cast<uint64_t>(v) << shift;
-    shift += 8;
+DataLogReader::iterator DataLogReader::begin() const {
+  return DataLogIterator{this, GetDataStart()};
+}
+
+void DataLogReader::BuildIndex() const {
+  GetIndex();
+}
+
+void DataLogReader::BuildIndex(
+    wpi::function_ref<bool(const DataLogRecord& record)> func) const {
+  std::scoped_lock lock{m_index->mutex};
+  if (!m_index->built) {
+    BuildIndexLocked(func);
+    return;
+  }
+  for (auto&& record : *this) {
+    if (!func(record)) {
+      break;
+    }
   }
-  return val;
 }
 
-bool DataLogReader::GetRecord(size_t* pos, DataLogRecord* out) const {
-  if (!m_buf) {
+const DataLogReader::Index& DataLogReader::GetIndex() const {
+  std::scoped_lock lock{m_index->mutex};
+  if (!m_index->built) {
+    BuildIndexLocked([](const DataLogRecord&) { return true; });
+  }
+  return *m_index;
+}
+
+void DataLogReader::BuildIndexLocked(
+    wpi::function_ref<bool(const DataLogRecord& record)> func) const {
+  Index& index = *m_index;
+  index.Clear();
+
+  // adds a record to the current index block; data is the record if it's
+  // within a compressed block
+  auto addRecord = [&](const DataLogRecord& record, size_t pos,
+                       size_t blockPos, wpi::span<const uint8_t> data) {
+    if (!func(record)) {
+      return false;
+    }
+    int64_t timestamp = record.GetTimestamp();
+    auto& block = index.blocks.back();
+    block.minTimestamp = (std::min)(block.minTimestamp, timestamp);
+    block.maxTimestamp = (std::max)(block.maxTimestamp, timestamp);
+    if (record.IsControl()) {
+      if (record.IsStart() || record.IsFinish() || record.IsSetMetadata()) {
+        index.controls.push_back(
+            {pos, blockPos, {data.begin(), data.end()}});
+      }
+    } else {
+      uint32_t blockNum = index.blocks.size() - 1;
+      auto& entryBlocks = index.entryBlocks[record.GetEntry()];
+      if (entryBlocks.empty() || entryBlocks.back() != blockNum) {
+        entryBlocks.push_back(blockNum);
+      }
+    }
+    return true;
+  };
+
+  // index blocks start at top-level records; the contents of compressed
+  // blocks are indexed as part of the index block containing them
+  size_t pos = GetDataStart();
+  DataLogRecord record;
+  std::vector<uint8_t> decompressed;
+  for (;;) {
+    size_t recordPos = pos;
+    if (!GetRecord(&pos, &record)) {
+      break;
+    }
+    if (index.blocks.empty() ||
+        (recordPos - index.blocks.back().pos) >= kIndexBlockSize) {
+      index.blocks.push_back({recordPos, INT64_MAX, INT64_MIN, 0});
+    }
+    if (!IsCompressedBlock(record)) {
+      if (!addRecord(record, recordPos, 0, {})) {
+        index.Clear();
+        return;
+      }
+      continue;
+    }
+    DecompressBlock(record.GetRaw(), &decompressed);
+    size_t blockPos = 0;
+    DataLogRecord inner;
+    for (;;) {
+      size_t innerPos = blockPos;
+      if (!ParseRecord(decompressed, &blockPos, &inner)) {
+        break;
+      }
+      if (!addRecord(inner, recordPos, innerPos,
+                     wpi::span<const uint8_t>{decompressed}.subspan(
+                         innerPos, blockPos - innerPos))) {
+        index.Clear();
+        return;
+      }
+    }
+  }
+  index.UpdatePrefixMax();
+  index.built = true;
+}
+
+// identifies the log an index belongs to; hashes the end of the log, as
+// that's where logs that share a prefix (e.g. one still being written) differ
+static uint64_t HashLogTail(wpi::span<const uint8_t> buf) {
+  uint64_t hash = 14695981039346656037ull;  // FNV-1a
+  size_t len = (std::min)(buf.size(), size_t{4096});
+  for (auto v : buf.subspan(buf.size() - len)) {
+    hash = (hash ^ v) * 1099511628211ull;
+  }
+  return hash;
+}
+
+static constexpr std::string_view kIndexMagic = "WPILOGIX";
+static constexpr uint16_t kIndexVersion = 0x0200;
+
+void DataLogReader::SaveIndex(wpi::raw_ostream& os) const {
+  const Index& index = GetIndex();
+  auto buf = m_buf ? m_buf->GetBuffer() : wpi::span<const uint8_t>{};
+
+  std::vector<uint8_t> out;
+  auto write32 = [&](uint32_t val) {
+    uint8_t b[4];
+    wpi::support::endian::write32le(b, val);
+    out.insert(out.end(), b, b + 4);
+  };
+  auto write64 = [&](uint64_t val) {
+    uint8_t b[8];
+    wpi::support::endian::write64le(b, val);
+    out.insert(out.end(), b, b + 8);
+  };
+
+  // header: magic, version, log size, log hash
+  out.insert(out.end(), kIndexMagic.begin(), kIndexMagic.end());
+  out.push_back(kIndexVersion & 0xff);
+  out.push_back(kIndexVersion >> 8);
+  write64(buf.size());
+  write64(HashLogTail(buf));
+
+  write32(index.blocks.size());
+  for (auto&& block : index.blocks) {
+    write64(block.pos);
+    write64(block.minTimestamp);
+    write64(block.maxTimestamp);
+  }
+  write32(index.controls.size());
+  for (auto&& control : index.controls) {
+    write64(control.pos);
+    write64(control.blockPos);
+    write32(control.data.size());
+    out.insert(out.end(), control.data.begin(), control.data.end());
+  }
+  write32(index.entryBlocks.size());
+  for (auto&& [entry, blocks] : index.entryBlocks) {
+    write32(entry);
+    write32(blocks.size());
+    for (auto blockNum : blocks) {
+      write32(blockNum);
+    }
+  }
+  os << out;
+}
+
+bool DataLogReader::LoadIndex(wpi::span<const uint8_t> data) {
+  if (!m_buf || !m_index) {
     return false;
   }
   auto buf = m_buf->GetBuffer();
-  if (*pos >= buf.size()) {
+
+  // all reads are bounds checked; sets ok to false on failure
+  bool ok = true;
+  auto read32 = [&] {
+    if (data.size() < 4) {
+      ok = false;
+      return uint32_t{0};
+    }
+    uint32_t val = wpi::support::endian::read32le(data.data());
+    data = data.subspan(4);
+    return val;
+  };
+  auto read64 = [&] {
+    if (data.size() < 8) {
+      ok = false;
+      return uint64_t{0};
+    }
+    uint64_t val = wpi::support::endian::read64le(data.data());
+    data = data.subspan(8);
+    return val;
+  };
+
+  if (data.size() < 10 ||
+      std::string_view{reinterpret_cast<const char*>(data.data()), 8} !=
+          kIndexMagic ||
+      wpi::support::endian::read16le(&data[8]) != kIndexVersion) {
     return false;
   }
-  buf = buf.subspan(*pos);
-  if (buf.size() < 4) {  // minimum header length
+  data = data.subspan(10);
+  if (read64() != buf.size() || read64() != HashLogTail(buf) || !ok) {
     return false;
   }
-  unsigned int entryLen = (buf[0] & 0x3) + 1;
-  unsigned int sizeLen = ((buf[0] >> 2) & 0x3) + 1;
-  unsigned int timestampLen = ((buf[0] >> 4) & 0x7) + 1;
-  unsigned int headerLen = 1 + entryLen + sizeLen + timestampLen;
-  if (buf.size() < headerLen) {
+
+  // positions must be record positions within the log, in increasing order
+  size_t dataStart = GetDataStart();
+  if (dataStart == SIZE_MAX) {
     return false;
   }
-  int entry = ReadVarInt(buf.subspan(1, entryLen));
-  uint32_t size = ReadVarInt(buf.subspan(1 + entryLen, sizeLen));
-  if (size > (buf.size() - headerLen)) {
+  auto validPos = [&](size_t pos) {
+    return pos >= dataStart && pos < buf.size();
+  };
+
+  Index index;
+  uint32_t numBlocks = read32();
+  if (!ok || numBlocks > data.size() / 24) {
     return false;
   }
-  int64_t timestamp =
-      ReadVarInt(buf.subspan(1 + entryLen + sizeLen, timestampLen));
-  *out = DataLogRecord{entry, timestamp, buf.subspan(headerLen, size)};
-  *pos += headerLen + size;
+  index.blocks.reserve(numBlocks);
+  for (uint32_t i = 0; i < numBlocks; ++i) {
+    size_t pos = read64();
+    int64_t minTimestamp = read64();
+    int64_t maxTimestamp = read64();
+    if (!validPos(pos) ||
+        (!index.blocks.empty() && pos <= index.blocks.back().pos)) {
+      return false;
+    }
+    index.blocks.push_back({pos, minTimestamp, maxTimestamp, 0});
+  }
+  uint32_t numControl = read32();
+  if (!ok || numControl > data.size() / 20) {
+    return false;
+  }
+  index.controls.reserve(numControl);
+  for (uint32_t i = 0; i < numControl; ++i) {
+    size_t pos = read64();
+    size_t blockPos = read64();
+    uint32_t size = read32();
+    if (!ok || size > data.size() || !validPos(pos)) {
+      return false;
+    }
+    if (!index.controls.empty()) {
+      auto& prev = index.controls.back();
+      if (pos < prev.pos || (pos == prev.pos && blockPos <= prev.blockPos)) {
+        return false;
+      }
+    }
+    index.controls.push_back(
+        {pos, blockPos, {data.begin(), data.begin() + size}});
+    data = data.subspan(size);
+  }
+  uint32_t numEntries = read32();
+  for (uint32_t i = 0; ok && i < numEntries; ++i) {
+    int entry = read32();
+    uint32_t numEntryBlocks = read32();
+    if (!ok || numEntryBlocks > data.size() / 4) {
+      return false;
+    }
+    // the DenseMap empty and tombstone keys can't be inserted
+    if (entry == wpi::DenseMapInfo<int>::getEmptyKey() ||
+        entry == wpi::DenseMapInfo<int>::getTombstoneKey()) {
+      return false;
+    }
+    auto& entryBlocks = index.entryBlocks[entry];
+    if (!entryBlocks.empty()) {
+      return false;  // duplicate entry
+    }
+    entryBlocks.reserve(numEntryBlocks);
+    for (uint32_t j = 0; j < numEntryBlocks; ++j) {
+      uint32_t blockNum = read32();
+      if (blockNum >= numBlocks ||
+          (!entryBlocks.empty() && blockNum <= entryBlocks.back())) {
+        return false;
+      }
+      entryBlocks.push_back(blockNum);
+    }
+  }
+  if (!ok || !data.empty()) {
+    return false;
+  }
+  index.UpdatePrefixMax();
+
+  std::scoped_lock lock{m_index->mutex};
+  m_index->blocks = std::move(index.blocks);
+  m_index->controls = std::move(index.controls);
+  m_index->entryBlocks = std::move(index.entryBlocks);
+  m_index->built = true;
   return true;
 }
 
+std::vector<DataLogReader::iterator> DataLogReader::Split(size_t size) const {
+  const Index& index = GetIndex();
+  std::vector<iterator> ranges;
+  size_t start = 0;
+  for (auto&& block : index.blocks) {
+    if (ranges.empty() || (block.pos - start) >= size) {
+      ranges.emplace_back(this, block.pos);
+      start = block.pos;
+    }
+  }
+  return ranges;
+}
+
+DataLogReader::iterator DataLogReader::SeekToTime(int64_t timestamp) const {
+  const Index& index = GetIndex();
+  // the first block whose prefix max reaches the timestamp contains the record
+  auto it = std::partition_point(
+      index.blocks.begin(), index.blocks.end(), [&](const auto& block) {
+        return block.prefixMaxTimestamp < timestamp;
+      });
+  if (it == index.blocks.end()) {
+    return end();
+  }
+  for (DataLogIterator recordIt{this, it->pos}; recordIt.m_pos != SIZE_MAX;
+       ++recordIt) {
+    if (recordIt->GetTimestamp() >= timestamp) {
+      return recordIt;
+    }
+  }
+  return end();
+}
+
+std::vector<DataLogRecord> DataLogReader::GetControlRecords(
+    const iterator& it) const {
+  const Index& index = GetIndex();
+  std::vector<DataLogRecord> records;
+  for (auto&& control : index.controls) {
+    if (control.pos > it.m_pos ||
+        (control.pos == it.m_pos && control.blockPos >= it.m_blockPos)) {
+      break;
+    }
+    DataLogRecord record;
+    size_t pos = control.data.empty() ? control.pos : 0;
+    if (control.data.empty() ? GetRecord(&pos, &record)
+                             : ParseRecord(control.data, &pos, &record)) {
+      records.emplace_back(record);
+    }
+  }
+  return records;
+}
+
+void DataLogReader::ForEachEntryRecord(
+    int entry, int64_t start, int64_t end,
+    wpi::function_ref<void(const DataLogRecord& record)> func) const {
+  const Index& index = GetIndex();
+  auto entryIt = index.entryBlocks.find(entry);
+  if (entryIt == index.entryBlocks.end()) {
+    return;
+  }
+  auto handleRecord = [&](const DataLogRecord& record) {
+    if (record.GetEntry() == entry && record.GetTimestamp() >= start &&
+        record.GetTimestamp() <= end) {
+      func(record);
+    }
+  };
+  DataLogRecord record;
+  std::vector<uint8_t> decompressed;
+  for (uint32_t blockNum : entryIt->second) {
+    auto& block = index.blocks[blockNum];
+    if (block.maxTimestamp < start || block.minTimestamp > end) {
+      continue;
+    }
+    size_t blockEnd = (blockNum + 1) < index.blocks.size()
+                          ? index.blocks[blockNum + 1].pos
+                          : SIZE_MAX;
+    size_t pos = block.pos;
+    while (pos < blockEnd && GetRecord(&pos, &record)) {
+      if (!IsCompressedBlock(record)) {
+        handleRecord(record);
+        continue;
+      }
+      DecompressBlock(record.GetRaw(), &decompressed);
+      size_t blockPos = 0;
+      DataLogRecord inner;
+      while (ParseRecord(decompressed, &blockPos, &inner)) {
+        handleRecord(inner);
+      }
+    }
+  }
+}
+
+bool DataLogReader::GetRecord(size_t* pos, DataLogRecord* out) const {
+  return m_buf && ParseRecord(m_buf->GetBuffer(), pos, out);
+}
+
 bool DataLogReader::GetNextRecord(size_t* pos) const {
   if (!m_buf) {
     return false;
@@ -305,3 +1004,292 @@ bool DataLogReader::GetNextRecord(size_t* pos) const {
   *pos += headerLen + size;
   return true;
 }
+
+DataLogIterator::DataLogIterator(const DataLogReader* reader, size_t pos)
+    : m_reader{reader}, m_start{pos}, m_pos{pos} {
+  EnterBlock();
+}
+
+void DataLogIterator::EnterBlock() {
+  // skip over corrupt or empty compressed blocks
+  DataLogRecord record;
+  for (;;) {
+    size_t pos = m_pos;
+    if (!m_reader->GetRecord(&pos, &record) || !IsCompressedBlock(record)) {
+      return;
+    }
+    auto block = std::make_shared<std::vector<uint8_t>>();
+    DecompressBlock(record.GetRaw(), block.get());
+    if (!block->empty()) {
+      m_block = std::move(block);
+      m_blockPos = 0;
+      return;
+    }
+    if (!m_reader->GetNextRecord(&m_pos)) {
+      m_pos = SIZE_MAX;
+      return;
+    }
+  }
+}
+
+DataLogIterator& DataLogIterator::operator++() {
+  m_valid = false;
+  if (m_block) {
+    // next record within the block
+    DataLogRecord record;
+    if (ParseRecord(*m_block, &m_blockPos, &record) &&
+        m_blockPos < m_block->size()) {
+      return *this;
+    }
+    m_block.reset();
+    m_blockPos = 0;
+  }
+  size_t prev = m_pos;
+  if (!m_reader->GetNextRecord(&m_pos)) {
+    m_pos = SIZE_MAX;
+    return *this;
+  }
+  if (m_reader->m_map && (m_pos / DataLogReader::kWindowSize) !=
+                             (prev / DataLogReader::kWindowSize)) {
+    m_reader->AdvanceWindow(m_start, m_pos);
+  }
+  EnterBlock();
+  return *this;
+}
+
+DataLogIterator::reference DataLogIterator::operator*() const {
+  if (!m_valid) {
+    size_t pos = m_block ? m_blockPos : m_pos;
+    if (m_block ? ParseRecord(*m_block, &pos, &m_value)
+                : m_reader->GetRecord(&pos, &m_value)) {
+      m_valid = true;
+    }
+  }
+  return m_value;
+}
+
+// maximum number of bytes read from the stream at once
+static constexpr size_t kStreamReadChunkSize = 64 * 1024;
+
+DataLogStreamReader::DataLogStreamReader(wpi::raw_istream& is) : m_is{is} {
+  if (!Read(12) ||
+      std::string_view{reinterpret_cast<const char*>(m_buf.data()), 6} !=
+          "WPILOG") {
+    m_done = true;
+    return;
+  }
+  uint16_t version = wpi::support::endian::read16le(&m_buf[6]);
+  if (!IsSupportedVersion(version)) {
+    m_done = true;
+    return;
+  }
+  uint32_t extraLen = wpi::support::endian::read32le(&m_buf[8]);
+  m_buf.clear();
+  if (extraLen > 0 && !Read(extraLen)) {
+    return;
+  }
+  m_extraHeader.assign(m_buf.begin(), m_buf.end());
+  m_pos = 12 + extraLen;
+  m_version = version;
+}
+
+bool DataLogStreamReader::Read(size_t len) {
+  // the length comes from the stream, so read in bounded chunks rather than
+  // allocating (up to 4 GB) for a corrupt or truncated record up front
+  while (len > 0) {
+    size_t chunk = (std::min)(len, kStreamReadChunkSize);
+    m_is.readinto(m_buf, chunk);
+    if (m_is.has_error()) {
+      m_done = true;
+      m_truncated = !m_buf.empty();
+      return false;
+    }
+    len -= chunk;
+  }
+  return true;
+}
+
+bool DataLogStreamReader::ReadRecord(DataLogRecord* record) {
+  for (;;) {
+    // return records from the current decompressed block first
+    if (m_blockPos < m_block.size()) {
+      if (ParseRecord(m_block, &m_blockPos, record)) {
+        return true;
+      }
+      // corrupt; drop the rest of the block
+      m_blockPos = m_block.size();
+    }
+    if (m_done) {
+      return false;
+    }
+
+    m_buf.clear();
+    if (!Read(1)) {
+      return false;
+    }
+    unsigned int entryLen = (m_buf[0] & 0x3) + 1;
+    unsigned int sizeLen = ((m_buf[0] >> 2) & 0x3) + 1;
+    unsigned int timestampLen = ((m_buf[0] >> 4) & 0x7) + 1;
+    if (!Read(entryLen + sizeLen + timestampLen)) {
+      return false;
+    }
+    uint32_t size = ReadVarInt(
+        wpi::span<const uint8_t>{m_buf}.subspan(1 + entryLen, sizeLen));
+    if (size > 0 && !Read(size)) {
+      return false;
+    }
+    m_pos += m_buf.size();
+    size_t pos = 0;
+    ParseRecord(m_buf, &pos, record);
+
+    if (!IsCompressedBlock(*record)) {
+      return true;
+    }
+    DecompressBlock(record->GetRaw(), &m_block);
+    m_blockPos = 0;
+  }
+}
+
+DataLogFollower::DataLogFollower(std::string_view filename,
+                                 std::error_code& ec) {
+  m_file = fs::OpenFileForRead(filename, ec);
+  if (ec) {
+    m_file = fs::kInvalidFile;
+    return;
+  }
+#ifdef __linux__
+  m_notify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (m_notify >= 0 &&
+      inotify_add_watch(m_notify, std::string{filename}.c_str(), IN_MODIFY) <
+          0) {
+    ::close(m_notify);
+    m_notify = -1;
+  }
+#endif
+}
+
+DataLogFollower::~DataLogFollower() {
+  if (m_file != fs::kInvalidFile) {
+    fs::CloseFile(m_file);
+  }
+#ifdef __linux__
+  if (m_notify >= 0) {
+    ::close(m_notify);
+  }
+#endif
+}
+
+// appends everything from the current file position to the end of the file
+static void ReadToEnd(fs::file_t f, std::vector<uint8_t>* buf) {
+  if (f == fs::kInvalidFile) {
+    return;
+  }
+  for (;;) {
+    size_t oldSize = buf->size();
+    buf->resize(oldSize + 64 * 1024);
+#ifdef _WIN32
+    DWORD count;
+    if (!ReadFile(f, &(*buf)[oldSize], 64 * 1024, &count, nullptr)) {
+      count = 0;
+    }
+#else
+    ssize_t count;
+    do {
+      count = ::read(f, &(*buf)[oldSize], 64 * 1024);
+    } while (count < 0 && errno == EINTR);
+    if (count < 0) {
+      count = 0;
+    }
+#endif
+    buf->resize(oldSize + count);
+    if (count == 0) {
+      return;
+    }
+  }
+}
+
+bool DataLogFollower::ReadHeader() {
+  if (m_buf.size() < 12) {
+    return false;
+  }
+  if (std::string_view{reinterpret_cast<const char*>(m_buf.data()), 6} !=
+          "WPILOG" ||
+      !IsSupportedVersion(wpi::support::endian::read16le(&m_buf[6]))) {
+    m_invalid = true;
+    return false;
+  }
+  uint32_t extraLen = wpi::support::endian::read32le(&m_buf[8]);
+  if ((m_buf.size() - 12) < extraLen) {
+    return false;
+  }
+  m_extraHeader.assign(m_buf.begin() + 12, m_buf.begin() + 12 + extraLen);
+  m_version = wpi::support::endian::read16le(&m_buf[6]);
+  m_pos = 12 + extraLen;
+  m_buf.erase(m_buf.begin(), m_buf.begin() + m_pos);
+  return true;
+}
+
+size_t DataLogFollower::Poll(
+    wpi::function_ref<void(const DataLogRecord& record)> func) {
+  if (m_invalid) {
+    return 0;
+  }
+  ReadToEnd(m_file, &m_buf);
+  if (!IsValid() && !ReadHeader()) {
+    return 0;
+  }
+
+  // ParseRecord only succeeds for complete records
+  size_t count = 0;
+  size_t pos = 0;
+  DataLogRecord record;
+  while (ParseRecord(m_buf, &pos, &record)) {
+    if (IsCompressedBlock(record)) {
+      DecompressBlock(record.GetRaw(), &m_block);
+      size_t blockPos = 0;
+      DataLogRecord blockRecord;
+      while (ParseRecord(m_block, &blockPos, &blockRecord)) {
+        func(blockRecord);
+        ++count;
+      }
+    } else {
+      func(record);
+      ++count;
+    }
+  }
+  m_buf.erase(m_buf.begin(), m_buf.begin() + pos);
+  m_pos += pos;
+  return count;
+}
+
+size_t DataLogFollower::Wait(
+    double timeout, wpi::function_ref<void(const DataLogRecord& record)> func) {
+  auto end = std::chrono::steady_clock::now() +
+             std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                 std::chrono::duration<double>{timeout});
+  for (;;) {
+    size_t count = Poll(func);
+    auto now = std::chrono::steady_clock::now();
+    if (count > 0 || now >= end) {
+      return count;
+    }
+    auto left =
+        std::chrono::duration_cast<std::chrono::milliseconds>(end - now);
+#ifdef __linux__
+    if (m_notify >= 0) {
+      pollfd pfd{m_notify, POLLIN, 0};
+      if (::poll(&pfd, 1, static_cast<int>(left.count()) + 1) > 0) {
+        // drain the events; only the wakeup matters
+        char events[4096];
+        while (::read(m_notify, events, sizeof(events)) > 0) {
+        }
+      }
+      continue;
+    }
+#endif
+    // the writer flushes every 0.25 seconds by default
+    std::this_thread::sleep_for(
+        (std::min)(left + std::chrono::milliseconds{1},
+                   std::chrono::milliseconds{50}));
+  }
+}
@@ -0,0 +1,748 @@
+// Copyright (c) FIRST and other WPILib contributors.
+// Open Source Software; you can modify and/or share it under the terms of
+// the WPILib BSD license file in the root directory of this project.
+
+#include "wpi/Deflate.h"
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <queue>
+#include <utility>
+
+using namespace wpi;
+
+static constexpr size_t kMaxWindow = 32768;
+static constexpr size_t kMinMatch = 3;
+static constexpr size_t kMaxMatch = 258;
+// 3-byte matches further away than this cost more than literals
+static constexpr size_t kTooFar = 4096;
+static constexpr int kHashBits = 15;
+static constexpr int kMaxChain = 32;
+// tokens per block; each block gets its own Huffman codes
+static constexpr size_t kBlockTokens = 16384;
+static constexpr size_t kMaxStored = 65535;
+// restart stream positions well before they overflow
+static constexpr uint32_t kMaxStreamPos = 0x40000000;
+
+static constexpr int kNumLitLen = 286;
+static constexpr int kNumDist = 30;
+static constexpr int kNumCodeLen = 19;
+static constexpr int kMaxBits = 15;
+static constexpr int kMaxCodeLenBits = 7;
+
+static constexpr uint16_t kLenBase[29] = {
+    3,  4,  5,  6,  7,  8,  9,  10, 11,  13,  15,  17,  19,  23, 27,
+    31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static constexpr uint8_t kLenExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1,
+                                          1, 1, 2, 2, 2, 2, 3, 3, 3, 3,
+                                          4, 4, 4, 4, 5, 5, 5, 5, 0};
+static constexpr uint16_t kDistBase[30] = {
+    1,    2,    3,    4,    5,    7,     9,     13,    17,  25,
+    33,   49,   65,   97,   129,  193,   257,   385,   513, 769,
+    1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+static constexpr uint8_t kDistExtra[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2,  3,  3,  4,  4,  5,  5,  6,
+    6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+// order the code length code lengths are sent in
+static constexpr uint8_t kCodeLenOrder[kNumCodeLen] = {
+    16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+static int LenCode(unsigned int len) {
+  return std::upper_bound(std::begin(kLenBase), std::end(kLenBase), len) -
+         std::begin(kLenBase) - 1;
+}
+
+static int DistCode(unsigned int dist) {
+  return std::upper_bound(std::begin(kDistBase), std::end(kDistBase), dist) -
+         std::begin(kDistBase) - 1;
+}
+
+static uint16_t ReverseBits(unsigned int code, int len) {
+  unsigned int rev = 0;
+  for (int i = 0; i < len; ++i) {
+    rev = (rev << 1) | (code & 1);
+    code >>= 1;
+  }
+  return rev;
+}
+
+// Builds Huffman code lengths limited to maxBits for the given symbol
+// frequencies.  Frequencies are flattened until the lengths fit.
+static void BuildLengths(const uint32_t* freq, int n, int maxBits,
+                         uint8_t* lens) {
+  std::vector<uint32_t> weights(freq, freq + n);
+  std::vector<int> parent(2 * n);
+  for (;;) {
+    // nodes 0 to n-1 are the leaves
+    using Node = std::pair<uint32_t, int>;
+    std::priority_queue<Node, std::vector<Node>, std::greater<>> heap;
+    for (int i = 0; i < n; ++i) {
+      if (weights[i] != 0) {
+        heap.emplace(weights[i], i);
+      }
+    }
+    int next = n;
+    while (heap.size() > 1) {
+      Node a = heap.top();
+      heap.pop();
+      Node b = heap.top();
+      heap.pop();
+      parent[a.second] = next;
+      parent[b.second] = next;
+      heap.emplace(a.first + b.first, next++);
+    }
+
+    int root = heap.empty() ? -1 : heap.top().second;
+    int maxLen = 0;
+    for (int i = 0; i < n; ++i) {
+      int len = 0;
+      if (weights[i] != 0) {
+        for (int node = i; node != root; node = parent[node]) {
+          ++len;
+        }
+        len = (std::max)(len, 1);
+      }
+      lens[i] = len;
+      maxLen = (std::max)(maxLen, len);
+    }
+    if (maxLen <= maxBits) {
+      return;
+    }
+    for (auto&& weight : weights) {
+      if (weight != 0) {
+        weight = (weight + 1) / 2;
+      }
+    }
+  }
+}
+
+// Builds bit-reversed canonical Huffman codes from code lengths.
+static void BuildCodes(const uint8_t* lens, int n, uint16_t* codes) {
+  unsigned int count[kMaxBits + 1] = {};
+  for (int i = 0; i < n; ++i) {
+    ++count[lens[i]];
+  }
+  count[0] = 0;
+  unsigned int next[kMaxBits + 1];
+  unsigned int code = 0;
+  for (int len = 1; len <= kMaxBits; ++len) {
+    code = (code + count[len - 1]) << 1;
+    next[len] = code;
+  }
+  for (int i = 0; i < n; ++i) {
+    if (lens[i] != 0) {
+      codes[i] = ReverseBits(next[lens[i]]++, lens[i]);
+    }
+  }
+}
+
+// A complete code needs at least two symbols; unused symbols are harmless.
+static void EnsureTwoSymbols(uint32_t* freq, int n) {
+  if (std::count_if(freq, freq + n, [](uint32_t f) { return f != 0; }) < 2) {
+    freq[0] = (std::max)(freq[0], 1u);
+    freq[1] = (std::max)(freq[1], 1u);
+  }
+}
+
+namespace {
+
+struct FixedCodes {
+  FixedCodes() {
+    std::fill_n(litLen, 144, 8);
+    std::fill_n(litLen + 144, 112, 9);
+    std::fill_n(litLen + 256, 24, 7);
+    std::fill_n(litLen + 280, 8, 8);
+    std::fill_n(distLen, kNumDist, 5);
+    BuildCodes(litLen, 288, litCode);
+    BuildCodes(distLen, kNumDist, distCode);
+  }
+
+  uint8_t litLen[288];
+  uint16_t litCode[288];
+  uint8_t distLen[kNumDist];
+  uint16_t distCode[kNumDist];
+};
+
+const FixedCodes& GetFixedCodes() {
+  static const FixedCodes codes;
+  return codes;
+}
+
+class BitWriter {
+ public:
+  explicit BitWriter(std::vector<uint8_t>* out) : m_out{out} {}
+
+  void Write(uint32_t bits, int count) {
+    m_buf |= static_cast<uint64_t>(bits) << m_count;
+    m_count += count;
+    while (m_count >= 8) {
+      m_out->push_back(m_buf & 0xff);
+      m_buf >>= 8;
+      m_count -= 8;
+    }
+  }
+
+  void Align() {
+    if (m_count > 0) {
+      Write(0, 8 - m_count);
+    }
+  }
+
+ private:
+  std::vector<uint8_t>* m_out;
+  uint64_t m_buf = 0;
+  int m_count = 0;
+};
+
+}  // namespace
+
+static uint32_t Hash(const uint8_t* p) {
+  uint32_t seq = (p[0] << 16) | (p[1] << 8) | p[2];
+  return (seq * 2654435761u) >> (32 - kHashBits);
+}
+
+DeflateCompressor::DeflateCompressor(int windowBits)
+    : m_windowSize{size_t{1} << std::clamp(windowBits, 8, 15)},
+      m_head(size_t{1} << kHashBits),
+      m_prev(kMaxWindow) {}
+
+void DeflateCompressor::Reset() {
+  // hash chain entries before m_base are ignored
+  m_base += m_buf.size();
+  m_buf.clear();
+}
+
+void DeflateCompressor::Compress(span<const uint8_t> in,
+                                 std::vector<uint8_t>* out) {
+  if (m_base + m_buf.size() + in.size() > kMaxStreamPos) {
+    m_buf.clear();
+    m_base = 0;
+    std::fill(m_head.begin(), m_head.end(), 0);
+  }
+  if (m_buf.size() > kMaxWindow) {
+    size_t drop = m_buf.size() - kMaxWindow;
+    m_buf.erase(m_buf.begin(), m_buf.begin() + drop);
+    m_base += drop;
+  }
+  size_t start = m_buf.size();
+  m_buf.insert(m_buf.end(), in.begin(), in.end());
+
+  // greedy LZ77 parse
+  const uint8_t* buf = m_buf.data();
+  size_t end = m_buf.size();
+  auto insert = [&](size_t i) {
+    uint32_t h = Hash(buf + i);
+    uint32_t next = m_head[h];
+    m_prev[(m_base + i) & (kMaxWindow - 1)] = next;
+    m_head[h] = m_base + i + 1;
+    return next;
+  };
+  m_tokens.clear();
+  size_t i = start;
+  while (i < end) {
+    size_t bestLen = 0;
+    size_t bestDist = 0;
+    if (end - i >= kMinMatch) {
+      uint32_t pos = m_base + i;
+      size_t maxLen = (std::min)(kMaxMatch, end - i);
+      uint32_t next = insert(i);
+      for (int chain = 0; chain < kMaxChain && next != 0; ++chain) {
+        uint32_t cand = next - 1;
+        if (cand < m_base || cand >= pos || pos - cand > m_windowSize) {
+          break;
+        }
+        const uint8_t* p = buf + (cand - m_base);
+        if (p[bestLen] == buf[i + bestLen]) {
+          size_t len = 0;
+          while (len < maxLen && p[len] == buf[i + len]) {
+            ++len;
+          }
+          if (len > bestLen) {
+            bestLen = len;
+            bestDist = pos - cand;
+            if (len == maxLen) {
+              break;
+            }
+          }
+        }
+        next = m_prev[cand & (kMaxWindow - 1)];
+        if (next > cand) {
+          break;  // overwritten by a newer position
+        }
+      }
+    }
+
+    if (bestLen > kMinMatch || (bestLen == kMinMatch && bestDist <= kTooFar)) {
+      m_tokens.push_back(
+          {static_cast<uint16_t>(bestLen), static_cast<uint16_t>(bestDist)});
+      for (size_t j = i + 1; j < i + bestLen && end - j >= kMinMatch; ++j) {
+        insert(j);
+      }
+      i += bestLen;
+    } else {
+      m_tokens.push_back({buf[i], 0});
+      ++i;
+    }
+  }
+
+  WriteBlocks(start, out);
+}
+
+void DeflateCompressor::WriteBlocks(size_t start, std::vector<uint8_t>* out) {
+  const FixedCodes& fixed = GetFixedCodes();
+  BitWriter bits{out};
+  size_t blockStart = start;
+  for (size_t t = 0; t < m_tokens.size(); t += kBlockTokens) {
+    auto tokens = span{m_tokens}.subspan(
+        t, (std::min)(kBlockTokens, m_tokens.size() - t));
+
+    uint32_t litFreq[kNumLitLen] = {};
+    uint32_t distFreq[kNumDist] = {};
+    uint64_t extraBits = 0;
+    size_t rawLen = 0;
+    for (auto&& token : tokens) {
+      if (token.dist == 0) {
+        ++litFreq[token.litlen];
+        ++rawLen;
+      } else {
+        int lc = LenCode(token.litlen);
+        int dc = DistCode(token.dist);
+        ++litFreq[257 + lc];
+        ++distFreq[dc];
+        extraBits += kLenExtra[lc] + kDistExtra[dc];
+        rawLen += token.litlen;
+      }
+    }
+    litFreq[256] = 1;
+
+    // fixed and stored sizes
+    uint64_t fixedBits = 3 + extraBits;
+    for (int s = 0; s < kNumLitLen; ++s) {
+      fixedBits += static_cast<uint64_t>(litFreq[s]) * fixed.litLen[s];
+    }
+    for (int s = 0; s < kNumDist; ++s) {
+      fixedBits += static_cast<uint64_t>(distFreq[s]) * 5;
+    }
+    size_t storedChunks = (rawLen + kMaxStored - 1) / kMaxStored;
+    uint64_t storedBits = storedChunks * (3 + 7 + 32) + rawLen * 8;
+
+    // dynamic codes
+    EnsureTwoSymbols(distFreq, kNumDist);
+    uint8_t litLen[kNumLitLen];
+    uint8_t distLen[kNumDist];
+    BuildLengths(litFreq, kNumLitLen, kMaxBits, litLen);
+    BuildLengths(distFreq, kNumDist, kMaxBits, distLen);
+    int hlit = kNumLitLen;
+    while (hlit > 257 && litLen[hlit - 1] == 0) {
+      --hlit;
+    }
+    int hdist = kNumDist;
+    while (hdist > 1 && distLen[hdist - 1] == 0) {
+      --hdist;
+    }
+
+    // run-length encode the code lengths
+    uint8_t lens[kNumLitLen + kNumDist];
+    std::copy_n(litLen, hlit, lens);
+    std::copy_n(distLen, hdist, lens + hlit);
+    int numLens = hlit + hdist;
+    std::pair<uint8_t, uint8_t> runs[kNumLitLen + kNumDist];  // code, extra
+    int numRuns = 0;
+    for (int j = 0; j < numLens;) {
+      uint8_t len = lens[j];
+      int run = 1;
+      while (j + run < numLens && lens[j + run] == len) {
+        ++run;
+      }
+      j += run;
+      if (len == 0) {
+        while (run >= 11) {
+          int rep = (std::min)(run, 138);
+          runs[numRuns++] = {18, rep - 11};
+          run -= rep;
+        }
+        if (run >= 3) {
+          runs[numRuns++] = {17, run - 3};
+          run = 0;
+        }
+      } else {
+        runs[numRuns++] = {len, 0};
+        --run;
+        while (run >= 3) {
+          int rep = (std::min)(run, 6);
+          runs[numRuns++] = {16, rep - 3};
+          run -= rep;
+        }
+      }
+      for (; run > 0; --run) {
+        runs[numRuns++] = {len, 0};
+      }
+    }
+    uint32_t codeLenFreq[kNumCodeLen] = {};
+    for (int j = 0; j < numRuns; ++j) {
+      ++codeLenFreq[runs[j].first];
+    }
+    EnsureTwoSymbols(codeLenFreq, kNumCodeLen);
+    uint8_t codeLenLen[kNumCodeLen];
+    BuildLengths(codeLenFreq, kNumCodeLen, kMaxCodeLenBits, codeLenLen);
+    int hclen = kNumCodeLen;
+    while (hclen > 4 && codeLenLen[kCodeLenOrder[hclen - 1]] == 0) {
+      --hclen;
+    }
+
+    static constexpr int kRunExtra[3] = {2, 3, 7};
+    uint64_t dynamicBits = 3 + 14 + 3 * hclen + extraBits;
+    for (int j = 0; j < numRuns; ++j) {
+      uint8_t code = runs[j].first;
+      dynamicBits += codeLenLen[code] + (code >= 16 ? kRunExtra[code - 16] : 0);
+    }
+    for (int s = 0; s < kNumLitLen; ++s) {
+      dynamicBits += static_cast<uint64_t>(litFreq[s]) * litLen[s];
+    }
+    for (int s = 0; s < kNumDist; ++s) {
+      dynamicBits += static_cast<uint64_t>(distFreq[s]) * distLen[s];
+    }
+
+    auto writeTokens = [&](const uint8_t* lLen, const uint16_t* lCode,
+                           const uint8_t* dLen, const uint16_t* dCode) {
+      for (auto&& token : tokens) {
+        if (token.dist == 0) {
+          bits.Write(lCode[token.litlen], lLen[token.litlen]);
+        } else {
+          int lc = LenCode(token.litlen);
+          int dc = DistCode(token.dist);
+          bits.Write(lCode[257 + lc], lLen[257 + lc]);
+          bits.Write(token.litlen - kLenBase[lc], kLenExtra[lc]);
+          bits.Write(dCode[dc], dLen[dc]);
+          bits.Write(token.dist - kDistBase[dc], kDistExtra[dc]);
+        }
+      }
+      bits.Write(lCode[256], lLen[256]);
+    };
+
+    if (storedBits <= fixedBits && storedBits <= dynamicBits) {
+      for (size_t pos = blockStart, end = blockStart + rawLen; pos < end;) {
+        size_t len = (std::min)(kMaxStored, end - pos);
+        bits.Write(0, 3);  // BFINAL=0, BTYPE=00
+        bits.Align();
+        bits.Write(len, 16);
+        bits.Write(~len & 0xffff, 16);
+        out->insert(out->end(), m_buf.begin() + pos,
+                    m_buf.begin() + pos + len);
+        pos += len;
+      }
+    } else if (fixedBits <= dynamicBits) {
+      bits.Write(1 << 1, 3);  // BFINAL=0, BTYPE=01
+      writeTokens(fixed.litLen, fixed.litCode, fixed.distLen, fixed.distCode);
+    } else {
+      uint16_t litCode[kNumLitLen];
+      uint16_t distCode[kNumDist];
+      uint16_t codeLenCode[kNumCodeLen];
+      BuildCodes(litLen, kNumLitLen, litCode);
+      BuildCodes(distLen, kNumDist, distCode);
+      BuildCodes(codeLenLen, kNumCodeLen, codeLenCode);
+      bits.Write(2 << 1, 3);  // BFINAL=0, BTYPE=10
+      bits.Write(hlit - 257, 5);
+      bits.Write(hdist - 1, 5);
+      bits.Write(hclen - 4, 4);
+      for (int j = 0; j < hclen; ++j) {
+        bits.Write(codeLenLen[kCodeLenOrder[j]], 3);
+      }
+      for (int j = 0; j < numRuns; ++j) {
+        uint8_t code = runs[j].first;
+        bits.Write(codeLenCode[code], codeLenLen[code]);
+        if (code >= 16) {
+          bits.Write(runs[j].second, kRunExtra[code - 16]);
+        }
+      }
+      writeTokens(litLen, litCode, distLen, distCode);
+    }
+    blockStart += rawLen;
+  }
+
+  // sync flush
+  bits.Write(0, 3);
+  bits.Align();
+  bits.Write(0, 16);
+  bits.Write(0xffff, 16);
+}
+
+namespace {
+
+struct Huffman {
+  uint16_t count[kMaxBits + 1];  // number of codes of each length
+  uint16_t symbol[288];          // symbols ordered by code
+};
+
+// Returns 0 for a complete code, > 0 for an incomplete one, and < 0 for an
+// over-subscribed one.
+int BuildHuffman(Huffman* h, const uint8_t* lens, int n) {
+  std::fill(std::begin(h->count), std::end(h->count), 0);
+  for (int i = 0; i < n; ++i) {
+    ++h->count[lens[i]];
+  }
+  if (h->count[0] == n) {
+    return 0;
+  }
+  int left = 1;
+  for (int len = 1; len <= kMaxBits; ++len) {
+    left <<= 1;
+    left -= h->count[len];
+    if (left < 0) {
+      return left;
+    }
+  }
+  uint16_t offs[kMaxBits + 1];
+  offs[1] = 0;
+  for (int len = 1; len < kMaxBits; ++len) {
+    offs[len + 1] = offs[len] + h->count[len];
+  }
+  for (int i = 0; i < n; ++i) {
+    if (lens[i] != 0) {
+      h->symbol[offs[lens[i]]++] = i;
+    }
+  }
+  return left;
+}
+
+struct FixedHuffman {
+  FixedHuffman() {
+    const FixedCodes& codes = GetFixedCodes();
+    BuildHuffman(&lit, codes.litLen, 288);
+    BuildHuffman(&dist, codes.distLen, kNumDist);
+  }
+
+  Huffman lit;
+  Huffman dist;
+};
+
+class Inflater {
+ public:
+  using Status = DeflateDecompressor::Status;
+
+  Inflater(span<const uint8_t> in, std::vector<uint8_t>& buf, size_t maxSize)
+      : m_in{in}, m_buf{buf}, m_limit{buf.size() + maxSize} {
+    if (m_limit < maxSize) {
+      m_limit = SIZE_MAX;
+    }
+  }
+
+  Status Run();
+
+ private:
+  uint32_t Bits(int count);
+  int Decode(const Huffman& h);
+  Status Stored();
+  Status Dynamic();
+  Status Codes(const Huffman& lit, const Huffman& dist);
+
+  span<const uint8_t> m_in;
+  size_t m_pos = 0;
+  uint32_t m_bitBuf = 0;
+  int m_bitCount = 0;
+  bool m_error = false;  // read past the end of the input
+  std::vector<uint8_t>& m_buf;
+  size_t m_limit;
+};
+
+}  // namespace
+
+uint32_t Inflater::Bits(int count) {
+  while (m_bitCount < count) {
+    if (m_pos == m_in.size()) {
+      m_error = true;
+      return 0;
+    }
+    m_bitBuf |= static_cast<uint32_t>(m_in[m_pos++]) << m_bitCount;
+    m_bitCount += 8;
+  }
+  uint32_t val = m_bitBuf & ((1u << count) - 1);
+  m_bitBuf >>= count;
+  m_bitCount -= count;
+  return val;
+}
+
+int Inflater::Decode(const Huffman& h) {
+  int code = 0;
+  int first = 0;
+  int index = 0;
+  for (int len = 1; len <= kMaxBits; ++len) {
+    code |= Bits(1);
+    int count = h.count[len];
+    if (code - count < first) {
+      return h.symbol[index + (code - first)];
+    }
+    index += count;
+    first += count;
+    first <<= 1;
+    code <<= 1;
+  }
+  return -1;
+}
+
+Inflater::Status Inflater::Run() {
+  static const FixedHuffman fixed;
+  for (;;) {
+    uint32_t last = Bits(1);
+    uint32_t type = Bits(2);
+    if (m_error) {
+      return Status::kInvalid;
+    }
+    Status status;
+    if (type == 0) {
+      status = Stored();
+    } else if (type == 1) {
+      status = Codes(fixed.lit, fixed.dist);
+    } else if (type == 2) {
+      status = Dynamic();
+    } else {
+      return Status::kInvalid;
+    }
+    if (status != Status::kOk || last != 0 || m_pos == m_in.size()) {
+      return status;
+    }
+  }
+}
+
+Inflater::Status Inflater::Stored() {
+  // discard the rest of the current byte
+  m_bitBuf = 0;
+  m_bitCount = 0;
+  if (m_in.size() - m_pos < 4) {
+    return Status::kInvalid;
+  }
+  size_t len = m_in[m_pos] | (m_in[m_pos + 1] << 8);
+  size_t nlen = m_in[m_pos + 2] | (m_in[m_pos + 3] << 8);
+  m_pos += 4;
+  if (len != (~nlen & 0xffff) || m_in.size() - m_pos < len) {
+    return Status::kInvalid;
+  }
+  if (len > m_limit - m_buf.size()) {
+    return Status::kTooLarge;
+  }
+  m_buf.insert(m_buf.end(), m_in.begin() + m_pos, m_in.begin() + m_pos + len);
+  m_pos += len;
+  return Status::kOk;
+}
+
+Inflater::Status Inflater::Dynamic() {
+  int nlen = Bits(5) + 257;
+  int ndist = Bits(5) + 1;
+  int ncode = Bits(4) + 4;
+  if (m_error || nlen > kNumLitLen || ndist > kNumDist) {
+    return Status::kInvalid;
+  }
+
+  uint8_t lens[kNumLitLen + kNumDist] = {};
+  for (int i = 0; i < ncode; ++i) {
+    lens[kCodeLenOrder[i]] = Bits(3);
+  }
+  Huffman lit;
+  Huffman dist;
+  if (BuildHuffman(&lit, lens, kNumCodeLen) != 0) {
+    return Status::kInvalid;  // the code length code must be complete
+  }
+
+  for (int index = 0; index < nlen + ndist;) {
+    int sym = Decode(lit);
+    if (m_error || sym < 0) {
+      return Status::kInvalid;
+    }
+    if (sym < 16) {
+      lens[index++] = sym;
+      continue;
+    }
+    uint8_t len = 0;
+    int rep;
+    if (sym == 16) {
+      if (index == 0) {
+        return Status::kInvalid;
+      }
+      len = lens[index - 1];
+      rep = 3 + Bits(2);
+    } else if (sym == 17) {
+      rep = 3 + Bits(3);
+    } else {
+      rep = 11 + Bits(7);
+    }
+    if (index + rep > nlen + ndist) {
+      return Status::kInvalid;
+    }
+    std::fill_n(lens + index, rep, len);
+    index += rep;
+  }
+  if (m_error || lens[256] == 0) {
+    return Status::kInvalid;
+  }
+
+  // incomplete codes are only allowed if they have a single symbol
+  int err = BuildHuffman(&lit, lens, nlen);
+  if (err < 0 || (err > 0 && nlen - lit.count[0] != 1)) {
+    return Status::kInvalid;
+  }
+  err = BuildHuffman(&dist, lens + nlen, ndist);
+  if (err < 0 || (err > 0 && ndist - dist.count[0] != 1)) {
+    return Status::kInvalid;
+  }
+  return Codes(lit, dist);
+}
+
+Inflater::Status Inflater::Codes(const Huffman& lit, const Huffman& dist) {
+  for (;;) {
+    int sym = Decode(lit);
+    if (m_error || sym < 0) {
+      return Status::kInvalid;
+    }
+    if (sym < 256) {
+      if (m_buf.size() == m_limit) {
+        return Status::kTooLarge;
+      }
+      m_buf.push_back(sym);
+      continue;
+    }
+    if (sym == 256) {
+      return Status::kOk;
+    }
+
+    sym -= 257;
+    if (sym >= 29) {
+      return Status::kInvalid;
+    }
+    size_t len = kLenBase[sym] + Bits(kLenExtra[sym]);
+    int dsym = Decode(dist);
+    if (m_error || dsym < 0 || dsym >= kNumDist) {
+      return Status::kInvalid;
+    }
+    size_t back = kDistBase[dsym] + Bits(kDistExtra[dsym]);
+    if (m_error || back > m_buf.size()) {
+      return Status::kInvalid;
+    }
+    if (len > m_limit - m_buf.size()) {
+      return Status::kTooLarge;
+    }
+    // copy byte by byte, as the source may overlap the destination
+    size_t to = m_buf.size();
+    m_buf.resize(to + len);
+    uint8_t* p = m_buf.data() + to;
+    const uint8_t* from = p - back;
+    for (size_t i = 0; i < len; ++i) {
+      p[i] = from[i];
+    }
+  }
+}
+
+DeflateDecompressor::Status DeflateDecompressor::Decompress(
+    span<const uint8_t> in, std::vector<uint8_t>* out, size_t maxSize) {
+  if (m_buf.size() > kMaxWindow) {
+    m_buf.erase(m_buf.begin(), m_buf.end() - kMaxWindow);
+  }
+  size_t start = m_buf.size();
+  Status status = Inflater{in, m_buf, maxSize}.Run();
+  if (status == kOk) {
+    out->insert(out->end(), m_buf.begin() + start, m_buf.end());
+  } else {
+    m_buf.resize(start);
+  }
+  return status;
+}
@@ -0,0 +1,176 @@
+// Copyright (c) FIRST and other WPILib contributors.
+// Open Source Software; you can modify and/or share it under the terms of
+// the WPILib BSD license file in the root directory of this project.
+
+#include "wpi/LZ4.h"
+
+#include <cstring>
+
+#include "wpi/Endian.h"
+
+using namespace wpi;
+
+static constexpr size_t kMinMatch = 4;
+// the last 5 bytes are always literals
+static constexpr size_t kLastLiterals = 5;
+// the last match must start at least 12 bytes before the end
+static constexpr size_t kMatchFindLimit = 12;
+static constexpr size_t kMaxOffset = 65535;
+static constexpr int kHashLog = 12;
+
+static inline uint32_t Read32(const uint8_t* p) {
+  uint32_t v;
+  std::memcpy(&v, p, 4);
+  return v;
+}
+
+static inline uint32_t Hash(uint32_t seq) {
+  return (seq * 2654435761u) >> (32 - kHashLog);
+}
+
+static void WriteLength(std::vector<uint8_t>* out, size_t len) {
+  while (len >= 255) {
+    out->push_back(255);
+    len -= 255;
+  }
+  out->push_back(len);
+}
+
+static void WriteSequence(std::vector<uint8_t>* out,
+                          span<const uint8_t> literals, size_t offset,
+                          size_t matchLen) {
+  size_t litLen = literals.size();
+  size_t extraMatch = matchLen - kMinMatch;
+  out->push_back(((litLen < 15 ? litLen : 15) << 4) |
+                 (extraMatch < 15 ? extraMatch : 15));
+  if (litLen >= 15) {
+    WriteLength(out, litLen - 15);
+  }
+  out->insert(out->end(), literals.begin(), literals.end());
+  out->push_back(offset & 0xff);
+  out->push_back((offset >> 8) & 0xff);
+  if (extraMatch >= 15) {
+    WriteLength(out, extraMatch - 15);
+  }
+}
+
+void wpi::LZ4Compress(span<const uint8_t> in, std::vector<uint8_t>* out) {
+  out->reserve(out->size() + LZ4CompressBound(in.size()));
+  const uint8_t* data = in.data();
+  size_t size = in.size();
+  size_t anchor = 0;
+
+  if (size > kMatchFindLimit) {
+    uint32_t table[1 << kHashLog];
+    std::memset(table, 0, sizeof(table));
+    size_t matchLimit = size - kLastLiterals;
+    size_t pos = 1;
+    while (pos < size - kMatchFindLimit) {
+      uint32_t seq = Read32(data + pos);
+      uint32_t h = Hash(seq);
+      size_t ref = table[h];
+      table[h] = pos;
+      if ((pos - ref) > kMaxOffset || Read32(data + ref) != seq) {
+        ++pos;
+        continue;
+      }
+
+      // extend backwards over pending literals, then forwards
+      while (pos > anchor && ref > 0 && data[pos - 1] == data[ref - 1]) {
+        --pos;
+        --ref;
+      }
+      size_t len = kMinMatch;
+      while ((pos + len) < matchLimit && data[ref + len] == data[pos + len]) {
+        ++len;
+      }
+
+      WriteSequence(out, in.subspan(anchor, pos - anchor), pos - ref, len);
+      pos += len;
+      anchor = pos;
+      // seed the table with the end of the match to help the next search
+      if (pos < size - kMatchFindLimit) {
+        table[Hash(Read32(data + pos - 2))] = pos - 2;
+      }
+    }
+  }
+
+  // last literals
+  size_t litLen = size - anchor;
+  out->push_back((litLen < 15 ? litLen : 15) << 4);
+  if (litLen >= 15) {
+    WriteLength(out, litLen - 15);
+  }
+  out->insert(out->end(), in.begin() + anchor, in.end());
+}
+
+// returns false if input runs out
+static bool ReadLength(span<const uint8_t> in, size_t* pos, size_t* len) {
+  uint8_t v;
+  do {
+    if (*pos >= in.size()) {
+      return false;
+    }
+    v = in[(*pos)++];
+    *len += v;
+  } while (v == 255);
+  return true;
+}
+
+std::optional<size_t> wpi::LZ4Decompress(span<const uint8_t> in,
+                                         span<uint8_t> out) {
+  size_t inPos = 0;
+  size_t outPos = 0;
+  while (inPos < in.size()) {
+    uint8_t token = in[inPos++];
+
+    // literals
+    size_t litLen = token >> 4;
+    if (litLen == 15 && !ReadLength(in, &inPos, &litLen)) {
+      return {};
+    }
+    if (litLen > (in.size() - inPos) || litLen > (out.size() - outPos)) {
+      return {};
+    }
+    if (litLen > 0) {
+      std::memcpy(out.data() + outPos, in.data() + inPos, litLen);
+    }
+    inPos += litLen;
+    outPos += litLen;
+
+    // the last sequence has no match
+    if (inPos == in.size()) {
+      break;
+    }
+
+    // match
+    if ((in.size() - inPos) < 2) {
+      return {};
+    }
+    size_t offset = support::endian::read16le(in.data() + inPos);
+    inPos += 2;
+    if (offset == 0 || offset > outPos) {
+      return {};
+    }
+    size_t matchLen = token & 0xf;
+    if (matchLen == 15 && !ReadLength(in, &inPos, &matchLen)) {
+      return {};
+    }
+    matchLen += kMinMatch;
+    if (matchLen > (out.size() - outPos)) {
+      return {};
+    }
+    // may overlap, so copy forwards a byte at a time unless it can't
+    uint8_t* dst = out.data() + outPos;
+    const uint8_t* src = dst - offset;
+    if (offset >= matchLen) {
+      std::memcpy(dst, src, matchLen);
+    } else {
+      for (size_t i = 0; i < matchLen; ++i) {
+        dst[i] = src[i];
+      }
+    }
+    outPos += matchLen;
+  }
+  return outPos;
+}
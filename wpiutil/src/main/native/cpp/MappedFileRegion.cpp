@@ -118,6 +118,40 @@ void MappedFileRegion::Unmap() {
   m_mapping = nullptr;
 }
 
+void MappedFileRegion::Advise(uint64_t offset, uint64_t length,
+                              Advice advice) const {
+#ifndef _WIN32
+  if (!m_mapping || offset >= m_size) {
+    return;
+  }
+  if (length > (m_size - offset)) {
+    length = m_size - offset;
+  }
+  int flags = MADV_NORMAL;
+  switch (advice) {
+    case kNormal:
+      flags = MADV_NORMAL;
+      break;
+    case kSequential:
+      flags = MADV_SEQUENTIAL;
+      break;
+    case kRandom:
+      flags = MADV_RANDOM;
+      break;
+    case kWillNeed:
+      flags = MADV_WILLNEED;
+      break;
+    case kDontNeed:
+      flags = MADV_DONTNEED;
+      break;
+  }
+  // the mapping itself is page aligned
+  uint64_t start = offset & ~static_cast<uint64_t>(GetAlignment() - 1);
+  ::madvise(static_cast<uint8_t*>(m_mapping) + start, length + offset - start,
+            flags);
+#endif
+}
+
 size_t MappedFileRegion::GetAlignment() {
 #ifdef _WIN32
   SYSTEM_INFO SysInfo;
@@ -88,6 +88,53 @@ Java_edu_wpi_first_util_datalog_DataLogJNI_resume
   reinterpret_cast<DataLog*>(impl)->Resume();
 }
 
+/*
+ * Class:     edu_wpi_first_util_datalog_DataLogJNI
+ * Method:    setSyncPeriod
+ * Signature: (JD)V
+ */
+JNIEXPORT void JNICALL
+Java_edu_wpi_first_util_datalog_DataLogJNI_setSyncPeriod
+  (JNIEnv*, jclass, jlong impl, jdouble period)
+{
+  if (impl == 0) {
+    return;
+  }
+  reinterpret_cast<DataLog*>(impl)->SetSyncPeriod(period);
+}
+
+/*
+ * Class:     edu_wpi_first_util_datalog_DataLogJNI
+ * Method:    setPreallocation
+ * Signature: (JJ)V
+ */
+JNIEXPORT void JNICALL
+Java_edu_wpi_first_util_datalog_DataLogJNI_setPreallocation
+  (JNIEnv*, jclass, jlong impl, jlong size)
+{
+  if (impl == 0) {
+    return;
+  }
+  reinterpret_cast<DataLog*>(impl)->SetPreallocation(size < 0 ? 0 : size);
+}
+
+/*
+ * Class:     edu_wpi_first_util_datalog_DataLogJNI
+ * Method:    setBufferLimit
+ * Signature: (JJII)V
+ */
+JNIEXPORT void JNICALL
+Java_edu_wpi_first_util_datalog_DataLogJNI_setBufferLimit
+  (JNIEnv*, jclass, jlong impl, jlong size, jint policy, jint decimation)
+{
+  if (impl == 0) {
+    return;
+  }
+  reinterpret_cast<DataLog*>(impl)->SetBufferLimit(
+      size < 0 ? 0 : size, static_cast<DataLog::BufferPolicy>(policy),
+      decimation < 1 ? 1 : decimation);
+}
+
 /*
  * Class:     edu_wpi_first_util_datalog_DataLogJNI
  * Method:    start
@@ -43,6 +43,10 @@ class CallbackListenerData {
 //   bool Matches(const ListenerData& listener, const NotifierData& data);
 //   void SetListener(NotifierData* data, unsigned int listener_uid);
 //   void DoCallback(Callback callback, const NotifierData& data);
+// Derived may also define the following function, which is called with the
+// lock held before the queue is seen as empty, to deliver callbacks it has
+// batched up (unlocking around them):
+//   void FlushCallbacks(std::unique_lock<wpi::mutex>& lock);
 template <typename Derived, typename TUserInfo,
           typename TListenerData =
               CallbackListenerData<std::function<void(const TUserInfo& info)>>,
@@ -67,6 +71,8 @@ class CallbackThread : public wpi::SafeThread {
 
   void Main() override;
 
+  void FlushCallbacks(std::unique_lock<wpi::mutex>&) {}
+
   wpi::UidVector<ListenerData, 64> m_listeners;
 
   std::queue<std::pair<unsigned int, NotifierData>> m_queue;
@@ -170,6 +176,9 @@ void CallbackThread<Derived, TUserInfo, TListenerData, TNotifierData>::Main() {
           }
         }
       }
+      if (m_queue.size() == 1) {
+        static_cast<Derived*>(this)->FlushCallbacks(lock);
+      }
       m_queue.pop();
     }
 
@@ -6,6 +6,7 @@
 
 #include <stdint.h>
 
+#include <atomic>
 #include <functional>
 #include <initializer_list>
 #include <memory>
@@ -31,7 +32,51 @@ namespace impl {
 enum ControlRecordType {
   kControlStart = 0,
   kControlFinish,
-  kControlSetMetadata
+  kControlSetMetadata,
+  kControlCompressedBlock
+};
+
+// Log format versions.  Version 2.0 adds compressed block control records;
+// logs without them are written as version 1.0 so older readers can read them.
+inline constexpr uint16_t kFormatVersion = 0x0100;
+inline constexpr uint16_t kCompressedFormatVersion = 0x0200;
+
+/**
+ * Encoder for packed series records.  Each record holds a sequence of
+ * timestamped 64-bit values.  Timestamps are stored using delta-of-delta
+ * encoding; values are stored either XOR'ed with the previous value (for
+ * floating point) or using delta-of-delta encoding (for integers).  The
+ * record timestamp is the timestamp of the first value.
+ */
+class PackedSeriesEncoder {
+ public:
+  explicit PackedSeriesEncoder(bool xorValues) : m_xor{xorValues} {}
+
+  void Add(int64_t timestamp, uint64_t value);
+
+  uint32_t GetCount() const { return m_count; }
+  int64_t GetFirstTimestamp() const { return m_firstTimestamp; }
+
+  /** Gets the encoded record contents.  Valid until the next Add(). */
+  wpi::span<const uint8_t> GetData();
+
+  void Clear() { m_count = 0; }
+
+ private:
+  void WriteBits(uint64_t value, unsigned int nbits);
+  void WriteDelta(int64_t value);
+
+  bool m_xor;
+  uint32_t m_count = 0;
+  unsigned int m_freeBits = 0;
+  unsigned int m_leading = 0;
+  unsigned int m_trailing = 0;
+  int64_t m_firstTimestamp = 0;
+  int64_t m_prevTimestamp = 0;
+  int64_t m_prevDelta = 0;
+  uint64_t m_prevValue = 0;
+  int64_t m_prevValueDelta = 0;
+  std::vector<uint8_t> m_buf;
 };
 
 }  // namespace impl
@@ -57,14 +102,75 @@ enum ControlRecordType {
  *
  * DataLog calls are thread safe.  DataLog uses a typical multiple-supplier,
  * single-consumer setup.  Writes to the log are atomic, but there is no
- * guaranteed order in the log when multiple threads are writing to it;
- * whichever thread grabs the write mutex first will get written first.
- * For this reason (as well as the fact that timestamps can be set to
- * arbitrary values), records in the log are not guaranteed to be sorted by
- * timestamp.
+ * guaranteed order in the log when multiple threads are writing to it.
+ * Data records are first appended to a per-thread lock-free buffer that is
+ * periodically merged into the log by the writer thread, so records from a
+ * single thread stay in order, but records from different threads may be
+ * interleaved arbitrarily.  For this reason (as well as the fact that
+ * timestamps can be set to arbitrary values), records in the log are not
+ * guaranteed to be sorted by timestamp.
  */
 class DataLog final {
  public:
+  /**
+   * Output statistics, as returned by GetWriteStats().  Times are in
+   * microseconds.  A write or sync is counted as a stall if it takes longer
+   * than kStallTime.
+   */
+  struct WriteStats {
+    /** Total bytes written to the output. */
+    uint64_t bytesWritten = 0;
+    /** Number of batched writes (one per flush). */
+    uint64_t writes = 0;
+    /** Number of syncs to storage (file output only). */
+    uint64_t syncs = 0;
+    /** Number of writes or syncs that took longer than kStallTime. */
+    uint64_t stalls = 0;
+    /** Total time spent writing. */
+    uint64_t writeTime = 0;
+    /** Longest single write. */
+    uint64_t maxWriteTime = 0;
+    /** Total time spent syncing. */
+    uint64_t syncTime = 0;
+    /** Longest single sync. */
+    uint64_t maxSyncTime = 0;
+    /** Bytes currently waiting to be written. */
+    size_t pendingBytes = 0;
+    /** Largest number of bytes written by a single flush. */
+    size_t maxPendingBytes = 0;
+    /** Number of data records discarded due to the buffer limit. */
+    uint64_t droppedRecords = 0;
+    /** Total size of data records discarded due to the buffer limit. */
+    uint64_t droppedBytes = 0;
+  };
+
+  /**
+   * What to do with data records when the buffer limit set by
+   * SetBufferLimit() is reached.  Control records (entry starts, finishes,
+   * and metadata changes) are never discarded.
+   */
+  enum class BufferPolicy {
+    /**
+     * Discard the oldest buffered data records to make room.  Data already
+     * being written is not counted against the limit, so memory use may
+     * reach twice the limit while a write is stalled.
+     */
+    kDropOldest,
+    /** Discard newly appended data records until there is room. */
+    kDropNewest,
+    /**
+     * Keep only every Nth record of each entry once the buffers are half
+     * full, and discard newly appended data records once they are full.
+     */
+    kDecimate
+  };
+
+  /**
+   * Writes or syncs that take longer than this time (in microseconds) are
+   * counted as stalls.
+   */
+  static constexpr uint64_t kStallTime = 100000;
+
   /**
    * Construct a new Data Log.  The log will be initially created with a
    * temporary filename.
@@ -75,9 +181,12 @@ class DataLog final {
    * @param period time between automatic flushes to disk, in seconds;
    *               this is a time/storage tradeoff
    * @param extraHeader extra header data
+   * @param compress true to write a compressed (version 2.0) log; see
+   *                 SetCompression()
    */
   explicit DataLog(std::string_view dir = "", std::string_view filename = "",
-                   double period = 0.25, std::string_view extraHeader = "");
+                   double period = 0.25, std::string_view extraHeader = "",
+                   bool compress = false);
 
   /**
    * Construct a new Data Log.  The log will be initially created with a
@@ -90,10 +199,12 @@ class DataLog final {
    * @param period time between automatic flushes to disk, in seconds;
    *               this is a time/storage tradeoff
    * @param extraHeader extra header data
+   * @param compress true to write a compressed (version 2.0) log; see
+   *                 SetCompression()
    */
   explicit DataLog(wpi::Logger& msglog, std::string_view dir = "",
                    std::string_view filename = "", double period = 0.25,
-                   std::string_view extraHeader = "");
+                   std::string_view extraHeader = "", bool compress = false);
 
   /**
    * Construct a new Data Log that passes its output to the provided function
@@ -105,9 +216,12 @@ class DataLog final {
    * @param period time between automatic calls to write, in seconds;
    *               this is a time/storage tradeoff
    * @param extraHeader extra header data
+   * @param compress true to write a compressed (version 2.0) log; see
+   *                 SetCompression()
    */
   explicit DataLog(std::function<void(wpi::span<const uint8_t> data)> write,
-                   double period = 0.25, std::string_view extraHeader = "");
+                   double period = 0.25, std::string_view extraHeader = "",
+                   bool compress = false);
 
   /**
    * Construct a new Data Log that passes its output to the provided function
@@ -120,10 +234,13 @@ class DataLog final {
    * @param period time between automatic calls to write, in seconds;
    *               this is a time/storage tradeoff
    * @param extraHeader extra header data
+   * @param compress true to write a compressed (version 2.0) log; see
+   *                 SetCompression()
    */
   explicit DataLog(wpi::Logger& msglog,
                    std::function<void(wpi::span<const uint8_t> data)> write,
-                   double period = 0.25, std::string_view extraHeader = "");
+                   double period = 0.25, std::string_view extraHeader = "",
+                   bool compress = false);
 
   ~DataLog();
   DataLog(const DataLog&) = delete;
@@ -155,6 +272,68 @@ class DataLog final {
    */
   void Resume();
 
+  /**
+   * Enables or disables block compression.  When enabled, all records written
+   * by each flush are LZ4 compressed into a single compressed block control
+   * record, which DataLogReader transparently decompresses.  Data that does
+   * not compress is written uncompressed.
+   *
+   * Compressed logs are written as format version 2.0, which readers of
+   * version 1.0 logs reject.  The version is chosen when the log is
+   * constructed (the compress constructor parameter), so this only has an
+   * effect on logs constructed with compression enabled; it takes effect at
+   * the next flush.
+   *
+   * @param enable True to enable compression
+   */
+  void SetCompression(bool enable);
+
+  /**
+   * Sets how often written data is synced to storage (file output only).
+   * Data that has been synced survives a power loss, so the most data that can
+   * be lost is what was appended in the last flush period plus sync period.
+   * The default (0) syncs after every flush.
+   *
+   * @param period minimum time between syncs, in seconds; 0 to sync after
+   *               every flush, negative to only sync when the log is closed
+   */
+  void SetSyncPeriod(double period);
+
+  /**
+   * Sets the amount of file space to preallocate ahead of the written data
+   * (file output only).  Preallocating in large chunks avoids filesystem
+   * allocation (and fragmentation) on every write, which reduces write
+   * stalls on slow media.  The space is allocated without changing the file
+   * size, so the log is always readable, and any unused space is released
+   * when the log is closed.  Only supported on Linux; ignored elsewhere.
+   *
+   * @param size preallocation size in bytes; 0 to disable
+   */
+  void SetPreallocation(size_t size);
+
+  /**
+   * Limits the amount of memory used to buffer data waiting to be written.
+   * Without a limit, buffers grow without bound if the output falls behind
+   * (e.g. during a slow disk period).  The limit applies to the shared
+   * buffers; each appending thread also has a fixed size buffer of its own,
+   * so the limit may be exceeded by up to that amount per thread.
+   *
+   * @param size maximum buffered bytes; 0 (the default) for no limit
+   * @param policy what to do with data records when the limit is reached
+   * @param decimation for BufferPolicy::kDecimate, keep one out of this many
+   *                   records of each entry
+   */
+  void SetBufferLimit(size_t size,
+                      BufferPolicy policy = BufferPolicy::kDropOldest,
+                      unsigned int decimation = 4);
+
+  /**
+   * Gets output statistics.  Useful for detecting slow storage.
+   *
+   * @return Statistics
+   */
+  WriteStats GetWriteStats() const;
+
   /**
    * Start an entry.  Duplicate names are allowed (with the same type), and
    * result in the same index being returned (Start/Finish are reference
@@ -235,31 +414,76 @@ class DataLog final {
   void WriterThreadMain(
       std::function<void(wpi::span<const uint8_t> data)> write);
 
+  class Buffer;
+
+  // returns empty span if the data does not compress
+  static wpi::span<const uint8_t> CompressBlock(
+      wpi::span<const Buffer> bufs, std::vector<uint8_t>* raw,
+      std::vector<uint8_t>* out);
+
+  class ThreadBuffer;
+
+  // lock-free when the calling thread's buffer has space
+  void AppendRecord(int entry, int64_t timestamp,
+                    wpi::span<const wpi::span<const uint8_t>> data);
+  ThreadBuffer* GetThreadBuffer(bool create);
+  // lock-free except when decimating; returns true (and counts the record)
+  // if it should be dropped
+  bool DropRecord(int entry, size_t size);
+
   // must be called with m_mutex held
   uint8_t* StartRecord(uint32_t entry, uint64_t timestamp, uint32_t payloadSize,
                        size_t reserveSize);
   uint8_t* Reserve(size_t size);
   void AppendImpl(wpi::span<const uint8_t> data);
   void AppendStringImpl(std::string_view str);
+  void DrainThreadBuffer(ThreadBuffer& buf);
+  void DrainThreadBuffers();
+  void EnforceBufferLimit();
+  void DropOldest(size_t size);
+  void ReleaseBuffer(Buffer&& buf);
+  // must be called with m_mutex held; returns number of bytes
+  size_t UpdatePendingStats(wpi::span<const Buffer> bufs);
+  void UpdateWriteStats(size_t bytes, uint64_t writeTime);
+  void UpdateSyncStats(uint64_t syncTime);
 
   wpi::Logger& m_msglog;
   mutable wpi::mutex m_mutex;
   wpi::condition_variable m_cond;
   bool m_active{true};
   bool m_doFlush{false};
-  bool m_paused{false};
+  std::atomic_bool m_paused{false};
+  // log was opened as version 2.0
+  const bool m_compressible;
+  std::atomic_bool m_compress;
+  std::atomic<double> m_syncPeriod{0};
+  std::atomic<size_t> m_preallocate{0};
+  std::atomic<size_t> m_bufferLimit{0};
+  std::atomic<BufferPolicy> m_bufferPolicy{BufferPolicy::kDropOldest};
+  std::atomic<unsigned int> m_decimation{4};
+  // bytes in m_outgoing plus bytes being written; updated with m_mutex held
+  std::atomic<size_t> m_bufferedBytes{0};
+  std::atomic<uint64_t> m_droppedRecords{0};
+  std::atomic<uint64_t> m_droppedBytes{0};
   double m_period;
+  WriteStats m_stats;
   std::string m_extraHeader;
   std::string m_newFilename;
-  class Buffer;
   std::vector<Buffer> m_free;
   std::vector<Buffer> m_outgoing;
+  // bytes taken from m_outgoing by the writer and not yet released; these
+  // are included in m_bufferedBytes but can no longer be dropped
+  size_t m_writingBytes = 0;
+  uint64_t m_instance;
+  std::vector<std::shared_ptr<ThreadBuffer>> m_threadBuffers;
   struct EntryInfo {
     std::string type;
     int id{0};
   };
   wpi::StringMap<EntryInfo> m_entries;
   wpi::DenseMap<int, unsigned int> m_entryCounts;
+  // per-entry counters for BufferPolicy::kDecimate
+  wpi::DenseMap<int, unsigned int> m_decimateCounts;
   int m_lastId = 0;
   std::thread m_thread;
 };
@@ -443,6 +667,125 @@ class DoubleLogEntry : public DataLogEntry {
   }
 };
 
+/**
+ * Log double values, packing multiple values into each record.  Timestamps
+ * are delta-of-delta encoded and values are XOR'ed with the previous value
+ * (Gorilla-style), so slowly changing values at a regular rate take only a
+ * few bits per value.  Values are buffered in this object until kMaxValues
+ * values have been appended, Flush() is called, or this object is destroyed.
+ * Use DataLogRecord::GetPackedDoubles() to decode.
+ *
+ * Unlike other log entry types, Append() must not be called concurrently from
+ * multiple threads.
+ */
+class PackedDoubleLogEntry : public DataLogEntry {
+ public:
+  static constexpr std::string_view kDataType = "packed:double";
+  static constexpr uint32_t kMaxValues = 64;
+
+  PackedDoubleLogEntry() = default;
+  PackedDoubleLogEntry(DataLog& log, std::string_view name,
+                       int64_t timestamp = 0)
+      : PackedDoubleLogEntry{log, name, {}, timestamp} {}
+  PackedDoubleLogEntry(DataLog& log, std::string_view name,
+                       std::string_view metadata, int64_t timestamp = 0)
+      : DataLogEntry{log, name, kDataType, metadata, timestamp} {}
+  ~PackedDoubleLogEntry() { Flush(); }
+
+  PackedDoubleLogEntry(PackedDoubleLogEntry&&) = default;
+  PackedDoubleLogEntry& operator=(PackedDoubleLogEntry&& rhs) {
+    Flush();
+    DataLogEntry::operator=(std::move(rhs));
+    m_encoder = std::move(rhs.m_encoder);
+    return *this;
+  }
+
+  /**
+   * Appends a value to the log.
+   *
+   * @param value Value to record
+   * @param timestamp Time stamp (may be 0 to indicate now)
+   */
+  void Append(double value, int64_t timestamp = 0);
+
+  /**
+   * Writes any buffered values to the log as a single record.
+   */
+  void Flush();
+
+  /**
+   * Writes any buffered values, then finishes the entry.
+   *
+   * @param timestamp Time stamp (may be 0 to indicate now)
+   */
+  void Finish(int64_t timestamp = 0) {
+    Flush();
+    DataLogEntry::Finish(timestamp);
+  }
+
+ private:
+  impl::PackedSeriesEncoder m_encoder{true};
+};
+
+/**
+ * Log integer values, packing multiple values into each record.  Timestamps
+ * and values are both delta-of-delta encoded.  Values are buffered in this
+ * object until kMaxValues values have been appended, Flush() is called, or
+ * this object is destroyed.  Use DataLogRecord::GetPackedIntegers() to
+ * decode.
+ *
+ * Unlike other log entry types, Append() must not be called concurrently from
+ * multiple threads.
+ */
+class PackedIntegerLogEntry : public DataLogEntry {
+ public:
+  static constexpr std::string_view kDataType = "packed:int64";
+  static constexpr uint32_t kMaxValues = 64;
+
+  PackedIntegerLogEntry() = default;
+  PackedIntegerLogEntry(DataLog& log, std::string_view name,
+                        int64_t timestamp = 0)
+      : PackedIntegerLogEntry{log, name, {}, timestamp} {}
+  PackedIntegerLogEntry(DataLog& log, std::string_view name,
+                        std::string_view metadata, int64_t timestamp = 0)
+      : DataLogEntry{log, name, kDataType, metadata, timestamp} {}
+  ~PackedIntegerLogEntry() { Flush(); }
+
+  PackedIntegerLogEntry(PackedIntegerLogEntry&&) = default;
+  PackedIntegerLogEntry& operator=(PackedIntegerLogEntry&& rhs) {
+    Flush();
+    DataLogEntry::operator=(std::move(rhs));
+    m_encoder = std::move(rhs.m_encoder);
+    return *this;
+  }
+
+  /**
+   * Appends a value to the log.
+   *
+   * @param value Value to record
+   * @param timestamp Time stamp (may be 0 to indicate now)
+   */
+  void Append(int64_t value, int64_t timestamp = 0);
+
+  /**
+   * Writes any buffered values to the log as a single record.
+   */
+  void Flush();
+
+  /**
+   * Writes any buffered values, then finishes the entry.
+   *
+   * @param timestamp Time stamp (may be 0 to indicate now)
+   */
+  void Finish(int64_t timestamp = 0) {
+    Flush();
+    DataLogEntry::Finish(timestamp);
+  }
+
+ private:
+  impl::PackedSeriesEncoder m_encoder{false};
+};
+
 /**
  * Log string values.
  */
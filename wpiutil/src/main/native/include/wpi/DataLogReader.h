@@ -8,12 +8,32 @@
 
 #include <iterator>
 #include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
 #include <utility>
 #include <vector>
 
 #include "wpi/MemoryBuffer.h"
+#include "wpi/function_ref.h"
 #include "wpi/span.h"
 
+// Duplicated from fs.h to avoid a dependency
+namespace fs {
+#if defined(_WIN32)
+// A Win32 HANDLE is a typedef of void*
+using file_t = void*;
+#else
+using file_t = int;
+#endif
+}  // namespace fs
+
+namespace wpi {
+class MappedFileRegion;
+class raw_istream;
+class raw_ostream;
+}  // namespace wpi
+
 namespace wpi::log {
 
 /**
@@ -47,6 +67,19 @@ struct MetadataRecordData {
   std::string_view metadata;
 };
 
+/**
+ * A single timestamped value decoded from a packed record (see
+ * DataLogRecord::GetPackedDoubles() and DataLogRecord::GetPackedIntegers()).
+ */
+template <typename T>
+struct TimestampedValue {
+  /** Time stamp. */
+  int64_t timestamp;
+
+  /** Value. */
+  T value;
+};
+
 /**
  * A record in the data log. May represent either a control record (entry == 0)
  * or a data record. Used only for reading (e.g. with DataLogReader).
@@ -239,6 +272,28 @@ class DataLogRecord {
    */
   bool GetStringArray(std::vector<std::string_view>* arr) const;
 
+  /**
+   * Decodes a data record as packed doubles (as written by
+   * PackedDoubleLogEntry). Note if the data type (as indicated in the
+   * corresponding start control record for this entry) is not
+   * "packed:double", invalid results may be returned.
+   *
+   * @param[out] arr timestamped values (if successful)
+   * @return True on success, false on error
+   */
+  bool GetPackedDoubles(std::vector<TimestampedValue<double>>* arr) const;
+
+  /**
+   * Decodes a data record as packed integers (as written by
+   * PackedIntegerLogEntry). Note if the data type (as indicated in the
+   * corresponding start control record for this entry) is not
+   * "packed:int64", invalid results may be returned.
+   *
+   * @param[out] arr timestamped values (if successful)
+   * @return True on success, false on error
+   */
+  bool GetPackedIntegers(std::vector<TimestampedValue<int64_t>>* arr) const;
+
  private:
   int64_t m_timestamp{0};
   wpi::span<const uint8_t> m_data;
@@ -247,25 +302,35 @@ class DataLogRecord {
 
 class DataLogReader;
 
-/** DataLogReader iterator. */
+/**
+ * DataLogReader iterator.  Compressed blocks are decompressed as the iterator
+ * enters them, and the decompressed data is shared by copies of the iterator.
+ * Records within a compressed block are only valid while an iterator refers
+ * to that block.
+ */
 class DataLogIterator {
+  friend class DataLogReader;
+
  public:
   using iterator_category = std::forward_iterator_tag;
   using value_type = DataLogRecord;
   using pointer = const value_type*;
   using reference = const value_type&;
 
-  DataLogIterator(const DataLogReader* reader, size_t pos)
-      : m_reader{reader}, m_pos{pos} {}
+  DataLogIterator(const DataLogReader* reader, size_t pos);
 
   bool operator==(const DataLogIterator& oth) const {
-    return m_reader == oth.m_reader && m_pos == oth.m_pos;
+    return m_reader == oth.m_reader && m_pos == oth.m_pos &&
+           m_blockPos == oth.m_blockPos;
   }
   bool operator!=(const DataLogIterator& oth) const {
     return !this->operator==(oth);
   }
 
-  bool operator<(const DataLogIterator& oth) const { return m_pos < oth.m_pos; }
+  bool operator<(const DataLogIterator& oth) const {
+    return m_pos < oth.m_pos ||
+           (m_pos == oth.m_pos && m_blockPos < oth.m_blockPos);
+  }
   bool operator>(const DataLogIterator& oth) const {
     return !this->operator<(oth) && !this->operator==(oth);
   }
@@ -289,8 +354,19 @@ class DataLogIterator {
   pointer operator->() const { return &this->operator*(); }
 
  private:
+  void EnterBlock();
+
   const DataLogReader* m_reader;
+  // position where this iterator started; only windows after this are
+  // released, as earlier ones may be in use by other iterators (e.g. the
+  // ranges returned by DataLogReader::Split())
+  size_t m_start;
+  // position in the log; for records within a compressed block, this is the
+  // position of the block
   size_t m_pos;
+  // position within the decompressed block
+  size_t m_blockPos = 0;
+  std::shared_ptr<const std::vector<uint8_t>> m_block;
   mutable bool m_valid = false;
   mutable DataLogRecord m_value;
 };
@@ -302,9 +378,30 @@ class DataLogReader {
  public:
   using iterator = DataLogIterator;
 
-  /** Constructs from a memory buffer. */
+  /**
+   * Constructs from a memory buffer.  Compressed blocks in the log (see
+   * DataLog::SetCompression()) are decompressed one at a time by iterators as
+   * they reach them, so compressed blocks are never returned by iteration.
+   */
   explicit DataLogReader(std::unique_ptr<MemoryBuffer> buffer);
 
+  /**
+   * Constructs by memory mapping a file.  Unlike reading the file into a
+   * memory buffer, this works for files larger than available memory: the
+   * file is read on demand as records are accessed.  The mapping is hinted
+   * for sequential access, and as iterators advance, the file is read ahead
+   * of them and pages far behind them are released.  Records from released
+   * pages remain valid; they are simply read from the file again.
+   *
+   * @param filename file name
+   * @param ec error code (set on failure to open or map the file)
+   */
+  DataLogReader(std::string_view filename, std::error_code& ec);
+
+  DataLogReader(DataLogReader&&);
+  DataLogReader& operator=(DataLogReader&&);
+  ~DataLogReader();
+
   /** Returns true if the data log is valid (e.g. has a valid header). */
   explicit operator bool() const { return IsValid(); }
 
@@ -341,29 +438,277 @@ class DataLogReader {
   /** Returns end iterator. */
   iterator end() const { return DataLogIterator{this, SIZE_MAX}; }
 
+  /**
+   * Builds the index used by SeekToTime(), GetControlRecords(), and
+   * ForEachEntryRecord().  This requires a full scan of the log, so if not
+   * called explicitly (or loaded with LoadIndex()), it's done on the first call
+   * to one of those functions.  The index is small relative to the log (one
+   * block summary per 32 KB of log data).
+   */
+  void BuildIndex() const;
+
+  /**
+   * Builds the index while calling a function for each record, in log order,
+   * so an application that needs to scan the log anyway can build the index
+   * in the same pass.  If the index is already built, this just calls the
+   * function for each record.  The function must not call other functions of
+   * this reader that use the index.
+   *
+   * @param func function to call for each record; return false to stop (in
+   *             which case the index is not built)
+   */
+  void BuildIndex(
+      wpi::function_ref<bool(const DataLogRecord& record)> func) const;
+
+  /**
+   * Saves the index to a stream, typically a sidecar file next to the log
+   * (e.g. the log filename with ".idx" appended).  Builds the index if
+   * necessary.
+   *
+   * @param os output stream
+   */
+  void SaveIndex(wpi::raw_ostream& os) const;
+
+  /**
+   * Loads an index previously saved with SaveIndex().  The index is rejected
+   * if it doesn't match this log.
+   *
+   * @param data saved index contents
+   * @return True if loaded, false if the index is invalid or doesn't match
+   */
+  bool LoadIndex(wpi::span<const uint8_t> data);
+
+  /**
+   * Splits the log into contiguous ranges of approximately equal size, split
+   * at record boundaries, so the ranges can be processed in parallel.  Each
+   * range ends at the start of the next range (or end() for the last range).
+   * Control records that precede a range can be obtained with
+   * GetControlRecords().
+   *
+   * @param size approximate size (in bytes) of each range
+   * @return Iterators to the start of each range
+   */
+  std::vector<iterator> Split(size_t size) const;
+
+  /**
+   * Finds the first record (in log order) with a timestamp greater than or
+   * equal to the given timestamp.  Records are not guaranteed to be in strict
+   * timestamp order, so later records may still have earlier timestamps.
+   * Entry start and metadata records for the returned position can be
+   * obtained with GetControlRecords().
+   *
+   * @param timestamp timestamp
+   * @return Iterator to record, or end() if no such record
+   */
+  iterator SeekToTime(int64_t timestamp) const;
+
+  /**
+   * Gets all start, finish, and set metadata control records that precede a
+   * position.  Replaying these establishes the set of active entries at that
+   * position without scanning the data records.  The returned records remain
+   * valid until the index is replaced by LoadIndex().
+   *
+   * @param it position (e.g. from SeekToTime())
+   * @return Control records, in log order
+   */
+  std::vector<DataLogRecord> GetControlRecords(const iterator& it) const;
+
+  /**
+   * Calls a function for each data record of a single entry within a
+   * timestamp range, in log order.  Only the parts of the log that contain
+   * that entry are scanned.  Note entry IDs may be reused after the entry is
+   * finished; use GetControlRecords() to determine the range of validity.
+   *
+   * @param entry entry ID
+   * @param start minimum timestamp (inclusive)
+   * @param end maximum timestamp (inclusive)
+   * @param func function to call for each record
+   */
+  void ForEachEntryRecord(
+      int entry, int64_t start, int64_t end,
+      wpi::function_ref<void(const DataLogRecord& record)> func) const;
+
  private:
-  std::unique_ptr<MemoryBuffer> m_buf;
+  struct Index;
 
+  std::unique_ptr<MemoryBuffer> m_buf;
+  std::unique_ptr<Index> m_index;
+  // set if m_buf is a file mapping
+  const MappedFileRegion* m_map = nullptr;
+
+  // read ahead / release window size for mapped files
+  static constexpr size_t kWindowSize = 8 * 1024 * 1024;
+
+  void AdvanceWindow(size_t start, size_t pos) const;
+  const Index& GetIndex() const;
+  void BuildIndexLocked(
+      wpi::function_ref<bool(const DataLogRecord& record)> func) const;
+  size_t GetDataStart() const;
   bool GetRecord(size_t* pos, DataLogRecord* out) const;
   bool GetNextRecord(size_t* pos) const;
 };
 
-inline DataLogIterator& DataLogIterator::operator++() {
-  if (!m_reader->GetNextRecord(&m_pos)) {
-    m_pos = SIZE_MAX;
-  }
-  m_valid = false;
-  return *this;
-}
-
-inline DataLogIterator::reference DataLogIterator::operator*() const {
-  if (!m_valid) {
-    size_t pos = m_pos;
-    if (m_reader->GetRecord(&pos, &m_value)) {
-      m_valid = true;
-    }
-  }
-  return m_value;
-}
+/**
+ * Sequential data log reader for a stream, such as a log that is still being
+ * downloaded.  Only the current record is held in memory.  The header is read
+ * during construction.  Any compressed blocks in the log are transparently
+ * decompressed.
+ */
+class DataLogStreamReader {
+ public:
+  /**
+   * Constructs from an input stream.  The stream must outlive this object.
+   *
+   * @param is input stream, positioned at the start of the log
+   */
+  explicit DataLogStreamReader(wpi::raw_istream& is);
+
+  DataLogStreamReader(const DataLogStreamReader&) = delete;
+  DataLogStreamReader& operator=(const DataLogStreamReader&) = delete;
+
+  /** Returns true if the data log is valid (e.g. has a valid header). */
+  explicit operator bool() const { return IsValid(); }
+
+  /** Returns true if the data log is valid (e.g. has a valid header). */
+  bool IsValid() const { return m_version != 0; }
+
+  /**
+   * Gets the data log version. Returns 0 if data log is invalid.
+   *
+   * @return Version number; most significant byte is major, least significant
+   *         is minor (so version 1.0 will be 0x0100)
+   */
+  uint16_t GetVersion() const { return m_version; }
+
+  /**
+   * Gets the extra header data.
+   *
+   * @return Extra header data
+   */
+  std::string_view GetExtraHeader() const { return m_extraHeader; }
+
+  /**
+   * Reads the next record.  The record data is only valid until the next
+   * call.
+   *
+   * @param record record (output)
+   * @return False at end of stream (or if the log is invalid)
+   */
+  bool ReadRecord(DataLogRecord* record);
+
+  /**
+   * Returns true if the stream ended partway through a record, e.g. because
+   * the log was only partially downloaded.
+   */
+  bool IsTruncated() const { return m_truncated; }
+
+  /**
+   * Gets the number of bytes read from the stream, not counting any partial
+   * record at the end of the stream.
+   */
+  uint64_t GetPosition() const { return m_pos; }
+
+ private:
+  bool Read(size_t len);
+
+  wpi::raw_istream& m_is;
+  uint16_t m_version = 0;
+  std::string m_extraHeader;
+  bool m_done = false;
+  bool m_truncated = false;
+  uint64_t m_pos = 0;
+  std::vector<uint8_t> m_buf;
+  // decompressed block being returned
+  std::vector<uint8_t> m_block;
+  size_t m_blockPos = 0;
+};
+
+/**
+ * Reader that follows a log file as it is written (e.g. by DataLog), like
+ * "tail -f".  Each call to Poll() returns the records appended since the
+ * previous call.  A partially written record at the end of the file is held
+ * back until the rest of it has been written.  The file is kept open, so it
+ * can still be followed if DataLog renames it.  Any compressed blocks in the
+ * log are transparently decompressed.
+ */
+class DataLogFollower {
+ public:
+  /**
+   * Opens a log file.  The header does not need to have been written yet.
+   *
+   * @param filename file name
+   * @param ec error code (set on failure to open the file)
+   */
+  DataLogFollower(std::string_view filename, std::error_code& ec);
+  ~DataLogFollower();
+
+  DataLogFollower(const DataLogFollower&) = delete;
+  DataLogFollower& operator=(const DataLogFollower&) = delete;
+
+  /**
+   * Returns true if a valid header has been read.  This is false until the
+   * writer has written the header.
+   */
+  bool IsValid() const { return m_version != 0; }
+
+  /**
+   * Gets the data log version.  Returns 0 if the header hasn't been read or
+   * is invalid.
+   *
+   * @return Version number; most significant byte is major, least significant
+   *         is minor (so version 1.0 will be 0x0100)
+   */
+  uint16_t GetVersion() const { return m_version; }
+
+  /**
+   * Gets the extra header data.
+   *
+   * @return Extra header data
+   */
+  std::string_view GetExtraHeader() const { return m_extraHeader; }
+
+  /**
+   * Reads any data appended to the file and calls a function for each
+   * complete record.  Does not block.
+   *
+   * @param func function to call for each record; the record is only valid
+   *             during the call
+   * @return Number of records
+   */
+  size_t Poll(wpi::function_ref<void(const DataLogRecord& record)> func);
+
+  /**
+   * Waits for data to be appended to the file (up to a timeout), then reads
+   * it as Poll() does.  Returns as soon as at least one record is available.
+   * On Linux, inotify is used to wait for changes; on other platforms the
+   * file is polled periodically.
+   *
+   * @param timeout maximum time to wait, in seconds
+   * @param func function to call for each record; the record is only valid
+   *             during the call
+   * @return Number of records (0 on timeout)
+   */
+  size_t Wait(double timeout,
+              wpi::function_ref<void(const DataLogRecord& record)> func);
+
+  /**
+   * Gets the number of bytes of the file that have been processed, not
+   * counting any partial record at the end.
+   */
+  uint64_t GetPosition() const { return m_pos; }
+
+ private:
+  bool ReadHeader();
+
+  fs::file_t m_file;
+  int m_notify = -1;
+  uint16_t m_version = 0;
+  bool m_invalid = false;
+  std::string m_extraHeader;
+  uint64_t m_pos = 0;
+  // data read from the file but not yet processed
+  std::vector<uint8_t> m_buf;
+  std::vector<uint8_t> m_block;
+};
 
 }  // namespace wpi::log
@@ -0,0 +1,113 @@
+// Copyright (c) FIRST and other WPILib contributors.
+// Open Source Software; you can modify and/or share it under the terms of
+// the WPILib BSD license file in the root directory of this project.
+
+#ifndef WPIUTIL_WPI_DEFLATE_H_
+#define WPIUTIL_WPI_DEFLATE_H_
+
+#include <stdint.h>
+
+#include <vector>
+
+#include "wpi/span.h"
+
+namespace wpi {
+
+/**
+ * Raw DEFLATE (RFC 1951) compressor, without a zlib or gzip wrapper.  Keeps
+ * a history window across calls, so data can refer back to data passed to
+ * earlier calls ("context takeover" in WebSocket permessage-deflate).
+ *
+ * Uses greedy LZ77 matching with short hash chains, and picks the smallest
+ * of dynamic Huffman, fixed Huffman and stored encoding for each block.
+ */
+class DeflateCompressor {
+ public:
+  /**
+   * Constructs a compressor.
+   *
+   * @param windowBits base-2 logarithm of the history window size (8-15);
+   *                   the decompressor's window must be at least as large
+   */
+  explicit DeflateCompressor(int windowBits = 15);
+
+  /**
+   * Compresses data, ending the output with a sync flush: an empty stored
+   * block, so the output ends byte aligned with 00 00 FF FF.  All data passed
+   * so far can be decompressed from the output so far.
+   *
+   * @param in data to compress
+   * @param out vector to append compressed data to
+   */
+  void Compress(span<const uint8_t> in, std::vector<uint8_t>* out);
+
+  /**
+   * Forgets the history window, so the output of the next Compress() call
+   * doesn't refer back to earlier data.
+   */
+  void Reset();
+
+ private:
+  struct Token {
+    uint16_t litlen;  // literal byte, or match length if dist is nonzero
+    uint16_t dist;
+  };
+
+  void WriteBlocks(size_t start, std::vector<uint8_t>* out);
+
+  size_t m_windowSize;
+  // history followed by the data being compressed; m_buf[0] is at stream
+  // position m_base
+  std::vector<uint8_t> m_buf;
+  uint32_t m_base = 0;
+  // hash chains of stream positions + 1 (0 is none)
+  std::vector<uint32_t> m_head;
+  std::vector<uint32_t> m_prev;
+  std::vector<Token> m_tokens;
+};
+
+/**
+ * Raw DEFLATE (RFC 1951) decompressor.  Keeps the last 32 KB of output
+ * across calls, so input may refer back to earlier output.  All input is
+ * checked, so malformed data will result in an error rather than
+ * out-of-bounds accesses.
+ */
+class DeflateDecompressor {
+ public:
+  /**
+   * Decompression result.
+   */
+  enum Status {
+    /** Success. */
+    kOk,
+    /** Malformed or truncated input. */
+    kInvalid,
+    /** The output would exceed the maximum size. */
+    kTooLarge
+  };
+
+  /**
+   * Decompresses data.  The input must end at a block boundary, e.g. after a
+   * sync flush.  Input following a final block is ignored.
+   *
+   * @param in compressed data
+   * @param out vector to append decompressed data to
+   * @param maxSize maximum number of bytes to append
+   * @return Result
+   */
+  Status Decompress(span<const uint8_t> in, std::vector<uint8_t>* out,
+                    size_t maxSize = SIZE_MAX);
+
+  /**
+   * Forgets earlier output.
+   */
+  void Reset() { m_buf.clear(); }
+
+ private:
+  // earlier output (up to 32 KB) followed by the output of the current call
+  std::vector<uint8_t> m_buf;
+};
+
+}  // namespace wpi
+
+#endif  // WPIUTIL_WPI_DEFLATE_H_
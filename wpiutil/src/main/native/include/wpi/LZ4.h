@@ -0,0 +1,50 @@
+// Copyright (c) FIRST and other WPILib contributors.
+// Open Source Software; you can modify and/or share it under the terms of
+// the WPILib BSD license file in the root directory of this project.
+
+#ifndef WPIUTIL_WPI_LZ4_H_
+#define WPIUTIL_WPI_LZ4_H_
+
+#include <stdint.h>
+
+#include <optional>
+#include <vector>
+
+#include "wpi/span.h"
+
+namespace wpi {
+
+/**
+ * Gets the maximum compressed size of data of a given size.
+ *
+ * @param size uncompressed size
+ * @return Maximum size of the output of LZ4Compress()
+ */
+constexpr size_t LZ4CompressBound(size_t size) {
+  return size + size / 255 + 16;
+}
+
+/**
+ * Compresses data using the LZ4 block format (no frame header or checksum).
+ * This is a fast, single-pass compressor; it is compatible with any LZ4 block
+ * decompressor.
+ *
+ * @param in data to compress
+ * @param out vector to append compressed data to
+ */
+void LZ4Compress(span<const uint8_t> in, std::vector<uint8_t>* out);
+
+/**
+ * Decompresses LZ4 block format data.  All input is checked, so malformed
+ * data will result in an error rather than out-of-bounds accesses.
+ *
+ * @param in compressed data
+ * @param out output buffer; decompression fails if it is too small
+ * @return Number of bytes written to out, or empty on error
+ */
+std::optional<size_t> LZ4Decompress(span<const uint8_t> in,
+                                    span<uint8_t> out);
+
+}  // namespace wpi
+
+#endif  // WPIUTIL_WPI_LZ4_H_
@@ -28,6 +28,14 @@ class MappedFileRegion {
     kPriv        ///< May modify via data, but changes are lost on destruction.
   };
 
+  enum Advice {
+    kNormal,      ///< No special treatment.
+    kSequential,  ///< Accessed in order; read ahead aggressively.
+    kRandom,      ///< Accessed in random order; don't read ahead.
+    kWillNeed,    ///< Will be accessed soon; start reading it in.
+    kDontNeed     ///< Won't be accessed soon; pages may be released.
+  };
+
   MappedFileRegion() = default;
   MappedFileRegion(fs::file_t f, uint64_t length, uint64_t offset,
                    MapMode mapMode, std::error_code& ec);
@@ -64,6 +72,19 @@ class MappedFileRegion {
   void Flush();
   void Unmap();
 
+  /**
+   * Gives the OS a hint about how part of the mapping will be accessed.  The
+   * range is rounded out to page boundaries.  Released (kDontNeed) pages of a
+   * kReadOnly or kReadWrite mapping are read back in from the file if they
+   * are accessed again; changes to released pages of a kPriv mapping are
+   * lost.  Ignored on platforms that don't support it.
+   *
+   * @param offset offset from start of mapping
+   * @param length length of range
+   * @param advice access hint
+   */
+  void Advise(uint64_t offset, uint64_t length, Advice advice) const;
+
   uint64_t size() const { return m_size; }
   uint8_t* data() const { return static_cast<uint8_t*>(m_mapping); }
   const uint8_t* const_data() const {
@@ -0,0 +1,51 @@
+// Copyright (c) FIRST and other WPILib contributors.
+// Open Source Software; you can modify and/or share it under the terms of
+// the WPILib BSD license file in the root directory of this project.
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "fmt/format.h"
+#include "gtest/gtest.h"
+#include "wpi/DataLog.h"
+
+// Benchmark; only runs with --gtest_also_run_disabled_tests.
+TEST(DataLogBench, DISABLED_Append) {
+  using std::chrono::duration_cast;
+  using std::chrono::high_resolution_clock;
+  using std::chrono::nanoseconds;
+
+  constexpr int kCount = 50000;
+
+  for (int numThreads : {1, 4, 8}) {
+    wpi::log::DataLog log{[](auto) {}};
+    std::vector<std::vector<int64_t>> times(numThreads);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < numThreads; ++i) {
+      threads.emplace_back([&log, &out = times[i], i] {
+        wpi::log::DoubleLogEntry entry{log, fmt::format("thread{}", i)};
+        out.reserve(kCount);
+        for (int j = 0; j < kCount; ++j) {
+          auto start = high_resolution_clock::now();
+          entry.Append(j * 0.5, j + 1);
+          auto stop = high_resolution_clock::now();
+          out.push_back(duration_cast<nanoseconds>(stop - start).count());
+        }
+      });
+    }
+    for (auto&& thread : threads) {
+      thread.join();
+    }
+
+    std::vector<int64_t> all;
+    for (auto&& t : times) {
+      all.insert(all.end(), t.begin(), t.end());
+    }
+    std::sort(all.begin(), all.end());
+    fmt::print("DataLog append, {} threads: p50 {} ns p99 {} ns max {} ns\n",
+               numThreads, all[all.size() / 2], all[all.size() * 99 / 100],
+               all.back());
+  }
+}
@@ -0,0 +1,1031 @@
+// Copyright (c) FIRST and other WPILib contributors.
+// Open Source Software; you can modify and/or share it under the terms of
+// the WPILib BSD license file in the root directory of this project.
+
+#include "wpi/DataLog.h"  // NOLINT(build/include_order)
+
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "fmt/format.h"
+#include "gtest/gtest.h"
+#include "wpi/DataLogReader.h"
+#include "wpi/Endian.h"
+#include "wpi/fs.h"
+#include "wpi/raw_istream.h"
+#include "wpi/raw_ostream.h"
+#include "wpi/timestamp.h"
+
+namespace {
+
+class DataLogTest : public ::testing::Test {
+ public:
+  // call after the log is destroyed
+  wpi::log::DataLogReader GetReader() {
+    return wpi::log::DataLogReader{wpi::MemoryBuffer::GetMemBuffer(data)};
+  }
+
+  std::vector<uint8_t> data;
+  std::function<void(wpi::span<const uint8_t>)> write =
+      [this](auto out) { data.insert(data.end(), out.begin(), out.end()); };
+};
+
+}  // namespace
+
+TEST_F(DataLogTest, SimpleInt) {
+  {
+    wpi::log::DataLog log{write};
+    int entry = log.Start("test", "int64");
+    log.AppendInteger(entry, 1, 20);
+  }
+  auto reader = GetReader();
+  ASSERT_TRUE(reader.IsValid());
+  ASSERT_EQ(reader.GetVersion(), 0x0100);
+  auto it = reader.begin();
+  ASSERT_TRUE(it->IsStart());
+  ++it;
+  int64_t val;
+  ASSERT_TRUE(it->GetInteger(&val));
+  ASSERT_EQ(val, 1);
+  ASSERT_EQ(it->GetTimestamp(), 20);
+  ++it;
+  ASSERT_EQ(it, reader.end());
+}
+
+TEST_F(DataLogTest, FinishAfterAppend) {
+  {
+    wpi::log::DataLog log{write};
+    int entry = log.Start("test", "double");
+    log.AppendDouble(entry, 1.5, 10);
+    log.Finish(entry, 20);
+  }
+  auto reader = GetReader();
+  std::vector<wpi::log::DataLogRecord> records;
+  for (auto&& record : reader) {
+    records.push_back(record);
+  }
+  ASSERT_EQ(records.size(), 3u);
+  ASSERT_EQ(records[1].GetTimestamp(), 10);
+  ASSERT_TRUE(records[2].IsFinish());
+}
+
+TEST_F(DataLogTest, MultipleThreads) {
+  constexpr int kThreads = 4;
+  constexpr int kCount = 20000;
+  {
+    wpi::log::DataLog log{write};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < kThreads; ++i) {
+      int entry = log.Start(fmt::format("thread{}", i), "int64");
+      threads.emplace_back([&log, entry] {
+        for (int j = 0; j < kCount; ++j) {
+          log.AppendInteger(entry, j, j + 1);
+        }
+      });
+    }
+    for (auto&& thread : threads) {
+      thread.join();
+    }
+  }
+
+  // every record present, in order per thread
+  std::vector<int64_t> next(kThreads + 1, 0);
+  for (auto&& record : GetReader()) {
+    if (record.IsControl()) {
+      continue;
+    }
+    int64_t val;
+    ASSERT_TRUE(record.GetInteger(&val));
+    ASSERT_EQ(val, next[record.GetEntry()]++);
+  }
+  for (int i = 1; i <= kThreads; ++i) {
+    ASSERT_EQ(next[i], kCount);
+  }
+}
+
+TEST_F(DataLogTest, Compression) {
+  {
+    wpi::log::DataLog log{write, 0.25, "", true};
+    wpi::log::DoubleArrayLogEntry entry{log, "test", 1};
+    for (int i = 0; i < 1000; ++i) {
+      entry.Append({1.0, 2.0, i * 0.5}, i + 10);
+    }
+  }
+  // 1000 records of 24 bytes of data plus header
+  ASSERT_LT(data.size(), 1000u * 24 / 2);
+
+  auto reader = GetReader();
+  ASSERT_EQ(reader.GetVersion(), 0x0200);
+  int count = 0;
+  for (auto&& record : reader) {
+    if (record.IsStart()) {
+      continue;
+    }
+    ASSERT_FALSE(record.IsControl());
+    std::vector<double> arr;
+    ASSERT_TRUE(record.GetDoubleArray(&arr));
+    ASSERT_EQ(arr, (std::vector<double>{1.0, 2.0, count * 0.5}));
+    ASSERT_EQ(record.GetTimestamp(), count + 10);
+    ++count;
+  }
+  ASSERT_EQ(count, 1000);
+}
+
+TEST_F(DataLogTest, CompressionToggle) {
+  // the version is fixed when the log is opened
+  {
+    wpi::log::DataLog log{write};
+    log.SetCompression(true);
+    wpi::log::IntegerLogEntry entry{log, "a", 1};
+    for (int i = 0; i < 1000; ++i) {
+      entry.Append(0, i + 1);
+    }
+  }
+  ASSERT_EQ(GetReader().GetVersion(), 0x0100);
+  ASSERT_GT(data.size(), 1000u * 8);
+
+  // a 2.0 log can have compression switched off
+  data.clear();
+  std::vector<size_t> writes;
+  {
+    wpi::log::DataLog log{[&](auto out) {
+                            writes.push_back(out.size());
+                            write(out);
+                          },
+                          0.25, "", true};
+    log.SetCompression(false);
+    wpi::log::IntegerLogEntry entry{log, "a", 1};
+    for (int i = 0; i < 1000; ++i) {
+      entry.Append(0, i + 1);
+    }
+  }
+  // the header is written when the log is opened
+  ASSERT_EQ(writes.front(), 12u);
+  ASSERT_GT(data.size(), 1000u * 8);
+  auto reader = GetReader();
+  ASSERT_EQ(reader.GetVersion(), 0x0200);
+  int count = 0;
+  for (auto&& record : reader) {
+    if (!record.IsControl()) {
+      ASSERT_EQ(record.GetTimestamp(), ++count);
+    }
+  }
+  ASSERT_EQ(count, 1000);
+}
+
+TEST_F(DataLogTest, UnsupportedVersion) {
+  {
+    wpi::log::DataLog log{write};
+    log.Start("test", "int64");
+  }
+  ASSERT_TRUE(GetReader().IsValid());
+
+  // a future major version must be rejected rather than misread
+  data[7] = 3;
+  ASSERT_FALSE(GetReader().IsValid());
+  wpi::raw_mem_istream is{data};
+  wpi::log::DataLogStreamReader reader{is};
+  ASSERT_FALSE(reader.IsValid());
+}
+
+TEST_F(DataLogTest, PackedDouble) {
+  constexpr int kCount = 1000;
+  std::vector<double> values;
+  for (int i = 0; i < kCount; ++i) {
+    values.push_back(i < 100 ? 1.5 : std::sin(i * 0.01));
+  }
+  values[500] = std::numeric_limits<double>::infinity();
+  values[501] = -0.0;
+  {
+    wpi::log::DataLog log{write};
+    wpi::log::PackedDoubleLogEntry entry{log, "test", 1};
+    for (int i = 0; i < kCount; ++i) {
+      // regular rate with some jitter
+      entry.Append(values[i], 1000 + i * 20000 + (i % 7 == 0 ? 13 : 0));
+    }
+  }
+  // plain double records are 8 bytes of data plus at least 4 of header
+  ASSERT_LT(data.size(), kCount * 12u * 3 / 4);
+
+  int count = 0;
+  for (auto&& record : GetReader()) {
+    if (record.IsControl()) {
+      continue;
+    }
+    std::vector<wpi::log::TimestampedValue<double>> arr;
+    ASSERT_TRUE(record.GetPackedDoubles(&arr));
+    ASSERT_EQ(record.GetTimestamp(), arr.front().timestamp);
+    for (auto&& v : arr) {
+      ASSERT_EQ(v.timestamp, 1000 + count * 20000 + (count % 7 == 0 ? 13 : 0));
+      ASSERT_EQ(std::signbit(v.value), std::signbit(values[count]));
+      ASSERT_EQ(v.value, values[count]);
+      ++count;
+    }
+  }
+  ASSERT_EQ(count, kCount);
+}
+
+TEST_F(DataLogTest, PackedInteger) {
+  std::vector<std::pair<int64_t, int64_t>> values{
+      {1, 5},
+      {2, 6},
+      {3, 7},
+      {5, -100},
+      {6, std::numeric_limits<int64_t>::max()},
+      {7, std::numeric_limits<int64_t>::min()},
+      {1000000000000, 0},
+      {1000000000001, 300000},
+      {1000000000002, 300000}};
+  {
+    wpi::log::DataLog log{write};
+    wpi::log::PackedIntegerLogEntry entry{log, "test", 1};
+    for (auto&& [timestamp, value] : values) {
+      entry.Append(value, timestamp);
+    }
+    entry.Flush();
+    entry.Append(42, 2000000000000);
+  }
+
+  std::vector<wpi::log::TimestampedValue<int64_t>> all;
+  int records = 0;
+  for (auto&& record : GetReader()) {
+    if (record.IsControl()) {
+      continue;
+    }
+    std::vector<wpi::log::TimestampedValue<int64_t>> arr;
+    ASSERT_TRUE(record.GetPackedIntegers(&arr));
+    all.insert(all.end(), arr.begin(), arr.end());
+    ++records;
+  }
+  ASSERT_EQ(records, 2);
+  values.emplace_back(2000000000000, 42);
+  ASSERT_EQ(all.size(), values.size());
+  for (size_t i = 0; i < values.size(); ++i) {
+    ASSERT_EQ(all[i].timestamp, values[i].first);
+    ASSERT_EQ(all[i].value, values[i].second);
+  }
+}
+
+TEST_F(DataLogTest, PackedFinish) {
+  {
+    wpi::log::DataLog log{write};
+    wpi::log::PackedDoubleLogEntry d{log, "d", 1};
+    wpi::log::PackedIntegerLogEntry i{log, "i", 1};
+    d.Append(1.5, 10);
+    i.Append(5, 10);
+    d.Finish(20);
+    i.Finish(20);
+  }
+
+  // buffered values are written before the finish record
+  std::vector<wpi::log::DataLogRecord> records;
+  for (auto&& record : GetReader()) {
+    records.push_back(record);
+  }
+  ASSERT_EQ(records.size(), 6u);
+  std::vector<wpi::log::TimestampedValue<double>> doubles;
+  ASSERT_TRUE(records[2].GetPackedDoubles(&doubles));
+  ASSERT_EQ(doubles.size(), 1u);
+  ASSERT_EQ(doubles[0].value, 1.5);
+  ASSERT_TRUE(records[3].IsFinish());
+  std::vector<wpi::log::TimestampedValue<int64_t>> ints;
+  ASSERT_TRUE(records[4].GetPackedIntegers(&ints));
+  ASSERT_EQ(ints.size(), 1u);
+  ASSERT_EQ(ints[0].value, 5);
+  ASSERT_TRUE(records[5].IsFinish());
+}
+
+TEST_F(DataLogTest, PackedCorrupt) {
+  std::vector<uint8_t> raw{2, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
+  wpi::log::DataLogRecord record{1, 0, raw};
+  std::vector<wpi::log::TimestampedValue<int64_t>> arr;
+  ASSERT_FALSE(record.GetPackedIntegers(&arr));
+  ASSERT_TRUE(arr.empty());
+}
+
+TEST_F(DataLogTest, Index) {
+  constexpr int kCount = 20000;
+  {
+    wpi::log::DataLog log{write};
+    wpi::log::IntegerLogEntry a{log, "a", 1};
+    wpi::log::IntegerLogEntry b{log, "b", 1};
+    for (int i = 0; i < kCount; ++i) {
+      a.Append(i, 100 + i * 10);
+      if (i % 100 == 0) {
+        b.Append(i, 100 + i * 10);
+      }
+    }
+    log.SetMetadata(1, "meta", 200000);
+    b.Finish(200000);
+  }
+  auto reader = GetReader();
+
+  // seek
+  auto it = reader.SeekToTime(100 + 5000 * 10 + 5);
+  ASSERT_NE(it, reader.end());
+  ASSERT_EQ(it->GetTimestamp(), 100 + 5001 * 10);
+  int64_t val;
+  ASSERT_TRUE(it->GetInteger(&val));
+  ASSERT_EQ(val, 5001);
+  ASSERT_EQ(reader.SeekToTime(0), reader.begin());
+  ASSERT_EQ(reader.SeekToTime(300000), reader.end());
+
+  // control records before the seek point are the two starts
+  auto control = reader.GetControlRecords(it);
+  ASSERT_EQ(control.size(), 2u);
+  ASSERT_TRUE(control[0].IsStart());
+  ASSERT_TRUE(control[1].IsStart());
+  ASSERT_EQ(reader.GetControlRecords(reader.end()).size(), 4u);
+
+  // per-entry iteration
+  std::vector<int64_t> values;
+  reader.ForEachEntryRecord(2, 100 + 1000 * 10, 100 + 2000 * 10,
+                            [&](const wpi::log::DataLogRecord& record) {
+                              int64_t v;
+                              ASSERT_TRUE(record.GetInteger(&v));
+                              values.push_back(v);
+                            });
+  ASSERT_EQ(values.size(), 11u);
+  ASSERT_EQ(values.front(), 1000);
+  ASSERT_EQ(values.back(), 2000);
+
+  // save and load
+  std::vector<uint8_t> saved;
+  wpi::raw_uvector_ostream os{saved};
+  reader.SaveIndex(os);
+  auto reader2 = GetReader();
+  ASSERT_TRUE(reader2.LoadIndex(saved));
+  ASSERT_EQ(reader2.SeekToTime(100 + 5000 * 10 + 5)->GetTimestamp(),
+            100 + 5001 * 10);
+  saved[saved.size() - 1] ^= 0xff;
+  auto reader3 = GetReader();
+  ASSERT_FALSE(reader3.LoadIndex(saved));
+  ASSERT_FALSE(reader3.LoadIndex(wpi::span<const uint8_t>{saved}.subspan(1)));
+
+  // rejects out of range or unordered positions and invalid entry IDs
+  saved[saved.size() - 1] ^= 0xff;
+  ASSERT_TRUE(GetReader().LoadIndex(saved));
+  constexpr size_t kBlocksPos = 26;
+  uint32_t numBlocks = wpi::support::endian::read32le(&saved[kBlocksPos]);
+  ASSERT_GT(numBlocks, 1u);
+  size_t controlsPos = kBlocksPos + 4 + numBlocks * 24;
+  uint32_t numControls = wpi::support::endian::read32le(&saved[controlsPos]);
+  ASSERT_EQ(numControls, 4u);
+  size_t entriesPos = controlsPos + 4 + numControls * 20;
+  auto rejectsPos = [&](size_t offset, uint64_t pos) {
+    auto bad = saved;
+    wpi::support::endian::write64le(bad.data() + offset, pos);
+    return !GetReader().LoadIndex(bad);
+  };
+  auto rejectsEntry = [&](size_t offset, uint32_t entry) {
+    auto bad = saved;
+    wpi::support::endian::write32le(bad.data() + offset, entry);
+    return !GetReader().LoadIndex(bad);
+  };
+  ASSERT_TRUE(rejectsPos(kBlocksPos + 4, data.size()));
+  ASSERT_TRUE(rejectsPos(kBlocksPos + 4 + 24, 12));
+  ASSERT_TRUE(rejectsPos(controlsPos + 4, data.size()));
+  ASSERT_TRUE(rejectsPos(controlsPos + 4 + 20, 12));
+  ASSERT_TRUE(rejectsEntry(entriesPos + 4, 0x7fffffff));
+  ASSERT_TRUE(rejectsEntry(entriesPos + 4, 0x80000000));
+
+  // doesn't match a different log
+  data.pop_back();
+  ASSERT_FALSE(GetReader().LoadIndex(saved));
+}
+
+TEST_F(DataLogTest, BuildIndexWithScan) {
+  {
+    wpi::log::DataLog log{write, 0.25, "", true};
+    wpi::log::IntegerLogEntry entry{log, "a", 1};
+    for (int i = 0; i < 1000; ++i) {
+      entry.Append(i, i + 1);
+    }
+  }
+  auto reader = GetReader();
+
+  // stopping early doesn't leave a partial index
+  int count = 0;
+  reader.BuildIndex([&](const wpi::log::DataLogRecord&) {
+    return ++count < 10;
+  });
+  ASSERT_EQ(count, 10);
+
+  // every record is passed to the function, in log order
+  std::vector<int64_t> values;
+  reader.BuildIndex([&](const wpi::log::DataLogRecord& record) {
+    int64_t val;
+    if (!record.IsControl() && record.GetInteger(&val)) {
+      values.push_back(val);
+    }
+    return true;
+  });
+  ASSERT_EQ(values.size(), 1000u);
+  ASSERT_EQ(values.back(), 999);
+  ASSERT_EQ(reader.SeekToTime(500)->GetTimestamp(), 500);
+}
+
+TEST_F(DataLogTest, CompressedIndex) {
+  constexpr int kCount = 20000;
+  {
+    wpi::log::DataLog log{write, 0.25, "", true};
+    wpi::log::IntegerLogEntry a{log, "a", 1};
+    wpi::log::IntegerLogEntry b{log, "b", 1};
+    for (int i = 0; i < kCount; ++i) {
+      a.Append(i, 100 + i * 10);
+      if (i % 100 == 0) {
+        b.Append(i, 100 + i * 10);
+      }
+      if (i % 1000 == 0) {
+        log.Flush();
+      }
+    }
+    log.SetMetadata(1, "meta", 200000);
+    b.Finish(200000);
+  }
+  auto reader = GetReader();
+  ASSERT_EQ(reader.GetVersion(), 0x0200);
+
+  // seek lands within a compressed block, and the record stays valid while
+  // the iterator refers to it
+  auto it = reader.SeekToTime(100 + 5000 * 10 + 5);
+  ASSERT_NE(it, reader.end());
+  ASSERT_EQ(it->GetTimestamp(), 100 + 5001 * 10);
+  int64_t val;
+  ASSERT_TRUE(it->GetInteger(&val));
+  ASSERT_EQ(val, 5001);
+  ASSERT_EQ(reader.SeekToTime(0), reader.begin());
+  ASSERT_EQ(reader.SeekToTime(300000), reader.end());
+  auto next = it;
+  ++next;
+  ASSERT_LT(it, next);
+  ASSERT_TRUE(next->GetInteger(&val));
+  ASSERT_EQ(val, 5002);
+
+  // control records within compressed blocks
+  auto control = reader.GetControlRecords(it);
+  ASSERT_EQ(control.size(), 2u);
+  ASSERT_TRUE(control[0].IsStart());
+  ASSERT_TRUE(control[1].IsStart());
+  auto allControl = reader.GetControlRecords(reader.end());
+  ASSERT_EQ(allControl.size(), 4u);
+  ASSERT_TRUE(allControl[3].IsFinish());
+
+  // per-entry iteration
+  std::vector<int64_t> values;
+  reader.ForEachEntryRecord(2, 100 + 1000 * 10, 100 + 2000 * 10,
+                            [&](const wpi::log::DataLogRecord& record) {
+                              int64_t v;
+                              ASSERT_TRUE(record.GetInteger(&v));
+                              values.push_back(v);
+                            });
+  ASSERT_EQ(values.size(), 11u);
+  ASSERT_EQ(values.front(), 1000);
+  ASSERT_EQ(values.back(), 2000);
+
+  // saved index keeps the control records
+  std::vector<uint8_t> saved;
+  wpi::raw_uvector_ostream os{saved};
+  reader.SaveIndex(os);
+  auto reader2 = GetReader();
+  ASSERT_TRUE(reader2.LoadIndex(saved));
+  control = reader2.GetControlRecords(reader2.end());
+  ASSERT_EQ(control.size(), 4u);
+  wpi::log::MetadataRecordData metadata;
+  ASSERT_TRUE(control[2].GetSetMetadataData(&metadata));
+  ASSERT_EQ(metadata.metadata, "meta");
+
+  // every record, in order
+  int count = 0;
+  for (auto&& record : reader2) {
+    if (!record.IsControl() && record.GetEntry() == 1) {
+      ASSERT_TRUE(record.GetInteger(&val));
+      ASSERT_EQ(val, count++);
+    }
+  }
+  ASSERT_EQ(count, kCount);
+}
+
+TEST_F(DataLogTest, Split) {
+  constexpr int kCount = 50000;
+  {
+    wpi::log::DataLog log{write};
+    wpi::log::IntegerLogEntry entry{log, "a", 1};
+    for (int i = 0; i < kCount; ++i) {
+      entry.Append(i, i + 1);
+    }
+  }
+  auto reader = GetReader();
+  auto ranges = reader.Split(64 * 1024);
+  ASSERT_GT(ranges.size(), 2u);
+  ASSERT_EQ(ranges.front(), reader.begin());
+
+  // every record is in exactly one range, in order
+  int64_t next = 0;
+  for (size_t i = 0; i < ranges.size(); ++i) {
+    auto end = (i + 1) < ranges.size() ? ranges[i + 1] : reader.end();
+    for (auto it = ranges[i]; it != end; ++it) {
+      if (it->IsControl()) {
+        continue;
+      }
+      int64_t val;
+      ASSERT_TRUE(it->GetInteger(&val));
+      ASSERT_EQ(val, next++);
+    }
+  }
+  ASSERT_EQ(next, kCount);
+}
+
+TEST_F(DataLogTest, WriteStats) {
+  wpi::log::DataLog log{write};
+  wpi::log::IntegerLogEntry entry{log, "a", 1};
+  for (int i = 0; i < 1000; ++i) {
+    entry.Append(i, i + 1);
+  }
+  log.Flush();
+  for (int i = 0; i < 100; ++i) {
+    if (log.GetWriteStats().writes > 0) {
+      break;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  auto stats = log.GetWriteStats();
+  ASSERT_GT(stats.writes, 0u);
+  ASSERT_GT(stats.bytesWritten, 1000u);
+  ASSERT_GE(stats.maxPendingBytes, 1000u);
+  ASSERT_EQ(stats.syncs, 0u);
+}
+
+TEST_F(DataLogTest, BufferLimitDropOldest) {
+  wpi::log::DataLog::WriteStats stats;
+  {
+    // long period so nothing is written until the log is destroyed
+    wpi::log::DataLog log{write, 1000};
+    log.SetBufferLimit(64 * 1024);
+    wpi::log::IntegerLogEntry entry{log, "a", 1};
+    for (int i = 0; i < 100000; ++i) {
+      entry.Append(i, i + 1);
+    }
+    log.Flush();
+    for (int i = 0; i < 100; ++i) {
+      if (log.GetWriteStats().writes > 0) {
+        break;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    stats = log.GetWriteStats();
+  }
+  ASSERT_GT(stats.droppedRecords, 0u);
+  ASSERT_LE(stats.maxPendingBytes, 65u * 1024);
+
+  // the start record and the newest records survive
+  int count = 0;
+  int64_t last = -1;
+  for (auto&& record : GetReader()) {
+    if (record.IsStart()) {
+      wpi::log::StartRecordData start;
+      ASSERT_TRUE(record.GetStartData(&start));
+      ASSERT_EQ(start.name, "a");
+    } else if (!record.IsControl()) {
+      int64_t val;
+      ASSERT_TRUE(record.GetInteger(&val));
+      ASSERT_GT(val, last);
+      last = val;
+      ++count;
+    }
+  }
+  ASSERT_EQ(last, 99999);
+  ASSERT_EQ(count + stats.droppedRecords, 100000u);
+}
+
+TEST_F(DataLogTest, BufferLimitDropOldestMultipleEntries) {
+  wpi::log::DataLog::WriteStats stats;
+  {
+    wpi::log::DataLog log{write, 1000};
+    log.SetBufferLimit(64 * 1024);
+    wpi::log::IntegerLogEntry a{log, "a", 1};
+    wpi::log::IntegerLogEntry b{log, "b", 1};
+    for (int i = 0; i < 50000; ++i) {
+      a.Append(i, i + 1);
+      b.Append(-i, i + 1);
+    }
+    log.Flush();
+    for (int i = 0; i < 100; ++i) {
+      if (log.GetWriteStats().writes > 0) {
+        break;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    stats = log.GetWriteStats();
+  }
+  ASSERT_GT(stats.droppedRecords, 0u);
+
+  // both start records and the newest records of each entry survive
+  int entryA = 0;
+  int entryB = 0;
+  int count = 0;
+  int64_t lastA = -1;
+  int64_t lastB = 1;
+  for (auto&& record : GetReader()) {
+    if (record.IsStart()) {
+      wpi::log::StartRecordData start;
+      ASSERT_TRUE(record.GetStartData(&start));
+      (start.name == "a" ? entryA : entryB) = start.entry;
+    } else if (!record.IsControl()) {
+      int64_t val;
+      ASSERT_TRUE(record.GetInteger(&val));
+      if (record.GetEntry() == entryA) {
+        ASSERT_GT(val, lastA);
+        lastA = val;
+      } else {
+        ASSERT_EQ(record.GetEntry(), entryB);
+        ASSERT_LT(val, lastB);
+        lastB = val;
+      }
+      ++count;
+    }
+  }
+  ASSERT_NE(entryA, 0);
+  ASSERT_NE(entryB, 0);
+  ASSERT_EQ(lastA, 49999);
+  ASSERT_EQ(lastB, -49999);
+  ASSERT_EQ(count + stats.droppedRecords, 100000u);
+}
+
+TEST_F(DataLogTest, BufferLimitDropOldestStalledWrite) {
+  std::mutex mutex;
+  std::condition_variable cond;
+  int writes = 0;
+  bool stall = false;
+  bool stalled = false;
+  std::function<void(wpi::span<const uint8_t>)> stallingWrite =
+      [&](auto out) {
+        std::unique_lock lock{mutex};
+        write(out);
+        ++writes;
+        cond.notify_all();
+        if (stall) {
+          stalled = true;
+          cond.notify_all();
+          cond.wait(lock, [&] { return !stall; });
+        }
+      };
+
+  wpi::log::DataLog::WriteStats stats;
+  {
+    wpi::log::DataLog log{stallingWrite, 1000};
+    log.SetBufferLimit(256 * 1024);
+    // flushes until pred is true; a flush request can be missed if the
+    // writer isn't waiting yet
+    auto flushUntil = [&](auto pred) {
+      std::unique_lock lock{mutex};
+      for (int i = 0; i < 1000 && !pred(); ++i) {
+        lock.unlock();
+        log.Flush();
+        lock.lock();
+        cond.wait_for(lock, std::chrono::milliseconds(10), pred);
+      }
+      return pred();
+    };
+    wpi::log::IntegerLogEntry entry{log, "a", 1};
+    // get the header and start record out of the way
+    ASSERT_TRUE(flushUntil([&] { return writes >= 2; }));
+    {
+      std::scoped_lock lock{mutex};
+      stall = true;
+    }
+
+    // roughly 150 KB, all held by the writer while it is stalled
+    for (int i = 0; i < 11000; ++i) {
+      entry.Append(i, i + 1);
+    }
+    ASSERT_TRUE(flushUntil([&] { return stalled; }));
+
+    // another 150 KB; this exceeds the limit only if the bytes being
+    // written are counted
+    for (int i = 11000; i < 22000; ++i) {
+      entry.Append(i, i + 1);
+    }
+    stats = log.GetWriteStats();
+
+    {
+      std::scoped_lock lock{mutex};
+      stall = false;
+    }
+    cond.notify_all();
+  }
+  ASSERT_EQ(stats.droppedRecords, 0u);
+
+  int count = 0;
+  for (auto&& record : GetReader()) {
+    if (!record.IsControl()) {
+      int64_t val;
+      ASSERT_TRUE(record.GetInteger(&val));
+      ASSERT_EQ(val, count);
+      ++count;
+    }
+  }
+  ASSERT_EQ(count, 22000);
+}
+
+TEST_F(DataLogTest, BufferLimitDropNewest) {
+  wpi::log::DataLog::WriteStats stats;
+  {
+    wpi::log::DataLog log{write, 1000};
+    log.SetBufferLimit(64 * 1024,
+                       wpi::log::DataLog::BufferPolicy::kDropNewest);
+    wpi::log::IntegerLogEntry entry{log, "a", 1};
+    for (int i = 0; i < 100000; ++i) {
+      entry.Append(i, i + 1);
+    }
+    log.Flush();
+    for (int i = 0; i < 100; ++i) {
+      if (log.GetWriteStats().writes > 0) {
+        break;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    stats = log.GetWriteStats();
+  }
+  ASSERT_GT(stats.droppedRecords, 0u);
+  ASSERT_EQ(stats.droppedBytes, stats.droppedRecords * 8);
+
+  // the oldest records survive
+  int count = 0;
+  for (auto&& record : GetReader()) {
+    if (!record.IsControl()) {
+      int64_t val;
+      ASSERT_TRUE(record.GetInteger(&val));
+      ASSERT_EQ(val, count);
+      ++count;
+    }
+  }
+  ASSERT_EQ(count + stats.droppedRecords, 100000u);
+}
+
+TEST_F(DataLogTest, BufferLimitDecimate) {
+  wpi::log::DataLog::WriteStats stats;
+  {
+    wpi::log::DataLog log{write, 1000};
+    log.SetBufferLimit(256 * 1024,
+                       wpi::log::DataLog::BufferPolicy::kDecimate, 4);
+    wpi::log::IntegerLogEntry entry{log, "a", 1};
+    for (int i = 0; i < 100000; ++i) {
+      entry.Append(i, i + 1);
+    }
+    log.Flush();
+    for (int i = 0; i < 100; ++i) {
+      if (log.GetWriteStats().writes > 0) {
+        break;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    stats = log.GetWriteStats();
+  }
+  ASSERT_GT(stats.droppedRecords, 0u);
+
+  // once decimation starts, most gaps between kept records are 4
+  int count = 0;
+  int gaps = 0;
+  int64_t last = -1;
+  for (auto&& record : GetReader()) {
+    if (!record.IsControl()) {
+      int64_t val;
+      ASSERT_TRUE(record.GetInteger(&val));
+      ASSERT_GT(val, last);
+      if (val - last == 4) {
+        ++gaps;
+      }
+      last = val;
+      ++count;
+    }
+  }
+  ASSERT_GT(gaps, 0);
+  ASSERT_EQ(count + stats.droppedRecords, 100000u);
+}
+
+TEST_F(DataLogTest, BufferLimitDecimateCollidingEntries) {
+  int a;
+  int b;
+  {
+    wpi::log::DataLog log{write, 1000};
+    log.SetBufferLimit(256 * 1024,
+                       wpi::log::DataLog::BufferPolicy::kDecimate, 2);
+    // entry ids are assigned sequentially, so a and b are 64 apart
+    a = log.Start("a", "int64");
+    for (int i = 0; i < 63; ++i) {
+      log.Start(fmt::format("filler{}", i), "int64");
+    }
+    b = log.Start("b", "int64");
+    ASSERT_EQ(b - a, 64);
+    for (int i = 0; i < 100000; ++i) {
+      log.AppendInteger(a, i, i + 1);
+      log.AppendInteger(b, i, i + 1);
+    }
+  }
+
+  // each entry is decimated on its own, so both keep about the same number
+  int countA = 0;
+  int countB = 0;
+  for (auto&& record : GetReader()) {
+    if (record.GetEntry() == a) {
+      ++countA;
+    } else if (record.GetEntry() == b) {
+      ++countB;
+    }
+  }
+  ASSERT_LT(countA, 100000);
+  ASSERT_NEAR(countA, countB, 2);
+}
+
+TEST_F(DataLogTest, FileOutput) {
+  auto dir = fs::temp_directory_path();
+  std::string filename = fmt::format("datalogtest_{}.wpilog", wpi::Now());
+  wpi::log::DataLog::WriteStats stats;
+  {
+    wpi::log::DataLog log{dir.string(), filename, 0.01};
+    log.SetPreallocation(1024 * 1024);
+    log.SetSyncPeriod(0);
+    wpi::log::IntegerLogEntry entry{log, "a", 1};
+    for (int i = 0; i < 10000; ++i) {
+      entry.Append(i, i + 1);
+    }
+    log.Flush();
+    for (int i = 0; i < 100; ++i) {
+      if (log.GetWriteStats().syncs > 0) {
+        break;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    stats = log.GetWriteStats();
+  }
+  ASSERT_GT(stats.syncs, 0u);
+
+  std::error_code ec;
+  auto path = dir / filename;
+  auto buf = wpi::MemoryBuffer::GetFile(path.string(), ec);
+  ASSERT_FALSE(ec);
+  // preallocated space is not visible in the file
+  ASSERT_EQ(fs::file_size(path), buf->size());
+  wpi::log::DataLogReader reader{std::move(buf)};
+  int64_t next = 0;
+  for (auto&& record : reader) {
+    if (record.IsControl()) {
+      continue;
+    }
+    int64_t val;
+    ASSERT_TRUE(record.GetInteger(&val));
+    ASSERT_EQ(val, next++);
+  }
+  ASSERT_EQ(next, 10000);
+  fs::remove(path, ec);
+}
+
+TEST_F(DataLogTest, MappedFile) {
+  auto dir = fs::temp_directory_path();
+  std::string filename = fmt::format("datalogtest_{}.wpilog", wpi::Now());
+  {
+    wpi::log::DataLog log{dir.string(), filename};
+    wpi::log::IntegerLogEntry entry{log, "a", 1};
+    for (int i = 0; i < 10000; ++i) {
+      entry.Append(i, i + 1);
+    }
+  }
+  auto path = dir / filename;
+  std::error_code ec;
+  wpi::log::DataLogReader reader{path.string(), ec};
+  ASSERT_FALSE(ec);
+  ASSERT_TRUE(reader.IsValid());
+  int count = 0;
+  for (auto&& record : reader) {
+    if (!record.IsControl()) {
+      int64_t val;
+      ASSERT_TRUE(record.GetInteger(&val));
+      ASSERT_EQ(val, count);
+      ++count;
+    }
+  }
+  ASSERT_EQ(count, 10000);
+  fs::remove(path, ec);
+
+  wpi::log::DataLogReader missing{(dir / "nonexistent.wpilog").string(), ec};
+  ASSERT_TRUE(ec);
+  ASSERT_FALSE(missing.IsValid());
+}
+
+TEST_F(DataLogTest, StreamReader) {
+  {
+    wpi::log::DataLog log{write, 0.25, "extra", true};
+    wpi::log::IntegerLogEntry entry{log, "a", 1};
+    for (int i = 0; i < 1000; ++i) {
+      entry.Append(i, i + 1);
+      if (i == 500) {
+        log.Flush();
+      }
+    }
+  }
+
+  // full log
+  {
+    wpi::raw_mem_istream is{data};
+    wpi::log::DataLogStreamReader reader{is};
+    ASSERT_TRUE(reader.IsValid());
+    ASSERT_EQ(reader.GetExtraHeader(), "extra");
+    wpi::log::DataLogRecord record;
+    int count = 0;
+    while (reader.ReadRecord(&record)) {
+      if (!record.IsControl()) {
+        int64_t val;
+        ASSERT_TRUE(record.GetInteger(&val));
+        ASSERT_EQ(val, count);
+        ++count;
+      }
+    }
+    ASSERT_EQ(count, 1000);
+    ASSERT_FALSE(reader.IsTruncated());
+    ASSERT_EQ(reader.GetPosition(), data.size());
+  }
+
+  // partially downloaded log
+  {
+    wpi::raw_mem_istream is{wpi::span{data}.subspan(0, data.size() - 3)};
+    wpi::log::DataLogStreamReader reader{is};
+    ASSERT_TRUE(reader.IsValid());
+    wpi::log::DataLogRecord record;
+    while (reader.ReadRecord(&record)) {
+    }
+    ASSERT_TRUE(reader.IsTruncated());
+    ASSERT_LT(reader.GetPosition(), data.size() - 3);
+  }
+
+  // corrupt record size; only the available data is read
+  {
+    const uint8_t corrupt[] = {'W', 'P', 'I', 'L', 'O', 'G', 0x00, 0x01,
+                               0x00, 0x00, 0x00, 0x00, 0x0c, 0x01, 0xff, 0xff,
+                               0xff, 0xff, 0x00, 0x01, 0x02, 0x03};
+    wpi::raw_mem_istream is{corrupt};
+    wpi::log::DataLogStreamReader reader{is};
+    ASSERT_TRUE(reader.IsValid());
+    wpi::log::DataLogRecord record;
+    ASSERT_FALSE(reader.ReadRecord(&record));
+    ASSERT_TRUE(reader.IsTruncated());
+    ASSERT_EQ(reader.GetPosition(), 12u);
+  }
+}
+
+TEST_F(DataLogTest, Follower) {
+  {
+    wpi::log::DataLog log{write, 0.25, "extra"};
+    wpi::log::IntegerLogEntry entry{log, "a", 1};
+    for (int i = 0; i < 1000; ++i) {
+      entry.Append(i, i + 1);
+    }
+  }
+
+  auto path = fs::temp_directory_path() /
+              fmt::format("datalogtest_{}.wpilog", wpi::Now());
+  std::error_code ec;
+  wpi::raw_fd_ostream os{path.string(), ec};
+  ASSERT_FALSE(ec);
+  wpi::log::DataLogFollower follower{path.string(), ec};
+  ASSERT_FALSE(ec);
+
+  int count = 0;
+  auto check = [&](const wpi::log::DataLogRecord& record) {
+    if (!record.IsControl()) {
+      int64_t val;
+      ASSERT_TRUE(record.GetInteger(&val));
+      ASSERT_EQ(val, count);
+      ++count;
+    }
+  };
+
+  // no header yet
+  ASSERT_EQ(follower.Wait(0.01, check), 0u);
+  ASSERT_FALSE(follower.IsValid());
+
+  // write the first half, ending partway through a record
+  size_t half = data.size() / 2 + 3;
+  os << wpi::span<const uint8_t>{data}.subspan(0, half);
+  os.flush();
+  follower.Poll(check);
+  ASSERT_TRUE(follower.IsValid());
+  ASSERT_EQ(follower.GetExtraHeader(), "extra");
+  ASSERT_GT(count, 0);
+  ASSERT_LT(follower.GetPosition(), half);
+
+  os << wpi::span<const uint8_t>{data}.subspan(half);
+  os.flush();
+  follower.Wait(1, check);
+  ASSERT_EQ(count, 1000);
+  ASSERT_EQ(follower.GetPosition(), data.size());
+
+  os.close();
+  fs::remove(path, ec);
+}
+
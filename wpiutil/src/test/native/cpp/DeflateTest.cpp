@@ -0,0 +1,221 @@
+// Copyright (c) FIRST and other WPILib contributors.
+// Open Source Software; you can modify and/or share it under the terms of
+// the WPILib BSD license file in the root directory of this project.
+
+#include "wpi/Deflate.h"  // NOLINT(build/include_order)
+
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <fmt/format.h>
+
+#include "gtest/gtest.h"
+
+namespace wpi {
+
+static span<const uint8_t> Bytes(std::string_view str) {
+  return {reinterpret_cast<const uint8_t*>(str.data()), str.size()};
+}
+
+static std::vector<uint8_t> RoundTrip(span<const uint8_t> in,
+                                      size_t* compressedSize = nullptr) {
+  DeflateCompressor compressor;
+  std::vector<uint8_t> compressed;
+  compressor.Compress(in, &compressed);
+  if (compressedSize) {
+    *compressedSize = compressed.size();
+  }
+  // sync flush
+  EXPECT_GE(compressed.size(), 4u);
+  EXPECT_EQ(compressed[compressed.size() - 1], 0xff);
+  EXPECT_EQ(compressed[compressed.size() - 2], 0xff);
+  DeflateDecompressor decompressor;
+  std::vector<uint8_t> out;
+  EXPECT_EQ(decompressor.Decompress(compressed, &out),
+            DeflateDecompressor::kOk);
+  return out;
+}
+
+// JSON much like simulation traffic
+static std::string Json(int count) {
+  std::string str;
+  for (int i = 0; i < count; ++i) {
+    str += fmt::format("{{\"name\":\"/SmartDashboard/value{}\",\"value\":{}}}",
+                       i, i * i);
+  }
+  return str;
+}
+
+TEST(DeflateTest, Empty) {
+  std::vector<uint8_t> in;
+  EXPECT_EQ(RoundTrip(in), in);
+}
+
+TEST(DeflateTest, Short) {
+  auto in = Bytes("hello");
+  EXPECT_EQ(RoundTrip(in), std::vector<uint8_t>(in.begin(), in.end()));
+}
+
+TEST(DeflateTest, Repetitive) {
+  std::vector<uint8_t> in;
+  for (int i = 0; i < 100000; ++i) {
+    in.push_back(i % 7);
+  }
+  size_t compressedSize;
+  EXPECT_EQ(RoundTrip(in, &compressedSize), in);
+  EXPECT_LT(compressedSize, in.size() / 100);
+}
+
+TEST(DeflateTest, Json) {
+  auto str = Json(1000);
+  auto in = Bytes(str);
+  size_t compressedSize;
+  EXPECT_EQ(RoundTrip(in, &compressedSize),
+            std::vector<uint8_t>(in.begin(), in.end()));
+  EXPECT_LT(compressedSize, in.size() / 4);
+}
+
+TEST(DeflateTest, Random) {
+  // incompressible data is stored, split into 64 KB blocks
+  std::mt19937 rng{1234};
+  std::uniform_int_distribution<int> dist{0, 255};
+  std::vector<uint8_t> in;
+  for (int i = 0; i < 200000; ++i) {
+    // mix of random runs and repeats
+    if (i < 150000 || i % 1000 < 500) {
+      in.push_back(dist(rng));
+    } else {
+      in.push_back(in[i - 300]);
+    }
+  }
+  size_t compressedSize;
+  EXPECT_EQ(RoundTrip(in, &compressedSize), in);
+  EXPECT_LT(compressedSize, in.size() + 100);
+}
+
+TEST(DeflateTest, ContextTakeover) {
+  auto str = Json(20);
+  DeflateCompressor compressor;
+  DeflateDecompressor decompressor;
+  std::vector<uint8_t> first;
+  compressor.Compress(Bytes(str), &first);
+  std::vector<uint8_t> second;
+  compressor.Compress(Bytes(str), &second);
+  // the second message refers back to the first
+  EXPECT_LT(second.size(), first.size() / 5);
+
+  std::vector<uint8_t> out;
+  ASSERT_EQ(decompressor.Decompress(first, &out), DeflateDecompressor::kOk);
+  ASSERT_EQ(decompressor.Decompress(second, &out), DeflateDecompressor::kOk);
+  EXPECT_EQ(std::string_view(reinterpret_cast<const char*>(out.data()),
+                             out.size()),
+            str + str);
+
+  // after a reset, output can be decompressed on its own
+  compressor.Reset();
+  std::vector<uint8_t> third;
+  compressor.Compress(Bytes(str), &third);
+  EXPECT_EQ(third, first);
+}
+
+TEST(DeflateTest, SmallWindow) {
+  // repeats are 600 bytes apart, beyond a 512 byte window
+  std::mt19937 rng{1234};
+  std::uniform_int_distribution<int> dist{0, 255};
+  std::vector<uint8_t> in;
+  for (int i = 0; i < 600; ++i) {
+    in.push_back(dist(rng));
+  }
+  in.insert(in.end(), in.begin(), in.end());
+
+  for (int windowBits : {9, 15}) {
+    DeflateCompressor compressor{windowBits};
+    std::vector<uint8_t> compressed;
+    compressor.Compress(in, &compressed);
+    if (windowBits == 9) {
+      EXPECT_GT(compressed.size(), in.size());
+    } else {
+      EXPECT_LT(compressed.size(), in.size() / 2 + 100);
+    }
+    DeflateDecompressor decompressor;
+    std::vector<uint8_t> out;
+    ASSERT_EQ(decompressor.Decompress(compressed, &out),
+              DeflateDecompressor::kOk);
+    EXPECT_EQ(out, in);
+  }
+}
+
+TEST(DeflateTest, DecompressFixed) {
+  // zlib output using fixed Huffman codes
+  const uint8_t in[] = {0xca, 0x48, 0xcd, 0xc9, 0xc9, 0x57, 0xc8, 0x40,
+                        0x27, 0x01, 0x00, 0x00, 0x00, 0xff, 0xff};
+  DeflateDecompressor decompressor;
+  std::vector<uint8_t> out;
+  ASSERT_EQ(decompressor.Decompress(in, &out), DeflateDecompressor::kOk);
+  EXPECT_EQ(std::string_view(reinterpret_cast<const char*>(out.data()),
+                             out.size()),
+            "hello hello hello hello");
+}
+
+TEST(DeflateTest, DecompressDynamic) {
+  // zlib output using dynamic Huffman codes
+  const uint8_t in[] = {
+      0x84, 0xd1, 0x31, 0x0e, 0x83, 0x30, 0x0c, 0x05, 0xd0, 0xbb, 0x78, 0x46,
+      0x22, 0x4e, 0x42, 0x4a, 0x32, 0x73, 0x03, 0x4e, 0xe0, 0xaa, 0x48, 0x0c,
+      0x85, 0x4a, 0xb4, 0x65, 0x89, 0xb8, 0x3b, 0x12, 0x8b, 0x3d, 0xf1, 0xb7,
+      0x0c, 0x4f, 0xd6, 0xcf, 0xff, 0x95, 0x56, 0x59, 0x26, 0x2a, 0xd4, 0x8e,
+      0x8b, 0x6c, 0xbf, 0x41, 0xbe, 0xf3, 0xf3, 0x23, 0xdb, 0xab, 0xdd, 0xe5,
+      0xfd, 0x9f, 0x1c, 0x35, 0x74, 0x3d, 0xa8, 0xb8, 0xa3, 0xde, 0x52, 0x56,
+      0xca, 0x80, 0x7a, 0xa5, 0x11, 0xd0, 0xa0, 0x34, 0x03, 0x1a, 0x4d, 0x80,
+      0x04, 0x6c, 0xa7, 0xd6, 0x77, 0xc0, 0x26, 0xb5, 0x01, 0xdd, 0x7d, 0x98,
+      0x9f, 0xa1, 0xbc, 0xbd, 0xda, 0x84, 0x6a, 0xc8, 0x6a, 0x7b, 0xd4, 0x2e,
+      0x9b, 0xd1, 0xd8, 0xc1, 0xd9, 0xec, 0x6e, 0x1e, 0xde, 0x36, 0xd3, 0x71,
+      0x44, 0xa9, 0x39, 0xd8, 0x49, 0x50, 0x1f, 0x6c, 0x07, 0xcc, 0xe9, 0x38,
+      0x01, 0x00, 0x00, 0xff, 0xff};
+  DeflateDecompressor decompressor;
+  std::vector<uint8_t> out;
+  ASSERT_EQ(decompressor.Decompress(in, &out), DeflateDecompressor::kOk);
+  EXPECT_EQ(std::string_view(reinterpret_cast<const char*>(out.data()),
+                             out.size()),
+            Json(15));
+}
+
+TEST(DeflateTest, TooLarge) {
+  std::vector<uint8_t> in(1000, 5);
+  DeflateCompressor compressor;
+  std::vector<uint8_t> compressed;
+  compressor.Compress(in, &compressed);
+  DeflateDecompressor decompressor;
+  std::vector<uint8_t> out;
+  EXPECT_EQ(decompressor.Decompress(compressed, &out, 999),
+            DeflateDecompressor::kTooLarge);
+  EXPECT_TRUE(out.empty());
+  EXPECT_EQ(decompressor.Decompress(compressed, &out, 1000),
+            DeflateDecompressor::kOk);
+}
+
+TEST(DeflateTest, Invalid) {
+  DeflateDecompressor decompressor;
+  std::vector<uint8_t> out;
+  // reserved block type
+  const uint8_t reserved[] = {0x07};
+  EXPECT_EQ(decompressor.Decompress(reserved, &out),
+            DeflateDecompressor::kInvalid);
+  // stored block length mismatch
+  const uint8_t stored[] = {0x00, 0x05, 0x00, 0xfa, 0xfe, 'a'};
+  EXPECT_EQ(decompressor.Decompress(stored, &out),
+            DeflateDecompressor::kInvalid);
+  // truncated
+  const uint8_t truncated[] = {0xca, 0x48, 0xcd, 0xc9};
+  EXPECT_EQ(decompressor.Decompress(truncated, &out),
+            DeflateDecompressor::kInvalid);
+  // fixed code match before the start of the output
+  const uint8_t distance[] = {0x03, 0x02};
+  EXPECT_EQ(decompressor.Decompress(distance, &out),
+            DeflateDecompressor::kInvalid);
+  EXPECT_TRUE(out.empty());
+}
+
+}  // namespace wpi
@@ -0,0 +1,83 @@
+// Copyright (c) FIRST and other WPILib contributors.
+// Open Source Software; you can modify and/or share it under the terms of
+// the WPILib BSD license file in the root directory of this project.
+
+#include "wpi/LZ4.h"  // NOLINT(build/include_order)
+
+#include <random>
+#include <string_view>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace wpi {
+
+static std::vector<uint8_t> RoundTrip(span<const uint8_t> in,
+                                      size_t* compressedSize = nullptr) {
+  std::vector<uint8_t> compressed;
+  LZ4Compress(in, &compressed);
+  EXPECT_LE(compressed.size(), LZ4CompressBound(in.size()));
+  if (compressedSize) {
+    *compressedSize = compressed.size();
+  }
+  std::vector<uint8_t> out(in.size());
+  auto len = LZ4Decompress(compressed, out);
+  EXPECT_TRUE(len);
+  if (len) {
+    EXPECT_EQ(*len, in.size());
+  }
+  return out;
+}
+
+TEST(LZ4Test, Empty) {
+  std::vector<uint8_t> in;
+  EXPECT_EQ(RoundTrip(in), in);
+}
+
+TEST(LZ4Test, Short) {
+  std::string_view str = "hello";
+  std::vector<uint8_t> in{str.begin(), str.end()};
+  EXPECT_EQ(RoundTrip(in), in);
+}
+
+TEST(LZ4Test, Repetitive) {
+  std::vector<uint8_t> in;
+  for (int i = 0; i < 10000; ++i) {
+    in.push_back(i % 7);
+  }
+  size_t compressedSize;
+  EXPECT_EQ(RoundTrip(in, &compressedSize), in);
+  EXPECT_LT(compressedSize, in.size() / 50);
+}
+
+TEST(LZ4Test, Random) {
+  std::mt19937 rng{1234};
+  std::uniform_int_distribution<int> dist{0, 255};
+  std::vector<uint8_t> in;
+  for (int i = 0; i < 100000; ++i) {
+    // mix of random runs and repeats
+    if (i % 1000 < 500) {
+      in.push_back(dist(rng));
+    } else {
+      in.push_back(in[i - 300]);
+    }
+  }
+  EXPECT_EQ(RoundTrip(in), in);
+}
+
+TEST(LZ4Test, OutputTooSmall) {
+  std::vector<uint8_t> in(1000, 5);
+  std::vector<uint8_t> compressed;
+  LZ4Compress(in, &compressed);
+  std::vector<uint8_t> out(999);
+  EXPECT_FALSE(LZ4Decompress(compressed, out));
+}
+
+TEST(LZ4Test, Corrupt) {
+  // match offset before start of output
+  const uint8_t in[] = {0x10, 'a', 0x05, 0x00};
+  std::vector<uint8_t> out(100);
+  EXPECT_FALSE(LZ4Decompress(in, out));
+}
+
+}  // namespace wpi